@@ -27,12 +27,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define __BITSTREAMHANDLER_H__
 
 #include <TypeDefs.h>
+#include <Utilities.h>
 
 /**	
 *	Bitstream handling.
 *	Writes the output bitstream. This bitstream can then be written to a file.
 */
-class BitStreamHandler
+class CACHE_ALIGNED BitStreamHandler
 {
 private:
 	u32					m_uiCurrWord;						//!< Current Word
@@ -46,6 +47,7 @@ private:
 	BitStreamHandler	*m_pcNextBitStreamHandler;			//!< Next bitstream handler (useful for tiles and parallel encoding)
 	BitStreamHandler	*m_pcPrevBitStreamHandler;			//!< Previous bitstream handler (only allocated for slice header encoding with tiling)
 public:
+	CACHE_ALIGNED_NEW
 
 	/**
 	*	Constructor.
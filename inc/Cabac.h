@@ -25,6 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef __CABAC_H__
 #define __CABAC_H__
 
+#include <Utilities.h>
+
 class ImageParameters;
 class BitStreamHandler;
 
@@ -32,7 +34,7 @@ class BitStreamHandler;
 *	Context-Adaptive Binary Arithmetic Coding.
 *	Populates the bitstream with CABAC.
 */
-class Cabac
+class CACHE_ALIGNED Cabac
 {
 private:
 	u32						m_uiLow;							//!< Cabac engine variable
@@ -118,6 +120,7 @@ private:
 	void	WriteCoeffRemainExGolomb(i32 iSymbol, u32 uiParam, BitStreamHandler *& pcBitStreamHanlder);
 
 public:
+	CACHE_ALIGNED_NEW
 
 	/**
 	*	Constructor.
@@ -128,14 +131,30 @@ public:
 
 	/**
 	*	Initialize the CABAC generator.
+	*	@param eCurrSliceType Type of the slice being encoded.
+	*	@param uiQP QP of the slice being encoded.
 	*/
-	void	InitCabac();
+	void	InitCabac(eSliceType eCurrSliceType, u32 uiQP);
 
 	/**
 	*	Reset CABAC.
 	*/
 	void	ResetCabac();
 
+	/**
+	*	Store the context models.
+	*	Used for wavefront parallel processing, where the contexts after the second CTU of a row initialize the next row.
+	*	@param pbContextModels Destination of MAX_NUM_CTX_MOD context models.
+	*/
+	void	StoreContextModels(u8 *pbContextModels);
+
+	/**
+	*	Load the context models.
+	*	@see StoreContextModels()
+	*	@param pbContextModels Source of MAX_NUM_CTX_MOD context models.
+	*/
+	void	LoadContextModels(u8 const *pbContextModels);
+
 	/**
 	*	Encode a value.
 	*	@param uiBinVal Binary value to be encoded.
@@ -155,12 +174,13 @@ public:
 	/**
 	*	Encode quantized coefficients.
 	*	@param piCoeff Input coefficients.
+	*	@param puiSigMap Significance map of the 4x4 groups of the coefficients (see H265Transform::Quant()).
 	*	@param uiSize Size of the block.
 	*	@param uiMode Current encoding mode.
 	*	@param bIsLuma If 1, denotes that current block is luma.
 	*	@param pcBitStreamHandler The bitstream where the output will be written.
 	*/
-	void	EncodeCoeffNxN(i16 *piCoeff, u32 uiSize, u32 uiMode, bit bIsLuma, BitStreamHandler *& pcBitStreamHandler);
+	void	EncodeCoeffNxN(i16 const *piCoeff, u16 const *puiSigMap, u32 uiSize, u32 uiMode, bit bIsLuma, BitStreamHandler *& pcBitStreamHandler);
 
 	/**
 	*	Encode luma intra angular group.
@@ -0,0 +1,135 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file DeadlineGovernor.h
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the DeadlineGovernor class, which chooses the active workers from the frame deadline.
+*/
+
+#ifndef __DEADLINEGOVERNOR_H__
+#define __DEADLINEGOVERNOR_H__
+
+#include <Defines.h>
+#include <TypeDefs.h>
+
+/**
+*	Deadline governor.
+*	Compares the smoothed time per frame with the frame interval and chooses the fewest workers
+*	which still meet the deadline. The time per frame is measured over as many GOPs as are in flight,
+*	since the GOPs compressed concurrently are done at about the same time. A worker is added as soon as the frames take longer than
+*	RT_DEADLINE_HIGH percent of the interval, and removed only if the frames are predicted to take
+*	less than RT_DEADLINE_LOW percent of the interval with one worker less.
+*/
+class DeadlineGovernor
+{
+private:
+	u64						m_u64FrameInterval;		//!< Time between two frames in usec
+	u32						m_uiMinWorkers;			//!< Fewest active workers
+	u32						m_uiMaxWorkers;			//!< Most active workers
+	u32						m_uiActiveWorkers;		//!< Workers chosen for the next GOPs
+	u32						m_uiSettleGOPs;			//!< GOPs measured after a change before the next decision
+	u32						m_uiGOPsToSettle;		//!< GOPs still ignored after the last change
+	u32						m_uiWindowGOPs;			//!< GOPs over which the time per frame is measured, i.e. the GOPs in flight
+	u64						*m_pu64DoneTimes;		//!< Times in usec the last GOPs were done [GOP%m_uiWindowGOPs]
+	u64						m_u64GOPsDone;			//!< GOPs done so far
+	u64						m_u64WindowFrameTime;	//!< Time per frame in usec over the last GOPs in flight (0 if not measured yet)
+	u64						m_u64FrameTime;			//!< Smoothed time per frame in usec (0 if not measured yet)
+	u64						m_u64Frames;			//!< Frames measured so far
+	u64						m_u64LateFrames;		//!< Frames measured over the frame interval
+	u64						m_u64WorkerFrames;		//!< Sum of the active workers over the measured frames
+	u32						m_uiIncreases;			//!< Times a worker was added
+	u32						m_uiDecreases;			//!< Times a worker was removed
+
+public:
+	/**
+	*	Constructor.
+	*	@param iFrameRate Frames per second which must be met.
+	*	@param uiMaxWorkers Total workers, which are all active at the start.
+	*	@param uiGOPsInFlight GOPs compressed concurrently. The time per frame is measured over as many GOPs,
+	*	and after a change, as many GOPs less one are not measured, as they were started before it.
+	*/
+	DeadlineGovernor(i32 iFrameRate, u32 uiMaxWorkers, u32 uiGOPsInFlight);
+	~DeadlineGovernor();
+
+	/**
+	*	Start the measurement, when the first GOPs are submitted.
+	*	@param u64Time Time in usec.
+	*/
+	void					Start(u64 u64Time);
+
+	/**
+	*	Add a GOP which is done and choose the active workers for the next GOPs.
+	*	The GOPs done before all the first GOPs in flight are done are not measured.
+	*	@param u64Time Time in usec the GOP was done.
+	*	@param uiFrames Total frames of the GOP, the same for all the GOPs.
+	*	@return True if the active workers have changed.
+	*/
+	bit						AddGOPDone(u64 u64Time, u32 uiFrames);
+
+	/**
+	*	Get the workers chosen for the next GOPs.
+	*	@return Active workers, including the main thread.
+	*/
+	u32						GetActiveWorkers(){return m_uiActiveWorkers;}
+
+	/**
+	*	Get the smoothed time per frame.
+	*	@return Time in usec.
+	*/
+	u64						GetFrameTime(){return m_u64FrameTime;}
+
+	/**
+	*	Get the time per frame over the last GOPs in flight, without smoothing.
+	*	@return Time in usec (0 if not measured yet).
+	*/
+	u64						GetWindowFrameTime(){return m_u64WindowFrameTime;}
+
+	/**
+	*	Get the frame interval.
+	*	@return Time in usec.
+	*/
+	u64						GetFrameInterval(){return m_u64FrameInterval;}
+
+	/**
+	*	Get the frames measured over the frame interval.
+	*	@return Total late frames.
+	*/
+	u64						GetLateFrames(){return m_u64LateFrames;}
+
+	/**
+	*	Get the average active workers over the measured frames.
+	*	@return Average active workers.
+	*/
+	f64						GetAvgActiveWorkers(){return m_u64Frames ? f64(m_u64WorkerFrames)/f64(m_u64Frames) : f64(m_uiActiveWorkers);}
+
+	/**
+	*	Get the times a worker was added.
+	*	@return Total increases.
+	*/
+	u32						GetIncreases(){return m_uiIncreases;}
+
+	/**
+	*	Get the times a worker was removed.
+	*	@return Total decreases.
+	*/
+	u32						GetDecreases(){return m_uiDecreases;}
+};
+
+#endif	// __DEADLINEGOVERNOR_H__
@@ -32,6 +32,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #elif defined __linux
 #define			CES_H265_OS						"Linux"			//!<	Linux platform
 #endif
+#define			CES_H265_ISA_ENV				"CES265_ISA"	//!<	Environment variable with the highest instruction set of the kernels (see -isa)
 
 // For Debugging
 #define			DEBUG_APP										//!<	Define this to debug the application
@@ -55,14 +56,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define			CTU_HEIGHT							32			//!<	CTU/CU height (make sure it completely divides the frame height)
 #define			MIN_CU_SIZE							4			//!<	Minimum CU width or height
 #define			TOT_PUS_LINE						CTU_WIDTH/MIN_CU_SIZE	//!< Total PUs possible in a row/col of a CTU
-#define			MAX_TILES							24			//!<	Maximum tiles allowed per slice
+#define			MAX_TILE_COLUMNS					20			//!<	Maximum tile columns of any HEVC level (level 6 to 6.2), the level of the resolution may allow less
+#define			MAX_TILE_ROWS						22			//!<	Maximum tile rows of any HEVC level (level 6 to 6.2), the level of the resolution may allow less
+#define			MAX_SLICES_PER_FRAME				600			//!<	Maximum slice segments per picture of any HEVC level (level 6 to 6.2), the level of the resolution may allow less
+#define			SLICE_BYTES_FILL					90			//!<	Share (in %) of the byte budget of a slice which the predicted bytes of its CTU rows may fill
+#define			ADAPTIVE_TILES_MIN_GAIN				5			//!<	Minimum predicted gain (in %) of the slowest tile before the tile layout is changed
+#define			RT_DEADLINE_HIGH					95			//!<	Time per frame (in % of the frame interval) above which a worker is added in the real-time mode
+#define			RT_DEADLINE_LOW						85			//!<	Predicted time per frame (in % of the frame interval) with one worker less, below which a worker is removed
 #define			BYTES_PER_CTU						800			//!<	Total bytes an encoded CTU will presumably take 
 
 // Threads
 #define			USE_THREADS							1			//!<	Multithreading using pthreads will be used
-#define			MAX_GOP_THREADS						2			//!<	Maximum number of GOP threads. Minimum is 1.
-#define			MAX_SLICE_THREADS					4			//!<	Maximum number of Slice threads. Minimum is 1.
-#define			MAX_TILE_THREADS					24			//!<	Maximum number of Tile threads. Minimum is 1.
+#define			WORK_SPIN_MIN_ROUNDS				64			//!<	Fewest rounds a thread looks for a job to steal before it sleeps
+#define			WORK_SPIN_MAX_ROUNDS				8192		//!<	Most rounds a thread looks for a job to steal before it sleeps
+#define			CACHE_LINE_SIZE						64			//!<	Size of a cache line in bytes, the state of different threads is kept on separate lines
+#define			MAX_AFFINITY_CPUS					1024		//!<	Maximum processors in the affinity list of the worker threads
+#define			MAX_TASK_SUCCESSORS					8			//!<	Maximum tasks which can depend upon one task of a task graph
+
+// SIMD
+#define			USE_SIMD							1			//!<	SIMD kernels are chosen from the CPU features at startup (0 for the C kernels only)
+
+// Tracing
+#define			TRACE_LEVEL_OFF						0			//!<	No trace messages
+#define			TRACE_LEVEL_VERBOSE					1			//!<	Messages per GOP, slice, tile and CTU (see --ver)
+#define			TRACE_LEVEL_DEBUG					2			//!<	Messages per job of the worker threads
+#define			TRACE_LEVEL							TRACE_LEVEL_DEBUG	//!<	Highest trace level compiled in, the rest is removed by the compiler
+#define			TRACE_RING_SIZE						1024		//!<	Trace messages buffered per thread (must be a power of 2)
+#define			TRACE_MSG_LEN						120			//!<	Maximum length of a trace message, longer ones are truncated
+#define			TRACE_FLUSH_PERIOD					20			//!<	Period in msec at which the trace messages are written out
 
 // Intra modes
 #define			TOTAL_INTRA_MODES					36			//!<	Total number of intra modes available
@@ -75,6 +96,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define			CHROMA_DM_MODE						4			//!<	Location of the chroma DM mode
 #define			CHROMA_LM_MODE						5			//!<	Index for the intra chroam LM mode
 #define			CHROMA_DM_MODE_IDX					36			//!<	Index for the intra chroma DM mode
+#define			SATD_MODE_COST_WEIGHT				4.0			//!<	Weight of the bits of a luma mode with the SATD (see --satd), which also stands for the bits of the splits and the residue
 #define			USE_CHROMA_LM_MODE					0			//!<	To use chroma LM mode or not (this should be set to 0 if the main profile is used, see A.3.2 in the draft). DON'T USE THIS AS IT IS INCOMPLETE
 
 // Quantization
@@ -157,6 +179,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define 		INIT_FRAME_RATE 					30
 #define			INIT_QP								32
 #define			INIT_GOP_SIZE						1
+#define			INIT_IO_DEPTH						2			//!<	GOPs the reader thread reads ahead of the compression
 #define			PSNR_NUMERATOR						65025.0		//!<	For image values between [0,255] inclusive
 
 #endif
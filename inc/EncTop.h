@@ -26,7 +26,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef __ENCTOP_H__
 #define	__ENCTOP_H__
 
+#include <Defines.h>
 #include <TypeDefs.h>
+#include <ImageParameters.h>
+#include <Utilities.h>
+#include <pthread.h>
 #include <iostream>
 #include <fstream>
 
@@ -35,6 +39,30 @@ class ImageParameters;
 class BitStreamHandler;
 class H265GOPCompressor;
 class WorkQueue;
+class WorkItem;
+class ThreadHandler;
+class TileBalancer;
+class SliceBalancer;
+class DeadlineGovernor;
+
+/**
+*	GOP job arguments.
+*	Use this structure to feed the work-queue with GOP jobs for multi-threading.
+*	The pending counter is the job group of the GOP, it drops to zero when the GOP is compressed.
+*/
+typedef struct CACHE_ALIGNED _GOPJobArgs
+{
+	CACHE_ALIGNED_NEW
+
+	i32					iNum;
+	u32					uiStartSliceNum;
+	SliceParams_t		sSliceParams;
+	byte				**ppbYBuff;
+	byte				**ppbCbBuff;
+	byte				**ppbCrBuff;
+	H265GOPCompressor	*pcGOPCompressor;
+	volatile i64		i64Pending;
+}GOPJobArgs_t;
 
 using namespace std;
 
@@ -49,9 +77,10 @@ private:
 	InputParameters		*m_pcInputParam;								//!<	 Input parameters class
 	ImageParameters		*m_pcImageParam;								//!<	 Image parameters class
 	i8					**m_ppcInputArgs;								//!<	 Input arguments to the encoder
-	byte				***m_pppcYBuff;									//!<	 Contains luma pixels [GOP number][Slice number][ptr]
-	byte				***m_pppcCbBuff;								//!<	 Contains CB pixels [GOP number][Slice number][ptr]
-	byte				***m_pppcCrBuff;								//!<	 Contains CR pixels [GOP number][Slice number][ptr]
+	byte				***m_pppcYBuff;									//!<	 Contains luma pixels [GOP buffer][Slice number][ptr]
+	byte				***m_pppcCbBuff;								//!<	 Contains CB pixels [GOP buffer][Slice number][ptr]
+	byte				***m_pppcCrBuff;								//!<	 Contains CR pixels [GOP buffer][Slice number][ptr]
+	u32					m_uiNumGOPBuffs;								//!<	 GOP buffers, one per GOP in flight and one per GOP read ahead
 	BitStreamHandler	****m_ppppcStreamHandler;						//!<	 Handles the full bitstream and its related variables [GOP number][Slice number][Tile][ptr]
 	H265GOPCompressor	**m_ppcH265GOPCompressor;						//!<	 Compressor functions [GOP number][ptr]
 	ifstream			m_ifsYUVFile;									//!<	 Input YUV file
@@ -60,11 +89,30 @@ private:
 	ofstream			m_ofsStats;										//!<	 Output file for storing statistics
 	u64					m_u64CurrFrameNum;								//!<	 Current frame number under process
 	bit					m_bOutputRec;									//!<	 Output reconstructed frames
-	u32					m_uiTotalCores;									//!<	 Total cores available for processing
+	u32					m_uiTotalCores;									//!<	 Total cores available for processing (online, allowed by the affinity mask and the CPU quota)
 	bit					m_bStats;										//!<	 Output statistics are generated
 	f32					*m_pfPSNRPerFrame[3];							//!<	 PSNR per frame for Y, Cb, Cr
 	u64					*m_pu64BytesPerFrame;							//!<	 Keeps the total bytes per frame
 	u64					m_u64CurrGOPBytes;								//!<	 Keeps the total bytes for the current GOP
+	GOPJobArgs_t		**m_ppcGOPJobArgs;								//!<	 Arguments for the GOP thread function [GOP number][ptr]
+	WorkQueue			*m_pcWorkQueue;									//!<	 Queue shared by all the GOP, tile and CTU row jobs
+	u32					m_uiTotalPoolThreads;							//!<	 Threads of the pool (the main thread is not one of them)
+	ThreadHandler		**m_ppcThreadHandler;							//!<	 Thread handlers of the pool
+	WorkItem			**m_ppcGOPWorkItem;								//!<	 Work items per GOP job [GOP number][ptr]
+	TileBalancer		*m_pcTileBalancer;								//!<	 Chooses the tile layout with adaptive tiles (NULL otherwise)
+	SliceBalancer		*m_pcSliceBalancer;								//!<	 Chooses the slice layout with a byte budget of the slices (NULL otherwise)
+	DeadlineGovernor	*m_pcDeadlineGovernor;							//!<	 Chooses the active workers in the real-time mode (NULL otherwise)
+	u32					*m_puiActiveWorkersPerGOP;						//!<	 Active workers when each GOP was submitted
+	TileLayout_t		m_sPPSTileLayout;								//!<	 Tile layout of the last PPS in the bitstream
+	pthread_t			m_ptReaderThread;								//!<	 Reads the GOPs ahead of the compression
+	pthread_t			m_ptWriterThread;								//!<	 Writes the compressed GOPs and the reconstructed frames
+	pthread_mutex_t		m_ptPipeMutex;									//!<	 Guards the GOP counters of the pipeline stages
+	pthread_cond_t		m_ptPipeCond;									//!<	 Signalled when a stage has finished a GOP
+	u32					m_uiGOPsRead;									//!<	 GOPs in the buffers so far
+	u32					m_uiGOPsCompressed;								//!<	 GOPs compressed and handed to the writer so far
+	u32					m_uiGOPsStreamWritten;							//!<	 GOPs whose bitstream is written so far (their compressor is free)
+	u32					m_uiGOPsWritten;								//!<	 GOPs completely written so far (their buffer is free)
+	u32					m_uiEncodingTime;								//!<	 Time in msec the sequence took to encode
 
 	void				ConfigureEncoder();								//!<	 Configure the encoder
 	void				InitEncoder();									//!<	 Allocate memory to the buffers
@@ -72,24 +120,96 @@ private:
 	void				OpenIOFiles();									//!<	 Open the input and output files
 	void				CloseIOFiles();									//!<	 Close the input and output files
 
+	/**
+	*	Choose the threads and tiles from the detected hardware.
+	*	All frames are intra coded, so the GOPs in flight cost no compression efficiency and come first,
+	*	as long as their frames fit in the last level cache. The tiles (or the wavefront rows) make up for
+	*	the rest of the processors with as few tiles as possible. Only the values not given by the user are changed.
+	*	@param gopthreads GOPs in flight (0 if not given).
+	*	@param totaltiles Tiles per frame (0 if not given).
+	*	@param totaltilecols Tile columns.
+	*	@param totaltilerows Tile rows.
+	*	@param tilethreads CTU rows compressed concurrently with wavefronts.
+	*	@param workers Worker threads (0 if not given).
+	*	@param wpp Wavefront parallel processing is used.
+	*/
+	void				PlanParallelism(i32 &gopthreads, i32 &totaltiles, i32 &totaltilecols, i32 &totaltilerows,
+											i32 &tilethreads, i32 &workers, bool wpp);
+
 	/*
 	*	Write Parameter Set.
 	*	i.e. VPS, SPS and PPS headers.
 	*/
 	u64					WritePS();
+
+	/**
+	*	Write a PPS with another tile layout.
+	*	The PPS replaces the previous one for the following frames.
+	*	@param sTileLayout Tile layout of the following frames.
+	*	@return Bytes written.
+	*/
+	u64					WritePPS(TileLayout_t const &sTileLayout);
+
+	/**
+	*	Update the tile layout from the encoding time of a GOP.
+	*	The GOPs submitted afterwards use the new layout.
+	*	@param iGopNum GOP compressor number.
+	*/
+	void				UpdateTileLayout(i32 iGopNum);
+
+	/**
+	*	Update the slice layout from the bytes of a GOP.
+	*	The GOPs submitted afterwards use the new layout.
+	*	@param iGopNum GOP compressor number.
+	*/
+	void				UpdateSliceLayout(i32 iGopNum);
+
+	/**
+	*	Update the active workers from the time per frame of the last GOPs in flight, when a GOP is compressed.
+	*	Only used in the real-time mode. The workers which are no longer needed are parked.
+	*/
+	void				UpdateActiveWorkers();
 	
 	/**
 	*	Fill buffers by reading the YUV file.
 	*	Fills the buffer by considering the position of the GOP.
-	*	@param iGopNum GOP number.
+	*	@param uiGopBuff GOP buffer to fill.
 	*/
-	void				FillGOPBuffFromYUV(i32 iGopNum);
+	void				FillGOPBuffFromYUV(u32 uiGopBuff);
 
 	/**
 	*	Write the reconstructed output.
-	*	@param iGopNum GOP number.
+	*	@param uiGopBuff GOP buffer with the reconstructed frames.
+	*/
+	void				WriteGOPBuffToYUV(u32 uiGopBuff);
+
+	/**
+	*	Reader stage of the pipeline.
+	*	Reads all the GOPs in order, as long as a GOP buffer is free.
+	*	@param pArgs The encoder.
 	*/
-	void				WriteGOPBuffToYUV(i32 iGopNum);
+	static void			*ReaderThread(void *pArgs);
+
+	/**
+	*	Writer stage of the pipeline.
+	*	Writes the compressed GOPs and their reconstructed frames in order.
+	*	@param pArgs The encoder.
+	*/
+	static void			*WriterThread(void *pArgs);
+
+	/**
+	*	Wait until a pipeline stage has finished enough GOPs.
+	*	@param puiGOPsDone GOP counter of the stage.
+	*	@param uiGOPs GOPs which must be finished.
+	*/
+	void				WaitPipeStage(u32 const *puiGOPsDone, u32 uiGOPs);
+
+	/**
+	*	Publish the GOPs finished by a pipeline stage.
+	*	@param puiGOPsDone GOP counter of the stage.
+	*	@param uiGOPs GOPs finished.
+	*/
+	void				SetPipeStage(u32 *puiGOPsDone, u32 uiGOPs);
 
 	/**
 	*	Write output bitstream.
@@ -115,9 +235,43 @@ private:
 
 	/**
 	*	Make threads pool.
+	*	A single pool executes all the GOP, tile and CTU row jobs of the encoder. The main thread
+	*	helps while it waits, so the pool has one thread less than the requested workers.
+	*	Must be called before the GOP compressors are made.
+	*	Will only be activated if USE_THREADS is enabled.
 	*/
 	void				MakeThreadsPool();
 
+	/**
+	*	Free the threads pool.
+	*/
+	void				FreeThreadsPool();
+
+	/**
+	*	Read the next GOP from the input file and start its compression.
+	*	With the reader thread, this only waits until the GOP is read and the compressor's previous GOP is written.
+	*	With USE_THREADS, the compression is handed to the work-queue and this function returns immediately.
+	*	@param iGopNum GOP compressor number.
+	*	@param uiGopStartFrameNum Starting frame number of the GOP.
+	*/
+	void				SubmitGOP(i32 iGopNum, u32 uiGopStartFrameNum);
+
+	/**
+	*	Wait until the GOP compressor has finished its current GOP.
+	*	The main thread executes queued jobs in the meantime.
+	*	@param iGopNum GOP compressor number.
+	*/
+	void				WaitGOPDone(i32 iGopNum);
+
+	/**
+	*	Write the compressed GOP to the bitstream file.
+	*	Must be called in display order, as this is where the NAL units are serialized.
+	*	The reconstructed frames are written separately with WriteGOPBuffToYUV().
+	*	@param iGopNum GOP compressor number.
+	*	@param uiGopStartFrameNum Starting frame number of the GOP.
+	*/
+	void				WriteGOP(i32 iGopNum, u32 uiGopStartFrameNum);
+
 public:
 
 	/**
@@ -138,6 +292,13 @@ public:
 	*	@param bLumaOnly If 1, the PSNR only considers the luma frames. 
 	*/
 	void PrintPSNR(bool bLumaOnly);									
+
+	/**
+	*	Get the throughput of the encoder.
+	*	Only valid after the sequence is encoded.
+	*	@return Frames encoded per second.
+	*/
+	f64 GetFramesPerSec();
 };
 
 #endif	// __ENCTOP_H__
\ No newline at end of file
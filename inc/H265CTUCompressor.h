@@ -27,6 +27,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <Defines.h>
 #include <TypeDefs.h>
+#include <Utilities.h>
+#include <Kernels.h>
 
 class InputParameters;
 class ImageParameters;
@@ -34,19 +36,56 @@ class H265Transform;
 class BitStreamHandler;
 class Cabac;
 
+/**
+*	Top line buffers of a tile.
+*	Shared by all the CTU compressors of the tile. The CTU rows alternate between the two pixel lines, i.e. a row reads the
+*	line written by the row above and writes the other one, so that wavefront rows never overwrite samples still being read.
+*/
+typedef struct _TopLineBuffers
+{
+	byte				*ppbY[2];					//!< Bottom luma lines of the CTU rows (+1 for the top left and +CTU_WIDTH for the top right)
+	byte				*ppbCb[2];					//!< Bottom Cb lines of the CTU rows
+	byte				*ppbCr[2];					//!< Bottom Cr lines of the CTU rows
+	u8					*pbIntraModeInfoL;			//!< Luma mode information of the bottom PUs of the CTU rows
+}TopLineBuffers_t;
+
+/**
+*	Syntax of one compressed CTU.
+*	Holds everything the entropy coding of a CTU reads, so that a CTU can be entropy coded while the CTU compressor
+*	already analyses the next one.
+*/
+typedef struct _CTUSyntax
+{
+	u32					uiAddrX;															//!< Absolute displacement of the CTU from the left of the picture
+	u32					uiAddrY;															//!< Absolute displacement of the CTU from the top of the picture
+	i16					piCoeffY[CTU_WIDTH*CTU_WIDTH];										//!< Transformed luma coefficients
+	i16					piCoeffCb[CTU_WIDTH*CTU_WIDTH>>2];									//!< Transformed Cb coefficients
+	i16					piCoeffCr[CTU_WIDTH*CTU_WIDTH>>2];									//!< Transformed Cr coefficients
+	u16					puiSigMapY[(CTU_WIDTH>>2)*(CTU_WIDTH>>2)];							//!< Significance map of the 4x4 groups of the luma coefficients
+	u16					puiSigMapCb[(CTU_WIDTH>>3)*(CTU_WIDTH>>3)];							//!< Significance map of the 4x4 groups of the Cb coefficients
+	u16					puiSigMapCr[(CTU_WIDTH>>3)*(CTU_WIDTH>>3)];							//!< Significance map of the 4x4 groups of the Cr coefficients
+	u8					pbNeighIntraModeL[(TOT_PUS_LINE+2)*(TOT_PUS_LINE+2)];				//!< Luma modes of the CTU and its neighbours
+	u8					pbIntraModeInfoL[(TOT_PUS_LINE+1)*(TOT_PUS_LINE+1)];				//!< Luma mode information of the CTU and its neighbours
+	u16					puiIntraModeInfoC[TOT_PUS_LINE*TOT_PUS_LINE];						//!< Chroma mode information of the CTU
+}CTUSyntax_t;
+
 /**
 *	CTU compressor.
 *	Compress the current CTU.
 */
-class H265CTUCompressor
+class CACHE_ALIGNED H265CTUCompressor
 {
 private:
 	InputParameters const	*m_pcInputParam;							//!< Input parameters
 	ImageParameters const	*m_pcImageParam;							//!< Image parameters
 	H265Transform			*m_pcH265Trans;								//!< Transform and quantization
-	byte					*m_pbRefTopBuffY;							//!< Top pixels of luma
-	byte					*m_pbRefTopBuffCb;							//!< Top pixels of CB
-	byte					*m_pbRefTopBuffCr;							//!< Top pixels of CR
+	TopLineBuffers_t const	*m_psTopLine;								//!< Top line buffers shared within the tile
+	byte					*m_pbRefTopBuffY;							//!< Top pixels of luma (line of the CTU row above)
+	byte					*m_pbRefTopBuffCb;							//!< Top pixels of CB (line of the CTU row above)
+	byte					*m_pbRefTopBuffCr;							//!< Top pixels of CR (line of the CTU row above)
+	byte					*m_pbNextTopBuffY;							//!< Bottom pixels of luma written for the CTU row below
+	byte					*m_pbNextTopBuffCb;							//!< Bottom pixels of CB written for the CTU row below
+	byte					*m_pbNextTopBuffCr;							//!< Bottom pixels of CR written for the CTU row below
 	byte					m_ppbTempPred4[2][4*4];						//!< Prediction buffer for 4x4
 	byte					m_ppbTempPred8[2][8*8];						//!< Prediction buffer for 8x8
 	byte					m_ppbTempPred16[2][16*16];					//!< Prediction buffer for 16x16
@@ -57,13 +96,19 @@ private:
 	i16						m_piCoeffY[CTU_WIDTH*CTU_WIDTH];			//!< Transformed luma coefficients
 	i16						m_piCoeffCb[CTU_WIDTH*CTU_WIDTH>>2];		//!< Transformed Cb coefficients
 	i16						m_piCoeffCr[CTU_WIDTH*CTU_WIDTH>>2];		//!< Transformed Cr coefficients
+	u16						m_puiSigMapY[(CTU_WIDTH>>2)*(CTU_WIDTH>>2)];	//!< Significance map of the 4x4 groups of the luma coefficients (see H265Transform::Quant())
+	u16						m_puiSigMapCb[(CTU_WIDTH>>3)*(CTU_WIDTH>>3)];	//!< Significance map of the 4x4 groups of the Cb coefficients
+	u16						m_puiSigMapCr[(CTU_WIDTH>>3)*(CTU_WIDTH>>3)];	//!< Significance map of the 4x4 groups of the Cr coefficients
 	u32						m_uiYStride;								//!< Width of luma frame
 	u32						m_uiCStride;								//!< Width of the chroma frame
 	u32						m_uiQP;										//!< Quantization parameter
+	SATDFunc_t const		*m_ppfDistortion;							//!< Distortion of the mode decisions, the SAD or the SATD kernels [log2 size-2]
+	u32						m_puiModeCost[3];							//!< Cost of a luma mode, which is the first candidate, one of the other two candidates, or none of them
 	u32						m_uiTileWidthInPels;						//!< Width of the tile under process
 	u32						m_uiTileHeightInPels;						//!< Height of the tile under process
 	pixel					m_cTileStartCTUPelTL;						//!< Tile starting pixel
 	pixel					m_cTileEndCTUPelTL;							//!< Tile ending pixel
+	bit						m_bLastTileOfSlice;							//!< The tile ends the slice
 	u8						m_pbNeighIntraModeL[(TOT_PUS_LINE+2)*(TOT_PUS_LINE+2)];		//!< Modes of the neighboring blocks. There is a mode for every PU (+2 for the top and left/right and bottom and left/right)
 	byte					m_pbRecY[(CTU_WIDTH+2)*CTU_WIDTH];			//!< Stores the reconstructed Y samples (+2 the left of the CTU for chroma from luma prediction (LM chroma mode))
 	byte					m_pbRecCb[(CTU_WIDTH/2+1)*CTU_WIDTH/2];		//!< Stores the reconstructed Cb samples
@@ -76,9 +121,6 @@ private:
 	u8						m_pbIntraModeInfoL[(TOT_PUS_LINE+1)*(TOT_PUS_LINE+1)];	//!< Stores information about luma mode
 	u8						m_pbIntraModePredInfoL[(TOT_PUS_LINE+1)*(TOT_PUS_LINE+1)];	//!< Keeps the information about the predicted angular mode (@todo Delete this)
 	u8						*m_pbTopLineIntraModeInfoL;					//!< Holds the top line mode info from the above CTU row
-	byte					m_bSavedLTY;								//!< Left top pixel for luma
-	byte					m_bSavedLTCb;								//!< Left top pixel for Cb
-	byte					m_bSavedLTCr;								//!< Left top pixel for Cr
 	u32						m_ctTimeForCTU;								//!< Time consumed for processing the current CTU
 
 	/**
@@ -87,12 +129,6 @@ private:
 	*/
 	void					PrepareCTU(u32 uiAddrX, u32 uiAddrY);
 
-	/**	
-	*	CTU processing finisher.
-	*	Re-adjust the changes that were made via PrepareCTU() and other stuff.
-	*/
-	void					FinishCTU(u32 uiAddrX, u32 uiAddrY);
-
 	/**
 	*	Get displacement from CTU boundaries, given the total 4x4s traversed.
 	*	The left and top discplacements are for the luma CU from the current CTU.
@@ -120,6 +156,27 @@ private:
 	*/
 	u8						CheckNeighAvail(u8 *pbTopAndLeftModes, byte *pbCurrIntraModeL, u32 uiSize);
 
+	/**
+	*	Encode a CTU from its syntax.
+	*	@param uiAddrX Absolute displacement of the CTU from the left of the picture.
+	*	@param uiAddrY Absolute displacement of the CTU from the top of the picture.
+	*	@param piCoeffY Luma coefficients of the CTU.
+	*	@param piCoeffCb Cb coefficients of the CTU.
+	*	@param piCoeffCr Cr coefficients of the CTU.
+	*	@param puiSigMapY Significance map of the luma coefficients.
+	*	@param puiSigMapCb Significance map of the Cb coefficients.
+	*	@param puiSigMapCr Significance map of the Cr coefficients.
+	*	@param pbNeighIntraModeL Luma modes of the CTU and its neighbours.
+	*	@param pbIntraModeInfoL Luma mode information of the CTU and its neighbours.
+	*	@param puiIntraModeInfoC Chroma mode information of the CTU.
+	*	@param pcCabac CABAC encoder.
+	*	@param pcBitStreamHandler The bitstream where the output will be written.
+	*/
+	void					xEncodeCTU(u32 uiAddrX, u32 uiAddrY, i16 const *piCoeffY, i16 const *piCoeffCb, i16 const *piCoeffCr,
+								 u16 const *puiSigMapY, u16 const *puiSigMapCb, u16 const *puiSigMapCr,
+								 u8 const *pbNeighIntraModeL, u8 const *pbIntraModeInfoL, u16 const *puiIntraModeInfoC,
+								 Cabac *& pcCabac, BitStreamHandler *& pcBitStreamHandler);
+
 	/**
 	*	Generate the candidate mode list for intra.
 	*/
@@ -174,6 +231,7 @@ private:
 
 	/**
 	*	Compute the SAD.
+	*	The square blocks of 4x4 to 32x32 use the kernels chosen by InitKernels().
 	*/
 	u32						SAD_MxN(u32 uiM, u32 uiN, byte *pbSrc, u32 uiSrcStride, byte *pbRef, u32 uiRefStride);
 	
@@ -183,6 +241,22 @@ private:
 	*/
 	i32						MapModeToIndex(u32 uiBestMode, u8 *pbCandModeListIntra);
 
+	/**
+	*	Predict a luma mode and keep it, if its cost is the lowest so far.
+	*	The best prediction stays in the other buffer of the ping-pong.
+	*	@param uiMode Mode to test.
+	*	@param uiSize Width and height of the CU.
+	*	@param pbCurrY Source of the CU.
+	*	@param ppbPredPingPong Prediction buffers of the ping-pong.
+	*	@param pbCandModeListIntra Candidates for the mode.
+	*	@param bIsChroma See GenIntraPrediction().
+	*	@param bPingPongBuffNum Prediction buffer of the next mode.
+	*	@param uiBestCost Cost of the best mode so far.
+	*	@param uiBestMode Best mode so far.
+	*/
+	void					xTestLumaMode(u32 uiMode, u32 uiSize, byte *pbCurrY, byte **ppbPredPingPong, u8 const *pbCandModeListIntra, bit bIsChroma,
+								 u8 &bPingPongBuffNum, u32 &uiBestCost, u32 &uiBestMode);
+
 	/**
 	*	Recursively compress a CU.
 	*/
@@ -199,13 +273,20 @@ private:
 	*/
 	bit						IsLastTileCTU(u32 uiAddrX, u32 uiAddrY);
 
+	/**
+	*	Check if last CTU of the CABAC substream.
+	*	With wavefront parallel processing, every CTU row of the tile is a substream. Else, the full tile is.
+	*/
+	bit						IsLastSubStreamCTU(u32 uiAddrX, u32 uiAddrY);
+
 	/**
 	*	Check if last CTU of the slice.
-	*	This is important for the end_of_slice_segment_flag.
+	*	This is important for the end_of_slice_segment_flag. A slice always ends with the last CTU of a tile.
 	*/
 	bit						IsLastSliceCTU(u32 uiAddrX, u32 uiAddrY);
 
 public:
+	CACHE_ALIGNED_NEW
 
 	/**
 	*	Constructor.
@@ -213,9 +294,26 @@ public:
 	*	@param pcImageParam Image parameters of a video frame.
 	*	@param cTileStartCTUPelTL Top left (x,y) pixel locations of the the top left CTU of the tile which contains this CTU compressor.
 	*	@param cTileEndCTUPelTL Top left (x,y) pixel location of the bottom right CTU of the tile which contains this CTU compressor.
+	*	@param psTopLine Top line buffers of the tile, shared with the other CTU compressors of the tile.
 	*/
-	H265CTUCompressor(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL);
+	H265CTUCompressor(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL,
+		TopLineBuffers_t const *psTopLine);
 	~H265CTUCompressor();
+
+	/**
+	*	Move the CTU compressor to another tile.
+	*	@param cTileStartCTUPelTL Top left (x,y) pixel locations of the the top left CTU of the tile.
+	*	@param cTileEndCTUPelTL Top left (x,y) pixel location of the bottom right CTU of the tile.
+	*/
+	void					SetTileBoundary(pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL);
+
+	/**
+	*	Set whether the tile ends its slice.
+	*	By default, only the tile with the last CTU of the frame does.
+	*	@param bLastTileOfSlice True if the last CTU of the tile is the last one of the slice.
+	*/
+	void					SetLastTileOfSlice(bit bLastTileOfSlice){m_bLastTileOfSlice = bLastTileOfSlice;}
+
 	/**
 	*	Compress a CTU.
 	*	@param uiAddrX Absolute displacement of the CTU from the left of the picture.
@@ -237,6 +335,25 @@ public:
 	*/
 	void					EncodeCTU(u32 uiAddrX, u32 uiAddrY, Cabac *& pcCabac, BitStreamHandler *& pcBitStreamHandler);
 
+	/**
+	*	Save the syntax of the CTU compressed last.
+	*	Must be called after CompressCTU() and before UpdateBuffers().
+	*	@param uiAddrX Absolute displacement of the CTU from the left of the picture.
+	*	@param uiAddrY Absolute displacement of the CTU from the top of the picture.
+	*	@param psSyntax Where the syntax is saved.
+	*/
+	void					SaveSyntax(u32 uiAddrX, u32 uiAddrY, CTUSyntax_t *psSyntax);
+
+	/**
+	*	Encode a CTU from its saved syntax.
+	*	May be called concurrently with the compression of the next CTUs of the tile, as it only reads the tile boundary.
+	*	@see SaveSyntax()
+	*	@param psSyntax Syntax of the CTU.
+	*	@param pcCabac CABAC encoder.
+	*	@param pcBitStreamHandler The bitstream where the output will be written.
+	*/
+	void					EncodeCTU(CTUSyntax_t const *psSyntax, Cabac *& pcCabac, BitStreamHandler *& pcBitStreamHandler);
+
 	/**
 	*	Initialize the buffers on new CTU line.
 	*	If a new CTU line within a tile starts, some of the internal buffers of the CTU compressor must be initialized again.
@@ -245,7 +362,7 @@ public:
 
 	/**
 	*	Initialize the buffers on a new frame.
-	*	Initialize the internal buffers after a full frame is being processed.
+	*	Initialize the internal buffers after a full frame is being processed. The shared top line buffers are initialized by the tile compressor.
 	*/
 	void					InitBuffersNewTile();
 
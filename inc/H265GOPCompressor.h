@@ -33,6 +33,10 @@ class InputParameters;
 class ImageParameters;
 class BitStreamHandler;
 class H265SliceCompressor;
+class WorkQueue;
+struct _SliceParams;
+struct _TileLayout;
+struct _SliceLayout;
 
 /**
 *	GOP compressor.
@@ -53,8 +57,10 @@ public:
 	*	@param pcInputParam Input parameters to the program.
 	*	@param pcImageParam Image parameters of a video frame.
 	*	@param pppcBitStreamPerSlice Bitstream handlers for the GOP.
+	*	@param pcWorkQueue Work queue shared by the whole encoder (NULL if USE_THREADS is disabled).
 	*/
-	H265GOPCompressor(InputParameters *pcInputParam, ImageParameters *pcImageParam, BitStreamHandler ***& pppcBitStreamPerSlice);
+	H265GOPCompressor(InputParameters *pcInputParam, ImageParameters *pcImageParam, BitStreamHandler ***& pppcBitStreamPerSlice,
+		WorkQueue *pcWorkQueue);
 	~H265GOPCompressor();
 	/**
 	*	Compress a GOP.
@@ -63,8 +69,23 @@ public:
 	*	@param ppbCbBuff Contains Cb samples.
 	*	@param ppbCrBuff Contains Cr samples.
 	*	@param uiStartSliceNum The number of the starting slice within the GOP.
+	*	@param sSliceParams Parameters (type, QP) used for the slices of this GOP.
 	*/
-	void					CompressGOP(byte **ppbYBuff, byte **ppbCbBuff, byte **ppbCrBuff, u32 uiStartSliceNum);
+	void					CompressGOP(byte **ppbYBuff, byte **ppbCbBuff, byte **ppbCrBuff, u32 uiStartSliceNum, struct _SliceParams const &sSliceParams);
+
+	/**
+	*	Change the tile layout of all the slices.
+	*	Must not be called while the GOP is under compression.
+	*	@param sTileLayout Tile layout used from the next GOP on.
+	*/
+	void					SetTileLayout(struct _TileLayout const &sTileLayout);
+
+	/**
+	*	Change the slice layout of all the frames.
+	*	Must not be called while the GOP is under compression.
+	*	@param sSliceLayout Slice layout used from the next GOP on.
+	*/
+	void					SetSliceLayout(struct _SliceLayout const &sSliceLayout);
 
 	/**
 	*	Get compressed bitstream of a slice.
@@ -30,6 +30,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 class InputParameters;
 class ImageParameters;
 class BitStreamHandler;
+struct _SliceParams;
+struct _TileLayout;
 
 /**
 *	Header generators.
@@ -51,12 +53,13 @@ private:
 	/**
 	*	Write the SPS to the bitstream.
 	*/
-	void WritePPSInBitstream(ImageParameters const *pcImageParam, BitStreamHandler *&pcBitStreamHandler);
+	void WritePPSInBitstream(ImageParameters const *pcImageParam, struct _TileLayout const &sTileLayout, BitStreamHandler *&pcBitStreamHandler);
 
 	/**
 	*	Write the Slice header to the bitstream.
 	*/
-	void WriteSliceHdrInBitstream(ImageParameters const *pcImageParam, u32 uiCurrSliceNum, BitStreamHandler *&pcBitStreamHandler);
+	void WriteSliceHdrInBitstream(ImageParameters const *pcImageParam, struct _SliceParams const &sSliceParams, u32 uiCurrSliceNum, u32 uiSliceAddr,
+		BitStreamHandler *&pcBitStreamHandler);
 public:
 	/**
 	*	Generate VPS NAL Unit.
@@ -78,15 +81,28 @@ public:
 	*	Generate PPS NAL Unit.
 	*	@param pcInputParam Input parameters to the program.
 	*	@param pcImageParam Image parameters of a video frame.
+	*	@param sTileLayout Tile layout of the frames which refer to this PPS.
 	*	@param pcBitStreamHandler The bitstream where the output will be written.
 	*/
-	void GenPPSNALU(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, BitStreamHandler *&pcBitStreamHandler);
-	void GenSliceHeader(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, u32 uiCurrSliceNum, BitStreamHandler *&pcBitStreamHandler);	// Generate slice header
+	void GenPPSNALU(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, struct _TileLayout const &sTileLayout,
+		BitStreamHandler *&pcBitStreamHandler);
 	
 	/**
-	*	Encode the tile entry information in the slice header.
-	*	Only call this function if there are more than 1 tiles per slice.
-	*	@param uiNumEntryPointOffsets Total number of offsets in the bitstream where the tiles are written.
+	*	Generate slice header.
+	*	@param pcInputParam Input parameters to the program.
+	*	@param pcImageParam Image parameters of a video frame.
+	*	@param sSliceParams Parameters of the slice under compression (type, QP).
+	*	@param uiCurrSliceNum Slice number of the current slice.
+	*	@param uiSliceAddr Raster scan address of the first CTU of the slice within the frame (0 for the first slice of the frame).
+	*	@param pcBitStreamHandler The bitstream where the output will be written.
+	*/
+	void GenSliceHeader(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, struct _SliceParams const &sSliceParams, u32 uiCurrSliceNum,
+		u32 uiSliceAddr, BitStreamHandler *&pcBitStreamHandler);
+	
+	/**
+	*	Encode the tile (or wavefront substream) entry information in the slice header.
+	*	Only call this function if there are more than 1 tiles per slice or wavefront parallel processing is used.
+	*	@param uiNumEntryPointOffsets Total number of offsets in the bitstream where the tiles (or CTU rows) are written.
 	*	@param uiEntryPointOffsets Array which contains the offsets. 
 	*	@param pcBitStreamHandler The bitstream where the output will be written.
 	*/
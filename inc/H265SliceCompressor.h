@@ -27,6 +27,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <Defines.h>
 #include <TypeDefs.h>
+#include <ImageParameters.h>
+#include <Utilities.h>
 
 class InputParameters;
 class ImageParameters;
@@ -36,15 +38,17 @@ class H265Headers;
 class Cabac;
 class WorkQueue;
 class WorkItem;
-class ThreadHandler;
 class H265TileCompressor;
 
 /**
 *	Tile job arguments.
 *	Use this structure to feed the tile work-queue for multi-threading.
+*	The arguments of every job are on their own cache lines.
 */
-typedef struct _TileJobArgs
+typedef struct CACHE_ALIGNED _TileJobArgs
 {
+	CACHE_ALIGNED_NEW
+
 	i32					iNum;
 	byte				*pbYBuff;
 	byte				*pbCbBuff;
@@ -56,30 +60,40 @@ typedef struct _TileJobArgs
 
 /**
 *	Slice compressor.
-*	Compress a full slice.
+*	Compress a full frame, made of one or more slices. The slices are made of whole tiles, or with one tile
+*	per frame, of bands of CTU rows. Every tile (or band) has its own tile compressor, and all of them are
+*	compressed concurrently, whichever slice they belong to.
 */
 class H265SliceCompressor
 {
 private:
 	InputParameters const	*m_pcInputParam;					//!< Input parameters
 	ImageParameters const	*m_pcImageParam;					//!< Image parameters
-	H265TileCompressor		**m_ppcH265TileCompressor;			//!< Tile compressor
+	H265TileCompressor		**m_ppcH265TileCompressor;			//!< Tile compressor of each tile (or CTU row band of a slice)
 	Cabac					**m_ppcCabac;						//!< Cabac handler class for each tile
-	u32						m_uiTotalTiles;						//!< Total tiles
+	u32						m_uiMaxTiles;						//!< Total tile compressors
+	u32						m_uiTotalTiles;						//!< Tile compressors used by the slice layout (all of them but with adaptive slices)
 	pixel					*m_pcTileStartCTUPel;				//!< Tile starting CTU TL location (included in Tile)
 	pixel					*m_pcTileEndCTUPel;					//!< Tile ending CTU TL location (included in Tile)
-	eSliceType				m_eSliceType;						//!< Type of slice (I, P, B etc.)
+	TileLayout_t			m_sTileLayout;						//!< Tile layout of the slice
+	SliceLayout_t			m_sSliceLayout;						//!< Slice layout of the frame
+	u32						*m_puiSliceFirstTile;				//!< First tile compressor of each slice, and the total tile compressors at the end
+	u32						*m_puiCTUBytes;						//!< Bytes of each CTU (only with adaptive slices)
+	u32						*m_puiCTUCost;						//!< Encoding time in usec of each CTU (only with adaptive tiles)
+	SliceParams_t			m_sSliceParams;						//!< Parameters of the slice under compression (type, QP)
 	BitStreamHandler		**m_ppcBitStreamHandler;			//!< Bitstream handler
 	BitStreamHandler		*m_pcSliceBitStreamHandler;			//!< Bitstream handler of the slice
-	BitStreamHandler		*m_pcSliceHeaderBitStreamHandler;	//!< Stores the slice header bits (required for tiles)
+	BitStreamHandler		**m_ppcSliceHeaderBitStreamHandler;	//!< Stores the slice header bits of each slice (separate for tiles and wavefronts)
 	H265Headers				*m_pcH265Headers;					//!< For generating slice header
 	u32						*m_pcTimePerTile;					//!< For storing the time consumption of each tile
+	u32						*m_puiTileOrder;					//!< Tiles in the order of their predicted time, longest first
+	u32						*m_puiTileSizeInCTUs;				//!< Total CTUs of each tile
 	u64						*m_pu64TotalBytesPerTile;			//!< Bytes per Tile
 	u64						m_u64TotalBytesPerSlice;			//!< Bytes for the current slice
-	WorkQueue				*m_pcTileWorkQueue;					//!< Queue for holding the jobs for tile threads
-	u32						m_uiTotalTileThreads;				//!< Total threads allocated for tiles
+	u64						*m_pu64BytesPerSlice;				//!< Bytes of each slice of the frame, including its slice header
+	WorkQueue				*m_pcWorkQueue;						//!< Shared queue of the encoder, where the tile jobs are pushed
+	volatile i64			m_i64PendingTileJobs;				//!< Tile jobs of the slice which are not done yet
 	TileJobArgs_t			**m_ppcTileJobArgs;					//!< Arguments for the tile thread function
-	ThreadHandler			**m_ppcTileThreadHandler;			//!< Thread handlers for the tiles
 	WorkItem				**m_ppcWorkItem;					//!< Work items per tile thread job
 	u32						m_ctTimeForSlice;					//!< Total time per slice
 	/**
@@ -87,8 +101,21 @@ private:
 	*/
 	void					GenTileBoundingPixels();
 
+	/**
+	*	Generate the CTU row bands of the slices.
+	*	Only used with one tile per frame and more slices.
+	*/
+	void					GenSliceBandBoundingPixels();
+
+	/**
+	*	Assign the tile compressors to the slices.
+	*	The tile compressors which end a slice terminate it, and each slice gets its slice header bitstream handler.
+	*/
+	void					GenSliceTiles();
+
 	/**
 	*	Write slice header information.
+	*	Every slice of the frame gets its own slice header and NAL unit.
 	*/
 	void					WriteSliceHeader(u32 uiCurrSliceNum);
 
@@ -102,12 +129,13 @@ private:
 	*	Encode the tile entry information in the bitstream.
 	*	At the end of the slice with multiple tiles, the information about the start of the tile
 	*	bitstream in the concatenated bitstream must be encoded to enable parallel decoding.
+	*	@param uiSlice Slice of the frame.
 	*/
-	void					WriteTilesEntryPointInSliceHeader();
+	void					WriteTilesEntryPointInSliceHeader(u32 uiSlice);
 
 	/**
-	*	Fix the last byte of the NAL unit.
-	*	If there are multiple tiles for a given slice, then do it only for the last tile.
+	*	Fix the last byte of the NAL units.
+	*	If there are multiple tiles for a given slice, then do it only for the last tile of the slice.
 	*/
 	void					FixZeroTermination();
 
@@ -118,10 +146,18 @@ private:
 	void					InitialToCompression();
 
 	/**
-	*	Make threads for tile compressor.
+	*	Make the work items for the tile jobs.
+	*	The jobs are executed by the threads of the shared work queue.
 	*	Will only be activated if USE_THREADS is enabled.
 	*/
-	void					MakeTileThreadsPool();
+	void					MakeTileJobs();
+
+	/**
+	*	Order the tiles by their predicted time, longest first.
+	*	The time of a tile in the previous frame predicts its time in the current frame.
+	*	Without such a time (first frame or new tile layout), the tile size is used.
+	*/
+	void					OrderTilesByPredictedTime();
 
 public:
 
@@ -130,8 +166,10 @@ public:
 	*	@param pcInputParam Input parameters to the program.
 	*	@param pcImageParam Image parameters of a video frame.
 	*	@param ppcBitStreamHandler Bitstream handlers for the slice.
+	*	@param pcWorkQueue Work queue shared by the whole encoder (NULL if USE_THREADS is disabled).
 	*/
-	H265SliceCompressor(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, BitStreamHandler **& ppcBitStreamHandler);
+	H265SliceCompressor(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, BitStreamHandler **& ppcBitStreamHandler,
+		WorkQueue *pcWorkQueue);
 	~H265SliceCompressor();
 	/**
 	*	Compress a slice.
@@ -139,8 +177,9 @@ public:
 	*	@param pbCbBuff Contains Cb samples.
 	*	@param pbCrBuff Contains Cr samples.
 	*	@param uiCurrSliceNum Slice number of the current slice.
+	*	@param sSliceParams Parameters of the current slice (type, QP).
 	*/
-	void					CompressSlice(byte *pbYBuff, byte *pbCbBuff, byte *pbCrBuff, u32 uiCurrSliceNum);
+	void					CompressSlice(byte *pbYBuff, byte *pbCbBuff, byte *pbCrBuff, u32 uiCurrSliceNum, SliceParams_t const &sSliceParams);
 
 	/**
 	*	Get the slice bitstream handler.
@@ -155,6 +194,18 @@ public:
 	*/
 	BitStreamHandler		*GetSliceBitStreamHandler(u32 uiTileNum){return m_ppcBitStreamHandler[uiTileNum];}
 
+	/**
+	*	Get the total slices of the frame.
+	*	@return Total slices the frame was compressed with.
+	*/
+	u32						GetTotalSlices(){return m_sSliceLayout.uiNumSlices;}
+
+	/**
+	*	Get the bytes of each slice of the frame.
+	*	@return Bytes of each slice, including its slice header.
+	*/
+	u64 const				*GetBytesPerSlice(){return m_pu64BytesPerSlice;}
+
 	/**
 	*	Get total bytes per tile.
 	*	@return Total bytes of all the tiles.
@@ -185,6 +236,45 @@ public:
 	*/	
 	u32						GetTimePerSlice(){return m_ctTimeForSlice;}
 
+	/**
+	*	Change the tile layout.
+	*	Must not be called while the slice is under compression.
+	*	@param sTileLayout Tile layout used from the next slice on.
+	*/
+	void					SetTileLayout(TileLayout_t const &sTileLayout);
+
+	/**
+	*	Get the tile layout.
+	*	@return Tile layout the slice was compressed with.
+	*/
+	TileLayout_t const		&GetTileLayout(){return m_sTileLayout;}
+
+	/**
+	*	Change the slice layout.
+	*	Must not be called while the slice is under compression. With one tile per frame, the CTU row
+	*	bands of the slices may only be resized with adaptive slices.
+	*	@param sSliceLayout Slice layout used from the next frame on.
+	*/
+	void					SetSliceLayout(SliceLayout_t const &sSliceLayout);
+
+	/**
+	*	Get the slice layout.
+	*	@return Slice layout the frame was compressed with.
+	*/
+	SliceLayout_t const		&GetSliceLayout(){return m_sSliceLayout;}
+
+	/**
+	*	Get the bytes of the CTUs.
+	*	@return Bytes of each CTU of the frame in raster scan order, NULL without adaptive slices.
+	*/
+	u32 const				*GetCTUBytes(){return m_puiCTUBytes;}
+
+	/**
+	*	Get the encoding time of the CTUs.
+	*	@return Time in usec of each CTU of the slice in raster scan order, NULL without adaptive tiles.
+	*/
+	u32 const				*GetCTUCost(){return m_puiCTUCost;}
+
 	/**
 	*	Get maximum intra angles for the tile.
 	*	@param uiTileNum Number of the tile.
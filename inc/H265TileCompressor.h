@@ -27,23 +27,51 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <Defines.h>
 #include <TypeDefs.h>
+#include <Utilities.h>
+#include <H265CTUCompressor.h>
 
 class InputParameters;
 class ImageParameters;
 class BitStreamHandler;
 class Cabac;
-class H265CTUCompressor;
+class WorkQueue;
+class TaskGraph;
+class WorkItem;
+class H265TileCompressor;
+
+/**
+*	CTU task arguments.
+*	Use this structure to feed the CTU task graph of a tile with wavefronts.
+*/
+typedef struct _CTUTaskArgs
+{
+	u32					uiRow;
+	u32					uiCol;
+	H265TileCompressor	*pcTileCompressor;
+}CTUTaskArgs_t;
 
 /**
 *	Tile compressor.
 *	Compresses one full tile.
 */
-class H265TileCompressor
+class CACHE_ALIGNED H265TileCompressor
 {
 private:
 	InputParameters const	*m_pcInputParam;					//!< Input parameters
 	ImageParameters const	*m_pcImageParam;					//!< Image parameters
-	H265CTUCompressor		*m_pcH265CTUCompressor;				//!< CTU compressor (This is not threaded. But it can be made to)
+	H265CTUCompressor		**m_ppcH265CTUCompressor;			//!< CTU compressors, one per CTU row compressed concurrently
+	u32						m_uiTotalRowWorkers;				//!< CTU rows compressed concurrently (1 without wavefronts)
+	TopLineBuffers_t		m_sTopLine;							//!< Top line buffers shared by the CTU compressors
+	u32						m_uiTotalSubStreams;				//!< CABAC substreams of the tile (one per CTU row with wavefronts)
+	Cabac					**m_ppcSubStreamCabac;				//!< CABAC of each substream (the first one is provided to CompressTile())
+	BitStreamHandler		**m_ppcSubStreamBitStreamHandler;	//!< Bitstream handler of each substream (the first one is provided to CompressTile())
+	u8						*m_pbWPPContextModels;				//!< CABAC contexts after the second CTU of each CTU row
+	byte					*m_pbYBuff;							//!< Luma samples of the frame under compression
+	byte					*m_pbCbBuff;						//!< Cb samples of the frame under compression
+	byte					*m_pbCrBuff;						//!< Cr samples of the frame under compression
+	WorkQueue				*m_pcWorkQueue;						//!< Shared queue of the encoder, where the CTU tasks are pushed
+	TaskGraph				*m_pcCTUGraph;						//!< One task per CTU with wavefronts (NULL if the rows are compressed one after the other)
+	CTUTaskArgs_t			*m_pcCTUTaskArgs;					//!< Arguments for the CTU tasks
 	u32						*m_puiCTUAddrMapX;					//!< Address X of the CTUs to process in the frame
 	u32						*m_puiCTUAddrMapY;					//!< Address Y of the CTUs to process in the frame
 	u32						m_uiTotalCTUsInTile;				//!< Total CTUs to process in the tile
@@ -56,7 +84,58 @@ private:
 	u32						m_ctTimeForTile;					//!< Total tics the tile compressor takes
 	u64						m_uiTotalBytes;						//!< Total bytes written for the tile
 	u32						m_uiTileID;							//!< Tile ID
+	u32						*m_puiCTUCost;						//!< Encoding time in usec of each CTU of the frame (NULL if not measured)
+	u32						*m_puiCTUBytes;						//!< Bytes of each CTU of the frame (NULL if not measured)
+	CTUSyntax_t				*m_psCTUPipe;						//!< Ring of the compressed CTUs waiting for entropy coding (NULL without the CTU pipeline)
+	u32						m_uiCTUPipeDepth;					//!< Total entries of the ring
+	CACHE_ALIGNED volatile i64	m_i64CTUPipeHead;				//!< Next CTU of the ring to be entropy coded (entropy coding side)
+	CACHE_ALIGNED volatile i64	m_i64CTUPipeTail;				//!< Next entry of the ring to be filled by the compressing thread (compressing side)
+	CACHE_ALIGNED volatile i64	m_i64CTUPipeOwner;				//!< 1 while a thread entropy codes the CTUs of the ring
+	volatile i64			m_i64PendingEntropyJobs;			//!< Entropy coding jobs of the tile which are not done yet
+	WorkItem				*m_pcEntropyWorkItem;				//!< Job which entropy codes the CTUs of the ring
+
+	/**
+	*	Set the position and the size of the tile.
+	*	@param cTileStartCTUPelTL Top left (x,y) pixel locations of the the top left CTU of the tile.
+	*	@param cTileEndCTUPelTL Top left (x,y) pixel location of the bottom right CTU of the tile.
+	*/
+	void					SetTileDimensions(pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL);
+
+	/**
+	*	Compress one CTU row of the tile on the calling thread.
+	*	@param uiRow CTU row within the tile.
+	*/
+	void					CompressCTURow(u32 uiRow);
+
+	/**
+	*	Hand a compressed CTU over to the entropy coding.
+	*	The syntax of the CTU is saved in the ring, and a job is submitted to entropy code it unless one is still
+	*	pending. If the ring is full, the calling thread entropy codes the CTUs itself.
+	*	@param pcCTUCompressor CTU compressor, which compressed the CTU last.
+	*	@param uiAddrX Absolute displacement of the CTU from the left of the picture.
+	*	@param uiAddrY Absolute displacement of the CTU from the top of the picture.
+	*/
+	void					PushCTUSyntax(H265CTUCompressor *pcCTUCompressor, u32 uiAddrX, u32 uiAddrY);
+
+	/**
+	*	Wait until all the CTUs of the ring are entropy coded.
+	*/
+	void					FinishCTUPipe();
+
+	/**
+	*	Make the CTU task graph of the tile.
+	*	A CTU depends upon its left and top right neighbours (and thereby upon the top left and top ones).
+	*	The first CTU of a row also depends upon the last CTU of the row which used the same CTU compressor before.
+	*/
+	void					MakeCTUGraph();
+
+	/**
+	*	Link the substream bitstream handlers of the tile in order.
+	*/
+	void					CatSubStreamBitStreamHandlers();
+
 public:
+	CACHE_ALIGNED_NEW
 
 	/**
 	*	Constructor
@@ -81,6 +160,51 @@ public:
 	void					CompressTile(byte *pbYBuff, byte *pbCbBuff, byte *pbCrBuff,
 		Cabac *& pcCabac, BitStreamHandler *& pcBitStreamHandler);
 
+	/**
+	*	Compress one CTU.
+	*	With wavefronts, the first CTU of a row starts from the CABAC contexts saved after the second CTU of the row above.
+	*	The CTUs of a row are compressed in order by the CTU compressor of the row.
+	*	@param uiRow CTU row within the tile.
+	*	@param uiCol CTU column within the tile.
+	*/
+	void					CompressCTU(u32 uiRow, u32 uiCol);
+
+	/**
+	*	Entropy code the CTUs of the ring in order.
+	*	Only one thread at a time entropy codes, the others return at once.
+	*	@return true if the ring was emptied by the calling thread, false if another thread is entropy coding.
+	*/
+	bit						EncodeCTUPipe();
+
+	/**
+	*	Set the work queue for the CTU tasks.
+	*	Must be called once before the first CompressTile() if USE_THREADS is enabled.
+	*	The CTU tasks are only used with wavefronts, and the entropy coding jobs only with the CTU pipeline.
+	*	@param pcWorkQueue Work queue where the CTU tasks will be pushed.
+	*/
+	void					SetWorkQueue(WorkQueue *pcWorkQueue);
+
+	/**
+	*	Initialize the substreams which are owned by the tile.
+	*	@param eCurrSliceType Type of the slice being encoded.
+	*	@param uiQP QP of the slice being encoded.
+	*/
+	void					InitSubStreams(eSliceType eCurrSliceType, u32 uiQP);
+
+	/**
+	*	Get the total substreams of the tile.
+	*	@return Total substreams.
+	*/
+	u32						GetTotalSubStreams(){return m_uiTotalSubStreams;}
+
+	/**
+	*	Get the bitstream handler of a substream.
+	*	Only valid after the tile is compressed.
+	*	@param uiSubStream Number of the substream.
+	*	@return Bitstream handler of the substream.
+	*/
+	BitStreamHandler		*GetSubStreamBitStreamHandler(u32 uiSubStream){return m_ppcSubStreamBitStreamHandler[uiSubStream];}
+
 	/**
 	*	Get the time tics for the current tile.
 	*	@return Time in msec consumed by the tile.
@@ -99,6 +223,34 @@ public:
 	*/
 	void					MakeCTUAddrMap();
 
+	/**
+	*	Move and resize the tile.
+	*	Only allowed with adaptive tiles or slices, as the buffers are then made for the largest possible tile.
+	*	@param cTileStartCTUPelTL Top left (x,y) pixel locations of the the top left CTU of the tile.
+	*	@param cTileEndCTUPelTL Top left (x,y) pixel location of the bottom right CTU of the tile.
+	*/
+	void					SetTileBoundary(pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL);
+
+	/**
+	*	Measure the encoding time of the CTUs.
+	*	@param puiCTUCost Frame sized array (raster scan order), where the time of each CTU of the tile is written.
+	*/
+	void					SetCTUCostMap(u32 *puiCTUCost){m_puiCTUCost = puiCTUCost;}
+
+	/**
+	*	Measure the bytes of the CTUs.
+	*	The bytes are the ones flushed to the bitstream while the CTU is entropy coded, which
+	*	sum up to the bytes of the tile over a CTU row.
+	*	@param puiCTUBytes Frame sized array (raster scan order), where the bytes of each CTU of the tile are written.
+	*/
+	void					SetCTUBytesMap(u32 *puiCTUBytes){m_puiCTUBytes = puiCTUBytes;}
+
+	/**
+	*	Set whether the tile ends its slice.
+	*	@param bLastTileOfSlice True if the last CTU of the tile is the last one of the slice.
+	*/
+	void					SetLastTileOfSlice(bit bLastTileOfSlice);
+
 	/**
 	*	Set tile ID.
 	*	@param uiID ID of the tile.
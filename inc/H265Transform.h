@@ -28,117 +28,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <TypeDefs.h>
 
+// The matrices are 16-bit, so that the SIMD kernels can read two neighbouring coefficients at once
+extern const i16 g_piDST4[4*4];		//!< 4x4 DST matrix
+extern const i16 g_piT4[4*4];		//!< 4x4 DCT matrix
+extern const i16 g_piT8[8*8];		//!< 8x8 DCT matrix
+extern const i16 g_piT16[16*16];		//!< 16x16 DCT matrix
+extern const i16 g_piT32[32*32];		//!< 32x32 DCT matrix
+extern const i16 g_piQuantScales[6];		//!< Quantization scales [QP%6]
+extern const i16 g_piInvQuantScales[6];	//!< Inverse quantization scales [QP%6]
+
 /**
 *	HEVC Transform.
 *	Implements the transforms for HEVC, from 32x32 to 4x4 DCT and 4x4 DST.
 */
 class H265Transform
 {
-private:
-	typedef void	(H265Transform::*DCT)(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);		//!< Function pointer type definition
-	typedef void	(H265Transform::*IDCT)(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);		//!< Function pointer type definition
-	DCT		DCTN[5];																								//!< Function pointers to DCT 
-	IDCT	IDCTN[5];																								//!< Function pointers to IDCT
-
-	/**
-	*	4x4 DST.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	DST4(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
-
-	/**
-	*	4x4 DCT.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	DCT4(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
-
-	/**
-	*	8x8 DCT.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	DCT8(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
-
-	/**
-	*	16x16 DCT.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	DCT16(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
-
-	/**
-	*	32x32 DCT.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	DCT32(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
-
-	/**
-	*	4x4 IDST.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	IDST4(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
-
-	/**
-	*	4x4 IDCT.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	IDCT4(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
-
-	/**
-	*	8x8 IDCT.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	IDCT8(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
-
-	/**
-	*	16x16 IDCT.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	IDCT16(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
-
-	/**
-	*	32x32 IDCT.
-	*	@param piDest Destination pointer.
-	*	@param piSrc Sournce data.
-	*	@param uiStride Stride for the next line of source.
-	*	@param uiTrLines Total size of the transform.
-	*	@param uiShift Shift of the transform.
-	*/
-	void	IDCT32(i16 *piDest, i16 *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
 public:
 
 	/**
@@ -167,16 +71,19 @@ public:
 	/**
 	*	Generate the quantized coefficients.
 	*	After Quantization, the output will contain 2Mx2M data in a linear order. I.e. a 4x4 will start from array location 0 and end at array location 16.
+	*	The significance map of the 4x4 groups is made in the same pass, so that the entropy coder does not search the coefficients.
 	*	@param piOutput Output pointer.
 	*	@param uiOutputStride Stride within the output for the next line.
+	*	@param puiSigMap Significance map of the 4x4 groups, with a stride of uiOutputStride/4 (see QuantFunc_t).
 	*	@param uiQP QP value.
 	*	@param uiWidth Width of the block.
 	*	@param uiHeight Height of the block.
 	*	@param piSrc Source pointer.
 	*	@param uiSrcStride Stride within the source for the next line.
 	*	@param eST Type of slice (I or P).
+	*	@return Number of the coefficients which are not zero.
 	*/
-	u32		Quant(i16 *piOutput, u32 uiOutputStride, u32 uiQP, u32 uiWidth, u32 uiHeight, i16 *piSrc, u32 uiSrcStride, eSliceType eST);
+	u32		Quant(i16 *piOutput, u32 uiOutputStride, u16 *puiSigMap, u32 uiQP, u32 uiWidth, u32 uiHeight, i16 *piSrc, u32 uiSrcStride, eSliceType eST);
 
 	/**
 	*	Generate inverse qunatized coefficients.
@@ -188,13 +95,15 @@ public:
 	*	@param uiHeight Height of the block.
 	*	@param piSrc Source pointer.
 	*	@param uiSrcStride Stride within the source for the next line.
+	*	@param puiSigMap Significance map of the source, made by Quant(). The 4x4 groups without coefficients are only set to zero.
 	*	@param eST Type of slice (I or P).
 	*/
-	void	InvQuant(i16 *piOutput, u32 uiOutputStride, u32 uiQP, u32 uiWidth, u32 uiHeight, i16 *piSrc, u32 uiSrcStride, eSliceType eST);
+	void	InvQuant(i16 *piOutput, u32 uiOutputStride, u32 uiQP, u32 uiWidth, u32 uiHeight, i16 *piSrc, u32 uiSrcStride, u16 const *puiSigMap, eSliceType eST);
 
 	/**
 	*	Recontruct after IDCT.
-	*	The output of the butterflies have the same stride as the source. Therefore, allocate the same amount of memory to the butterflies as is allocated (or accessed) in the source.
+	*	The second stage of the IDCT adds the prediction and writes the reconstruction directly.
+	*	The output of the first stage has the same stride as the source. Therefore, allocate the same amount of memory to the butterflies as is allocated (or accessed) in the source.
 	*	@param pbOutput Output pointer.
 	*	@param uiOutputStride Stride within the output for the next line.
 	*	@param uiWidth Width of the block.
@@ -203,10 +112,10 @@ public:
 	*	@param uiSrcStride Stride within the source for the next line.
 	*	@param pbRef Reference pointer.
 	*	@param uiRefStride Stride within the reference for the next line.
-	*	@param uiBufferflyOut1 Temporary buffer of size at least uiWidthxuiHeight.
+	*	@param piButterflyOut Temporary buffer of size at least uiWidthxuiHeight.
 	*	@param uiMode Mode of the encoding.
 	*/
-	void	IDCTRec(byte *pbOutput, u32 uiOutputStride, u32 uiWidth, u32 uiHeight, i16 *piSrc, u32 uiSrcStride, byte *pbRef, u32 uiRefStride, i16 *piButterflyOut1, i16 *piButterflyOut2, u32 uiMode);	
+	void	IDCTRec(byte *pbOutput, u32 uiOutputStride, u32 uiWidth, u32 uiHeight, i16 *piSrc, u32 uiSrcStride, byte *pbRef, u32 uiRefStride, i16 *piButterflyOut, u32 uiMode);	
 };
 
 #endif	// __H265TRANSFORM_H__
\ No newline at end of file
@@ -31,6 +31,40 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 class CTU;
 class InputParameters;
 
+/**
+*	Per-slice encoding parameters.
+*	These change from frame to frame and are therefore kept apart from ImageParameters,
+*	which is shared by all the GOP compressors that can be in flight at the same time.
+*/
+typedef struct _SliceParams
+{
+	eSliceType	eType;						//!<	Slice type (I, P, B etc.)
+	u32			uiQP;						//!<	Slice QP
+}SliceParams_t;
+
+/**
+*	Tile layout of a frame.
+*	The number of tile columns and rows is fixed for the sequence, their sizes may change from
+*	frame to frame. A layout which is not the uniform one is signalled explicitly in the PPS.
+*/
+typedef struct _TileLayout
+{
+	u32			puiColWidthInCTUs[MAX_TILE_COLUMNS];	//!<	Width of each tile column in CTUs
+	u32			puiRowHeightInCTUs[MAX_TILE_ROWS];		//!<	Height of each tile row in CTUs
+	bit			bUniform;								//!<	The sizes follow from uniform_spacing_flag
+}TileLayout_t;
+
+/**
+*	Slice layout of a frame.
+*	A slice is made of whole tiles in the tile scan order, or with one tile per frame, of whole CTU rows.
+*	Every slice of a frame has its own slice header and NAL unit.
+*/
+typedef struct _SliceLayout
+{
+	u32			uiNumSlices;								//!<	Total slices of the frame
+	u32			puiSliceSizeInUnits[MAX_SLICES_PER_FRAME];	//!<	Tiles of each slice, or CTU rows with one tile per frame
+}SliceLayout_t;
+
 /**
 *	Image parameters of a video frame.
 *	Currently, I am keeping everything public of this class. 
@@ -55,11 +89,17 @@ public:
 	u32		*m_puiTileCTUNumX;				//!<	Array to store the right-most CTU number of the tile
 	u32		*m_puiTileCTUNumY;				//!<	Array to store the bottom-most CTU number of the tile
 	u32		m_uiFrameHeightInTiles;			//!<	Total rows of tiles in one frame
-	eSliceType	m_eSliceType;				//!<	Slice type
 	u64		m_u64TotalBytesPerTile;			//!<	Total bytes allocated to a tile
+	TileLayout_t	m_sUniformTileLayout;	//!<	Tile layout with uniform spacing
+	u32		m_uiFrameSizeInSlices;			//!<	Most slices in one frame
+	u32		m_uiFrameSizeInRegions;			//!<	Total regions of a frame with their own tile compressor, i.e. the tiles or the CTU row bands of the slices
+	bit		m_bSliceBands;					//!<	The slices are bands of CTU rows of the only tile of the frame
+	u32		m_uiSliceMaxBytes;				//!<	Byte budget of a slice (0 for a fixed slice layout)
+	bit		m_bAdaptiveSlices;				//!<	The CTU row bands of the slices follow the measured bytes of the CTU rows
+	SliceLayout_t	m_sUniformSliceLayout;	//!<	Slice layout with slices of about the same size
 
 	// Frame processing
-	u32 	m_uiQP;                     	//!<	Current quantization
+	u32 	m_uiQP;                     	//!<	Initial quantization (per-slice QP is in SliceParams_t)
 	i32 	m_iType;						//!<	Frame m_iType (I, P, B)
 	i32 	m_uiCurrCTUNum;					//!<	Current CTU number
 	i32 	m_uiCurrSliceNum;				//!<	Current slice number
@@ -75,7 +115,8 @@ public:
 	u32		m_uiMaxNumRefFrames;			//!<	Maximum reference frames
 	u32		m_uiBitsForPOC;					//!<	Total bits for presenting POC
 	u32		m_uiMaxMergeCands;				//!<	Totoal merge candidates
-	u32		m_uiTileCodingSync;				//!<	Denotes if more than one tile per slice
+	u32		m_uiTileCodingSync;				//!<	Denotes if more than one tile per slice (1) or wavefront parallel processing (2)
+	bit		m_bAdaptiveTiles;				//!<	The tile layout follows the measured encoding time of the CTUs
 
 	/**
 	*	Constructor.
@@ -132,6 +173,45 @@ public:
 	void	SetTileStruct(u32 uiFrameWidth, u32 uiFrameHeight, u32 uiFrameSizeInTiles, u32 uiFrameWidthInTiles, u32 uiFrameHeightInTiles, 
 							u32 & uiMaxTileWidthInCTUs, u32 & uiMaxTileHeightInCTUs,
 							u32 *puiTileWidthInCTUs, u32 *puiTileHeightInCTUs, u32 *puiTileCTUNumX, u32 *puiTileCTUNumY);
+
+	/**
+	*	Compare two tile layouts of this frame.
+	*	@param sTileLayoutA First tile layout.
+	*	@param sTileLayoutB Second tile layout.
+	*	@return True if the tiles and their signalling are the same.
+	*/
+	bit		IsSameTileLayout(TileLayout_t const &sTileLayoutA, TileLayout_t const &sTileLayoutB) const;
+
+	/**
+	*	Compare two slice layouts of this frame.
+	*	@param sSliceLayoutA First slice layout.
+	*	@param sSliceLayoutB Second slice layout.
+	*	@return True if the slices are the same.
+	*/
+	bit		IsSameSliceLayout(SliceLayout_t const &sSliceLayoutA, SliceLayout_t const &sSliceLayoutB) const;
+
+	/**
+	*	Get the most tile columns and rows a frame may have.
+	*	The limits are the ones of the lowest HEVC level which allows the resolution, or of the highest
+	*	level, as a decoder of a higher level can also decode a smaller picture. Every tile is at least two CTUs
+	*	wide and high, as needed by the tile compressors.
+	*	@param uiFrameWidth Width of the frame in pixels.
+	*	@param uiFrameHeight Height of the frame in pixels.
+	*	@param bAnyLevel True for the limits of the highest level, false for the lowest level which allows the resolution.
+	*	@param uiMaxTileCols Most tile columns.
+	*	@param uiMaxTileRows Most tile rows.
+	*/
+	static void	GetMaxTiles(u32 uiFrameWidth, u32 uiFrameHeight, bit bAnyLevel, u32 &uiMaxTileCols, u32 &uiMaxTileRows);
+
+	/**
+	*	Get the most slices a frame may have.
+	*	The limit is the one of the lowest HEVC level which allows the resolution, or of the highest level.
+	*	@param uiFrameWidth Width of the frame in pixels.
+	*	@param uiFrameHeight Height of the frame in pixels.
+	*	@param bAnyLevel True for the limit of the highest level, false for the lowest level which allows the resolution.
+	*	@return Most slice segments per picture.
+	*/
+	static u32	GetMaxSlices(u32 uiFrameWidth, u32 uiFrameHeight, bit bAnyLevel);
 };
 
 #endif	// __IMAGEPARAMETERS_H__
\ No newline at end of file
@@ -39,13 +39,19 @@ public:
 	i32 	NumRefFrame;										//!<	Number of reference frames to be used
 	u32 	m_uiNumFrames;                						//!<	Number of frames to be encoded
 	i32 	m_iFrameRate;										//!<	Frame rate of the input
+	bit		m_bRealTime;										//!<	Use the fewest workers which meet the frame rate
 	u32 	m_uiQP;                      						//!<	QP of first frame
+	bit		m_bSATD;											//!<	Decide the intra modes and splits on the SATD instead of the SAD, with fewer modes tested
+	u32		m_uiISALevel;										//!<	Highest instruction set of the kernels (an eCPULevel, CPU_LEVEL_TOTAL for the one of the processor)
 	u32 	m_uiFrameWidth;                						//!<	Image uiWidth  (must be a multiple of 16 pels)
 	u32 	m_uiFrameHeight;               						//!<	Image height (must be a multiple of 16 pels)
 	u32		m_uiGopSize;										//!<	GOP size
 	u32		m_uiTilesPerFrame;									//!<	Total Tiles in one frame
 	u32		m_uiFrameWidthInTiles;								//!<	Total columns of the tiles in one frame
 	u32		m_uiFrameHeightInTiles;								//!<	Total rows of tiles in one frame
+	bit		m_bAdaptiveTiles;									//!<	Adapt the tile sizes to the measured encoding time
+	u32		m_uiSlicesPerFrame;									//!<	Total slices in one frame, each of them of about the same CTUs
+	u32		m_uiSliceMaxBytes;									//!<	Byte budget of a slice, the slices follow the bytes of the CTU rows (0 for a fixed number of slices)
 				
 	// Files and their names
 	i8  	m_cInputYuvName[100];								//!<	Name of Input File
@@ -57,6 +63,13 @@ public:
 	u32		m_uiNumGOPThreads;									//!<	Total number of GOP threads
 	u32		m_uiNumSliceThreads;								//!<	Total number of slice threads
 	u32		m_uiNumTileThreads;									//!<	Total number of tile threads
+	bit		m_bWPP;												//!<	Wavefront parallel processing (CTU rows of a tile are compressed concurrently)
+	u32		m_uiNumWorkers;										//!<	Total threads executing the jobs of the shared pool, including the main thread
+	u32		m_puiAffinityCPUs[MAX_AFFINITY_CPUS];				//!<	Processors the workers are pinned to, worker i to entry i modulo the total entries
+	u32		m_uiNumAffinityCPUs;								//!<	Total entries in m_puiAffinityCPUs (0 if the workers are not pinned)
+	i32		m_iRTPriority;										//!<	Real-time priority of the workers (0 for the normal scheduling policy)
+	u32		m_uiCTUPipeDepth;									//!<	CTUs of a tile buffered between the compression and the entropy coding (0 to entropy code on the compressing thread)
+	u32		m_uiIODepth;										//!<	GOPs read ahead of the compression by the reader thread (0 to read and write on the main thread)
 
 	// Others
 	bit		m_bVerbose;											//!< Display verbose output
@@ -0,0 +1,270 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file Kernels.h
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the table of the pixel kernels, which are chosen from the CPU features at startup.
+*/
+
+#ifndef __KERNELS_H__
+#define __KERNELS_H__
+
+#include <Defines.h>
+#include <TypeDefs.h>
+
+/**
+*	Architecture and compiler support of the SIMD kernels.
+*	With GCC and Clang, the SIMD kernels are compiled for their instruction set with a target attribute,
+*	so that the rest of the encoder stays compiled for the baseline processor.
+*/
+#if USE_SIMD && (defined __i386__ || defined __x86_64__ || defined _M_IX86 || defined _M_X64)
+#define			ARCH_X86					1
+#else
+#define			ARCH_X86					0
+#endif
+
+#if defined __GNUC__ || defined __clang__
+#define			TARGET_SSE41				__attribute__((target("sse4.1")))
+#define			TARGET_AVX2					__attribute__((target("avx2")))
+#define			TARGET_AVX512				__attribute__((target("avx512f,avx512bw")))
+#else
+#define			TARGET_SSE41
+#define			TARGET_AVX2
+#define			TARGET_AVX512
+#endif
+
+/**
+*	Instruction set levels of the kernels.
+*	Each level includes the ones below it.
+*/
+enum eCPULevel
+{
+	CPU_LEVEL_C = 0,			//!< Plain C kernels
+	CPU_LEVEL_SSE41,			//!< SSE4.1
+	CPU_LEVEL_AVX2,				//!< AVX2
+	CPU_LEVEL_AVX512,			//!< AVX-512 (F and BW)
+	CPU_LEVEL_TOTAL
+};
+
+/**
+*	Sum of absolute differences of a square block.
+*	@param pbSrc Top left sample of the source block.
+*	@param uiSrcStride Stride of the source block.
+*	@param pbRef Top left sample of the reference (e.g. prediction) block.
+*	@param uiRefStride Stride of the reference block.
+*	@return The SAD.
+*/
+typedef u32 (*SADFunc_t)(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride);
+
+/**
+*	Sum of absolute Hadamard transformed differences (SATD) of a square block.
+*	A 4x4 block is transformed by a 4x4 Hadamard transform, and the larger blocks by 8x8 ones. The sum of a 4x4 transform is halved
+*	and the one of an 8x8 transform is divided by 4, both rounded, to keep the SATD in the range of the SAD.
+*	@see SADFunc_t
+*	@return The SATD.
+*/
+typedef u32 (*SATDFunc_t)(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride);
+
+/**
+*	Angular intra prediction of a square block (see 8.4.3.1.6 in draft), once the reference of the main direction is made.
+*	The horizontal modes are predicted like the vertical ones and transposed at the end.
+*	@param pbPred Prediction block, whose stride is its size.
+*	@param pbMainRef Reference of the main direction. pbMainRef[0] is the top left sample, pbMainRef[1..2*size] are the samples
+*	along the main direction and, for negative angles, pbMainRef[-size..-1] are the samples projected from the side reference.
+*	The kernels may read up to 16 samples after pbMainRef[2*size] and use them for nothing.
+*	@param pbSideRef NULL, or the side reference of the edge filter of the pure horizontal and vertical luma modes (8.4.3.1.3 and 8.4.3.1.4).
+*	pbSideRef[0] is the top left sample and pbSideRef[1..size] are the samples along the side.
+*	@param iAngle Angle of the mode (intraPredAngle).
+*	@param bTranspose Transpose the prediction, for the horizontal modes.
+*/
+typedef void (*IntraPredAngFunc_t)(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose);
+
+/**
+*	DC intra prediction of a square block (see 8.4.3.1.5 in draft).
+*	@param pbPred Prediction block, whose stride is its size.
+*	@param pbRef Reference samples, from the bottom left (pbRef[0]) over the top left (pbRef[2*size]) to the top right (pbRef[4*size]).
+*	@param bFilterEdge Filter the first row and column with the reference samples, for luma.
+*/
+typedef void (*IntraPredDCFunc_t)(byte *pbPred, byte const *pbRef, bit bFilterEdge);
+
+/**
+*	Planar intra prediction of a square block (see 8.4.3.1.7 in draft).
+*	@param pbPred Prediction block, whose stride is its size.
+*	@param pbRef Reference samples, see IntraPredDCFunc_t.
+*/
+typedef void (*IntraPredPlanarFunc_t)(byte *pbPred, byte const *pbRef);
+
+/**
+*	Reference samples of the luma intra prediction in one pass from the bottom left to the top right.
+*	Each sample is fetched or substituted (see 8.4.3.1.1 in draft), stored, and [1 2 1] filtered as soon as its
+*	right neighbour is there (see 8.4.3.1.2 in draft). The first and the last filtered sample are copied.
+*	@param pbRef Unfiltered reference samples, see IntraPredDCFunc_t.
+*	@param pbFiltered Filtered reference samples.
+*	@param pbLeft Left neighbour of the first row of the block, the left samples go down with uiLeftStride.
+*	@param uiLeftStride Stride of the left samples.
+*	@param pbTopLeft Top left neighbour of the block, followed by the top and top right samples.
+*	@param puiRefOffset Start of the 5 neighbourhoods in pbRef and their end (see InitRefPointers()).
+*	@param bValidFlag Available neighbourhoods, bit VALID_LB to VALID_TR. At least one is set.
+*	@param uiSize Width and height of the block, i.e. there are 4*uiSize+1 reference samples.
+*/
+typedef void (*RefSamplesFunc_t)(byte *pbRef, byte *pbFiltered, byte const *pbLeft, u32 uiLeftStride, byte const *pbTopLeft,
+								 u32 const *puiRefOffset, u8 bValidFlag, u32 uiSize);
+
+/**
+*	One stage of a forward transform (see H265Transform::ResDCT()).
+*	Each line of the source is transformed into a column of the destination.
+*	@param piDest Destination pointer.
+*	@param piSrc Source data.
+*	@param uiStride Stride for the next line of source and destination.
+*	@param uiTrLines Total lines to transform.
+*	@param uiShift Shift of the transform.
+*/
+typedef void (*DCTFunc_t)(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
+
+/**
+*	First stage of an inverse transform (see H265Transform::IDCTRec()).
+*	Each column of the source is transformed into a line of the destination, which is saturated to 16 bits.
+*	@param piDest Destination pointer.
+*	@param piSrc Source data.
+*	@param uiStride Stride for the next line of source and destination.
+*	@param uiTrLines Total lines to transform.
+*	@param uiShift Shift of the transform.
+*/
+typedef void (*IDCTFunc_t)(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift);
+
+/**
+*	Second stage of an inverse transform with the reconstruction, i.e. the residue is added to the prediction and saturated by Clip1.
+*	@param pbRec Top left sample of the reconstructed block.
+*	@param uiRecStride Stride of the reconstructed block.
+*	@param piSrc Output of the first stage.
+*	@param uiStride Stride for the next line of the source (at most CTU_WIDTH).
+*	@param pbPred Top left sample of the prediction.
+*	@param uiPredStride Stride of the prediction.
+*/
+typedef void (*IDCTRecFunc_t)(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride);
+
+/**
+*	Quantization of a square block (see H265Transform::Quant()), with the significance map of its 4x4 groups.
+*	@param piCoeff Quantized coefficients.
+*	@param uiCoeffStride Stride of the coefficients.
+*	@param puiSigMap Significance map, one mask per 4x4 group of the coefficients with a stride of uiCoeffStride/4.
+*	Bit 4*y+x of a mask is set if the coefficient at (x,y) of the group is not zero.
+*	@param piSrc Transformed residue.
+*	@param uiSrcStride Stride of the transformed residue.
+*	@param iScale Scale of the QP.
+*	@param iRound Rounding offset.
+*	@param uiShift Shift of the quantization.
+*	@return Number of the coefficients which are not zero.
+*/
+typedef u32 (*QuantFunc_t)(i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift);
+
+/**
+*	Inverse quantization of a square block (see H265Transform::InvQuant()).
+*	The 4x4 groups without coefficients are not read, but set to zero.
+*	@param piDest Inverse quantized coefficients.
+*	@param uiDestStride Stride of the inverse quantized coefficients.
+*	@param piCoeff Quantized coefficients.
+*	@param uiCoeffStride Stride of the quantized coefficients.
+*	@param puiSigMap Significance map of the quantized coefficients, see QuantFunc_t.
+*	@param iScale Scale of the QP.
+*	@param uiShift Shift of the inverse quantization.
+*/
+typedef void (*InvQuantFunc_t)(i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift);
+
+/**
+*	Table of the kernels.
+*	The kernels of every level give exactly the same results as the C kernels.
+*/
+typedef struct _Kernels
+{
+	SADFunc_t			pfSAD[4];			//!< SAD of 4x4, 8x8, 16x16 and 32x32 blocks [log2 size-2]
+	SATDFunc_t			pfSATD[4];			//!< SATD of 4x4, 8x8, 16x16 and 32x32 blocks [log2 size-2]
+	IntraPredAngFunc_t	pfIntraPredAng[4];	//!< Angular intra prediction of 4x4 to 32x32 blocks [log2 size-2]
+	IntraPredDCFunc_t	pfIntraPredDC[4];	//!< DC intra prediction of 4x4 to 32x32 blocks [log2 size-2]
+	IntraPredPlanarFunc_t	pfIntraPredPlanar[4];	//!< Planar intra prediction of 4x4 to 32x32 blocks [log2 size-2]
+	RefSamplesFunc_t	pfRefSamples;		//!< Substituted and filtered reference samples of the intra prediction
+	DCTFunc_t			pfDCT[5];			//!< 4x4 DST and 4x4 to 32x32 DCT [log2 size-1-DST]
+	IDCTFunc_t			pfIDCT[5];			//!< First stage of the 4x4 IDST and 4x4 to 32x32 IDCT [log2 size-1-DST]
+	IDCTRecFunc_t		pfIDCTRec[5];		//!< Second stage of the 4x4 IDST and 4x4 to 32x32 IDCT with the reconstruction [log2 size-1-DST]
+	QuantFunc_t			pfQuant[4];			//!< Quantization of 4x4 to 32x32 blocks [log2 size-2]
+	InvQuantFunc_t		pfInvQuant[4];		//!< Inverse quantization of 4x4 to 32x32 blocks [log2 size-2]
+}Kernels_t;
+
+extern Kernels_t		g_sKernels;			//!< Kernels chosen by InitKernels()
+
+/**
+*	Get the highest level supported by the processor and the operating system.
+*	The CPUID instruction is only executed the first time.
+*	@return Level of the processor (CPU_LEVEL_C if SIMD is not supported or disabled).
+*/
+eCPULevel				GetCPULevel();
+
+/**
+*	Get the name of a level.
+*	@param eLevel Level.
+*	@return Name of the level.
+*/
+i8 const				*GetCPULevelName(eCPULevel eLevel);
+
+/**
+*	Get a level from its name, e.g. given by the user.
+*	The case, dots and dashes are ignored, i.e. "sse41" is SSE4.1 and "avx512" is AVX-512.
+*	@param pcName Name of the level.
+*	@param eLevel Level of the name, if there is one.
+*	@return True if the name is the one of a level.
+*/
+bit						GetCPULevelFromName(i8 const *pcName, eCPULevel &eLevel);
+
+/**
+*	Fill a kernel table with the kernels of all the levels up to a level, i.e. the best kernels of the level.
+*	The processor is not checked.
+*	@param sKernels Table of the kernels.
+*	@param eLevel Highest level of the kernels.
+*/
+void					FillKernels(Kernels_t &sKernels, eCPULevel eLevel);
+
+/**
+*	Fill g_sKernels with the best kernels of the processor.
+*	Must be called once before the first frame is compressed.
+*	@param eMaxLevel Highest level to use, e.g. to compare the levels or to reproduce a problem of the C kernels.
+*	@return Level of the chosen kernels, the lower of the processor level and eMaxLevel.
+*/
+eCPULevel				InitKernels(eCPULevel eMaxLevel = CPU_LEVEL_TOTAL);
+
+/**
+*	Check the kernels of every level up to a level against the C kernels, on blocks with random and extreme values.
+*	Only the kernels which a level has itself are checked, the others were checked with the level below.
+*	@param eLevel Highest level to check, at most the level of the processor.
+*	@param bVerbose Print the kernels checked of every level.
+*	@return Number of kernels whose results differ from the C kernels.
+*/
+u32						CheckKernels(eCPULevel eLevel, bit bVerbose);
+
+/**
+*	Fill a kernel table with the kernels of one level.
+*	Only the kernels, which the level has, are changed. The tables are filled level by level from the C kernels upwards.
+*	@param sKernels Table of the kernels.
+*/
+void					InitKernelsC(Kernels_t &sKernels);
+void					InitKernelsSSE41(Kernels_t &sKernels);	//!< See InitKernelsC()
+void					InitKernelsAVX2(Kernels_t &sKernels);	//!< See InitKernelsC()
+void					InitKernelsAVX512(Kernels_t &sKernels);	//!< See InitKernelsC()
+
+#endif	// __KERNELS_H__
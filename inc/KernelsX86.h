@@ -0,0 +1,225 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+* @file KernelsX86.h
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the helpers, which the SIMD kernels of the different x86 instruction sets share.
+* It is only included by the files of the kernels. The helpers need SSE4.1, and are inlined in the kernels of the higher levels.
+*/
+
+#ifndef __KERNELSX86_H__
+#define __KERNELSX86_H__
+
+#include <Kernels.h>
+
+#if ARCH_X86
+#include <immintrin.h>
+#include <string.h>
+
+/**
+*	Read 4 bytes from any address.
+*/
+static inline i32 Load32(byte const *pbSrc)
+{
+	i32 iVal;
+	memcpy(&iVal, pbSrc, 4);
+	return iVal;
+}
+
+/**
+*	Write 4 bytes to any address.
+*/
+static inline void Store32(byte *pbDst, i32 iVal)
+{
+	memcpy(pbDst, &iVal, 4);
+}
+
+/**
+*	Transpose an 8x8 block of bytes.
+*	@param pmRows The 8 rows, each in the lower 8 bytes of a register. They are replaced by the 8 columns.
+*/
+TARGET_SSE41 static inline void Transpose8x8(__m128i *pmRows)
+{
+	__m128i m01 = _mm_unpacklo_epi8(pmRows[0], pmRows[1]);
+	__m128i m23 = _mm_unpacklo_epi8(pmRows[2], pmRows[3]);
+	__m128i m45 = _mm_unpacklo_epi8(pmRows[4], pmRows[5]);
+	__m128i m67 = _mm_unpacklo_epi8(pmRows[6], pmRows[7]);
+	__m128i m0123Lo = _mm_unpacklo_epi16(m01, m23);		// Columns 0 to 3 of rows 0 to 3
+	__m128i m0123Hi = _mm_unpackhi_epi16(m01, m23);		// Columns 4 to 7 of rows 0 to 3
+	__m128i m4567Lo = _mm_unpacklo_epi16(m45, m67);
+	__m128i m4567Hi = _mm_unpackhi_epi16(m45, m67);
+	__m128i mCol01 = _mm_unpacklo_epi32(m0123Lo, m4567Lo);
+	__m128i mCol23 = _mm_unpackhi_epi32(m0123Lo, m4567Lo);
+	__m128i mCol45 = _mm_unpacklo_epi32(m0123Hi, m4567Hi);
+	__m128i mCol67 = _mm_unpackhi_epi32(m0123Hi, m4567Hi);
+	pmRows[0] = mCol01;
+	pmRows[1] = _mm_unpackhi_epi64(mCol01, mCol01);
+	pmRows[2] = mCol23;
+	pmRows[3] = _mm_unpackhi_epi64(mCol23, mCol23);
+	pmRows[4] = mCol45;
+	pmRows[5] = _mm_unpackhi_epi64(mCol45, mCol45);
+	pmRows[6] = mCol67;
+	pmRows[7] = _mm_unpackhi_epi64(mCol67, mCol67);
+}
+
+/**
+*	Load an 8x8 block of bytes, each row in the lower 8 bytes of a register.
+*/
+TARGET_SSE41 static inline void Load8x8(byte const *pbSrc, u32 uiStride, __m128i *pmRows)
+{
+	for(u32 i=0;i<8;i++)
+		pmRows[i] = _mm_loadl_epi64((__m128i const *)(pbSrc+i*uiStride));
+}
+
+/**
+*	Store an 8x8 block of bytes from the lower 8 bytes of the registers.
+*/
+TARGET_SSE41 static inline void Store8x8(byte *pbDst, u32 uiStride, __m128i const *pmRows)
+{
+	for(u32 i=0;i<8;i++)
+		_mm_storel_epi64((__m128i *)(pbDst+i*uiStride), pmRows[i]);
+}
+
+/**
+*	Transpose a square block of bytes in place.
+*	@param pbBlk Block, whose stride is its size.
+*	@param uiSize Width and height of the block (4, 8, 16 or 32).
+*/
+TARGET_SSE41 static inline void TransposeBlock(byte *pbBlk, u32 uiSize)
+{
+	if(uiSize == 4)
+	{
+		__m128i mBlk = _mm_loadu_si128((__m128i const *)pbBlk);
+		mBlk = _mm_shuffle_epi8(mBlk, _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+		_mm_storeu_si128((__m128i *)pbBlk, mBlk);
+		return;
+	}
+
+	// Swap the transposed 8x8 blocks on both sides of the diagonal
+	__m128i pmBlkA[8];
+	__m128i pmBlkB[8];
+	for(u32 i=0;i<uiSize;i+=8)
+	{
+		Load8x8(pbBlk+i*uiSize+i, uiSize, pmBlkA);
+		Transpose8x8(pmBlkA);
+		Store8x8(pbBlk+i*uiSize+i, uiSize, pmBlkA);
+		for(u32 j=i+8;j<uiSize;j+=8)
+		{
+			Load8x8(pbBlk+i*uiSize+j, uiSize, pmBlkA);
+			Load8x8(pbBlk+j*uiSize+i, uiSize, pmBlkB);
+			Transpose8x8(pmBlkA);
+			Transpose8x8(pmBlkB);
+			Store8x8(pbBlk+j*uiSize+i, uiSize, pmBlkA);
+			Store8x8(pbBlk+i*uiSize+j, uiSize, pmBlkB);
+		}
+	}
+}
+
+/**
+*	Edge filter of 8 samples of the pure horizontal and vertical modes, Clip1(iBase + ((pbSideRef[x+1] - pbSideRef[0])>>1)).
+*	@param pbSide First of the 8 side samples.
+*	@param mCorner Top left sample in every 16-bit lane.
+*	@param mBase Predicted sample before the filter in every 16-bit lane.
+*	@return The 8 samples as 16-bit values.
+*/
+TARGET_SSE41 static inline __m128i EdgeFilter8(byte const *pbSide, __m128i mCorner, __m128i mBase)
+{
+	__m128i mSide = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const *)pbSide));
+	return _mm_add_epi16(mBase, _mm_srai_epi16(_mm_sub_epi16(mSide, mCorner), 1));
+}
+
+/**
+*	Apply the edge filter and the transpose of the angular intra prediction, after the rows are predicted.
+*	@see IntraPredAngFunc_t
+*	@param uiSize Width and height of the block.
+*/
+TARGET_SSE41 static inline void FinishIntraPredAng(u32 uiSize, byte *pbPred, byte const *pbSideRef, bit bTranspose)
+{
+	byte pbEdge[CTU_WIDTH];
+	if(pbSideRef)
+	{
+		// The angle is 0, so the whole first column is pbMainRef[1] before the filter
+		__m128i mCorner = _mm_set1_epi16(pbSideRef[0]);
+		__m128i mBase = _mm_set1_epi16(pbPred[0]);
+		if(uiSize == 4)
+		{
+			byte pbSide[8];
+			memcpy(pbSide, pbSideRef+1, 4);
+			memset(pbSide+4, 0, 4);
+			__m128i mEdge = EdgeFilter8(pbSide, mCorner, mBase);
+			Store32(pbEdge, _mm_cvtsi128_si32(_mm_packus_epi16(mEdge, mEdge)));
+		}
+		else
+		{
+			for(u32 x=0;x<uiSize;x+=8)
+			{
+				__m128i mEdge = EdgeFilter8(pbSideRef+1+x, mCorner, mBase);
+				_mm_storel_epi64((__m128i *)(pbEdge+x), _mm_packus_epi16(mEdge, mEdge));
+			}
+		}
+	}
+
+	if(bTranspose)
+	{
+		TransposeBlock(pbPred, uiSize);
+		if(pbSideRef)	// The first column is the first row now
+			memcpy(pbPred, pbEdge, uiSize);
+	}
+	else if(pbSideRef)
+		for(u32 x=0;x<uiSize;x++)
+			pbPred[x*uiSize] = pbEdge[x];
+}
+
+/**
+*	Load 8 lines of a block for the forward transforms, as pairs of neighbouring samples for PMADDWD.
+*	Each 32-bit pair of samples of 4 lines is transposed into a register, i.e. pmPairs[2*j+h] holds the samples 2*j and 2*j+1
+*	of the lines 4*h to 4*h+3.
+*	@param piSrc First line.
+*	@param uiStride Stride for the next line.
+*	@param uiSize Samples per line (8 to 32).
+*	@param pmPairs The pairs of the samples.
+*/
+TARGET_SSE41 static inline void LoadPairs(i16 const *piSrc, u32 uiStride, u32 uiSize, __m128i *pmPairs)
+{
+	for(u32 n=0;n<uiSize;n+=8)
+	{
+		for(u32 h=0;h<2;h++)
+		{
+			i16 const *piLines = piSrc+4*h*uiStride+n;
+			__m128i mLine0 = _mm_loadu_si128((__m128i const *)piLines);
+			__m128i mLine1 = _mm_loadu_si128((__m128i const *)(piLines+uiStride));
+			__m128i mLine2 = _mm_loadu_si128((__m128i const *)(piLines+2*uiStride));
+			__m128i mLine3 = _mm_loadu_si128((__m128i const *)(piLines+3*uiStride));
+			__m128i m01Lo = _mm_unpacklo_epi32(mLine0, mLine1);
+			__m128i m23Lo = _mm_unpacklo_epi32(mLine2, mLine3);
+			__m128i m01Hi = _mm_unpackhi_epi32(mLine0, mLine1);
+			__m128i m23Hi = _mm_unpackhi_epi32(mLine2, mLine3);
+			pmPairs[(n>>1)*2+h] = _mm_unpacklo_epi64(m01Lo, m23Lo);
+			pmPairs[((n>>1)+1)*2+h] = _mm_unpackhi_epi64(m01Lo, m23Lo);
+			pmPairs[((n>>1)+2)*2+h] = _mm_unpacklo_epi64(m01Hi, m23Hi);
+			pmPairs[((n>>1)+3)*2+h] = _mm_unpackhi_epi64(m01Hi, m23Hi);
+		}
+	}
+}
+
+#endif	// ARCH_X86
+
+#endif	// __KERNELSX86_H__
@@ -0,0 +1,99 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file SliceBalancer.h
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the SliceBalancer class, which adapts the slices to their byte budget.
+*/
+
+#ifndef __SLICEBALANCER_H__
+#define __SLICEBALANCER_H__
+
+#include <Defines.h>
+#include <TypeDefs.h>
+#include <ImageParameters.h>
+
+/**
+*	Slice balancer.
+*	Keeps the bytes of every CTU row of the previous frames and chooses the CTU row bands of the slices,
+*	so that every slice is predicted to fit into its byte budget, e.g. into one network packet, with the
+*	fewest slices.
+*/
+class SliceBalancer
+{
+private:
+	ImageParameters const	*m_pcImageParam;		//!< Image parameters
+	u64						*m_pu64RowBytes;		//!< Predicted bytes of each CTU row
+	bit						m_bBytesValid;			//!< At least one frame has been measured
+	SliceLayout_t			m_sSliceLayout;			//!< Slice layout chosen for the next frames
+	u64						m_u64TotalFrames;		//!< Frames measured
+	u64						m_u64TotalSlices;		//!< Slices of the measured frames
+	u64						m_u64OverBudgetSlices;	//!< Slices of the measured frames which took more bytes than the budget
+
+public:
+	/**
+	*	Constructor.
+	*	The slices start with one CTU row each (as many as the level allows), until the bytes are known.
+	*	@param pcImageParam Image parameters of a video frame.
+	*/
+	SliceBalancer(ImageParameters const *pcImageParam);
+	~SliceBalancer();
+
+	/**
+	*	Add the measured bytes of a frame.
+	*	@param puiCTUBytes Bytes of each CTU of the frame in raster scan order.
+	*	@param uiNumSlices Total slices of the frame.
+	*	@param pu64BytesPerSlice Bytes of each slice of the frame.
+	*/
+	void					AddFrameBytes(u32 const *puiCTUBytes, u32 uiNumSlices, u64 const *pu64BytesPerSlice);
+
+	/**
+	*	Choose a new slice layout from the measured bytes.
+	*	The CTU rows are packed greedily into slices, which are filled up to SLICE_BYTES_FILL percent of the budget.
+	*	@return True if the layout has changed.
+	*/
+	bit						UpdateSliceLayout();
+
+	/**
+	*	Get the slice layout for the next frames.
+	*	@return Slice layout.
+	*/
+	SliceLayout_t const		&GetSliceLayout(){return m_sSliceLayout;}
+
+	/**
+	*	Get the average slices per frame.
+	*	@return Slices per measured frame.
+	*/
+	f64						GetAvgSlices(){return m_u64TotalFrames ? f64(m_u64TotalSlices)/m_u64TotalFrames : 0;}
+
+	/**
+	*	Get the total slices of the measured frames.
+	*	@return Total slices.
+	*/
+	u64						GetTotalSlices(){return m_u64TotalSlices;}
+
+	/**
+	*	Get the slices which took more bytes than the budget.
+	*	@return Total slices over the budget.
+	*/
+	u64						GetOverBudgetSlices(){return m_u64OverBudgetSlices;}
+};
+
+#endif	// __SLICEBALANCER_H__
@@ -0,0 +1,138 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file TaskGraph.h
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the TaskGraph class, which runs tasks with dependencies on a work queue.
+*/
+
+#ifndef __TASKGRAPH_H__
+#define __TASKGRAPH_H__
+
+#include <Defines.h>
+#include <TypeDefs.h>
+#include <Utilities.h>
+
+class WorkQueue;
+class WorkItem;
+class TaskGraph;
+
+/**
+*	Task of a task graph.
+*	The pending dependencies are counted down by the tasks it depends upon, the last one makes it ready.
+*	Every task has its own cache lines, as the neighbouring tasks are run by different threads.
+*/
+typedef struct CACHE_ALIGNED _TaskNode
+{
+	CACHE_ALIGNED_NEW
+
+	void				*(*pfFunc)(void *p);						//!< Function of the task
+	void				*pArgs;										//!< Arguments of the function
+	u32					uiNumDeps;									//!< Total tasks this task depends upon
+	volatile i64		i64PendingDeps;								//!< Tasks this task still waits for
+	u32					uiNumSuccessors;							//!< Total tasks depending upon this task
+	u32					puiSuccessors[MAX_TASK_SUCCESSORS];			//!< Tasks depending upon this task
+	WorkItem			*pcWorkItem;								//!< Work item, which runs the task on the work queue
+	TaskGraph			*pcGraph;									//!< Graph of the task
+}TaskNode_t;
+
+/**
+*	Directed acyclic graph of tasks.
+*	The graph is built once and can be run many times. A task becomes ready when all the tasks it
+*	depends upon are done, and is then pushed to the work queue by the thread which finished the last
+*	of them. Nothing is polled, and the thread running the graph helps with the tasks until all are done.
+*/
+class CACHE_ALIGNED TaskGraph
+{
+private:
+	TaskNode_t			*m_pcTasks;									//!< Tasks of the graph
+	u32					m_uiMaxTasks;								//!< Maximum tasks in the graph
+	u32					m_uiNumTasks;								//!< Total tasks in the graph
+	WorkQueue			*m_pcWorkQueue;								//!< Queue of the current run (NULL if run by the calling thread only)
+	CACHE_ALIGNED volatile i64	m_i64PendingTasks;					//!< Tasks pushed to the work queue but not done yet (on its own cache line)
+	WorkItem			**m_ppcReadyTasks;							//!< Stack of ready tasks without a work queue, ready tasks to queue at once otherwise
+	u32					m_uiNumReadyTasks;							//!< Total ready tasks on the stack
+
+	/**
+	*	Count down the pending dependencies of a task.
+	*	@param uiTask Task number.
+	*	@return True if the task is ready now.
+	*/
+	bit					ReleaseTask(u32 uiTask);
+
+	/**
+	*	Queue ready tasks, all at once on the work queue.
+	*	@param ppcTasks Work items of the ready tasks.
+	*	@param uiNumTasks Total ready tasks.
+	*/
+	void				QueueTasks(WorkItem **ppcTasks, u32 uiNumTasks);
+
+	/**
+	*	Execute a task and release the tasks depending upon it.
+	*	@param pArgs The task (TaskNode_t).
+	*/
+	static void			*ExecTask(void *pArgs);
+
+public:
+	CACHE_ALIGNED_NEW
+
+	/**
+	*	Constructor.
+	*	@param uiMaxTasks Maximum tasks in the graph.
+	*/
+	TaskGraph(u32 uiMaxTasks);
+
+	~TaskGraph();
+
+	/**
+	*	Remove all the tasks.
+	*/
+	void				Clear();
+
+	/**
+	*	Add a task.
+	*	@param pfFunc Function of the task.
+	*	@param pArgs Arguments of the function.
+	*	@return Task number.
+	*/
+	u32					AddTask(void *(*pfFunc)(void *p), void *pArgs);
+
+	/**
+	*	Let a task depend upon another task.
+	*	Successors are released in the reverse order of their dependencies, so that on a work queue
+	*	the first successor of a task is usually run next by the same thread.
+	*	@param uiTask Task which depends upon the other.
+	*	@param uiDependsOn Task which must be done before.
+	*/
+	void				AddDependency(u32 uiTask, u32 uiDependsOn);
+
+	/**
+	*	Run all the tasks of the graph and wait until they are done.
+	*	@param pcWorkQueue Work queue executing the tasks, or NULL to run them on the calling thread.
+	*/
+	void				Run(WorkQueue *pcWorkQueue);
+
+	/**
+	*	Get the total tasks in the graph.
+	*/
+	u32					GetNumTasks(){return m_uiNumTasks;}
+};
+
+#endif // __TASKGRAPH_H__
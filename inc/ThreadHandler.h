@@ -41,20 +41,30 @@ private:
 	int			m_iStatus;			//!< 1 -> Running, 0 -> Idle
 	int			m_iDetached;		//!< 1 -> Detached, 0 -> Not detached (default)
 	pthread_t	m_TID;				//!< Thread ID
+	int			m_iCPU;				//!< Processor the thread is pinned to (-1 if not pinned)
+	int			m_iRTPriority;		//!< Real-time priority of the thread (0 for the normal scheduling policy)
 
 public:
 	/**
 	*	Constructor.
 	*	@param pcWorkQueue Working queue which holds the jobs for the thread.
+	*	@param iCPU Processor the thread is pinned to, or -1 to leave it to the OS.
+	*	@param iRTPriority Real-time priority of the thread, or 0 for the normal scheduling policy.
 	*	@see WorkQueue()
 	*/
-	ThreadHandler(WorkQueue *pcWorkQueue);
+	ThreadHandler(WorkQueue *pcWorkQueue, int iCPU = -1, int iRTPriority = 0);
 	
+	/**
+	*	Destructor.
+	*	Joins the thread, therefore WorkQueue::Shutdown() must be called before.
+	*/
 	~ThreadHandler();
 	
 	/**
 	*	Actual runing function of the thread.
 	*	When this function is called, the thread will start running continously and will look for a job in the queue. 
+	*	The thread is pinned and its scheduling policy is set before it takes the first job, so that the memory
+	*	it touches first is placed on its own NUMA node. It returns when the queue is shut down.
 	*/
 	void		*RunThread();
 
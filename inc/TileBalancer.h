@@ -0,0 +1,119 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* @file TileBalancer.h
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the TileBalancer class, which adapts the tile layout to the encoding time.
+*/
+
+#ifndef __TILEBALANCER_H__
+#define __TILEBALANCER_H__
+
+#include <Defines.h>
+#include <TypeDefs.h>
+#include <ImageParameters.h>
+
+/**
+*	Tile balancer.
+*	Keeps a smoothed map of the encoding time of every CTU and chooses the tile column widths
+*	and row heights, so that the slowest tile of the frame (the critical path of a slice when the
+*	tiles are compressed concurrently) is as fast as possible.
+*/
+class TileBalancer
+{
+private:
+	ImageParameters const	*m_pcImageParam;		//!< Image parameters
+	u64						*m_pu64CTUCost;			//!< Smoothed encoding time of each CTU in raster scan order
+	u64						*m_pu64IntegralCost;	//!< Summed area table of the CTU costs, one row and column larger than the frame
+	bit						m_bCostValid;			//!< At least one frame has been measured
+	TileLayout_t			m_sTileLayout;			//!< Tile layout chosen for the next frames
+
+	/**
+	*	Get the cost of a rectangle of CTUs.
+	*	@param uiX0 First CTU column.
+	*	@param uiY0 First CTU row.
+	*	@param uiX1 CTU column after the last one.
+	*	@param uiY1 CTU row after the last one.
+	*	@return Sum of the costs of the CTUs.
+	*/
+	u64						GetRectCost(u32 uiX0, u32 uiY0, u32 uiX1, u32 uiY1);
+
+	/**
+	*	Get the cost of a tile column (or row) spanning the given CTUs, i.e. the cost of its slowest tile.
+	*	@param bColumns True for a tile column, false for a tile row.
+	*	@param uiStart First CTU column (or row) of the tile column (or row).
+	*	@param uiEnd CTU column (or row) after the last one.
+	*	@param sTileLayout Tile layout which gives the tile rows (or columns) crossing it.
+	*	@return Cost of the slowest tile.
+	*/
+	u64						GetSpanCost(bit bColumns, u32 uiStart, u32 uiEnd, TileLayout_t const &sTileLayout);
+
+	/**
+	*	Get the cost of the slowest tile.
+	*	@param sTileLayout Tile layout.
+	*	@return Cost of the slowest tile.
+	*/
+	u64						GetCriticalPath(TileLayout_t const &sTileLayout);
+
+	/**
+	*	Split the frame into tile columns (or rows) with the smallest cost of the slowest tile.
+	*	The tile rows (or columns) are kept as they are. Every tile is at least 2 CTUs wide and high.
+	*	@param bColumns True to split the columns, false to split the rows.
+	*	@param sTileLayout Tile layout which is modified.
+	*/
+	void					SplitMinMax(bit bColumns, TileLayout_t &sTileLayout);
+
+	/**
+	*	Split greedily with a limit on the cost of a tile.
+	*	@param bColumns True to split the columns, false to split the rows.
+	*	@param u64MaxCost Cost which a tile must not exceed.
+	*	@param sTileLayout Tile layout where the sizes are written.
+	*	@return True if the limit can be met.
+	*/
+	bit						SplitWithMaxCost(bit bColumns, u64 u64MaxCost, TileLayout_t &sTileLayout);
+
+public:
+	/**
+	*	Constructor.
+	*	@param pcImageParam Image parameters of a video frame.
+	*/
+	TileBalancer(ImageParameters const *pcImageParam);
+	~TileBalancer();
+
+	/**
+	*	Add the measured encoding time of a frame.
+	*	@param puiCTUCost Time of each CTU of the frame in raster scan order.
+	*/
+	void					AddFrameCost(u32 const *puiCTUCost);
+
+	/**
+	*	Choose a new tile layout from the measured encoding time.
+	*	The layout is only changed if the slowest tile is predicted to get faster by at least ADAPTIVE_TILES_MIN_GAIN percent.
+	*	@return True if the layout has changed.
+	*/
+	bit						UpdateTileLayout();
+
+	/**
+	*	Get the tile layout for the next frames.
+	*	@return Tile layout.
+	*/
+	TileLayout_t const		&GetTileLayout(){return m_sTileLayout;}
+};
+
+#endif	// __TILEBALANCER_H__
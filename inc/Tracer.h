@@ -0,0 +1,142 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file Tracer.h
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the Tracer class, which writes the trace messages of the threads without locking.
+*/
+
+#ifndef __TRACER_H__
+#define __TRACER_H__
+
+#include <Defines.h>
+#include <TypeDefs.h>
+#include <Utilities.h>
+#include <pthread.h>
+
+/**
+*	Trace a message with printf() like arguments.
+*	Levels above TRACE_LEVEL are removed by the compiler, the others are checked against the run-time level.
+*/
+#define			TRACE(level, ...)																\
+	do{																							\
+		if((level) <= TRACE_LEVEL && (level) <= Tracer::GetLevel())								\
+			Tracer::Log(__VA_ARGS__);															\
+	}while(0)
+
+/**
+*	Trace message.
+*/
+typedef struct _TraceRecord
+{
+	u64					u64TimeUSec;								//!< Time of the message in usec
+	i8					pcMsg[TRACE_MSG_LEN];						//!< Message
+}TraceRecord_t;
+
+/**
+*	Ring of the trace messages of one thread.
+*	Only the thread writes the head and only the flusher writes the tail, so they are on separate cache lines.
+*/
+typedef struct CACHE_ALIGNED _TraceRing
+{
+	CACHE_ALIGNED_NEW
+
+	volatile i64		i64Head;									//!< Messages written by the thread
+	volatile i64		i64Dropped;									//!< Messages dropped, as the ring was full
+	CACHE_ALIGNED volatile i64	i64Tail;							//!< Messages written out by the flusher
+	TraceRecord_t		*psRecords;									//!< TRACE_RING_SIZE messages
+	struct _TraceRing	*psNext;									//!< Ring of the next thread
+}TraceRing_t;
+
+/**
+*	Tracer.
+*	Every thread writes its messages to its own ring, which is made the first time the thread traces.
+*	A message never waits: if the ring is full, it is dropped and counted. A flusher thread writes the
+*	messages of all the rings to stdout in the order of their time every TRACE_FLUSH_PERIOD msec.
+*	Before Start() and after Stop(), the messages are written to stdout right away.
+*/
+class Tracer
+{
+private:
+	static i32				m_iLevel;								//!< Run-time trace level
+	static bool				m_bRunning;								//!< Flusher is running
+	static i64				m_i64Generation;						//!< Incremented by Stop(), so that the threads make new rings after a restart
+	static TraceRing_t		*m_psRings;								//!< Rings of all the threads
+	static pthread_t		m_ptFlusher;							//!< Flusher thread
+	static pthread_mutex_t	m_ptMutex;								//!< Guards the list of rings and the flushing
+	static pthread_cond_t	m_ptCond;								//!< Wakes up the flusher
+
+	/**
+	*	Get the ring of the calling thread, make it if needed.
+	*	@return Ring of the thread.
+	*/
+	static TraceRing_t		*GetThreadRing();
+
+	/**
+	*	Write out the messages of all the rings in the order of their time.
+	*	Must be called with m_ptMutex held.
+	*/
+	static void				Drain();
+
+	/**
+	*	Flusher thread.
+	*	@param pArgs Unused.
+	*/
+	static void				*FlusherThread(void *pArgs);
+
+public:
+	/**
+	*	Start the flusher.
+	*	Must be called before the other threads trace.
+	*/
+	static void				Start();
+
+	/**
+	*	Stop the flusher, write out the pending messages and free the rings.
+	*	Must be called after the other threads are finished.
+	*/
+	static void				Stop();
+
+	/**
+	*	Write out the pending messages now.
+	*	Used before printing directly to stdout, so that the output stays in order.
+	*/
+	static void				Flush();
+
+	/**
+	*	Trace a message, use TRACE() instead.
+	*	@param pcFormat printf() format string.
+	*/
+	static void				Log(i8 const *pcFormat, ...);
+
+	/**
+	*	Set the run-time trace level.
+	*	@param iLevel Messages of this level and below are traced (TRACE_LEVEL_OFF for none).
+	*/
+	static void				SetLevel(i32 iLevel){m_iLevel = iLevel;}
+
+	/**
+	*	Get the run-time trace level.
+	*	@return Trace level.
+	*/
+	static i32				GetLevel(){return m_iLevel;}
+};
+
+#endif	// __TRACER_H__
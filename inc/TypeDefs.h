@@ -33,7 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <math.h>
 
 #ifdef _MSC_VER
-#include <intrin.h>	// @todo For linux, I think I can use x86intrin.h
+#include <intrin.h>	// For the _Interlocked functions, GCC has builtins, and the SIMD intrinsics are only included by the kernels (see KernelsX86.h)
 #endif
 
 #define			I32_MIN						-(1<<31)				//!<	Min 32-bit signed
@@ -229,6 +229,46 @@ typedef enum {
 #define		sleep(A)		Sleep(A)
 #endif
 
+/**
+*	Atomic operations.
+*	Used by the lock-free parts of the thread handling. All of them act as full memory barriers.
+*	The operands must be 64-bit signed integers (i64) declared volatile.
+*/
+#ifdef _MSC_VER
+#define			ATOMIC_LOAD(A)				(A)													//!< Read A (volatile reads are acquire on MSVC).
+#define			ATOMIC_STORE(A,B)			_InterlockedExchange64(&(A),(B))					//!< Write B to A.
+#define			ATOMIC_FETCH_ADD(A,B)		_InterlockedExchangeAdd64(&(A),(B))					//!< Add B to A and return the old value of A.
+#define			ATOMIC_CAS(A,B,C)			(_InterlockedCompareExchange64(&(A),(C),(B)) == (B))	//!< If A equals B, set A to C. Returns true on success.
+#define			MEMORY_BARRIER()			MemoryBarrier()										//!< Full memory barrier.
+#define			CPU_RELAX()					YieldProcessor()									//!< Hint to the CPU that we are spinning.
+#define			THREAD_LOCAL				__declspec(thread)									//!< Thread local storage.
+#else
+#define			ATOMIC_LOAD(A)				__atomic_load_n(&(A),__ATOMIC_SEQ_CST)				//!< Read A.
+#define			ATOMIC_STORE(A,B)			__atomic_store_n(&(A),(B),__ATOMIC_SEQ_CST)			//!< Write B to A.
+#define			ATOMIC_FETCH_ADD(A,B)		__sync_fetch_and_add(&(A),(B))						//!< Add B to A and return the old value of A.
+#define			ATOMIC_CAS(A,B,C)			__sync_bool_compare_and_swap(&(A),(B),(C))			//!< If A equals B, set A to C. Returns true on success.
+#define			MEMORY_BARRIER()			__sync_synchronize()								//!< Full memory barrier.
+#if defined __i386__ || defined __x86_64__
+#define			CPU_RELAX()					__builtin_ia32_pause()								//!< Hint to the CPU that we are spinning.
+#else
+#define			CPU_RELAX()					__sync_synchronize()								//!< Hint to the CPU that we are spinning.
+#endif
+#define			THREAD_LOCAL				__thread											//!< Thread local storage.
+#endif
+
+/**
+*	Cache line alignment.
+*	A type or a member declared CACHE_ALIGNED starts on a cache line, and the size of the type is rounded
+*	up to whole cache lines. The data written by different threads is kept apart this way, so that the
+*	threads do not invalidate each other's lines (false sharing). The heap objects of such a type must be
+*	allocated with CACHE_ALIGNED_NEW (see Utilities.h).
+*/
+#ifdef _MSC_VER
+#define			CACHE_ALIGNED				__declspec(align(64))	// Must be a literal, keep it equal to CACHE_LINE_SIZE
+#else
+#define			CACHE_ALIGNED				__attribute__((aligned(CACHE_LINE_SIZE)))
+#endif
+
 #define			SATURATE_HIGH(A,B)			((A)>(B)?(B):(A))				//!< Saturate A after B.
 #define			SATURATE_LOW(A,B)			((A)<(B)?(B):(A))				//!< Saturate A before B.
 #define			SATURATE(A,B,C)				((A)<(B)?(B):((A)>(C)?(C):(A)))	//!< Saturate A between B (low) and C (high)
@@ -26,12 +26,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define __UTILITIES_H__
 
 #include <TypeDefs.h>
+#include <stddef.h>
 
 /**
 *	Get time in mili seconds.
 */
 u32 GetTimeInMiliSec();
 
+/**
+*	Get time in micro seconds.
+*	Only differences of the returned values are meaningful.
+*/
+u64 GetTimeInMicroSec();
+
 /**
 *	Bubble sort the values and their indexes.
 *	Help is taken from: http://rosettacode.org/wiki/Sorting_algorithms/Bubble_sort#C
@@ -48,4 +55,81 @@ void BubbleSortValIndex(i32 *piVals, i32 *piIdx, u32 uiSize);
 */
 void GetCurrentDateTime(i8 *piBuff, u32 uiBuffSize);
 
+/**
+*	Get the number of processors which are currently online.
+*	@return Online processors (at least 1).
+*/
+u32 GetNumOnlineCores();
+
+/**
+*	Get the number of processors the encoder can actually use.
+*	Takes the online processors, the affinity mask of the process and the CPU quota of its control group into account.
+*	@return Usable processors (at least 1).
+*/
+u32 GetNumUsableCores();
+
+/**
+*	Get the size of a data cache of the first processor.
+*	@param uiLevel Cache level (1 for L1 and so on).
+*	@return Size in bytes (0 if unknown).
+*/
+u64 GetCacheSize(u32 uiLevel);
+
+/**
+*	Parse a list of processors.
+*	The list is made of comma separated processor numbers and ranges, e.g. "0-3,8,10-11".
+*	@param pcList The list.
+*	@param puiCPUs Array where the processor numbers are written in the order of the list.
+*	@param uiMaxCPUs Size of the array.
+*	@return Total processors in the list, or 0 if the list is malformed or too long.
+*/
+u32 ParseCPUList(i8 const *pcList, u32 *puiCPUs, u32 uiMaxCPUs);
+
+/**
+*	Get the NUMA node of a processor.
+*	@param uiCPU Processor number.
+*	@return NUMA node of the processor (0 if unknown).
+*/
+i32 GetNUMANodeOfCPU(u32 uiCPU);
+
+/**
+*	Pin the calling thread to one processor.
+*	@param uiCPU Processor number.
+*	@return True if successful.
+*/
+bit SetThreadAffinity(u32 uiCPU);
+
+/**
+*	Move the calling thread to the real-time scheduling class.
+*	Usually needs elevated privileges.
+*	@param iPriority Real-time priority (1 to 99, where 99 is the highest).
+*	@return True if successful.
+*/
+bit SetThreadRealTime(i32 iPriority);
+
+/**
+*	Allocate memory which starts on a cache line.
+*	The size is rounded up to whole cache lines, so that no other allocation shares the last line.
+*	@param u64Size Size in bytes.
+*	@return The memory, which must be freed with AlignedFree().
+*/
+void *AlignedMalloc(u64 u64Size);
+
+/**
+*	Free memory allocated with AlignedMalloc().
+*	@param pMem The memory (may be NULL).
+*/
+void AlignedFree(void *pMem);
+
+/**
+*	Allocation of the objects of a CACHE_ALIGNED type.
+*	Put in the declaration of the type. The default allocator does not keep the alignment, which
+*	would let two objects written by different threads share a cache line.
+*/
+#define			CACHE_ALIGNED_NEW																	\
+	static void	*operator new(size_t uiSize){return AlignedMalloc(uiSize);}						\
+	static void	*operator new[](size_t uiSize){return AlignedMalloc(uiSize);}					\
+	static void	operator delete(void *pMem){AlignedFree(pMem);}									\
+	static void	operator delete[](void *pMem){AlignedFree(pMem);}
+
 #endif	// __UTILITIES_H__
\ No newline at end of file
@@ -26,13 +26,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef __WORKITEM_H__
 #define __WORKITEM_H__
 
+#include <TypeDefs.h>
+#include <Utilities.h>
+
 /**
 *	Stores a work item.
 *	Stores the items in the queue, which can be poped by a thread.
 */
-class WorkItem
+class CACHE_ALIGNED WorkItem
 {
 public:
+	CACHE_ALIGNED_NEW
+
 	/**
 	*	Thread calling function.
 	*	The function which must be called when the thread is run.
@@ -43,11 +48,13 @@ public:
 	int		m_iItemNum;					//!< Current item number
 	void	*m_pArgs;					//!< Arguments array
 	int		m_iTotArg;					//!< Total arguments
+	volatile i64	*m_pi64Group;		//!< Pending jobs of the group this item belongs to (NULL if none)
+	u64		m_u64SubmitTime;			//!< Time in usec the item was submitted (only if the queue measures latencies)
 
 	/**
 	*	Default Constructor.
 	*/
-	WorkItem(){}
+	WorkItem():m_pi64Group(NULL),m_u64SubmitTime(0){}
 
 	/**
 	*	Constructor.
@@ -55,9 +62,10 @@ public:
 	*	@param iItemNum The current work item identification number.
 	*	@param pArgs Pointer to an arguments. This can be an array or structure etc.
 	*	@param iTotArgs The total number of arguments.
+	*	@param pi64Group Pending jobs counter of the group, which can be waited for with WorkQueue::WaitGroupDone().
 	*/
-	WorkItem(void * (*PtrToFunc)(void*), int iItemNum, void *pArgs, int iTotArgs):
-		m_pfPtrToFunc(PtrToFunc), m_iItemNum(iItemNum), m_pArgs(pArgs), m_iTotArg(iTotArgs){}
+	WorkItem(void * (*PtrToFunc)(void*), int iItemNum, void *pArgs, int iTotArgs, volatile i64 *pi64Group = NULL):
+		m_pfPtrToFunc(PtrToFunc), m_iItemNum(iItemNum), m_pArgs(pArgs), m_iTotArg(iTotArgs), m_pi64Group(pi64Group), m_u64SubmitTime(0){}
 	~WorkItem(){}
 };
 
@@ -16,56 +16,190 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 /**
 * @file WorkQueue.h
 * @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
 * @brief This file contains the WorkQueue class.
 * Basic idea taken from: http://vichargrave.com/multithreaded-work-queue-in-c/
+* The queue is a work-stealing scheduler, each worker thread has its own WorkStealDeque.
 */
 
 #ifndef __WORKQUEUE_H__
 #define __WORKQUEUE_H__
 
+#include <TypeDefs.h>
+#include <Utilities.h>
 #include <pthread.h>
 
 class WorkItem;
+class WorkStealDeque;
+
+/**
+*	Statistics of the jobs of a work queue.
+*	The latencies are only measured if enabled with WorkQueue::SetMeasureLatency().
+*/
+typedef struct _WorkQueueStats
+{
+	u64					u64Jobs;				//!< Jobs started
+	u64					u64StartLatency;		//!< Sum of the times from the submission to the start of the jobs in usec
+	u64					u64StartLatencyMax;		//!< Longest time from the submission to the start of a job in usec
+	u64					u64DoneLatency;			//!< Sum of the times from the submission to the end of the jobs in usec
+	u64					u64DoneLatencyMax;		//!< Longest time from the submission to the end of a job in usec
+	u64					u64Parks;				//!< Times a thread went to sleep as spinning did not find a job
+}WorkQueueStats_t;
+
+/**
+*	Counters of one worker.
+*	Every worker has its own cache line, so that the workers do not share one. The pending jobs of the
+*	queue are the jobs submitted by all the workers minus the jobs done by all of them.
+*/
+typedef struct CACHE_ALIGNED _WorkerStats
+{
+	CACHE_ALIGNED_NEW
+
+	volatile i64		i64Submitted;			//!< Jobs submitted
+	volatile i64		i64Done;				//!< Jobs done
+	volatile i64		i64Jobs;				//!< See WorkQueueStats_t
+	volatile i64		i64StartLatency;		//!< See WorkQueueStats_t
+	volatile i64		i64StartLatencyMax;		//!< See WorkQueueStats_t
+	volatile i64		i64DoneLatency;			//!< See WorkQueueStats_t
+	volatile i64		i64DoneLatencyMax;		//!< See WorkQueueStats_t
+	volatile i64		i64Parks;				//!< See WorkQueueStats_t
+}WorkerStats_t;
 
 /**
 *	A queue of work items.
-*	A work queue is for all the threads/jobs.
+*	A work queue is for all the threads/jobs. Every worker thread owns a deque which it
+*	pushes to and pops from without locking. Jobs submitted by threads which are not workers
+*	of this queue go to a shared injection deque. Idle workers steal from the injection deque
+*	and from randomly chosen workers, and only sleep (park) after a number of unsuccessful tries.
+*	This number adapts per thread: it is doubled whenever spinning found a job and halved whenever
+*	the thread had to park, between WORK_SPIN_MIN_ROUNDS and WORK_SPIN_MAX_ROUNDS.
+*	The victims on the NUMA node of the thief are tried before the remote ones.
 */
-class WorkQueue
+class CACHE_ALIGNED WorkQueue
 {
 private:
-	WorkItem			**m_ppcWorkItemQueue;	//!< A queue for work items
-	int					m_iSize;				//!< Size of the queue
-	int					m_iCurrSize;			//!< Current size of the queue
-	int					m_iCurrReadLoc;			//!< Read location in the work queue
-	int					m_iCurrWriteLoc;		//!< Write location in the work queue
-	int					m_iPendingJobs;			//!< Total Pending jobs
-	pthread_mutex_t		m_ptMutex;				//!< Mutex for inserting and removing the job
+	WorkStealDeque		**m_ppcWorkerDeque;		//!< One deque per worker thread
+	WorkStealDeque		*m_pcInjectDeque;		//!< Deque for jobs from threads outside the queue
+	i32					m_iNumWorkers;			//!< Total worker threads
+	volatile i64		m_i64NumRegistered;		//!< Total workers registered so far
+	volatile i64		*m_pi64WorkerNode;		//!< NUMA node of each worker
+	volatile i64		m_i64MultiNode;			//!< Non-zero if the workers are spread over NUMA nodes
+	CACHE_ALIGNED volatile i64	m_i64InjectLock;	//!< Serializes the submitters to the injection deque (on its own cache line)
+	CACHE_ALIGNED volatile i64	m_i64NumSleepers;	//!< Workers sleeping on the job available condition (on its own cache line)
+	CACHE_ALIGNED volatile i64	m_i64Shutdown;		//!< Non-zero when the workers must leave
+	volatile i64		m_i64NumActive;			//!< Workers allowed to take jobs, the ones with a higher index are parked
+	CACHE_ALIGNED pthread_mutex_t	m_ptMutex;	//!< Mutex for sleeping and waking up only (on its own cache line)
 	pthread_cond_t		m_ptJobAvailCond;		//!< Condition variable if a job is available in the queue
 	pthread_cond_t		m_ptQueueEmptyCond;		//!< Condition variable if the job queue is empty
+	pthread_cond_t		m_ptUnparkCond;			//!< Condition variable if more workers are allowed to take jobs
+	i32					m_iMaxSpinRounds;		//!< Most rounds a thread spins before parking (less on a single processor)
+	bit					m_bMeasureLatency;		//!< Measure the latencies of the jobs
+	WorkerStats_t		*m_psWorkerStats;		//!< Counters of each worker, the last entry is for the threads which are not workers
+
+	/**
+	*	Look once through all the deques for a job.
+	*	@param iWorkerIdx Worker index of the calling thread, or -1 if it is not a worker.
+	*	@param puiSeed Random seed for choosing the victim.
+	*	@param bInjected Also take the jobs submitted by the threads which are not workers, e.g. the GOP jobs.
+	*	@return The work item or NULL if nothing was found.
+	*/
+	WorkItem			*FindJob(i32 iWorkerIdx, u32 *puiSeed, bit bInjected);
+
+	/**
+	*	Get the worker index of the calling thread for this queue.
+	*	@return The index or -1 if the calling thread is not a worker of this queue.
+	*/
+	i32					GetWorkerIdx();
+
+	/**
+	*	Wake up sleeping workers, if there are any.
+	*	@param iNumJobs Total jobs which have been submitted, at most as many workers are woken up.
+	*/
+	void				WakeWorkers(i32 iNumJobs);
+
+	/**
+	*	Look for a job, spinning for the adaptive number of rounds of the calling thread.
+	*	@param iWorkerIdx Worker index of the calling thread, or -1 if it is not a worker.
+	*	@param puiSeed Random seed for choosing the victim.
+	*	@param pi64Group Stop spinning once this group is done (NULL to spin for any job).
+	*	@param bInjected Also take the jobs submitted by the threads which are not workers (see FindJob()).
+	*	@return The work item or NULL if nothing was found.
+	*/
+	WorkItem			*SpinForJob(i32 iWorkerIdx, u32 *puiSeed, volatile i64 *pi64Group, bit bInjected);
+
+	/**
+	*	Check if a worker is parked.
+	*	@param iWorkerIdx Worker index of the calling thread, or -1 if it is not a worker.
+	*	@return True if the worker must not take jobs.
+	*/
+	bit					IsParked(i32 iWorkerIdx){return iWorkerIdx >= 0 && iWorkerIdx >= ATOMIC_LOAD(m_i64NumActive);}
+
+	/**
+	*	Account a job which is about to be executed.
+	*	@param pcWorkItem The work item.
+	*	@param iWorkerIdx Worker index of the calling thread, or -1 if it is not a worker.
+	*/
+	void				JobStarted(WorkItem *pcWorkItem, i32 iWorkerIdx);
+
+	/**
+	*	Get the counters of the calling thread.
+	*	@param iWorkerIdx Worker index of the calling thread, or -1 if it is not a worker.
+	*	@return Counters of the worker, or the shared ones of the threads which are not workers.
+	*/
+	WorkerStats_t		*GetWorkerStats(i32 iWorkerIdx){return &m_psWorkerStats[iWorkerIdx >= 0 ? iWorkerIdx : m_iNumWorkers];}
+
+	/**
+	*	Count the jobs submitted but not yet done.
+	*	The done jobs are read first, so a job is never seen done without being seen submitted.
+	*	@return Pending jobs (may be too high while jobs are submitted or done).
+	*/
+	i64					GetPendingJobs();
 public:
+	CACHE_ALIGNED_NEW
+
 	/**
 	*	Constructor.
+	*	@param iSize Maximum number of jobs in flight.
+	*	@param iNumWorkers Total worker threads that will take jobs from this queue.
 	*/
-	WorkQueue(int iSize = 1);
+	WorkQueue(int iSize = 1, int iNumWorkers = 1);
 
 	~WorkQueue();
 
+	/**
+	*	Register the calling thread as a worker of this queue.
+	*	Must be called by every worker thread before it asks for a job.
+	*	@param iNode NUMA node the calling thread runs on.
+	*	@return Worker index of the calling thread.
+	*/
+	int					RegisterWorker(i32 iNode = 0);
+
 	/**
 	*	Add a job to the back of the job queue.
 	*	Before writing, always check if there is space in the queue.
 	*	@param pcWorkItem The work item added to the queue.
 	*	@return 0 means successful and otherwise is unsuccessful.
 	*/
-	int					AddToJob(WorkItem *pcWorkItem);
+	int					AddToJob(WorkItem *pcWorkItem){return AddJobs(&pcWorkItem, 1);}
 
 	/**
-	*	Extract from the front of the job queue.
+	*	Add several jobs to the back of the job queue.
+	*	The jobs are published at once and the sleeping workers are woken up once, which is much
+	*	cheaper than adding them one by one.
+	*	@param ppcWorkItems The work items added to the queue, the first one is added first.
+	*	@param iNumItems Total work items.
+	*	@return 0 means successful and otherwise is unsuccessful (none of the jobs was added).
+	*/
+	int					AddJobs(WorkItem **ppcWorkItems, i32 iNumItems);
+
+	/**
+	*	Extract a job from the queue.
 	*	If no job is available, the function will be suspended in wait state.
 	*	I.e. this is a blocking function.
+	*	@return The work item or NULL if the queue is shut down.
 	*/
 	WorkItem			*GetNextJob();
 
@@ -75,22 +209,57 @@ public:
 	int					GetNumJobsInQueue();
 
 	/**
-	*	Increment job pending signal for the job.
-	*	Should be set by the working thread.
-	*/	
-	void				IncNumJobsUnderProcess();
+	*	Job done signal.
+	*	Should be called by the working thread. If the job was the last pending one of its group,
+	*	the threads waiting for the group are woken up.
+	*	@param pcWorkItem The work item which is done.
+	*/
+	void				JobDone(WorkItem *pcWorkItem);
 
 	/**
-	*	Job done signal.
-	*	Should be called by the working thread.
+	*	Wait until all the jobs of a group are done.
+	*	The calling thread does not sit idle, it executes the queued jobs (of any group) until the
+	*	group is done. Therefore, it is safe to wait from within a job, and the queue works even
+	*	without any worker thread. A worker only helps with the jobs of the deques of the workers,
+	*	where the jobs of its group are, and not with the jobs submitted from outside, e.g. a whole GOP,
+	*	which would delay its group by as long as the GOP takes.
+	*	@param i64Group Pending jobs counter of the group (see WorkItem::m_pi64Group).
+	*	@param bAnyJob Help with the jobs submitted from outside as well, e.g. while waiting for a GOP.
 	*/
-	void				JobDone();
+	void				WaitGroupDone(volatile i64 &i64Group, bit bAnyJob = false);
 
 	/**
-	*	Wait until the job queue is empty.
-	*	It is better to sleep a little before calling this function.
+	*	Wait until all the submitted jobs are done.
 	*/
 	void				WaitQueueEmpty();
+
+	/**
+	*	Measure the latencies of the jobs.
+	*	Must be called before the first job is submitted.
+	*	@param bMeasure True to measure the latencies.
+	*/
+	void				SetMeasureLatency(bit bMeasure){m_bMeasureLatency = bMeasure;}
+
+	/**
+	*	Set the workers which take jobs.
+	*	The workers with an index of iNumActive or higher finish their current job and then sleep until
+	*	they are allowed again. Their queued jobs are stolen by the others. The threads which are not
+	*	workers, e.g. the main thread waiting for a group, always help.
+	*	@param iNumActive Total workers allowed to take jobs.
+	*/
+	void				SetActiveWorkers(i32 iNumActive);
+
+	/**
+	*	Get the statistics of the jobs so far.
+	*	@param sStats Statistics of all the threads together.
+	*/
+	void				GetStats(WorkQueueStats_t &sStats);
+
+	/**
+	*	Ask the workers to leave.
+	*	GetNextJob() returns NULL afterwards, so that the threads can be joined.
+	*/
+	void				Shutdown();
 };
 
 #endif // __WORKQUEUE_H__
\ No newline at end of file
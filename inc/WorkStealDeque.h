@@ -0,0 +1,96 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file WorkStealDeque.h
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the WorkStealDeque class.
+* Based on: D. Chase and Y. Lev, "Dynamic circular work-stealing deque", SPAA 2005.
+*/
+
+#ifndef __WORKSTEALDEQUE_H__
+#define __WORKSTEALDEQUE_H__
+
+#include <TypeDefs.h>
+#include <Utilities.h>
+
+class WorkItem;
+
+/**
+*	A work-stealing double ended queue of work items.
+*	The owner pushes and pops at the bottom without taking a lock. Any other thread
+*	may steal from the top, which costs one compare-and-swap. The capacity is fixed.
+*/
+class CACHE_ALIGNED WorkStealDeque
+{
+private:
+	WorkItem			**m_ppcBuffer;			//!< Circular buffer of work items
+	i64					m_i64Mask;				//!< Capacity-1 (capacity is a power of 2)
+	CACHE_ALIGNED volatile i64	m_i64Top;		//!< Index of the oldest item (thieves side, on its own cache line)
+	CACHE_ALIGNED volatile i64	m_i64Bottom;	//!< Index after the newest item (owner side, on its own cache line)
+public:
+	CACHE_ALIGNED_NEW
+
+	/**
+	*	Constructor.
+	*	@param iSize Minimum capacity of the deque. It is rounded up to a power of 2.
+	*/
+	WorkStealDeque(i32 iSize = 1);
+
+	~WorkStealDeque();
+
+	/**
+	*	Push a work item at the bottom.
+	*	Only the owner of the deque is allowed to call this function.
+	*	@param pcWorkItem The work item added to the deque.
+	*	@return 0 means successful and otherwise the deque is full.
+	*/
+	i32					Push(WorkItem *pcWorkItem){return PushBatch(&pcWorkItem, 1);}
+
+	/**
+	*	Push several work items at the bottom, which become visible to the thieves at once.
+	*	Only the owner of the deque is allowed to call this function.
+	*	@param ppcWorkItems The work items added to the deque, the first one is pushed first.
+	*	@param iNumItems Total work items.
+	*	@return 0 means successful and otherwise the deque has no space for all of them (nothing is pushed).
+	*/
+	i32					PushBatch(WorkItem **ppcWorkItems, i32 iNumItems);
+
+	/**
+	*	Pop the newest work item from the bottom.
+	*	Only the owner of the deque is allowed to call this function.
+	*	@return The work item or NULL if the deque is empty.
+	*/
+	WorkItem			*Pop();
+
+	/**
+	*	Steal the oldest work item from the top.
+	*	Can be called by any thread.
+	*	@return The work item or NULL if the deque is empty.
+	*/
+	WorkItem			*Steal();
+
+	/**
+	*	Get the number of work items in the deque.
+	*	The value is only a snapshot if other threads are using the deque.
+	*/
+	i32					GetSize();
+};
+
+#endif // __WORKSTEALDEQUE_H__
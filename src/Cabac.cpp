@@ -734,10 +734,18 @@ void Cabac::ResetCabac()
 	m_uiNumByte = 0;
 }
 
-void Cabac::InitCabac()
+void Cabac::StoreContextModels(u8 *pbContextModels)
+{
+	memcpy(pbContextModels,m_pbContextModels,MAX_NUM_CTX_MOD);
+}
+
+void Cabac::LoadContextModels(u8 const *pbContextModels)
+{
+	memcpy(m_pbContextModels,pbContextModels,MAX_NUM_CTX_MOD);
+}
+
+void Cabac::InitCabac(eSliceType eCurrSliceType, u32 uiQP)
 {
-	u32 uiQP = m_pcImageParameters->m_uiQP;
-	eSliceType eCurrSliceType = m_pcImageParameters->m_eSliceType;
 	u8 *pbContextModels = m_pbContextModels;
 	u32 uiOffset = 0;
 
@@ -1050,17 +1058,20 @@ void Cabac::WriteCoeffRemainExGolomb(i32 iSymbol, u32 uiParam, BitStreamHandler
 
 }
 
-void Cabac::EncodeCoeffNxN(i16 *piCoeff, u32 uiSize, u32 uiMode, bit bIsLuma, BitStreamHandler *& pcBitStreamHandler)
+void Cabac::EncodeCoeffNxN(i16 const *piCoeff, u16 const *puiSigMap, u32 uiSize, u32 uiMode, bit bIsLuma, BitStreamHandler *& pcBitStreamHandler)
 {
 	MAKE_SURE((uiSize <= CTU_WIDTH),"NxN coefficients for cabac are larger than CTU_WIDTH x CTU_HEIGHT");
 	const u32 uiStride = (CTU_WIDTH >> (bIsLuma ? 0 : 1));
+	const u32 uiSigStride = uiStride >> 2;
 	const u32 uiLog2Size = LOG2(uiSize-1);
 	const u32 uiShift = MLS_CG_SIZE >> 1;
 	const u32 uiNumBlkSide = uiSize >> uiShift;
 	const u32 uiBlockType = uiLog2Size;
 
 	u8 ubSigCoeffGroupFlag[MLS_GRP_NUM];
-	memset(ubSigCoeffGroupFlag,0,sizeof(ubSigCoeffGroupFlag));
+	for(u32 i=0;i<uiNumBlkSide;i++)
+		for(u32 j=0;j<uiNumBlkSide;j++)
+			ubSigCoeffGroupFlag[i*uiNumBlkSide+j] = RET_1_IF_TRUE(puiSigMap[i*uiSigStride+j] != 0);
 
 	u32 uiScanIdx = GetCoeffScanIdx(uiSize,uiMode,bIsLuma);	// Scaning direction
 	if(uiScanIdx == SCAN_ZIGZAG) 
@@ -1073,30 +1084,23 @@ void Cabac::EncodeCoeffNxN(i16 *piCoeff, u32 uiSize, u32 uiMode, bit bIsLuma, Bi
 	else if(uiLog2Size == 5)
 		uiScanCG = g_puiSigLastScanCG32x32;
 
-	u32 uiNumSig = 0;	// Total non-zero signals
-	for(u32 i=0;i<uiSize;i++)
-		for(u32 j=0;j<uiSize;j++)
-			uiNumSig += RET_1_IF_TRUE(piCoeff[i*uiStride+j] != 0);
+	// The last significant coefficient is in the last group of the scan, which has coefficients.
+	// Within this group, it is the last of the scan whose bit is set in the significance map.
+	i32 iScanPosLast = ((uiNumBlkSide*uiNumBlkSide) << LOG2_SCAN_SET_SIZE) - 1;
+	while(ubSigCoeffGroupFlag[uiScanCG[iScanPosLast >> LOG2_SCAN_SET_SIZE]] == 0)
+		iScanPosLast -= (1 << LOG2_SCAN_SET_SIZE);
 
-	i32 iScanPosLast = -1;
-	i32 iRealPos = -1;
 	i32 iPosLast;
+	u32 uiPosLastY, uiPosLastX;
 	do
 	{
-		iPosLast = uiScan[++iScanPosLast];
-		u32 uiPosY = iPosLast >> uiLog2Size;
-		u32 uiPosX = iPosLast - (uiPosY << uiLog2Size);
-		u32 uiBlkIdx = uiNumBlkSide * (uiPosY >> uiShift) + (uiPosX >> uiShift);
-		iRealPos = uiPosY * uiStride + uiPosX;
-		if(piCoeff[iRealPos])
-		{
-			ubSigCoeffGroupFlag[uiBlkIdx] = 1;
-			uiNumSig--;
-		}
-	}while(uiNumSig > 0);
+		iPosLast = uiScan[iScanPosLast--];
+		uiPosLastY = iPosLast >> uiLog2Size;
+		uiPosLastX = iPosLast - (uiPosLastY << uiLog2Size);
+	}while(!((puiSigMap[(uiPosLastY >> uiShift)*uiSigStride + (uiPosLastX >> uiShift)] >> (((uiPosLastY&3)<<2)|(uiPosLastX&3))) & 1));
+	iScanPosLast++;
+	i32 iRealPos = uiPosLastY * uiStride + uiPosLastX;
 
-	u32 uiPosLastY = iPosLast >> uiLog2Size;
-	u32 uiPosLastX = iPosLast - (uiPosLastY << uiLog2Size);
 	CodeLastSignifXY(uiPosLastX,uiPosLastY,uiSize,uiScanIdx,bIsLuma,pcBitStreamHandler);
 
 	u32 uiBaseCoeffGroupCtx = OFF_SIG_CG_FLAG_CTX + (bIsLuma ? 0 : NUM_SIG_CG_FLAG_CTX);
@@ -1137,6 +1141,7 @@ void Cabac::EncodeCoeffNxN(i16 *piCoeff, u32 uiSize, u32 uiMode, bit bIsLuma, Bi
 		if(ubSigCoeffGroupFlag[iCGBlkPos]) 
 		{
 			i32 iPatternSigCtx = CalcPatternSigCtx(ubSigCoeffGroupFlag, iCGPosX, iCGPosY, uiSize );
+			u32 uiSigMask = puiSigMap[iCGPosY*uiSigStride + iCGPosX];	// The coefficients of the group, which are not zero
 			u32 uiBlkPos, uiPosY, uiPosX, uiSig, uiCtxSig;
 			u32 uiRealBlkPos;
 			for(;iScanPosSig >= iSubPos; iScanPosSig--) 
@@ -1145,7 +1150,7 @@ void Cabac::EncodeCoeffNxN(i16 *piCoeff, u32 uiSize, u32 uiMode, bit bIsLuma, Bi
 				uiPosY       = uiBlkPos >> uiLog2Size;
 				uiPosX       = uiBlkPos - ( uiPosY << uiLog2Size );
 				uiRealBlkPos = uiPosY * uiStride + uiPosX;
-				uiSig        = (piCoeff[ uiRealBlkPos ] != 0);
+				uiSig        = (uiSigMask >> (((uiPosY&3)<<2)|(uiPosX&3))) & 1;
 				if((iScanPosSig != iSubPos) || iSubSet == 0 || iNumNonZero) 
 				{
 					uiCtxSig  = GetSigCtxInc(iPatternSigCtx, uiScanIdx, uiPosX, uiPosY, uiBlockType, uiSize, bIsLuma);
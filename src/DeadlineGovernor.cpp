@@ -0,0 +1,112 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file DeadlineGovernor.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the methods of the DeadlineGovernor class.
+*/
+
+#include <DeadlineGovernor.h>
+
+DeadlineGovernor::DeadlineGovernor(i32 iFrameRate, u32 uiMaxWorkers, u32 uiGOPsInFlight)
+{
+	m_u64FrameInterval = 1000000/u64(iFrameRate);
+	m_uiMinWorkers = 1;
+	m_uiMaxWorkers = max(uiMaxWorkers, 1u);
+	m_uiActiveWorkers = m_uiMaxWorkers;
+	m_uiWindowGOPs = max(uiGOPsInFlight, 1u);
+	m_uiSettleGOPs = m_uiWindowGOPs-1;
+	m_uiGOPsToSettle = 0;	// The first measurement already spans the filling of the pipeline
+	m_pu64DoneTimes = new u64[m_uiWindowGOPs];
+	m_u64GOPsDone = 0;
+	m_u64WindowFrameTime = 0;
+	m_u64FrameTime = 0;
+	m_u64Frames = 0;
+	m_u64LateFrames = 0;
+	m_u64WorkerFrames = 0;
+	m_uiIncreases = 0;
+	m_uiDecreases = 0;
+}
+
+DeadlineGovernor::~DeadlineGovernor()
+{
+	delete [] m_pu64DoneTimes;
+}
+
+void DeadlineGovernor::Start(u64 u64Time)
+{
+	// The start counts as the GOP done before the first one
+	m_pu64DoneTimes[m_uiWindowGOPs-1] = u64Time;
+	m_u64GOPsDone = 0;
+}
+
+bit DeadlineGovernor::AddGOPDone(u64 u64Time, u32 uiFrames)
+{
+	m_u64Frames += uiFrames;
+	m_u64WorkerFrames += u64(m_uiActiveWorkers)*uiFrames;
+
+	// Measure from the GOP done m_uiWindowGOPs GOPs before (or from the start), whose slot this GOP takes over
+	u32 uiSlot = u32(m_u64GOPsDone % m_uiWindowGOPs);
+	u64 u64WindowStart = m_pu64DoneTimes[uiSlot];
+	m_pu64DoneTimes[uiSlot] = u64Time;
+	if(++m_u64GOPsDone < m_uiWindowGOPs)
+		return false;
+
+	u64 u64FrameTime = (u64Time - u64WindowStart)/max(u64(m_uiWindowGOPs)*uiFrames, u64(1));
+	m_u64WindowFrameTime = u64FrameTime;
+	if(u64FrameTime > m_u64FrameInterval)
+		m_u64LateFrames += uiFrames;
+
+	// The GOPs started before the last change still run with the old workers
+	if(m_uiGOPsToSettle > 0)
+	{
+		m_uiGOPsToSettle--;
+		return false;
+	}
+
+	// The older GOPs are forgotten exponentially, so that a single outlier does not move the workers
+	m_u64FrameTime = m_u64FrameTime ? (m_u64FrameTime + u64FrameTime + 1)>>1 : u64FrameTime;
+
+	// Late, add as many workers as needed if the time scales with the workers, but at least one
+	u32 uiWorkers = m_uiActiveWorkers;
+	if(m_u64FrameTime*100 > m_u64FrameInterval*RT_DEADLINE_HIGH)
+	{
+		u64 u64Needed = (m_u64FrameTime*m_uiActiveWorkers*100 + m_u64FrameInterval*RT_DEADLINE_HIGH - 1)/(m_u64FrameInterval*RT_DEADLINE_HIGH);
+		uiWorkers = u32(min(max(u64Needed, u64(m_uiActiveWorkers+1)), u64(m_uiMaxWorkers)));
+	}
+	// Early, remove one worker at a time if the rest are still predicted to be in time
+	else if(m_uiActiveWorkers > m_uiMinWorkers &&
+		m_u64FrameTime*m_uiActiveWorkers*100 < m_u64FrameInterval*(m_uiActiveWorkers-1)*RT_DEADLINE_LOW)
+		uiWorkers = m_uiActiveWorkers-1;
+
+	if(uiWorkers == m_uiActiveWorkers)
+		return false;
+
+	if(uiWorkers > m_uiActiveWorkers)
+		m_uiIncreases++;
+	else
+		m_uiDecreases++;
+
+	// Measure the new workers afresh
+	m_u64FrameTime = 0;
+	m_uiGOPsToSettle = m_uiSettleGOPs;
+	m_uiActiveWorkers = uiWorkers;
+	return true;
+}
@@ -31,7 +31,39 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include		<stdlib.h>
 #endif
 #include 		<stdio.h>
+#include		<string.h>
 #include		<EncTop.h>
+#include		<Kernels.h>
+
+/**
+*	Encode the sequence once with every number of workers from 1 to iMaxWorkers.
+*	The frames per second and the speedup over one worker are printed at the end, so that a loss of
+*	scaling, e.g. by threads sharing cache lines, shows up. The "-Nworkers" argument is appended to the
+*	arguments of the user, the tiles (or wavefronts) of the user are kept.
+*	@param argc Total arguments without "-scaling".
+*	@param argv Arguments without "-scaling", with space for two more.
+*	@param pcWorkers Buffer of the workers argument, which lives as long as argv.
+*	@param iMaxWorkers Most workers.
+*/
+static void EncodeScaling(int argc, char* argv[], char *pcWorkers, int iMaxWorkers)
+{
+	f64 *pf64FramesPerSec = new f64[iMaxWorkers];
+	argv[argc] = (char *)"-Nworkers";
+	argv[argc+1] = pcWorkers;
+	for(int i=0;i<iMaxWorkers;i++)
+	{
+		sprintf(pcWorkers,"%d",i+1);
+		EncTop *pcEnc = new EncTop(argc+2, argv);
+		pcEnc->Encode();
+		pf64FramesPerSec[i] = pcEnc->GetFramesPerSec();
+		delete pcEnc;
+	}
+
+	for(int i=0;i<iMaxWorkers;i++)
+		printf("Trace: Scaling with %d workers, %.2f frames per sec, speedup %.2f, efficiency %.0f%%.\n",i+1,
+			pf64FramesPerSec[i],pf64FramesPerSec[i]/pf64FramesPerSec[0],100.0*pf64FramesPerSec[i]/pf64FramesPerSec[0]/(i+1));
+	delete [] pf64FramesPerSec;
+}
 
 int main (int argc, char* argv[])
 {
@@ -45,10 +77,40 @@ int main (int argc, char* argv[])
 	_CrtSetReportFile( _CRT_ASSERT, _CRTDBG_FILE_STDOUT );
 	//_crtBreakAlloc = 103;	// To conditionally set a break point at the memory allcoation number
 #endif
-	EncTop *pcEnc = new EncTop(argc, argv);
-	pcEnc->Encode();
-	pcEnc->PrintPSNR(false);
-	delete pcEnc;
+	// "--checkkernels" checks the kernels of the processor against the C kernels instead, with no other arguments needed
+	for(int i=1;i<argc;i++)
+	{
+		if(!strcmp(argv[i], "--checkkernels"))
+		{
+			u32 uiFailed = CheckKernels(GetCPULevel(), true);
+			printf("%s: %u kernels up to %s differ from the C kernels.\n",uiFailed ? "Error" : "Trace",uiFailed,GetCPULevelName(GetCPULevel()));
+			return uiFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+		}
+	}
+
+	// "-scaling MaxWorkers" measures the throughput with 1 to MaxWorkers workers instead
+	int iMaxWorkers = 0;
+	int iNumArgs = 0;
+	char **ppcArgs = new char*[argc+2];
+	char pcWorkers[16];
+	for(int i=0;i<argc;i++)
+	{
+		if(!strcmp(argv[i], "-scaling") && i+1 < argc)
+			iMaxWorkers = atoi(argv[++i]);
+		else
+			ppcArgs[iNumArgs++] = argv[i];
+	}
+
+	if(iMaxWorkers > 0)
+		EncodeScaling(iNumArgs, ppcArgs, pcWorkers, iMaxWorkers);
+	else
+	{
+		EncTop *pcEnc = new EncTop(iNumArgs, ppcArgs);
+		pcEnc->Encode();
+		pcEnc->PrintPSNR(false);
+		delete pcEnc;
+	}
+	delete [] ppcArgs;
 	
 #ifdef TEST_MEMORY_LEAKS
 	_CrtDumpMemoryLeaks();
@@ -32,6 +32,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <H265Headers.h>
 #include <TypeDefs.h>
 #include <Utilities.h>
+#include <WorkItem.h>
+#include <WorkQueue.h>
+#include <ThreadHandler.h>
+#include <TileBalancer.h>
+#include <SliceBalancer.h>
+#include <DeadlineGovernor.h>
+#include <Tracer.h>
+#include <Kernels.h>
 #include <stdlib.h>
 #include <string.h>
 #include <cassert>
@@ -40,6 +48,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace std;
 
+/**
+*	Compress a GOP, possibly using threads.
+*	The work queue marks the job group of the GOP as done once this function returns.
+*/
+static void *CompressGOPThread(void *pArgs)
+{
+	GOPJobArgs_t *pcArgs = (GOPJobArgs_t *)pArgs;
+	pcArgs->pcGOPCompressor->CompressGOP(pcArgs->ppbYBuff, pcArgs->ppbCbBuff, pcArgs->ppbCrBuff,
+		pcArgs->uiStartSliceNum, pcArgs->sSliceParams);
+	return NULL;
+}
+
 EncTop::EncTop(int argc, char *argv[])
 {
 	m_pcInputParam = new InputParameters;
@@ -51,15 +71,39 @@ EncTop::EncTop(int argc, char *argv[])
 	// Configure the encoder
 	ConfigureEncoder();
 
+	// The pixel kernels follow the instruction set of the processor
+	eCPULevel eKernelLevel = InitKernels(eCPULevel(m_pcInputParam->m_uiISALevel));
+	if(m_pcInputParam->m_bVerbose)
+		printf("Trace: %s kernels are used.\n",GetCPULevelName(eKernelLevel));
+
+	// The threads trace from now on
+	Tracer::Start();
+
 	// Initialize image properties and store them
 	m_pcImageParam->InitImgProp(m_pcInputParam);
 	
+	// Threads shared by all the compressors
+	MakeThreadsPool();
+
 	// Allocate memory to the buffers
 	InitEncoder();
 
+	// The tile layout follows the encoding time with adaptive tiles
+	m_pcTileBalancer = m_pcImageParam->m_bAdaptiveTiles ? new TileBalancer(m_pcImageParam) : NULL;
+
+	// The slice layout follows the bytes of the CTU rows with a byte budget of the slices
+	m_pcSliceBalancer = m_pcImageParam->m_bAdaptiveSlices ? new SliceBalancer(m_pcImageParam) : NULL;
+
+	// The active workers follow the frame deadline in the real-time mode
+	m_pcDeadlineGovernor = m_pcInputParam->m_bRealTime ?
+		new DeadlineGovernor(m_pcInputParam->m_iFrameRate,m_pcInputParam->m_uiNumWorkers,m_pcInputParam->m_uiNumGOPThreads) : NULL;
+
 	// Open the IO files
 	OpenIOFiles();
 
+	pthread_mutex_init(&m_ptPipeMutex, NULL);
+	pthread_cond_init(&m_ptPipeCond, NULL);
+
 	return;
 }
 
@@ -68,13 +112,24 @@ EncTop::~EncTop()
 	// Close the files
 	CloseIOFiles();
 
+	// Stop the threads before the compressors are freed
+	FreeThreadsPool();
+	Tracer::Stop();
+
 	// Free the memories
 	FreeAllocBuff();
+	delete m_pcTileBalancer;
+	delete m_pcSliceBalancer;
+	delete m_pcDeadlineGovernor;
+
+	pthread_mutex_destroy(&m_ptPipeMutex);
+	pthread_cond_destroy(&m_ptPipeCond);
 }
 
 void EncTop::ConfigureEncoder()
 {
 	m_u64CurrFrameNum = 0;
+	m_uiEncodingTime = 0;
 	i32 gopsize = 0;
 	i32 inputqp = 0;
 	i32 gopthreads = 0;
@@ -83,11 +138,25 @@ void EncTop::ConfigureEncoder()
 	i32 totaltilecols = 0;
 	i32 totaltilerows = 0;
 	i32 framerate = 0;
-	i32 tilethreads = 1;
+	bool realtime = false;
+	i32 tilethreads = 0;
+	i32 workers = 0;
+	i8 const *affinity = NULL;
+	i32 rtpriority = 0;
+	i32 iodepth = -1;
+	i32 ctupipe = 0;
+	i32 slices = 0;
+	i32 slicebytes = 0;
+	i32 tracelevel = -1;
 	m_bOutputRec = false;
 	m_bStats = false;
-	m_uiTotalCores = 1;
+	m_uiTotalCores = GetNumUsableCores();
 	bool verbose = false;
+	bool autoconfig = false;
+	bool wpp = false;
+	bool adaptivetiles = false;
+	bool satd = false;
+	i8 const *isa = NULL;
 
 	for(i32 i=1;i<m_iNumInputArgs;i++)
 	{
@@ -133,6 +202,11 @@ void EncTop::ConfigureEncoder()
 			inputqp = atoi(m_ppcInputArgs[++i]);
 		}
 
+		else if(!(strcmp(m_ppcInputArgs[i], "--satd")))
+		{
+			satd = true;
+		}
+
 		else if(!(strcmp(m_ppcInputArgs[i], "-Ngopth")))
 		{
 			gopthreads = atoi(m_ppcInputArgs[++i]);
@@ -143,6 +217,16 @@ void EncTop::ConfigureEncoder()
 			slicethreads = atoi(m_ppcInputArgs[++i]);
 		}
 
+		else if(!(strcmp(m_ppcInputArgs[i], "-Nslices")))
+		{
+			slices = atoi(m_ppcInputArgs[++i]);
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "-slicebytes")))
+		{
+			slicebytes = atoi(m_ppcInputArgs[++i]);
+		}
+
 		else if(!(strcmp(m_ppcInputArgs[i], "-Ntiles")))
 		{
 			totaltiles = atoi(m_ppcInputArgs[++i]);
@@ -155,6 +239,61 @@ void EncTop::ConfigureEncoder()
 			tilethreads = atoi(m_ppcInputArgs[++i]);
 		}
 
+		else if(!(strcmp(m_ppcInputArgs[i], "--rt")))
+		{
+			realtime = true;
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "--atiles")))
+		{
+			adaptivetiles = true;
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "-Nworkers")))
+		{
+			workers = atoi(m_ppcInputArgs[++i]);
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "-affinity")))
+		{
+			affinity = m_ppcInputArgs[++i];
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "-rtprio")))
+		{
+			rtpriority = atoi(m_ppcInputArgs[++i]);
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "-iodepth")))
+		{
+			iodepth = atoi(m_ppcInputArgs[++i]);
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "-ctupipe")))
+		{
+			ctupipe = atoi(m_ppcInputArgs[++i]);
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "--wpp")))
+		{
+			wpp = true;
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "--auto")))
+		{
+			autoconfig = true;
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "-isa")))
+		{
+			isa = m_ppcInputArgs[++i];
+		}
+
+		else if(!(strcmp(m_ppcInputArgs[i], "-trace")))
+		{
+			tracelevel = atoi(m_ppcInputArgs[++i]);
+		}
+
 		else if(!(strcmp(m_ppcInputArgs[i], "--ver")))
 		{
 			verbose = true;
@@ -182,7 +321,14 @@ void EncTop::ConfigureEncoder()
 
 	MAKE_SURE(CTU_HEIGHT == CTU_WIDTH,"The CTU must be a square. Check definitions of CTU_HEIGHT and CTU_WIDTH");
 
+	if(autoconfig)
+		PlanParallelism(gopthreads, totaltiles, totaltilecols, totaltilerows, tilethreads, workers, wpp);
+
 	m_pcInputParam->m_bVerbose = verbose;
+
+	// Trace messages of the compressors, by default with verbosity only
+	Tracer::SetLevel(tracelevel < 0 ? (verbose ? TRACE_LEVEL_VERBOSE : TRACE_LEVEL_OFF) : min(tracelevel, TRACE_LEVEL));
+	if(tracelevel > TRACE_LEVEL) printf("Warning: Trace level being set to %d.\n",Tracer::GetLevel());
 	if(verbose)
 	{
 		printf("Trace: CES_H265 Version [%s].\n",CES_H265_VER);
@@ -208,62 +354,238 @@ void EncTop::ConfigureEncoder()
 	m_pcInputParam->m_iFrameRate = framerate < 1 ? INIT_FRAME_RATE : framerate;
 	if(framerate < 1) printf("Warning: Frame rate being set to %d.\n",m_pcInputParam->m_iFrameRate);
 	else if(verbose) printf("Trace: Frame rate %d.\n",m_pcInputParam->m_iFrameRate);
+	m_pcInputParam->m_bRealTime = realtime;
+	if(realtime && verbose) printf("Trace: Real-time mode, the workers follow the deadline of %d frames per second.\n",m_pcInputParam->m_iFrameRate);
 
 	// QP
 	m_pcInputParam->m_uiQP = inputqp > 0 && inputqp < 52 ? inputqp : INIT_QP; //	QP of first frame
 	if(inputqp <= 0 || inputqp >= 52)	printf("Warning: QP value being set to %d.\n",INIT_QP);
 	else if(verbose) printf("Trace: QP value %u.\n",m_pcInputParam->m_uiQP);
 
+	// Cost of the mode decisions
+	m_pcInputParam->m_bSATD = satd;
+	if(satd && verbose) printf("Trace: SATD cost of the mode decisions.\n");
+
+	// Instruction set of the kernels, the command line overrides the environment
+	if(!isa)
+		isa = getenv(CES_H265_ISA_ENV);
+	eCPULevel eISALevel = CPU_LEVEL_TOTAL;
+	if(isa && !GetCPULevelFromName(isa, eISALevel))
+	{
+		printf("Warning: Unknown instruction set %s, the kernels of the processor are used.\n",isa);
+		eISALevel = CPU_LEVEL_TOTAL;
+	}
+	else if(isa && eISALevel > GetCPULevel())
+		printf("Warning: The processor does not support %s, %s kernels are used.\n",GetCPULevelName(eISALevel),GetCPULevelName(GetCPULevel()));
+	m_pcInputParam->m_uiISALevel = eISALevel;
+
 	// Threads
 	// GOP threads
 	m_pcInputParam->m_uiNumGOPThreads = gopthreads < 1 ? 1 : gopthreads;
-	m_pcInputParam->m_uiNumGOPThreads = gopthreads > MAX_GOP_THREADS ? MAX_GOP_THREADS : m_pcInputParam->m_uiNumGOPThreads;
-	if(gopthreads < 1 || gopthreads > MAX_GOP_THREADS) printf("Warning: Total GOP threads being set to %d.\n",m_pcInputParam->m_uiNumGOPThreads);
+	if(gopthreads < 1) printf("Warning: Total GOP threads being set to %d.\n",m_pcInputParam->m_uiNumGOPThreads);
 	else if(verbose) printf("Trace: Total GOP threads %d.\n",m_pcInputParam->m_uiNumGOPThreads);
 	// Slice threads
 	m_pcInputParam->m_uiNumSliceThreads = slicethreads < 1 ? 1 : slicethreads;
-	m_pcInputParam->m_uiNumSliceThreads = slicethreads > MAX_SLICE_THREADS ? MAX_SLICE_THREADS : m_pcInputParam->m_uiNumSliceThreads;
 	MAKE_SURE((m_pcInputParam->m_uiGopSize % m_pcInputParam->m_uiNumSliceThreads) == 0,
 		"The GOP size must be completely divisble by the number of slice threads");
-	if(slicethreads < 1 || slicethreads > MAX_SLICE_THREADS) printf("Warning: Total Slice threads being set to %d.\n",m_pcInputParam->m_uiNumSliceThreads);
+	if(slicethreads < 1) printf("Warning: Total Slice threads being set to %d.\n",m_pcInputParam->m_uiNumSliceThreads);
 	else if(verbose) printf("Trace: Total Slice threads %d.\n",m_pcInputParam->m_uiNumSliceThreads);
 
 	MAKE_SURE(m_pcInputParam->m_uiNumSliceThreads == 1, "Error: Currently, only 1 slice thread is acceptable.");
 
-	// Tiles
+	// Tiles, as many as the highest HEVC level allows for the resolution
+	u32 uiMaxTileCols, uiMaxTileRows;
+	ImageParameters::GetMaxTiles(m_pcInputParam->m_uiFrameWidth, m_pcInputParam->m_uiFrameHeight, true, uiMaxTileCols, uiMaxTileRows);
 	m_pcInputParam->m_uiTilesPerFrame = totaltiles < 1 ? 1 : totaltiles;
-	m_pcInputParam->m_uiTilesPerFrame = totaltiles > MAX_TILES ? MAX_TILES : m_pcInputParam->m_uiTilesPerFrame;
-	m_pcInputParam->m_uiFrameWidthInTiles = totaltilecols;
-	m_pcInputParam->m_uiFrameHeightInTiles = totaltilerows;
-	if(totaltiles < 1 || totaltiles > MAX_TILES) 
-	{
-		if(m_pcInputParam->m_uiTilesPerFrame == 1)
-		{
-			m_pcInputParam->m_uiFrameWidthInTiles = 1;
-			m_pcInputParam->m_uiFrameHeightInTiles = 1;
-		}
-		else
-		{
-			m_pcInputParam->m_uiFrameWidthInTiles = m_pcInputParam->m_uiTilesPerFrame/2;
-			m_pcInputParam->m_uiFrameHeightInTiles = m_pcInputParam->m_uiTilesPerFrame/2;
-		}
+	m_pcInputParam->m_uiFrameWidthInTiles = totaltiles < 1 ? 1 : totaltilecols;
+	m_pcInputParam->m_uiFrameHeightInTiles = totaltiles < 1 ? 1 : totaltilerows;
+	if(totaltiles < 1)
 		printf("Warning: Total Tiles per frame being set to %d.\n",m_pcInputParam->m_uiTilesPerFrame);
+	else if(totaltilecols > i32(uiMaxTileCols) || totaltilerows > i32(uiMaxTileRows))
+	{
+		m_pcInputParam->m_uiFrameWidthInTiles = min(u32(totaltilecols), uiMaxTileCols);
+		m_pcInputParam->m_uiFrameHeightInTiles = min(u32(totaltilerows), uiMaxTileRows);
+		m_pcInputParam->m_uiTilesPerFrame = m_pcInputParam->m_uiFrameWidthInTiles*m_pcInputParam->m_uiFrameHeightInTiles;
+		printf("Warning: Total Tiles per frame being set to %d (%d x %d), the most the resolution allows.\n",m_pcInputParam->m_uiTilesPerFrame,
+			m_pcInputParam->m_uiFrameWidthInTiles, m_pcInputParam->m_uiFrameHeightInTiles);
 	}
 	else if(verbose) printf("Trace: Tiles_per_frame Frame_width_tiles Frame_height_tiles %d %d %d.\n",m_pcInputParam->m_uiTilesPerFrame,
 		m_pcInputParam->m_uiFrameWidthInTiles, m_pcInputParam->m_uiFrameHeightInTiles);
 	MAKE_SURE(m_pcInputParam->m_uiTilesPerFrame == (m_pcInputParam->m_uiFrameWidthInTiles*m_pcInputParam->m_uiFrameHeightInTiles),
 		"Error: The total tiles do not match the frame width in tiles and frame height in tiles");
+	ImageParameters::GetMaxTiles(m_pcInputParam->m_uiFrameWidth, m_pcInputParam->m_uiFrameHeight, false, uiMaxTileCols, uiMaxTileRows);
+	if(verbose && (m_pcInputParam->m_uiFrameWidthInTiles > uiMaxTileCols || m_pcInputParam->m_uiFrameHeightInTiles > uiMaxTileRows))
+		printf("Trace: More tiles than the lowest HEVC level of the resolution allows (%u x %u), the decoder must be of a higher level.\n",
+			uiMaxTileCols, uiMaxTileRows);
+
+	// Adaptive tiles
+	m_pcInputParam->m_bAdaptiveTiles = adaptivetiles;
+	if(adaptivetiles && m_pcInputParam->m_uiTilesPerFrame < 2) printf("Warning: Adaptive tiles need more than one tile and are turned off.\n");
+	else if(adaptivetiles && verbose) printf("Trace: Adaptive tiles enabled.\n");
 
 	// Tile threads
 	m_pcInputParam->m_uiNumTileThreads = tilethreads < 1 ? 1 : tilethreads;
-	m_pcInputParam->m_uiNumTileThreads = tilethreads > MAX_TILE_THREADS ? MAX_TILE_THREADS : m_pcInputParam->m_uiNumTileThreads;
-	if(tilethreads < 1 || tilethreads > MAX_TILE_THREADS) printf("Warning: Total Tile threads being set to %d.\n",m_pcInputParam->m_uiNumTileThreads);
+	if(tilethreads < 0) printf("Warning: Total Tile threads being set to %d.\n",m_pcInputParam->m_uiNumTileThreads);	// 0 if not given
 	else if(verbose) printf("Trace: Total Tile threads %d.\n",m_pcInputParam->m_uiNumTileThreads);
 
+	// Wavefront parallel processing
+	m_pcInputParam->m_bWPP = wpp;
+	if(wpp && verbose) printf("Trace: Wavefront parallel processing enabled.\n");
+
+	// Slices, of whole tiles or with one tile, of whole CTU rows, as many as the highest HEVC level allows
+	u32 uiSliceUnits = m_pcInputParam->m_uiTilesPerFrame > 1 ? m_pcInputParam->m_uiTilesPerFrame : m_pcInputParam->m_uiFrameHeight/CTU_HEIGHT;
+	u32 uiMaxSlices = min(ImageParameters::GetMaxSlices(m_pcInputParam->m_uiFrameWidth, m_pcInputParam->m_uiFrameHeight, true), uiSliceUnits);
+	m_pcInputParam->m_uiSlicesPerFrame = slices < 1 ? 1 : min(u32(slices), uiMaxSlices);
+	if(slices < 0) printf("Warning: Total Slices per frame being set to %d.\n",m_pcInputParam->m_uiSlicesPerFrame);
+	else if(slices > i32(uiMaxSlices)) printf("Warning: Total Slices per frame being set to %d, the most the %s and the level allow.\n",
+		m_pcInputParam->m_uiSlicesPerFrame, m_pcInputParam->m_uiTilesPerFrame > 1 ? "tiles" : "CTU rows");
+	else if(slices > 1 && verbose) printf("Trace: Slices per frame %d.\n",m_pcInputParam->m_uiSlicesPerFrame);
+	if(m_pcInputParam->m_uiSlicesPerFrame > ImageParameters::GetMaxSlices(m_pcInputParam->m_uiFrameWidth, m_pcInputParam->m_uiFrameHeight, false) && verbose)
+		printf("Trace: More slices than the lowest HEVC level of the resolution allows, the decoder must be of a higher level.\n");
+
+	// Byte budget of the slices
+	m_pcInputParam->m_uiSliceMaxBytes = slicebytes < 0 ? 0 : slicebytes;
+	if(slicebytes < 0) printf("Warning: The byte budget of the slices is being set to 0.\n");
+	else if(slicebytes > 0)
+	{
+		MAKE_SURE(m_pcInputParam->m_uiTilesPerFrame == 1 && !wpp,
+			"Error: The byte budget of the slices can only be used with one tile per frame and without wavefront parallel processing");
+		if(slices > 0) printf("Warning: The total slices per frame follow the byte budget of the slices.\n");
+		else if(verbose) printf("Trace: Byte budget of %u bytes per slice.\n",m_pcInputParam->m_uiSliceMaxBytes);
+	}
+
+	// Entropy coding of the CTUs next to their compression
+	m_pcInputParam->m_uiCTUPipeDepth = ctupipe < 0 ? 0 : ctupipe;
+	if(ctupipe < 0) printf("Warning: The CTU pipeline depth is being set to 0.\n");
+	else if(ctupipe && wpp) printf("Warning: The CTU pipeline is not used with wavefront parallel processing.\n");
+	else if(ctupipe && verbose) printf("Trace: CTU pipeline with %u CTUs per tile.\n",m_pcInputParam->m_uiCTUPipeDepth);
+
+	// Processors of the workers
+	m_pcInputParam->m_uiNumAffinityCPUs = 0;
+	if(affinity && !strcmp(affinity, "all"))
+	{
+		// All online processors, node by node, so that neighbouring workers share a NUMA node
+		i32 piNodes[MAX_AFFINITY_CPUS];
+		i32 iMaxNode = 0;
+		u32 uiNumCPUs = min(m_uiTotalCores, u32(MAX_AFFINITY_CPUS));
+		for(u32 j=0;j<uiNumCPUs;j++)
+		{
+			piNodes[j] = GetNUMANodeOfCPU(j);
+			iMaxNode = piNodes[j] > iMaxNode ? piNodes[j] : iMaxNode;
+		}
+		for(i32 n=0;n<=iMaxNode;n++)
+			for(u32 j=0;j<uiNumCPUs;j++)
+				if(piNodes[j] == n)
+					m_pcInputParam->m_puiAffinityCPUs[m_pcInputParam->m_uiNumAffinityCPUs++] = j;
+	}
+	else if(affinity)
+	{
+		m_pcInputParam->m_uiNumAffinityCPUs = ParseCPUList(affinity, m_pcInputParam->m_puiAffinityCPUs, MAX_AFFINITY_CPUS);
+		MAKE_SURE(m_pcInputParam->m_uiNumAffinityCPUs > 0, "Error: The processor list of -affinity is malformed.");
+	}
+	if(m_pcInputParam->m_uiNumAffinityCPUs && verbose)
+	{
+		printf("Trace: Worker threads pinned to processors");
+		for(u32 j=0;j<m_pcInputParam->m_uiNumAffinityCPUs;j++)
+			printf(" %u",m_pcInputParam->m_puiAffinityCPUs[j]);
+		printf(".\n");
+	}
+
+	// Scheduling policy of the workers
+	m_pcInputParam->m_iRTPriority = rtpriority < 0 ? 0 : rtpriority > 99 ? 99 : rtpriority;
+	if(rtpriority < 0 || rtpriority > 99) printf("Warning: Real-time priority being set to %d.\n",m_pcInputParam->m_iRTPriority);
+	else if(rtpriority && verbose) printf("Trace: Real-time priority %d.\n",m_pcInputParam->m_iRTPriority);
+
+	// Workers of the shared threads pool, by default one per online core or per pinned processor
+	m_pcInputParam->m_uiNumWorkers = workers > 0 ? workers : m_pcInputParam->m_uiNumAffinityCPUs ? m_pcInputParam->m_uiNumAffinityCPUs : m_uiTotalCores;
+	if(verbose) printf("Trace: Total worker threads %d (%d cores usable).\n",m_pcInputParam->m_uiNumWorkers,m_uiTotalCores);
+
+	// Reader and writer threads
+	m_pcInputParam->m_uiIODepth = iodepth < 0 ? INIT_IO_DEPTH : iodepth;
+	if(verbose && m_pcInputParam->m_uiIODepth) printf("Trace: Reader thread %u GOPs ahead, writer thread enabled.\n",m_pcInputParam->m_uiIODepth);
+	else if(verbose) printf("Trace: GOPs read and written by the main thread.\n");
+
 	m_pfPSNRPerFrame[0] = new f32[m_pcInputParam->m_uiNumFrames];	// Y PSNR
 	m_pfPSNRPerFrame[1] = new f32[m_pcInputParam->m_uiNumFrames];	// Cb PSNR
 	m_pfPSNRPerFrame[2] = new f32[m_pcInputParam->m_uiNumFrames];	// Cr PSNR
 	m_pu64BytesPerFrame = new u64[m_pcInputParam->m_uiNumFrames];
+	m_puiActiveWorkersPerGOP = new u32[m_pcInputParam->m_uiNumFrames/m_pcInputParam->m_uiGopSize+1];
+}
+
+void EncTop::PlanParallelism(i32 &gopthreads, i32 &totaltiles, i32 &totaltilecols, i32 &totaltilerows,
+							 i32 &tilethreads, i32 &workers, bool wpp)
+{
+	u32 uiCores = m_uiTotalCores;
+	u32 uiWidthInCTUs = m_pcInputParam->m_uiFrameWidth/CTU_WIDTH;
+	u32 uiHeightInCTUs = m_pcInputParam->m_uiFrameHeight/CTU_HEIGHT;
+	u32 uiTotalGOPs = m_pcInputParam->m_uiNumFrames/INIT_GOP_SIZE;
+	u64 u64FrameBytes = u64(m_pcInputParam->m_uiFrameWidth)*m_pcInputParam->m_uiFrameHeight*3/2;
+	u64 u64CacheBytes = GetCacheSize(3);
+	u64CacheBytes = u64CacheBytes ? u64CacheBytes : GetCacheSize(2);
+
+	// GOPs in flight, each of them keeps its frames (and their reconstruction) hot in the cache
+	if(gopthreads < 1)
+	{
+		u32 uiGOPs = min(uiCores, uiTotalGOPs);
+		if(u64CacheBytes)
+			uiGOPs = min(uiGOPs, u32(min(u64CacheBytes/(u64FrameBytes*INIT_GOP_SIZE), u64(uiCores))));
+		gopthreads = uiGOPs < 1 ? 1 : uiGOPs;
+	}
+
+	// The processors left per GOP are filled with tiles or wavefront rows
+	u32 uiPerGOP = (uiCores+gopthreads-1)/gopthreads;
+	if(wpp && totaltiles < 1)
+		totaltiles = totaltilecols = totaltilerows = 1;
+	else if(totaltiles < 1)
+	{
+		// The fewest tiles which give every processor a tile, or as many as the level of the resolution allows
+		// Among equal counts, the tiles closest to a square are taken
+		u32 uiMaxCols, uiMaxRows;
+		ImageParameters::GetMaxTiles(m_pcInputParam->m_uiFrameWidth, m_pcInputParam->m_uiFrameHeight, false, uiMaxCols, uiMaxRows);
+		uiMaxCols = uiWidthInCTUs >= 4 ? min(uiWidthInCTUs/2, uiMaxCols) : 1;
+		uiMaxRows = uiHeightInCTUs >= 4 ? min(uiHeightInCTUs/2, uiMaxRows) : 1;
+		u32 uiBestCols = 1, uiBestRows = 1, uiBestShape = uiWidthInCTUs > uiHeightInCTUs ? uiWidthInCTUs-uiHeightInCTUs : uiHeightInCTUs-uiWidthInCTUs;
+		for(u32 uiCols=1;uiCols<=uiMaxCols;uiCols++)
+		{
+			for(u32 uiRows=1;uiRows<=uiMaxRows;uiRows++)
+			{
+				u32 uiTiles = uiCols*uiRows;
+				u32 uiBestTiles = uiBestCols*uiBestRows;
+				u32 uiTileW = uiWidthInCTUs/uiCols, uiTileH = uiHeightInCTUs/uiRows;
+				u32 uiShape = uiTileW > uiTileH ? uiTileW-uiTileH : uiTileH-uiTileW;
+				bit bEnough = uiTiles >= uiPerGOP, bBestEnough = uiBestTiles >= uiPerGOP;
+				bit bBetter;
+				if(bEnough != bBestEnough)
+					bBetter = bEnough;
+				else if(uiTiles != uiBestTiles)
+					bBetter = bEnough ? uiTiles < uiBestTiles : uiTiles > uiBestTiles;
+				else
+					bBetter = uiShape < uiBestShape;
+				if(bBetter)
+				{
+					uiBestCols = uiCols;
+					uiBestRows = uiRows;
+					uiBestShape = uiShape;
+				}
+			}
+		}
+		totaltilecols = uiBestCols;
+		totaltilerows = uiBestRows;
+		totaltiles = uiBestCols*uiBestRows;
+	}
+
+	// The wavefront rows of a GOP, unless given by the user
+	if(tilethreads < 1)
+		tilethreads = wpp ? min(uiPerGOP, uiHeightInCTUs) : 1;
+
+	// More workers than jobs which can run concurrently would only wait
+	if(workers < 1)
+		workers = min(uiCores, u32(gopthreads)*u32(wpp ? tilethreads : totaltiles));
+
+	printf("Trace: Automatic configuration for %u cores (%u online), %llu KB last level cache, %u x %u CTUs.\n",
+		uiCores, GetNumOnlineCores(), u64CacheBytes >> 10, uiWidthInCTUs, uiHeightInCTUs);
+	printf("Trace: Plan -Ngopth %d -Ntiles %d %d %d -Ntileth %d -Nworkers %d%s.\n",
+		gopthreads, totaltiles, totaltilecols, totaltilerows, tilethreads, workers, wpp ? " --wpp" : "");
 }
 
 void EncTop::InitEncoder()
@@ -271,30 +593,100 @@ void EncTop::InitEncoder()
 	// This depends upon the total GOP and slice threads
 	// Each GOP thread has separate slice threads
 	// In this project, a slice equals a full frame
-	m_pppcYBuff = new byte**[m_pcInputParam->m_uiNumGOPThreads];
-	m_pppcCbBuff = new byte**[m_pcInputParam->m_uiNumGOPThreads];
-	m_pppcCrBuff = new byte**[m_pcInputParam->m_uiNumGOPThreads];
-	m_ppppcStreamHandler = new BitStreamHandler***[m_pcInputParam->m_uiNumGOPThreads];
-	m_ppcH265GOPCompressor = new H265GOPCompressor*[m_pcInputParam->m_uiNumGOPThreads];
-	for(u32 i=0;i<m_pcInputParam->m_uiNumGOPThreads;i++)
+	// The GOP buffers are not tied to a GOP compressor, the reader fills them ahead of the compression
+	m_uiNumGOPBuffs = m_pcInputParam->m_uiNumGOPThreads + m_pcInputParam->m_uiIODepth;
+	m_pppcYBuff = new byte**[m_uiNumGOPBuffs];
+	m_pppcCbBuff = new byte**[m_uiNumGOPBuffs];
+	m_pppcCrBuff = new byte**[m_uiNumGOPBuffs];
+	for(u32 i=0;i<m_uiNumGOPBuffs;i++)
 	{
 		m_pppcYBuff[i] = new byte*[m_pcInputParam->m_uiGopSize];
 		m_pppcCbBuff[i] = new byte*[m_pcInputParam->m_uiGopSize];
 		m_pppcCrBuff[i] = new byte*[m_pcInputParam->m_uiGopSize];
-		m_ppppcStreamHandler[i] = new BitStreamHandler**[m_pcInputParam->m_uiGopSize];		
 		for(u32 j=0;j<m_pcInputParam->m_uiGopSize;j++)
 		{
 			m_pppcYBuff[i][j] = new byte[m_pcImageParam->m_uiFramePelsLuma];
 			m_pppcCbBuff[i][j] = new byte[m_pcImageParam->m_uiFramePelsChroma];
 			m_pppcCrBuff[i][j] = new byte[m_pcImageParam->m_uiFramePelsChroma];	
-			m_ppppcStreamHandler[i][j] = new BitStreamHandler*[m_pcInputParam->m_uiTilesPerFrame];//(m_pcImageParam->m_uiFrameSizeInCTUs * 4096);	// Assume for the moment that a CTU will not take more than 4096 bytes
-			for(u32 k=0;k<m_pcInputParam->m_uiTilesPerFrame;k++)
+		}
+	}
+
+	m_ppppcStreamHandler = new BitStreamHandler***[m_pcInputParam->m_uiNumGOPThreads];
+	m_ppcH265GOPCompressor = new H265GOPCompressor*[m_pcInputParam->m_uiNumGOPThreads];
+	m_ppcGOPJobArgs = new GOPJobArgs_t*[m_pcInputParam->m_uiNumGOPThreads];
+	m_ppcGOPWorkItem = new WorkItem*[m_pcInputParam->m_uiNumGOPThreads];
+	for(u32 i=0;i<m_pcInputParam->m_uiNumGOPThreads;i++)
+	{
+		m_ppppcStreamHandler[i] = new BitStreamHandler**[m_pcInputParam->m_uiGopSize];		
+		for(u32 j=0;j<m_pcInputParam->m_uiGopSize;j++)
+		{
+			m_ppppcStreamHandler[i][j] = new BitStreamHandler*[m_pcImageParam->m_uiFrameSizeInRegions];//(m_pcImageParam->m_uiFrameSizeInCTUs * 4096);	// Assume for the moment that a CTU will not take more than 4096 bytes
+			for(u32 k=0;k<m_pcImageParam->m_uiFrameSizeInRegions;k++)
 				m_ppppcStreamHandler[i][j][k] = new BitStreamHandler(m_pcImageParam->m_u64TotalBytesPerTile);
 		}
-		m_ppcH265GOPCompressor[i] = new H265GOPCompressor(m_pcInputParam,m_pcImageParam,m_ppppcStreamHandler[i]);	// This will create the whole chain of slice, tile and CTU encoders
+		m_ppcH265GOPCompressor[i] = new H265GOPCompressor(m_pcInputParam,m_pcImageParam,m_ppppcStreamHandler[i],m_pcWorkQueue);	// This will create the whole chain of slice, tile and CTU encoders
+
+		m_ppcGOPJobArgs[i] = new GOPJobArgs_t;
+		m_ppcGOPJobArgs[i]->iNum = i;
+		m_ppcGOPJobArgs[i]->ppbYBuff = NULL;	// Set for every GOP
+		m_ppcGOPJobArgs[i]->ppbCbBuff = NULL;
+		m_ppcGOPJobArgs[i]->ppbCrBuff = NULL;
+		m_ppcGOPJobArgs[i]->pcGOPCompressor = m_ppcH265GOPCompressor[i];
+		m_ppcGOPJobArgs[i]->i64Pending = 0;
+		m_ppcGOPWorkItem[i] = new WorkItem(CompressGOPThread,i,m_ppcGOPJobArgs[i],0,&m_ppcGOPJobArgs[i]->i64Pending);
 	}
 }
 
+void EncTop::MakeThreadsPool()
+{
+	m_pcWorkQueue = NULL;
+	m_ppcThreadHandler = NULL;
+	m_uiTotalPoolThreads = 0;
+#if(USE_THREADS)
+	// Every GOP compressor in flight has one GOP job, at most one job per tile (or slice band) but
+	// the first, and with wavefronts, the CTU row jobs of its tiles
+	u32 uiTotalTiles = m_pcImageParam->m_uiFrameSizeInRegions;
+	u32 uiJobsPerGOP = 1 + uiTotalTiles*(1+m_pcInputParam->m_uiNumTileThreads);
+	m_uiTotalPoolThreads = m_pcInputParam->m_uiNumWorkers-1;
+	m_pcWorkQueue = new WorkQueue(m_pcInputParam->m_uiNumGOPThreads*uiJobsPerGOP,m_uiTotalPoolThreads);
+	m_pcWorkQueue->SetMeasureLatency(m_pcInputParam->m_bVerbose);
+
+	// The main thread is the first worker, it executes jobs while it waits for them
+	u32 uiNumCPUs = m_pcInputParam->m_uiNumAffinityCPUs;
+	u32 const *puiCPUs = m_pcInputParam->m_puiAffinityCPUs;
+	if(uiNumCPUs && !SetThreadAffinity(puiCPUs[0]))
+		printf("Warning: Main thread could not be pinned to processor %u.\n",puiCPUs[0]);
+	if(m_pcInputParam->m_iRTPriority && !SetThreadRealTime(m_pcInputParam->m_iRTPriority))
+		printf("Warning: Main thread could not be given the real-time priority %d.\n",m_pcInputParam->m_iRTPriority);
+
+	// Start the threads
+	// They will wait for jobs inserted in the job queue
+	m_ppcThreadHandler = new ThreadHandler*[m_uiTotalPoolThreads];
+	for(u32 i=0;i<m_uiTotalPoolThreads;i++)
+	{
+		i32 iCPU = uiNumCPUs ? i32(puiCPUs[(i+1)%uiNumCPUs]) : -1;
+		m_ppcThreadHandler[i] = new ThreadHandler(m_pcWorkQueue,iCPU,m_pcInputParam->m_iRTPriority);
+		m_ppcThreadHandler[i]->StartThread();
+	}
+#endif
+}
+
+void EncTop::FreeThreadsPool()
+{
+#if(USE_THREADS)
+	if(m_pcWorkQueue == NULL)
+		return;
+
+	m_pcWorkQueue->WaitQueueEmpty();
+	m_pcWorkQueue->Shutdown();
+	for(u32 i=0;i<m_uiTotalPoolThreads;i++)
+		delete m_ppcThreadHandler[i];
+	delete [] m_ppcThreadHandler;
+	delete m_pcWorkQueue;
+	m_pcWorkQueue = NULL;
+#endif
+}
+
 void EncTop::OpenIOFiles()
 {
 	m_ifsYUVFile.open(m_pcInputParam->m_cInputYuvName, ios::binary | ios::in);
@@ -337,11 +729,16 @@ void EncTop::OpenIOFiles()
 		m_ofsStats<<"QP: " << m_pcInputParam->m_uiQP << endl;
 		m_ofsStats<<"Total GOP threads: " << m_pcInputParam->m_uiNumGOPThreads << endl;
 		m_ofsStats<<"Total slice threads: " << m_pcInputParam->m_uiNumSliceThreads << endl;
+		m_ofsStats<<"Total worker threads: " << m_pcInputParam->m_uiNumWorkers << endl;
 		m_ofsStats<<"Total tiles per frame: " << m_pcInputParam->m_uiTilesPerFrame << endl;
 		m_ofsStats<<"Frame width in tiles: " << m_pcInputParam->m_uiFrameWidthInTiles << endl;
 		m_ofsStats<<"Frame height in tiles: " << m_pcInputParam->m_uiFrameHeightInTiles << endl;
+		m_ofsStats<<"Total slices per frame: " << m_pcInputParam->m_uiSlicesPerFrame << endl;
+		if(m_pcImageParam->m_bSliceBands)
+			m_ofsStats<<"Tile_Bytes and Tile_Time are given per CTU row band of the slices" << endl;
 		m_ofsStats<<"Data is written in the following format" << endl;
-		m_ofsStats<<"GOP_Number GOP_Bytes Frame_Number Frame_Bytes Frame_Time Tile_Bytes Tile_Time"<< endl;
+		m_ofsStats<<"GOP_Number GOP_Bytes Frame_Number Frame_Bytes Frame_Time Tile_Bytes Tile_Time"
+			<< (m_pcDeadlineGovernor ? " Active_Workers" : "") << endl;
 	}
 }
 
@@ -354,52 +751,213 @@ void EncTop::Encode()
 		printf("Trace: Headers encoded with total %llu bytes.\n",uiTotalPSBytes);
 
 	// Start encoding the rest of the frames
-	for(u32 i=0;i<m_pcInputParam->m_uiNumFrames/m_pcInputParam->m_uiNumGOPThreads/m_pcInputParam->m_uiGopSize;i++)
-	{
-		// Compress one GOP at a time
-		for(u32 j=0;j<m_pcInputParam->m_uiNumGOPThreads;j++)
-		{
-			// For every GOP, read exactly Num Slice threads frames and compress these frames
-			// Read input files
-			FillGOPBuffFromYUV(j);
-			m_pcImageParam->m_eSliceType = I_SLICE;
-
-			// Start compression
-			m_ppcH265GOPCompressor[j]->CompressGOP(m_pppcYBuff[j], m_pppcCbBuff[j], m_pppcCrBuff[j],
-				i*m_pcInputParam->m_uiNumGOPThreads+j);
-
-			// Write the bitstream
-			// For each slice of the GOP, there is one or more Tiles
-			// and we write per-tile
-			m_u64CurrGOPBytes = 0;
-			m_pu64BytesPerFrame[i*m_pcInputParam->m_uiNumGOPThreads+j] = 0;
-			for(u32 k=0;k<m_pcInputParam->m_uiGopSize;k++)
-			{
-				BitStreamHandler *pcBitStreamHandler = m_ppcH265GOPCompressor[j]->GetSliceBitStreamHandler(k);
-				u64 u64TotalSliceBytes = 0;
-				// Loop over slice headers and tiles (if present)
-				do
-				{
-					u64TotalSliceBytes += WriteBitstreamFile(pcBitStreamHandler);
-					pcBitStreamHandler = pcBitStreamHandler->GetNextBitStreamHandler();
-				}while(pcBitStreamHandler);	// If there is a next bitstream allocated for the tile
-				m_pu64BytesPerFrame[i*m_pcInputParam->m_uiNumGOPThreads+j] += u64TotalSliceBytes;
-				m_u64CurrGOPBytes += u64TotalSliceBytes;
-			}
-			if(m_pcInputParam->m_bVerbose)
-				printf("Trace: GOP %d encoded with total %llu bytes.\n",i,m_u64CurrGOPBytes);
+	// GOP compressor j handles every m_uiNumGOPThreads-th GOP starting from GOP j. All the compressors
+	// are kept busy, while the compressed GOPs are written to the bitstream strictly in display order
+	u32 uiGopSize = m_pcInputParam->m_uiGopSize;
+	u32 uiNumGOPThreads = m_pcInputParam->m_uiNumGOPThreads;
+	u32 uiTotalGOPs = m_pcInputParam->m_uiNumFrames/uiGopSize;
+
+	// With an IO depth, the reading and writing run in their own threads, so that
+	// the main thread only waits for the disk when the pipeline runs dry
+	m_uiGOPsRead = 0;
+	m_uiGOPsCompressed = 0;
+	m_uiGOPsStreamWritten = 0;
+	m_uiGOPsWritten = 0;
+	if(m_pcInputParam->m_uiIODepth)
+	{
+		MAKE_SURE(pthread_create(&m_ptReaderThread, NULL, ReaderThread, this) == 0, "Error: Cannot create the reader thread.");
+		MAKE_SURE(pthread_create(&m_ptWriterThread, NULL, WriterThread, this) == 0, "Error: Cannot create the writer thread.");
+	}
 
-			// Dump the stats
-			if(m_bStats)
-				DumpStats(j,i*m_pcInputParam->m_uiNumGOPThreads+j);
+	if(m_pcDeadlineGovernor)
+		m_pcDeadlineGovernor->Start(GetTimeInMicroSec());
+	for(u32 i=0;i<uiNumGOPThreads && i<uiTotalGOPs;i++)
+		SubmitGOP(i,i*uiGopSize);
 
-			// Write reconstructed GOP
-			if(m_bOutputRec)
-				WriteGOPBuffToYUV(j);
+	for(u32 i=0;i<uiTotalGOPs;i++)
+	{
+		i32 iGopNum = i % uiNumGOPThreads;
+		WaitGOPDone(iGopNum);
+		if(m_pcTileBalancer)
+			UpdateTileLayout(iGopNum);
+		if(m_pcSliceBalancer)
+			UpdateSliceLayout(iGopNum);
+		if(m_pcDeadlineGovernor)
+			UpdateActiveWorkers();
+		if(m_pcInputParam->m_uiIODepth)
+			SetPipeStage(&m_uiGOPsCompressed,i+1);
+		else
+		{
+			WriteGOP(iGopNum,i*uiGopSize);
+			WriteGOPBuffToYUV(i % m_uiNumGOPBuffs);
 		}
+
+		// The compressor is free again (once the writer is done with it), give it the next GOP in line
+		if(i+uiNumGOPThreads < uiTotalGOPs)
+			SubmitGOP(iGopNum,(i+uiNumGOPThreads)*uiGopSize);
+	}
+
+	if(m_pcInputParam->m_uiIODepth)
+	{
+		pthread_join(m_ptReaderThread, NULL);
+		pthread_join(m_ptWriterThread, NULL);
 	}
 	uiCurrTime = GetTimeInMiliSec() - uiCurrTime;
+	m_uiEncodingTime = uiCurrTime;
+	Tracer::Flush();
 	printf("Trace: Total encoding time is %u msec.\n",uiCurrTime);
+	if(m_pcDeadlineGovernor)
+	{
+		printf("Trace: Real-time mode, %llu of %u frames late, %.2f active workers on average, %u increases and %u decreases.\n",
+			m_pcDeadlineGovernor->GetLateFrames(),uiTotalGOPs*uiGopSize,m_pcDeadlineGovernor->GetAvgActiveWorkers(),
+			m_pcDeadlineGovernor->GetIncreases(),m_pcDeadlineGovernor->GetDecreases());
+		if(m_bStats)
+			m_ofsStats << "Real-time: frame interval " << m_pcDeadlineGovernor->GetFrameInterval() << " usec, late frames "
+				<< m_pcDeadlineGovernor->GetLateFrames() << ", average active workers " << m_pcDeadlineGovernor->GetAvgActiveWorkers()
+				<< ", increases " << m_pcDeadlineGovernor->GetIncreases() << ", decreases " << m_pcDeadlineGovernor->GetDecreases() << endl;
+	}
+	if(m_pcSliceBalancer)
+	{
+		printf("Trace: Slices of at most %u bytes, %.2f slices per frame on average, %llu of %llu slices over the budget.\n",
+			m_pcImageParam->m_uiSliceMaxBytes,m_pcSliceBalancer->GetAvgSlices(),
+			m_pcSliceBalancer->GetOverBudgetSlices(),m_pcSliceBalancer->GetTotalSlices());
+		if(m_bStats)
+			m_ofsStats << "Slices: budget " << m_pcImageParam->m_uiSliceMaxBytes << " bytes, average slices per frame "
+				<< m_pcSliceBalancer->GetAvgSlices() << ", slices over the budget " << m_pcSliceBalancer->GetOverBudgetSlices()
+				<< " of " << m_pcSliceBalancer->GetTotalSlices() << endl;
+	}
+#if(USE_THREADS)
+	if(m_pcInputParam->m_bVerbose)
+	{
+		WorkQueueStats_t sStats;
+		m_pcWorkQueue->GetStats(sStats);
+		u64 u64Jobs = sStats.u64Jobs ? sStats.u64Jobs : 1;
+		printf("Trace: %llu jobs, start latency %llu usec (max %llu), completion latency %llu usec (max %llu), %llu parks.\n",
+			sStats.u64Jobs,sStats.u64StartLatency/u64Jobs,sStats.u64StartLatencyMax,
+			sStats.u64DoneLatency/u64Jobs,sStats.u64DoneLatencyMax,sStats.u64Parks);
+	}
+#endif
+}
+
+void EncTop::SubmitGOP(i32 iGopNum, u32 uiGopStartFrameNum)
+{
+	// For every GOP, read exactly GOP size frames
+	u32 uiGop = uiGopStartFrameNum/m_pcInputParam->m_uiGopSize;
+	u32 uiGopBuff = uiGop % m_uiNumGOPBuffs;
+	if(m_pcInputParam->m_uiIODepth)
+	{
+		// The bitstream buffers of the compressor must have been written out
+		if(uiGop >= m_pcInputParam->m_uiNumGOPThreads)
+			WaitPipeStage(&m_uiGOPsStreamWritten,uiGop-m_pcInputParam->m_uiNumGOPThreads+1);
+		WaitPipeStage(&m_uiGOPsRead,uiGop+1);
+	}
+	else
+		FillGOPBuffFromYUV(uiGopBuff);
+
+	// Per-frame state travels with the job, so that the GOPs in flight do not share it
+	GOPJobArgs_t *pcArgs = m_ppcGOPJobArgs[iGopNum];
+	pcArgs->ppbYBuff = m_pppcYBuff[uiGopBuff];
+	pcArgs->ppbCbBuff = m_pppcCbBuff[uiGopBuff];
+	pcArgs->ppbCrBuff = m_pppcCrBuff[uiGopBuff];
+	pcArgs->uiStartSliceNum = uiGopStartFrameNum;
+	pcArgs->sSliceParams.eType = I_SLICE;
+	pcArgs->sSliceParams.uiQP = m_pcInputParam->m_uiQP;
+	if(m_pcTileBalancer)
+		m_ppcH265GOPCompressor[iGopNum]->SetTileLayout(m_pcTileBalancer->GetTileLayout());
+	if(m_pcSliceBalancer)
+		m_ppcH265GOPCompressor[iGopNum]->SetSliceLayout(m_pcSliceBalancer->GetSliceLayout());
+	m_puiActiveWorkersPerGOP[uiGop] = m_pcDeadlineGovernor ? m_pcDeadlineGovernor->GetActiveWorkers() : m_pcInputParam->m_uiNumWorkers;
+
+#if(USE_THREADS)
+	MAKE_SURE(m_pcWorkQueue->AddToJob(m_ppcGOPWorkItem[iGopNum]) == 0,
+		"Error: No space in the workqueue.");
+#else
+	CompressGOPThread(pcArgs);
+#endif
+}
+
+void EncTop::WaitGOPDone(i32 iGopNum)
+{
+#if(USE_THREADS)
+	m_pcWorkQueue->WaitGroupDone(m_ppcGOPJobArgs[iGopNum]->i64Pending, true);	// The main thread also helps with the next GOPs
+#endif
+}
+
+void EncTop::WriteGOP(i32 iGopNum, u32 uiGopStartFrameNum)
+{
+	// For each slice of the GOP, there is one or more Tiles
+	// and we write per-tile
+	m_u64CurrGOPBytes = 0;
+	for(u32 k=0;k<m_pcInputParam->m_uiGopSize;k++)
+	{
+		BitStreamHandler *pcBitStreamHandler = m_ppcH265GOPCompressor[iGopNum]->GetSliceBitStreamHandler(k);
+		u64 u64TotalSliceBytes = 0;
+		// The slice refers to the last PPS, which must carry the tile layout the slice was compressed with
+		TileLayout_t const &sTileLayout = m_ppcH265GOPCompressor[iGopNum]->GetSliceCompressor(k % m_pcInputParam->m_uiNumSliceThreads)->GetTileLayout();
+		if(!m_pcImageParam->IsSameTileLayout(sTileLayout,m_sPPSTileLayout))
+			u64TotalSliceBytes += WritePPS(sTileLayout);
+		// Loop over slice headers and tiles (if present)
+		do
+		{
+			u64TotalSliceBytes += WriteBitstreamFile(pcBitStreamHandler);
+			pcBitStreamHandler = pcBitStreamHandler->GetNextBitStreamHandler();
+		}while(pcBitStreamHandler);	// If there is a next bitstream allocated for the tile
+		m_pu64BytesPerFrame[uiGopStartFrameNum+k] = u64TotalSliceBytes;
+		m_u64CurrGOPBytes += u64TotalSliceBytes;
+	}
+	TRACE(TRACE_LEVEL_VERBOSE, "Trace: GOP %u encoded with total %llu bytes.\n",uiGopStartFrameNum/m_pcInputParam->m_uiGopSize,m_u64CurrGOPBytes);
+
+	// Dump the stats
+	if(m_bStats)
+		DumpStats(iGopNum,uiGopStartFrameNum);
+}
+
+void *EncTop::ReaderThread(void *pArgs)
+{
+	EncTop *pcEncTop = (EncTop *)pArgs;
+	u32 uiTotalGOPs = pcEncTop->m_pcInputParam->m_uiNumFrames/pcEncTop->m_pcInputParam->m_uiGopSize;
+	for(u32 i=0;i<uiTotalGOPs;i++)
+	{
+		// The buffer is free once its previous GOP is completely written
+		u32 uiGopBuff = i % pcEncTop->m_uiNumGOPBuffs;
+		if(i >= pcEncTop->m_uiNumGOPBuffs)
+			pcEncTop->WaitPipeStage(&pcEncTop->m_uiGOPsWritten,i-pcEncTop->m_uiNumGOPBuffs+1);
+		pcEncTop->FillGOPBuffFromYUV(uiGopBuff);
+		pcEncTop->SetPipeStage(&pcEncTop->m_uiGOPsRead,i+1);
+	}
+	return NULL;
+}
+
+void *EncTop::WriterThread(void *pArgs)
+{
+	EncTop *pcEncTop = (EncTop *)pArgs;
+	u32 uiGopSize = pcEncTop->m_pcInputParam->m_uiGopSize;
+	u32 uiTotalGOPs = pcEncTop->m_pcInputParam->m_uiNumFrames/uiGopSize;
+	for(u32 i=0;i<uiTotalGOPs;i++)
+	{
+		pcEncTop->WaitPipeStage(&pcEncTop->m_uiGOPsCompressed,i+1);
+		pcEncTop->WriteGOP(i % pcEncTop->m_pcInputParam->m_uiNumGOPThreads,i*uiGopSize);
+		pcEncTop->SetPipeStage(&pcEncTop->m_uiGOPsStreamWritten,i+1);
+		pcEncTop->WriteGOPBuffToYUV(i % pcEncTop->m_uiNumGOPBuffs);
+		pcEncTop->SetPipeStage(&pcEncTop->m_uiGOPsWritten,i+1);
+	}
+	return NULL;
+}
+
+void EncTop::WaitPipeStage(u32 const *puiGOPsDone, u32 uiGOPs)
+{
+	pthread_mutex_lock(&m_ptPipeMutex);
+	while(*puiGOPsDone < uiGOPs)
+		pthread_cond_wait(&m_ptPipeCond, &m_ptPipeMutex);
+	pthread_mutex_unlock(&m_ptPipeMutex);
+}
+
+void EncTop::SetPipeStage(u32 *puiGOPsDone, u32 uiGOPs)
+{
+	pthread_mutex_lock(&m_ptPipeMutex);
+	*puiGOPsDone = uiGOPs;
+	pthread_cond_broadcast(&m_ptPipeCond);
+	pthread_mutex_unlock(&m_ptPipeMutex);
 }
 
 u64 EncTop::WritePS()
@@ -412,12 +970,75 @@ u64 EncTop::WritePS()
 	u64TotalBytes += WriteBitstreamFile(pcBitStreamHandler);
 	pcHeader->GenSPSNALU(m_pcInputParam,m_pcImageParam,pcBitStreamHandler);
 	u64TotalBytes += WriteBitstreamFile(pcBitStreamHandler);
-	pcHeader->GenPPSNALU(m_pcInputParam,m_pcImageParam,pcBitStreamHandler);
+	m_sPPSTileLayout = m_pcImageParam->m_sUniformTileLayout;
+	pcHeader->GenPPSNALU(m_pcInputParam,m_pcImageParam,m_sPPSTileLayout,pcBitStreamHandler);
 	u64TotalBytes += WriteBitstreamFile(pcBitStreamHandler);
 	delete pcHeader;
 	return u64TotalBytes;
 }
 
+u64 EncTop::WritePPS(TileLayout_t const &sTileLayout)
+{
+	H265Headers *pcHeader = new H265Headers;
+	// The compressed GOPs are still waiting in their buffers, so the PPS gets its own buffer
+	BitStreamHandler *pcBitStreamHandler = new BitStreamHandler(64+4*(MAX_TILE_COLUMNS+MAX_TILE_ROWS));
+	m_sPPSTileLayout = sTileLayout;
+	pcHeader->GenPPSNALU(m_pcInputParam,m_pcImageParam,m_sPPSTileLayout,pcBitStreamHandler);
+	u64 u64TotalBytes = WriteBitstreamFile(pcBitStreamHandler);
+	delete pcBitStreamHandler;
+	delete pcHeader;
+	return u64TotalBytes;
+}
+
+void EncTop::UpdateTileLayout(i32 iGopNum)
+{
+	for(u32 i=0;i<m_pcInputParam->m_uiNumSliceThreads;i++)
+		m_pcTileBalancer->AddFrameCost(m_ppcH265GOPCompressor[iGopNum]->GetSliceCompressor(i)->GetCTUCost());
+	if(!m_pcTileBalancer->UpdateTileLayout() || !m_pcInputParam->m_bVerbose)
+		return;
+
+	TileLayout_t const &sTileLayout = m_pcTileBalancer->GetTileLayout();
+	Tracer::Flush();
+	printf("Trace: New tile layout, column widths");
+	for(u32 i=0;i<m_pcImageParam->m_uiFrameWidthInTiles;i++)
+		printf(" %u",sTileLayout.puiColWidthInCTUs[i]);
+	printf(", row heights");
+	for(u32 i=0;i<m_pcImageParam->m_uiFrameHeightInTiles;i++)
+		printf(" %u",sTileLayout.puiRowHeightInCTUs[i]);
+	printf(" CTUs.\n");
+}
+
+void EncTop::UpdateSliceLayout(i32 iGopNum)
+{
+	for(u32 i=0;i<m_pcInputParam->m_uiNumSliceThreads;i++)
+	{
+		H265SliceCompressor *pcSliceCompressor = m_ppcH265GOPCompressor[iGopNum]->GetSliceCompressor(i);
+		m_pcSliceBalancer->AddFrameBytes(pcSliceCompressor->GetCTUBytes(),pcSliceCompressor->GetTotalSlices(),pcSliceCompressor->GetBytesPerSlice());
+	}
+	if(!m_pcSliceBalancer->UpdateSliceLayout() || !m_pcInputParam->m_bVerbose)
+		return;
+
+	SliceLayout_t const &sSliceLayout = m_pcSliceBalancer->GetSliceLayout();
+	Tracer::Flush();
+	printf("Trace: New slice layout, %u slices of",sSliceLayout.uiNumSlices);
+	for(u32 i=0;i<sSliceLayout.uiNumSlices;i++)
+		printf(" %u",sSliceLayout.puiSliceSizeInUnits[i]);
+	printf(" CTU rows.\n");
+}
+
+void EncTop::UpdateActiveWorkers()
+{
+	if(!m_pcDeadlineGovernor->AddGOPDone(GetTimeInMicroSec(), m_pcInputParam->m_uiGopSize))
+		return;
+
+#if(USE_THREADS)
+	// The main thread is not a worker of the queue and always helps
+	m_pcWorkQueue->SetActiveWorkers(i32(m_pcDeadlineGovernor->GetActiveWorkers())-1);
+#endif
+	TRACE(TRACE_LEVEL_VERBOSE, "Trace: %u active workers, as a frame took %llu usec with a frame interval of %llu usec.\n",
+		m_pcDeadlineGovernor->GetActiveWorkers(),m_pcDeadlineGovernor->GetWindowFrameTime(),m_pcDeadlineGovernor->GetFrameInterval());
+}
+
 u64 EncTop::WriteBitstreamFile(BitStreamHandler *pcBitStreamHandler)
 {
 	u64 u64TotalBytes = pcBitStreamHandler->GetTotalBytesWritten();
@@ -426,28 +1047,31 @@ u64 EncTop::WriteBitstreamFile(BitStreamHandler *pcBitStreamHandler)
 	return u64TotalBytes;
 }
 
-void EncTop::FillGOPBuffFromYUV(i32 iGopNum)
+void EncTop::FillGOPBuffFromYUV(u32 uiGopBuff)
 {
 	for(u32 i=0;i<m_pcInputParam->m_uiGopSize;i++)
 	{
 		if(m_ifsYUVFile.good())
 		{
-			m_ifsYUVFile.read((i8 *)m_pppcYBuff[iGopNum][i],m_pcImageParam->m_uiFramePelsLuma);
-			m_ifsYUVFile.read((i8 *)m_pppcCbBuff[iGopNum][i],m_pcImageParam->m_uiFramePelsChroma);
-			m_ifsYUVFile.read((i8 *)m_pppcCrBuff[iGopNum][i],m_pcImageParam->m_uiFramePelsChroma);
+			m_ifsYUVFile.read((i8 *)m_pppcYBuff[uiGopBuff][i],m_pcImageParam->m_uiFramePelsLuma);
+			m_ifsYUVFile.read((i8 *)m_pppcCbBuff[uiGopBuff][i],m_pcImageParam->m_uiFramePelsChroma);
+			m_ifsYUVFile.read((i8 *)m_pppcCrBuff[uiGopBuff][i],m_pcImageParam->m_uiFramePelsChroma);
 		}
 	}
 }
 
-void EncTop::WriteGOPBuffToYUV(i32 iGopNum)
+void EncTop::WriteGOPBuffToYUV(u32 uiGopBuff)
 {
+	if(!m_bOutputRec)
+		return;
+
 	for(u32 i=0;i<m_pcInputParam->m_uiGopSize;i++)
 	{
 		if(m_fsYUVFileRec.good())
 		{
-			m_fsYUVFileRec.write((i8 *)m_pppcYBuff[iGopNum][i],m_pcImageParam->m_uiFramePelsLuma);
-			m_fsYUVFileRec.write((i8 *)m_pppcCbBuff[iGopNum][i],m_pcImageParam->m_uiFramePelsChroma);
-			m_fsYUVFileRec.write((i8 *)m_pppcCrBuff[iGopNum][i],m_pcImageParam->m_uiFramePelsChroma);
+			m_fsYUVFileRec.write((i8 *)m_pppcYBuff[uiGopBuff][i],m_pcImageParam->m_uiFramePelsLuma);
+			m_fsYUVFileRec.write((i8 *)m_pppcCbBuff[uiGopBuff][i],m_pcImageParam->m_uiFramePelsChroma);
+			m_fsYUVFileRec.write((i8 *)m_pppcCrBuff[uiGopBuff][i],m_pcImageParam->m_uiFramePelsChroma);
 		}
 	}
 }
@@ -463,36 +1087,47 @@ void EncTop::DumpStats(i32 iGopNum, u32 uiGopStartFrameNum)
 	for(u32 i=0;i<m_pcInputParam->m_uiGopSize;i++)
 	{
 		u64 *pcBytesPerTile = m_ppcH265GOPCompressor[iGopNum]->GetSliceCompressor(i)->GetBytesPerTile();
-		for(u32 j=0;j<m_pcInputParam->m_uiTilesPerFrame;j++)
+		for(u32 j=0;j<m_pcImageParam->m_uiFrameSizeInRegions;j++)
 			m_ofsStats << "\t" << pcBytesPerTile[j];
 	}
 	for(u32 i=0;i<m_pcInputParam->m_uiGopSize;i++)
 	{
 		u32 *pcTimePerTile = m_ppcH265GOPCompressor[iGopNum]->GetSliceCompressor(i)->GetTimePerTile();
-		for(u32 j=0;j<m_pcInputParam->m_uiTilesPerFrame;j++)
+		for(u32 j=0;j<m_pcImageParam->m_uiFrameSizeInRegions;j++)
 			m_ofsStats << "\t" << pcTimePerTile[j];
 	}
+	if(m_pcDeadlineGovernor)
+		m_ofsStats << "\t" << m_puiActiveWorkersPerGOP[uiGopStartFrameNum/m_pcInputParam->m_uiGopSize];
 	m_ofsStats << endl;
 }
 
 void EncTop::FreeAllocBuff()
 {
-	for(u32 i=0;i<m_pcInputParam->m_uiNumGOPThreads;i++)
+	for(u32 i=0;i<m_uiNumGOPBuffs;i++)
 	{
 		for(u32 j=0;j<m_pcInputParam->m_uiGopSize;j++)
 		{
 			delete [] m_pppcYBuff[i][j] ;
 			delete [] m_pppcCbBuff[i][j];
 			delete [] m_pppcCrBuff[i][j];
-			for(u32 k=0;k<m_pcInputParam->m_uiTilesPerFrame;k++)
-				delete m_ppppcStreamHandler[i][j][k];
-			delete [] m_ppppcStreamHandler[i][j];
 		}
 		delete [] m_pppcYBuff[i];
 		delete [] m_pppcCbBuff[i];
 		delete [] m_pppcCrBuff[i];
+	}
+
+	for(u32 i=0;i<m_pcInputParam->m_uiNumGOPThreads;i++)
+	{
+		for(u32 j=0;j<m_pcInputParam->m_uiGopSize;j++)
+		{
+			for(u32 k=0;k<m_pcImageParam->m_uiFrameSizeInRegions;k++)
+				delete m_ppppcStreamHandler[i][j][k];
+			delete [] m_ppppcStreamHandler[i][j];
+		}
 		delete [] m_ppppcStreamHandler[i];
 		delete m_ppcH265GOPCompressor[i];
+		delete m_ppcGOPJobArgs[i];
+		delete m_ppcGOPWorkItem[i];
 	}
 
 	delete [] m_pppcYBuff;
@@ -500,10 +1135,13 @@ void EncTop::FreeAllocBuff()
 	delete [] m_pppcCrBuff;
 	delete [] m_ppppcStreamHandler;
 	delete [] m_ppcH265GOPCompressor;
+	delete [] m_ppcGOPJobArgs;
+	delete [] m_ppcGOPWorkItem;
 	delete [] m_pfPSNRPerFrame[0];
 	delete [] m_pfPSNRPerFrame[1];
 	delete [] m_pfPSNRPerFrame[2];
 	delete [] m_pu64BytesPerFrame;
+	delete [] m_puiActiveWorkersPerGOP;
 
 	delete m_pcInputParam;
 	delete m_pcImageParam;
@@ -517,6 +1155,12 @@ void EncTop::CloseIOFiles()
 	if(m_ofsStats.is_open()) m_ofsStats.close();
 }
 
+f64 EncTop::GetFramesPerSec()
+{
+	u32 uiTotalFrames = m_pcInputParam->m_uiNumFrames/m_pcInputParam->m_uiGopSize*m_pcInputParam->m_uiGopSize;
+	return f64(uiTotalFrames)*1000.0/f64(max(m_uiEncodingTime,1u));
+}
+
 void EncTop::PrintPSNR(bool bLumaOnly)
 {
 	if(m_bOutputRec)
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <BitStreamHandler.h>
 #include <H265CTUCompressor.h>
 #include <Cabac.h>
+#include <Kernels.h>
 #include <Utilities.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -80,7 +81,7 @@ const u8 g_pbChramaQPFromLuma[52] = {
 
 // CTU
 H265CTUCompressor::H265CTUCompressor(InputParameters const *pcInputParam, ImageParameters const *pcImageParam,
-									 pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL)
+									 pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL, TopLineBuffers_t const *psTopLine)
 {
 	m_pcInputParam = pcInputParam;
 	m_pcImageParam = pcImageParam;
@@ -89,19 +90,37 @@ H265CTUCompressor::H265CTUCompressor(InputParameters const *pcInputParam, ImageP
 	m_uiQP = pcInputParam->m_uiQP;
 	m_pcH265Trans = new H265Transform;
 
-	m_cTileStartCTUPelTL.x = cTileStartCTUPelTL.x;
-	m_cTileStartCTUPelTL.y = cTileStartCTUPelTL.y;
-	m_cTileEndCTUPelTL.x = cTileEndCTUPelTL.x;
-	m_cTileEndCTUPelTL.y = cTileEndCTUPelTL.y;
-	
-	m_uiTileWidthInPels = cTileEndCTUPelTL.x - cTileStartCTUPelTL.x + CTU_WIDTH;
-	m_uiTileHeightInPels = cTileEndCTUPelTL.y - cTileStartCTUPelTL.y + CTU_HEIGHT;
+	// The candidates of the mode list take fewer bits to signal (about 2, 3 and 6 bits).
+	// With the SAD, the cost of a mode grows with the QP, and with the SATD, with the square root of lambda (0.57*2^((QP-12)/3)).
+	if(pcInputParam->m_bSATD)
+	{
+		f64 dSqrtLambda = SATD_MODE_COST_WEIGHT*sqrt(0.57*pow(2.0, (f64(m_uiQP)-12.0)/3.0));
+		m_ppfDistortion = g_sKernels.pfSATD;
+		m_puiModeCost[0] = u32(2.0*dSqrtLambda + 0.5);
+		m_puiModeCost[1] = u32(3.0*dSqrtLambda + 0.5);
+		m_puiModeCost[2] = u32(6.0*dSqrtLambda + 0.5);
+	}
+	else
+	{
+		m_ppfDistortion = g_sKernels.pfSAD;
+		m_puiModeCost[0] = m_uiQP;
+		m_puiModeCost[1] = m_uiQP<<1;
+		m_puiModeCost[2] = (m_uiQP<<1)+m_uiQP;
+	}
 
-	// CTU_WIDTH+1 added to eliminate invalid reads in reference generation
-	m_pbRefTopBuffY = new byte[m_uiTileWidthInPels+CTU_WIDTH+1];
-	m_pbRefTopBuffCb = new byte[(m_uiTileWidthInPels>>1)+(CTU_WIDTH>>1)+1];	
-	m_pbRefTopBuffCr = new byte[(m_uiTileWidthInPels>>1)+(CTU_WIDTH>>1)+1];
-	m_pbTopLineIntraModeInfoL = new u8[m_uiTileWidthInPels/MIN_CU_SIZE+1];
+	SetTileBoundary(cTileStartCTUPelTL, cTileEndCTUPelTL);
+	m_bLastTileOfSlice = (cTileEndCTUPelTL.x == (m_pcImageParam->m_uiFrameWidthInCTUs-1)*CTU_WIDTH &&
+		cTileEndCTUPelTL.y == (m_pcImageParam->m_uiFrameHeightInCTUs-1)*CTU_HEIGHT);
+
+	// The top lines belong to the tile, the rows select their lines in PrepareCTU()
+	m_psTopLine = psTopLine;
+	m_pbRefTopBuffY = m_psTopLine->ppbY[1];
+	m_pbRefTopBuffCb = m_psTopLine->ppbCb[1];
+	m_pbRefTopBuffCr = m_psTopLine->ppbCr[1];
+	m_pbNextTopBuffY = m_psTopLine->ppbY[0];
+	m_pbNextTopBuffCb = m_psTopLine->ppbCb[0];
+	m_pbNextTopBuffCr = m_psTopLine->ppbCr[0];
+	m_pbTopLineIntraModeInfoL = m_psTopLine->pbIntraModeInfoL;
 
 	m_pppbTempPred[0][0] = m_ppbTempPred4[0];
 	m_pppbTempPred[0][1] = m_ppbTempPred8[0];
@@ -122,10 +141,17 @@ H265CTUCompressor::H265CTUCompressor(InputParameters const *pcInputParam, ImageP
 H265CTUCompressor::~H265CTUCompressor()
 {
 	delete m_pcH265Trans;
-	delete [] m_pbRefTopBuffY;
-	delete [] m_pbRefTopBuffCb;
-	delete [] m_pbRefTopBuffCr;
-	delete [] m_pbTopLineIntraModeInfoL;
+}
+
+void H265CTUCompressor::SetTileBoundary(pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL)
+{
+	m_cTileStartCTUPelTL.x = cTileStartCTUPelTL.x;
+	m_cTileStartCTUPelTL.y = cTileStartCTUPelTL.y;
+	m_cTileEndCTUPelTL.x = cTileEndCTUPelTL.x;
+	m_cTileEndCTUPelTL.y = cTileEndCTUPelTL.y;
+	
+	m_uiTileWidthInPels = cTileEndCTUPelTL.x - cTileStartCTUPelTL.x + CTU_WIDTH;
+	m_uiTileHeightInPels = cTileEndCTUPelTL.y - cTileStartCTUPelTL.y + CTU_HEIGHT;
 }
 
 void H265CTUCompressor::InitBuffersNewTile()
@@ -133,10 +159,6 @@ void H265CTUCompressor::InitBuffersNewTile()
 	memset(m_pbNeighIntraModeL,INVALID_MODE,sizeof(m_pbNeighIntraModeL));
 	memset(m_pbIntraModeInfoL,INVALID_MODE,sizeof(m_pbIntraModeInfoL));
 	memset(m_puiIntraModeInfoC,INVALID_MODE,sizeof(m_puiIntraModeInfoC));
-	memset(m_pbTopLineIntraModeInfoL,INVALID_MODE,m_uiTileWidthInPels/MIN_CU_SIZE+1);
-	m_bSavedLTY = 0;
-	m_bSavedLTCb = 0;
-	m_bSavedLTCr = 0;
 }
 
 void H265CTUCompressor::InitBuffersNewCTULine()
@@ -300,8 +322,7 @@ void H265CTUCompressor::SubstituteReference(byte *puiRefArr, u32 *puiRefOffset,
 	// Now for the reference samples pertaining to the neighborhood block which is not available, substitute the pixels
 	// @todo Check if this is only for the bottom left and left reference samples
 	byte bSubstitutePel = puiRefArr[puiRefOffset[uiNeighPredChecked]];	// Copy first available pixel to the unavailable pixels
-	for(u32 i=0;i<puiRefOffset[uiNeighPredChecked];i++)
-		puiRefArr[i] = bSubstitutePel;
+	memset(puiRefArr, bSubstitutePel, puiRefOffset[uiNeighPredChecked]);
 
 	// Now check other unavailable neighbors and substitute their reference samples
 	// @todo Check if this is only for the top reference samples
@@ -312,8 +333,7 @@ void H265CTUCompressor::SubstituteReference(byte *puiRefArr, u32 *puiRefOffset,
 			u32 uiRefOffset = puiRefOffset[uiNeighPredChecked];	// The location of the reference array from where the substitution should start
 			u32 uiTotRefSubs = puiRefOffset[uiNeighPredChecked+1] - puiRefOffset[uiNeighPredChecked];	// Size of the subsitution
 			bSubstitutePel = puiRefArr[uiRefOffset-1];		// Copy p[x-1,y] to unavailable pixels
-			for(u32 i=0;i<uiTotRefSubs;i++)
-				puiRefArr[uiRefOffset+i] = bSubstitutePel;
+			memset(puiRefArr+uiRefOffset, bSubstitutePel, uiTotRefSubs);
 		}
 		uiNeighPredChecked++;
 	}
@@ -355,35 +375,14 @@ void H265CTUCompressor::GenReferenceSamplesIntra(byte *pbCurrRecY, byte *pbCurrR
 	{
 		if(bValidFlag)	// There are neighboring modes available
 		{
-			// Fill the reference pixels in the array, starting from the bottom left to top right
-
-			// Copy the bottom left and left pixels
-			// @todo Need to check this. I am reading outside the array
-			/*if(bValidFlag & (1<<VALID_LB))	// If the bottom left is available
-			{
-				for(i32 i=0;i<i32(uiSize);i++)
-					m_pbRefYUnfiltered[i] = pbCurrRecY[-1+(uiSize*2-i-1)*(CTU_WIDTH+2)];
-			}*/				
-			for(i32 i=0;i<i32(uiSize<<1);i++)	// Copy the other prediction pixels
-				m_pbRefYUnfiltered[i] = pbCurrRecY[-1+(i32(uiSize*2)-i-1)*(CTU_WIDTH+2)];	
-
-			// Copy the top left, top and top right pixels
-			// If this CU is in the top line of the current CTU, then we need to fetch the reference from the top line buffer, else, the reconstructed buffer
-			// of the CTU will do.
-			// @ todo This will read invalid data for the top-right-most PU of the tile, 
-			// but it is made sure it will not impact the output (see SubstituteReference)
-			memcpy(&m_pbRefYUnfiltered[uiSize*2],(uiDispCTUTop == 0 ? pbCurrRefTopBuffY-1 : &pbCurrRecY[-1*(CTU_WIDTH+2)-1]), (uiSize<<1)+1);
-
-			// We now need to substitute the reference samples, if there are some missing
-			// See 8.4.3.1.1 in the draft
-			SubstituteReference(m_pbRefYUnfiltered,puiRefYOffset,bValidFlag,uiSize);
-
-			// Filter the unfiltered samples
-			// See 8.4.3.1.2 in the draft
-			m_pbRefYFiltered[0] = m_pbRefYUnfiltered[0];				// Bottom left pixel
-			m_pbRefYFiltered[4*uiSize] = m_pbRefYUnfiltered[4*uiSize];	// Top right pixel
-			for(u32 i=1;i<4*uiSize;i++)
-				m_pbRefYFiltered[i] = (m_pbRefYUnfiltered[i-1] + (m_pbRefYUnfiltered[i] << 1) + m_pbRefYUnfiltered[i+1] + 2) >> 2;
+			// Fill the reference pixels in the array, starting from the bottom left to top right.
+			// The missing samples are substituted and the filtered array is made in the same pass.
+			// See 8.4.3.1.1 and 8.4.3.1.2 in the draft
+			// If this CU is in the top line of the current CTU, then we need to fetch the top reference from the top line buffer, else, the reconstructed buffer
+			// of the CTU will do. Only the available neighbours are read.
+			g_sKernels.pfRefSamples(m_pbRefYUnfiltered, m_pbRefYFiltered, pbCurrRecY-1, CTU_WIDTH+2,
+									(uiDispCTUTop == 0 ? pbCurrRefTopBuffY-1 : &pbCurrRecY[-1*(CTU_WIDTH+2)-1]),
+									puiRefYOffset, bValidFlag, uiSize);
 		}
 		else	// No neighbors available
 		{
@@ -441,76 +440,30 @@ void H265CTUCompressor::GenerateReferenceSamplesChromaLM(byte *pbCurrRecY, byte
 
 void H265CTUCompressor::GenIntraPredDC(byte *pbPred, byte *pbRef, u32 uiSize, u32 uiMode, bit bIsChroma)
 {
-	// See 8.4.3.1.5 in draft
-	byte *pbTop = pbRef + (uiSize<<1) + 1;
-	byte *pbLeft = pbRef + (uiSize<<1) - 1;	// The left array starts from the top and goes to the bottom. We must have a negative iterator
-
-	// Get DC value
-	u32 uiDCVal = 0;
-	u32 uiTopSum = 0;
-	u32 uiLeftSum = 0;
-
-	for(i32 i=0;i<i32(uiSize);i++)
-	{
-		uiTopSum += pbTop[i];
-		uiLeftSum += pbLeft[-i];
-	}
-
-	//u32 uiDiv = m_uiLog2Size + (bIsChroma && m_uiLog2Size != 2? 0 : 1);	// Will only work for 4:2:0
-	u32 uiDiv = uiSize<<1;	//uiSize;
-	//uiDiv *= (bIsChroma && uiSize != 4? 1 : 2);
-	uiDCVal = (uiTopSum + uiLeftSum + uiSize) / uiDiv;// >> uiDiv;
-
-	// Copy DC values to all locations of the predictor
-	memset(pbPred,uiDCVal,uiSize*uiSize);	// This requires the prediction buffer to be a full 1-D array, and not a dynamically allocated 2-D array
-
-	if(bIsChroma == 0)	// Luma pixels require DC filtering
-	{
-		u32 uiDCValx3 = (uiDCVal<<1)+uiDCVal;	// uiDCVal * 3
-		pbPred[0] = (pbLeft[0] + (uiDCVal<<1) + pbTop[0] + 2) >> 2;
-		for(i32 i=1;i<i32(uiSize);i++)
-		{
-			pbPred[i]			= (pbTop[i] + uiDCValx3 + 2) >> 2;			// Prediction samples [x,0]
-			pbPred[i*uiSize]	= (pbLeft[-i] + uiDCValx3 + 2) >> 2;		// Prediction samples [0,y]
-		}
-	}
+	// See 8.4.3.1.5 in draft, luma pixels require DC filtering
+	u32 uiSizeIdx = LOG2(uiSize-1)-2;	// Index of the kernels of 4x4 to 32x32 blocks
+	MAKE_SURE(uiSizeIdx < 4, "The block size has no kernel");
+	g_sKernels.pfIntraPredDC[uiSizeIdx](pbPred, pbRef, bIsChroma == 0);
 }
 
 void H265CTUCompressor::GenIntraPredPlanar(byte *pbPred, byte *pbRef, u32 uiSize, u32 uiMode, bit bIsChroma)
 {
 	// See 8.4.3.1.7 of draft
-	byte *pbTop = pbRef + (uiSize<<1) + 1;
-	byte *pbLeft = pbRef + (uiSize<<1) - 1;	// The left array starts from the top and goes to the bottom. We must have a negative iterator
-
-	byte bTopRightRec = pbTop[uiSize];
-	byte bBottomLeftRec = pbLeft[-i32(uiSize)];	// @todo Need to check this
-
-	i32 iTopComp;
-	i32 iLeftComp;
-	u32 uiLog2Size = LOG2(uiSize-1);
-	u32 uiDiv = uiLog2Size + 1;	// Usman: I couldn't find this anywhere (bIsChroma && uiLog2Size != 2? 0 : 1);
-
-	i32 iSize = i32(uiSize);
-
-	for(i32 y=0;y<iSize;y++)
-	{
-		for(i32 x=0;x<iSize;x++)
-		{
-			iTopComp = (iSize-1-y)*pbTop[x] + (y+1)*bBottomLeftRec;
-			iLeftComp = (iSize-1-x)*pbLeft[-y] + (x+1)*bTopRightRec;
-			pbPred[y*iSize+x] = (iTopComp + iLeftComp + iSize) >> uiDiv;
-		}
-	}
+	u32 uiSizeIdx = LOG2(uiSize-1)-2;	// Index of the kernels of 4x4 to 32x32 blocks
+	MAKE_SURE(uiSizeIdx < 4, "The block size has no kernel");
+	g_sKernels.pfIntraPredPlanar[uiSizeIdx](pbPred, pbRef);
 }
 
 void H265CTUCompressor::GenIntraPredAngular(byte *pbPred, byte *pbRef, u32 uiSize, u32 uiMode, bit bIsChroma)
 {
 	// See 8.4.3.1.6 in draft
+	u32 uiSizeIdx = LOG2(uiSize-1)-2;	// Index of the kernels of 4x4 to 32x32 blocks
+	MAKE_SURE(uiSizeIdx < 4, "The block size has no kernel");
 	byte *pbTopLeft = pbRef + (uiSize<<1);		// The top left array also starts from the top and goes to the bottom. We must have a negative iterator
 	i32 iIntraPredAngle = g_pbIntraPredAngleFromMode[uiMode];
 	i32 iInvAngle = g_pbInvAngleFromMode[uiMode];
 	bit bModeVer = (uiMode >= 18);
-	byte pbRefBuff[2*CTU_WIDTH+1];	// Note that only 2*CTU_WIDTH + 1 elements are used instead of 3*CTU_WIDTH+1 (check 8.4.3.1.6)
+	byte pbRefBuff[2*CTU_WIDTH+1+16];	// Note that only 2*CTU_WIDTH + 1 elements are used instead of 3*CTU_WIDTH+1 (check 8.4.3.1.6), the kernels may read 16 more
 	byte *pbMainRef = pbRefBuff + (iIntraPredAngle < 0 ? CTU_WIDTH : 0);
 
 	// Generate reference array
@@ -535,54 +488,16 @@ void H265CTUCompressor::GenIntraPredAngular(byte *pbPred, byte *pbRef, u32 uiSiz
 		for(i32 x=uiSize+1;x<=i32(uiSize<<1);x++)
 			pbMainRef[x] = bModeVer ? pbTopLeft[x] : pbTopLeft[-x];
 
-	// Now generate the prediction samples
-	i32 iDeltaPos = 0;
-	i32 iIdx;
-	i32 iFact;
-	i32 iRefMainIdx;
-
-	for(u32 k=0;k<uiSize;k++)
-	{
-		iDeltaPos += iIntraPredAngle;
-		iIdx = iDeltaPos >> 5;	// Equation 8-53
-		iFact = iDeltaPos & 0x1F;	// Equation 8-54
-
-		if(iFact)	// We need to filter
-		{
-			for(i32 x=0;x<i32(uiSize);x++)
-			{
-				iRefMainIdx = x+iIdx+1;
-				//pbPred[k*uiSize+x] = ( (pbMainRef[iRefMainIdx]<<5) + iFact*(pbMainRef[iRefMainIdx+1]-pbMainRef[iRefMainIdx]) + 16 ) >> 5;
-				pbPred[k*uiSize+x] = ( ((32-iFact)*pbMainRef[iRefMainIdx] + iFact*pbMainRef[iRefMainIdx+1] + 16 ) >> 5);
-			}
-		}
-		else
-			for(i32 x=0;x<i32(uiSize);x++)
-				pbPred[k*uiSize+x] = pbMainRef[x+iIdx+1];
-	}
-
 	// Filtering in case of prediction modes equal to HOR or VER
 	// See 8.4.3.1.3 and 8.4.3.1.4
-	if(bIsChroma == 0 && (uiMode == HOR_MODE_IDX || uiMode == VER_MODE_IDX))
-	{
-		i32 iOffset = bModeVer ? -1 : 1;
-		for(i32 x=0;x<i32(uiSize);x++)
-			pbPred[x*uiSize] = Clip1(pbPred[x*uiSize] + ((pbTopLeft[(x+1)*iOffset] - pbTopLeft[0])>>1));
-	}
-
-	if(!bModeVer)	// Do the matrix transpose
-	{
-		byte bTmp;
-		for(u32 k=0;k<uiSize-1;k++)
-		{
-			for(u32 x=k+1;x<uiSize;x++)
-			{
-				bTmp = pbPred[k*uiSize+x];
-				pbPred[k*uiSize+x] = pbPred[x*uiSize+k];
-				pbPred[x*uiSize+k] = bTmp;
-			}
-		}
-	}
+	byte pbSideRef[CTU_WIDTH+1];
+	bit bEdgeFilter = (bIsChroma == 0 && (uiMode == HOR_MODE_IDX || uiMode == VER_MODE_IDX));
+	if(bEdgeFilter)
+		for(i32 x=0;x<=i32(uiSize);x++)
+			pbSideRef[x] = bModeVer ? pbTopLeft[-x] : pbTopLeft[x];
+
+	// Now generate the prediction samples, with the kernel of the block size
+	g_sKernels.pfIntraPredAng[uiSizeIdx](pbPred, pbMainRef, bEdgeFilter ? pbSideRef : NULL, iIntraPredAngle, !bModeVer);
 }
 
 void H265CTUCompressor::GenIntraPrediction(byte *pbPred, byte *pbRef, u32 uiSize, u32 uiMode, bit bIsChroma)
@@ -598,6 +513,19 @@ void H265CTUCompressor::GenIntraPrediction(byte *pbPred, byte *pbRef, u32 uiSize
 
 u32 H265CTUCompressor::SAD_MxN(u32 uiM, u32 uiN, byte *pbSrc, u32 uiSrcStride, byte *pbRef, u32 uiRefStride)
 {
+	// The square blocks of the mode decisions have kernels for the instruction set of the processor
+	if(uiM == uiN)
+	{
+		switch(uiM)
+		{
+		case 4:		return g_sKernels.pfSAD[0](pbSrc, uiSrcStride, pbRef, uiRefStride);
+		case 8:		return g_sKernels.pfSAD[1](pbSrc, uiSrcStride, pbRef, uiRefStride);
+		case 16:	return g_sKernels.pfSAD[2](pbSrc, uiSrcStride, pbRef, uiRefStride);
+		case 32:	return g_sKernels.pfSAD[3](pbSrc, uiSrcStride, pbRef, uiRefStride);
+		default:	break;
+		}
+	}
+
 	u32 uiSAD = 0;
 
 	for(u32 i=0;i<uiN;i++)
@@ -657,6 +585,41 @@ i32 H265CTUCompressor::MapModeToIndex(u32 uiBestMode, u8 *pbCandModeListIntra)
 	return iPredIdx;
 }
 
+void H265CTUCompressor::xTestLumaMode(u32 uiMode, u32 uiSize, byte *pbCurrY, byte **ppbPredPingPong, u8 const *pbCandModeListIntra, bit bIsChroma,
+									  u8 &bPingPongBuffNum, u32 &uiBestCost, u32 &uiBestMode)
+{
+	u32 uiSizeIdx = LOG2(uiSize-1)-2;	// Index of the kernels of 4x4 to 32x32 blocks
+	u32 uiCost;
+	MAKE_SURE(uiSizeIdx < 4, "The block size has no kernel");
+
+	// Determine whether to use filtered or unfiltered reference
+	u8 bUseFilter = g_pbIntraFilterUsage[uiSizeIdx][uiMode];
+	byte *pbCurrRef = (bUseFilter == 0 ? m_pbRefYUnfiltered : m_pbRefYFiltered);
+	byte *pbCurrPred = ppbPredPingPong[bPingPongBuffNum];
+
+	// Generate luma prediction
+	GenIntraPrediction(pbCurrPred, pbCurrRef, uiSize, uiMode, bIsChroma);
+
+	// Assign more weight to the most probable modes
+	if(uiMode == pbCandModeListIntra[0])
+		uiCost = m_puiModeCost[0];
+	else if(uiMode == pbCandModeListIntra[1] || uiMode == pbCandModeListIntra[2])
+		uiCost = m_puiModeCost[1];
+	else
+		uiCost = m_puiModeCost[2];
+
+	// Get the distortion
+	uiCost += m_ppfDistortion[uiSizeIdx](pbCurrY,m_uiYStride,pbCurrPred,uiSize);
+
+	// Test the cost
+	if(uiCost < uiBestCost)
+	{
+		uiBestCost = uiCost;
+		uiBestMode = uiMode;
+		bPingPongBuffNum = (bPingPongBuffNum+1)%2;	// Change the buffer
+	}
+}
+
 u32 H265CTUCompressor::xCompressLumaCU(u32 uiAddrX, u32 uiAddrY, byte *pbCurrBuff, u32 uiSize, u32 uiDispCTULeft, u32 uiDispCTUTop, bit bIsChroma)
 {
 	// In the below, the term Curr pertains to the current location of the CU.
@@ -705,57 +668,48 @@ u32 H265CTUCompressor::xCompressLumaCU(u32 uiAddrX, u32 uiAddrY, byte *pbCurrBuf
 	// Start Prediction
 	u32 uiBestSAD = I32_MAX;
 	u32 uiBestMode = 0;
-	u8 bUseFilter = 0;
-	byte *pbCurrRef;
 	byte *pbPredPingPong[2] = {m_pppbTempPred[0][uiLog2Size-2], m_pppbTempPred[1][uiLog2Size-2]};	// Prediction buffers for ping-pong
 	byte *pbCurrPred;
 	u8 bPingPongBuffNum = 0;
-	u32 uiSAD;
+	u32 uiSAD = I32_MAX;
 
 	// Now test intra modes and decide about the best mode
 	// @todo We can have threads here as well
 	// @todo Insert the edge predictor here and determine the number of
 	// maximum modes being tested
-	bit bPlanarTested = false;
-	bit bDCTested = false;
-
-	// Test all modes
 	u32 uiBestPredMode = 0;
-	u32 uiStartPredMode = 0;
-	u32 uiEndPredMode = 35;
 
-	for(u32 uiMode=uiStartPredMode;uiMode<uiEndPredMode;uiMode++)
+	if(!m_pcInputParam->m_bSATD)
 	{
-		if(uiMode == PLANAR_MODE_IDX)
-			bPlanarTested = true;
-		if(uiMode == DC_MODE_IDX)
-			bDCTested = true;
-
-		// Determine whether to use filtered or unfiltered reference
-		bUseFilter = g_pbIntraFilterUsage[uiLog2Size-2][uiMode];
-		pbCurrRef = (bUseFilter == 0 ? m_pbRefYUnfiltered : m_pbRefYFiltered);
-		pbCurrPred = pbPredPingPong[bPingPongBuffNum];
-
-		// Generate luma prediction
-		GenIntraPrediction(pbCurrPred, pbCurrRef, uiSize, uiMode, bIsChroma);
-
-		// Assign more weight to the most probable modes
-		if(uiMode == pbCandModeListIntra[0])
-			uiSAD = m_uiQP;
-		else if(uiMode == pbCandModeListIntra[1] || uiMode == pbCandModeListIntra[2])
-			uiSAD = m_uiQP<<1;
-		else
-			uiSAD = (m_uiQP<<1)+m_uiQP;
-
-		// Get the SAD value
-		uiSAD +=SAD_MxN(uiSize,uiSize,pbCurrY,m_uiYStride,pbCurrPred,uiSize);
-
-		// Test the SAD value
-		if(uiSAD < uiBestSAD)
+		// Test all modes
+		for(u32 uiMode=0;uiMode<TOTAL_INTRA_MODES-1;uiMode++)
+			xTestLumaMode(uiMode,uiSize,pbCurrY,pbPredPingPong,pbCandModeListIntra,bIsChroma,bPingPongBuffNum,uiBestSAD,uiBestMode);
+	}
+	else
+	{
+		// The SATD tells the modes apart better. Test planar, DC, every fourth angular mode and the candidates,
+		// and then the angular modes at a distance of 2 and 1 from the best one.
+		u64 u64Tested = 0;	// A bit for every tested mode
+		for(u32 uiMode=0;uiMode<TOTAL_INTRA_MODES-1;uiMode++)
 		{
-			uiBestSAD = uiSAD;
-			uiBestMode = uiMode;
-			bPingPongBuffNum = (bPingPongBuffNum+1)%2;	// Change the buffer
+			if(uiMode > DC_MODE_IDX && ((uiMode-2) & 3) && uiMode != pbCandModeListIntra[0] &&
+				uiMode != pbCandModeListIntra[1] && uiMode != pbCandModeListIntra[2])
+				continue;
+			xTestLumaMode(uiMode,uiSize,pbCurrY,pbPredPingPong,pbCandModeListIntra,bIsChroma,bPingPongBuffNum,uiBestSAD,uiBestMode);
+			u64Tested |= u64(1) << uiMode;
+		}
+		for(u32 uiDist=2;uiDist>0;uiDist--)
+		{
+			u32 uiCenter = uiBestMode;
+			if(uiCenter <= DC_MODE_IDX)
+				break;
+			for(u32 uiMode=uiCenter-uiDist;uiMode<=uiCenter+uiDist;uiMode+=(uiDist<<1))
+			{
+				if(uiMode <= DC_MODE_IDX || uiMode >= TOTAL_INTRA_MODES-1 || (u64Tested & (u64(1) << uiMode)))
+					continue;
+				xTestLumaMode(uiMode,uiSize,pbCurrY,pbPredPingPong,pbCandModeListIntra,bIsChroma,bPingPongBuffNum,uiBestSAD,uiBestMode);
+				u64Tested |= u64(1) << uiMode;
+			}
 		}
 	}
 
@@ -799,15 +753,16 @@ u32 H265CTUCompressor::xCompressLumaCU(u32 uiAddrX, u32 uiAddrY, byte *pbCurrBuf
 		i16 *piTransBuffTmp1 = m_ppiTransBuffTmp[0];	// This is necessary for binding to a reference
 		i16 *piTransBuffTmp2 = m_ppiTransBuffTmp[1];	// This is necessary for binding to a reference
 		i16 *piQuantCoeff = piCurrCoeffY;	// This must be stored for further processing, therefore, the stride is CTU_WIDTH
+		u16 *puiSigMap = m_puiSigMapY + (uiDispCTULeft>>2) + (uiDispCTUTop>>2)*(CTU_WIDTH>>2);	// Significance map of the coefficients
 
 		m_pcH265Trans->ResDCT(piTransBuffTmp1,uiSize,uiSize,pbCurrY,m_uiYStride,pbCurrPred,uiSize,piTransBuffTmp1,piTransBuffTmp2,uiBestMode);
-		u32 uiQuantSumNonZero = m_pcH265Trans->Quant(piQuantCoeff,CTU_WIDTH,m_uiQP,uiSize,uiSize,piTransBuffTmp1,uiSize,I_SLICE);
+		u32 uiQuantSumNonZero = m_pcH265Trans->Quant(piQuantCoeff,CTU_WIDTH,puiSigMap,m_uiQP,uiSize,uiSize,piTransBuffTmp1,uiSize,I_SLICE);
 		if(uiQuantSumNonZero)
 		{
 			// Need the inverse loop
 			// We do an inplace transformation, i.e. the original image is changed
-			m_pcH265Trans->InvQuant(piTransBuffTmp2,uiSize,m_uiQP,uiSize,uiSize,piQuantCoeff,CTU_WIDTH,I_SLICE);
-			m_pcH265Trans->IDCTRec(pbCurrRecY,CTU_WIDTH+2,uiSize,uiSize,piTransBuffTmp2,uiSize,pbCurrPred,uiSize,piTransBuffTmp1,piTransBuffTmp2,uiBestMode);
+			m_pcH265Trans->InvQuant(piTransBuffTmp2,uiSize,m_uiQP,uiSize,uiSize,piQuantCoeff,CTU_WIDTH,puiSigMap,I_SLICE);
+			m_pcH265Trans->IDCTRec(pbCurrRecY,CTU_WIDTH+2,uiSize,uiSize,piTransBuffTmp2,uiSize,pbCurrPred,uiSize,piTransBuffTmp1,uiBestMode);
 		}
 		else // Do not need the inverse loop, as all the coefficients are 0			
 			for(u32 i=0;i<uiSize;i++)
@@ -906,6 +861,8 @@ void H265CTUCompressor::CompressChromaCU(u32 uiAddrX, u32 uiAddrY, byte *pbCbBuf
 
 		// Initialize chroma reference
 		u32 uiSizeChroma = (uiSizeL == 4 ? 4 : (uiSizeL >> 1));	// Size of chroma block
+		u32 uiSizeIdxChroma = LOG2(uiSizeChroma-1)-2;	// Index of the kernels of 4x4 to 32x32 blocks
+		MAKE_SURE(uiSizeIdxChroma < 4, "The chroma block size has no kernel");
 		/* @todo There is a problem while using the memory like this for a 4x4. Therefore, I just took the largest array for prediction (see below)
 		byte *pbPredPingPongCb[2] = {m_pppbTempPred[0][uiLog2Size-2], &m_pppbTempPred[0][uiLog2Size-2][CTU_WIDTH*CTU_WIDTH>>1]};	// Prediction buffers for ping-pong (reuse the same memory)
 		byte *pbPredPingPongCr[2] = {m_pppbTempPred[1][uiLog2Size-2], &m_pppbTempPred[1][uiLog2Size-2][CTU_WIDTH*CTU_WIDTH>>1]};	// Prediction buffers for ping-pong	(reuse the same memory)*/
@@ -945,9 +902,9 @@ void H265CTUCompressor::CompressChromaCU(u32 uiAddrX, u32 uiAddrY, byte *pbCbBuf
 			GenIntraPrediction(pbPredPingPongCb[bPingPongBuffNum], m_pbRefCb, uiSizeChroma, uiCurrModeC, true);
 			GenIntraPrediction(pbPredPingPongCr[bPingPongBuffNum], m_pbRefCr, uiSizeChroma, uiCurrModeC, true);
 
-			// Get the SAD value
-			uiSAD = SAD_MxN(uiSizeChroma,uiSizeChroma,pbCurrCb,m_uiCStride,pbPredPingPongCb[bPingPongBuffNum],uiSizeChroma);
-			uiSAD += SAD_MxN(uiSizeChroma,uiSizeChroma,pbCurrCr,m_uiCStride,pbPredPingPongCr[bPingPongBuffNum],uiSizeChroma);
+			// Get the distortion
+			uiSAD = m_ppfDistortion[uiSizeIdxChroma](pbCurrCb,m_uiCStride,pbPredPingPongCb[bPingPongBuffNum],uiSizeChroma);
+			uiSAD += m_ppfDistortion[uiSizeIdxChroma](pbCurrCr,m_uiCStride,pbPredPingPongCr[bPingPongBuffNum],uiSizeChroma);
 
 			if(uiSAD < uiBestSAD)
 			{
@@ -976,6 +933,8 @@ void H265CTUCompressor::CompressChromaCU(u32 uiAddrX, u32 uiAddrY, byte *pbCbBuf
 		i16 *piTransBuffTmp2 = m_ppiTransBuffTmp[1];	// This is necessary for binding to a reference
 		i16 *piQuantCoeffCb = piCurrCoeffCb;
 		i16 *piQuantCoeffCr = piCurrCoeffCr;
+		u16 *puiSigMapCb = m_puiSigMapCb + (uiDispCTULeft>>3) + (uiDispCTUTop>>3)*(CTU_WIDTH>>3);	// Significance maps of the coefficients
+		u16 *puiSigMapCr = m_puiSigMapCr + (uiDispCTULeft>>3) + (uiDispCTUTop>>3)*(CTU_WIDTH>>3);
 		byte *pbCurrPredCb = pbPredPingPongCb[bPingPongBuffNum];	// Cb prediction with the best SAD
 		byte *pbCurrPredCr = pbPredPingPongCr[bPingPongBuffNum];	// Cr prediction with the best SAD
 
@@ -983,13 +942,13 @@ void H265CTUCompressor::CompressChromaCU(u32 uiAddrX, u32 uiAddrY, byte *pbCbBuf
 		m_pcH265Trans->ResDCT(piTransBuffTmp1,uiSizeChroma,uiSizeChroma,pbCurrCb,m_uiCStride,pbCurrPredCb,uiSizeChroma,piTransBuffTmp1,piTransBuffTmp2,INVALID_MODE);
 		u32 uiQPC = g_pbChramaQPFromLuma[m_uiQP];	// Get chroma QP from luma QP
 		// @todo Combine the quantization and inverse quantization into one function
-		u32 uiQuantSumNonZeroCb = m_pcH265Trans->Quant(piQuantCoeffCb,(CTU_WIDTH>>1),uiQPC,uiSizeChroma,uiSizeChroma,piTransBuffTmp1,uiSizeChroma,I_SLICE);
+		u32 uiQuantSumNonZeroCb = m_pcH265Trans->Quant(piQuantCoeffCb,(CTU_WIDTH>>1),puiSigMapCb,uiQPC,uiSizeChroma,uiSizeChroma,piTransBuffTmp1,uiSizeChroma,I_SLICE);
 		if(uiQuantSumNonZeroCb)
 		{
 			// Need the inverse loop
 			// We do an inplace transformation, i.e. the original image is changed
-			m_pcH265Trans->InvQuant(piTransBuffTmp2,uiSizeChroma,uiQPC,uiSizeChroma,uiSizeChroma,piQuantCoeffCb,(CTU_WIDTH>>1),I_SLICE);
-			m_pcH265Trans->IDCTRec(pbCurrRecCb,CTU_WIDTH/2+1,uiSizeChroma,uiSizeChroma,piTransBuffTmp2,uiSizeChroma,pbCurrPredCb,uiSizeChroma,piTransBuffTmp1,piTransBuffTmp2,INVALID_MODE);
+			m_pcH265Trans->InvQuant(piTransBuffTmp2,uiSizeChroma,uiQPC,uiSizeChroma,uiSizeChroma,piQuantCoeffCb,(CTU_WIDTH>>1),puiSigMapCb,I_SLICE);
+			m_pcH265Trans->IDCTRec(pbCurrRecCb,CTU_WIDTH/2+1,uiSizeChroma,uiSizeChroma,piTransBuffTmp2,uiSizeChroma,pbCurrPredCb,uiSizeChroma,piTransBuffTmp1,INVALID_MODE);
 		}
 		else // Do not need the inverse loop, as all the coefficients are 0			
 			for(u32 i=0;i<uiSizeChroma;i++)
@@ -997,13 +956,13 @@ void H265CTUCompressor::CompressChromaCU(u32 uiAddrX, u32 uiAddrY, byte *pbCbBuf
 
 		// Transform loop Cr
 		m_pcH265Trans->ResDCT(piTransBuffTmp1,uiSizeChroma,uiSizeChroma,pbCurrCr,m_uiCStride,pbCurrPredCr,uiSizeChroma,piTransBuffTmp1,piTransBuffTmp2,INVALID_MODE);
-		u32 uiQuantSumNonZeroCr = m_pcH265Trans->Quant(piQuantCoeffCr,(CTU_WIDTH>>1),uiQPC,uiSizeChroma,uiSizeChroma,piTransBuffTmp1,uiSizeChroma,I_SLICE);
+		u32 uiQuantSumNonZeroCr = m_pcH265Trans->Quant(piQuantCoeffCr,(CTU_WIDTH>>1),puiSigMapCr,uiQPC,uiSizeChroma,uiSizeChroma,piTransBuffTmp1,uiSizeChroma,I_SLICE);
 		if(uiQuantSumNonZeroCr)
 		{
 			// Need the inverse loop
 			// We do an inplace transformation, i.e. the original image is changed
-			m_pcH265Trans->InvQuant(piTransBuffTmp2,uiSizeChroma,uiQPC,uiSizeChroma,uiSizeChroma,piQuantCoeffCr,(CTU_WIDTH>>1),I_SLICE);
-			m_pcH265Trans->IDCTRec(pbCurrRecCr,CTU_WIDTH/2+1,uiSizeChroma,uiSizeChroma,piTransBuffTmp2,uiSizeChroma,pbCurrPredCr,uiSizeChroma,piTransBuffTmp1,piTransBuffTmp2,INVALID_MODE);
+			m_pcH265Trans->InvQuant(piTransBuffTmp2,uiSizeChroma,uiQPC,uiSizeChroma,uiSizeChroma,piQuantCoeffCr,(CTU_WIDTH>>1),puiSigMapCr,I_SLICE);
+			m_pcH265Trans->IDCTRec(pbCurrRecCr,CTU_WIDTH/2+1,uiSizeChroma,uiSizeChroma,piTransBuffTmp2,uiSizeChroma,pbCurrPredCr,uiSizeChroma,piTransBuffTmp1,INVALID_MODE);
 		}
 		else // Do not need the inverse loop, as all the coefficients are 0			
 			for(u32 i=0;i<uiSizeChroma;i++)
@@ -1025,6 +984,15 @@ void H265CTUCompressor::PrepareCTU(u32 uiAddrX, u32 uiAddrY)
 		InitBuffersNewCTULine();
 		if(uiAddrY > m_cTileStartCTUPelTL.y)	// Not the first row of CTUs, then the top modes are always available
 			memset(m_pbNeighIntraModeL+1,VALID_MODE,TOT_PUS_LINE+1);	// Left mode is not available in the top row
+
+		// Read the line of the row above and write the other one
+		u32 uiRowParity = ((uiAddrY - m_cTileStartCTUPelTL.y)/CTU_HEIGHT) & 1;
+		m_pbRefTopBuffY = m_psTopLine->ppbY[uiRowParity^1];
+		m_pbRefTopBuffCb = m_psTopLine->ppbCb[uiRowParity^1];
+		m_pbRefTopBuffCr = m_psTopLine->ppbCr[uiRowParity^1];
+		m_pbNextTopBuffY = m_psTopLine->ppbY[uiRowParity];
+		m_pbNextTopBuffCb = m_psTopLine->ppbCb[uiRowParity];
+		m_pbNextTopBuffCr = m_psTopLine->ppbCr[uiRowParity];
 	}
 		
 	// Determine the mode of top and top right, if they exist for the current CTU
@@ -1044,38 +1012,6 @@ void H265CTUCompressor::PrepareCTU(u32 uiAddrX, u32 uiAddrY)
 	// Copy the mode information from the above CTU row
 	memcpy(m_pbIntraModeInfoL+1,
 		m_pbTopLineIntraModeInfoL+uiCTUOffsetXFromTile/MIN_CU_SIZE,TOT_PUS_LINE);
-
-	// Swaping the top left pixel
-	// @todo Need a better approach and also better understanding
-	byte tmp;
-	byte *pbRefTopBuff;
-	pbRefTopBuff = m_pbRefTopBuffY + uiCTUOffsetXFromTile + 1;
-	SWAP(pbRefTopBuff[-1],m_bSavedLTY);
-	pbRefTopBuff = m_pbRefTopBuffCb + (uiCTUOffsetXFromTile>>1) + 1;
-	SWAP(pbRefTopBuff[-1],m_bSavedLTCb);
-	pbRefTopBuff = m_pbRefTopBuffCr + (uiCTUOffsetXFromTile>>1) + 1;
-	SWAP(pbRefTopBuff[-1],m_bSavedLTCr);
-
-}
-
-void H265CTUCompressor::FinishCTU(u32 uiAddrX, u32 uiAddrY)
-{
-	// Determine the X offset from the tile boundary
-	u32 uiCTUOffsetXFromTile = uiAddrX - m_cTileStartCTUPelTL.x;
-
-	byte *pbRefTopBuff;
-	pbRefTopBuff = m_pbRefTopBuffY + uiCTUOffsetXFromTile + 1;
-	pbRefTopBuff[-1] = m_bSavedLTY;
-	m_bSavedLTY = pbRefTopBuff[CTU_WIDTH-1];
-
-	pbRefTopBuff = m_pbRefTopBuffCb + (uiCTUOffsetXFromTile>>1) + 1;
-	pbRefTopBuff[-1] = m_bSavedLTCb;
-	m_bSavedLTCb = pbRefTopBuff[(CTU_WIDTH>>1)-1];
-
-	pbRefTopBuff = m_pbRefTopBuffCr + (uiCTUOffsetXFromTile>>1) + 1;
-	pbRefTopBuff[-1] = m_bSavedLTCr;
-	m_bSavedLTCr = pbRefTopBuff[(CTU_WIDTH>>1)-1];
-
 }
 
 void H265CTUCompressor::CompressCTU(u32 uiAddrX, u32 uiAddrY, byte *pbYBuff, byte *pbCbBuff, byte *pbCrBuff)
@@ -1091,9 +1027,6 @@ void H265CTUCompressor::CompressCTU(u32 uiAddrX, u32 uiAddrY, byte *pbYBuff, byt
 	// Compress the Chroma CTU
 	CompressChromaCU(uiAddrX, uiAddrY, pbCbBuff, pbCrBuff);
 
-	// Finish CTU
-	FinishCTU(uiAddrX,uiAddrY);
-
 	m_ctTimeForCTU = GetTimeInMiliSec()-m_ctTimeForCTU;
 }
 
@@ -1105,16 +1038,51 @@ bit H265CTUCompressor::IsLastTileCTU(u32 uiAddrX, u32 uiAddrY)
 		return false;
 }
 
-bit H265CTUCompressor::IsLastSliceCTU(u32 uiAddrX, u32 uiAddrY)
+bit H265CTUCompressor::IsLastSubStreamCTU(u32 uiAddrX, u32 uiAddrY)
 {
-	if(uiAddrX == (m_pcImageParam->m_uiFrameWidthInCTUs-1)*CTU_WIDTH &&
-		uiAddrY == (m_pcImageParam->m_uiFrameHeightInCTUs-1)*CTU_HEIGHT)
-		return true;
+	if(m_pcImageParam->m_uiTileCodingSync == 2)	// Wavefronts, every CTU row ends a substream
+		return (uiAddrX == m_cTileEndCTUPelTL.x);
 	else
-		return false;
+		return IsLastTileCTU(uiAddrX,uiAddrY);
+}
+
+bit H265CTUCompressor::IsLastSliceCTU(u32 uiAddrX, u32 uiAddrY)
+{
+	return m_bLastTileOfSlice && IsLastTileCTU(uiAddrX,uiAddrY);
 }
 
 void H265CTUCompressor::EncodeCTU(u32 uiAddrX, u32 uiAddrY, Cabac *& pcCabac, BitStreamHandler *& pcBitStreamHandler)
+{
+	xEncodeCTU(uiAddrX, uiAddrY, m_piCoeffY, m_piCoeffCb, m_piCoeffCr, m_puiSigMapY, m_puiSigMapCb, m_puiSigMapCr,
+		m_pbNeighIntraModeL, m_pbIntraModeInfoL, m_puiIntraModeInfoC, pcCabac, pcBitStreamHandler);
+}
+
+void H265CTUCompressor::SaveSyntax(u32 uiAddrX, u32 uiAddrY, CTUSyntax_t *psSyntax)
+{
+	psSyntax->uiAddrX = uiAddrX;
+	psSyntax->uiAddrY = uiAddrY;
+	memcpy(psSyntax->piCoeffY,m_piCoeffY,sizeof(m_piCoeffY));
+	memcpy(psSyntax->piCoeffCb,m_piCoeffCb,sizeof(m_piCoeffCb));
+	memcpy(psSyntax->piCoeffCr,m_piCoeffCr,sizeof(m_piCoeffCr));
+	memcpy(psSyntax->puiSigMapY,m_puiSigMapY,sizeof(m_puiSigMapY));
+	memcpy(psSyntax->puiSigMapCb,m_puiSigMapCb,sizeof(m_puiSigMapCb));
+	memcpy(psSyntax->puiSigMapCr,m_puiSigMapCr,sizeof(m_puiSigMapCr));
+	memcpy(psSyntax->pbNeighIntraModeL,m_pbNeighIntraModeL,sizeof(m_pbNeighIntraModeL));
+	memcpy(psSyntax->pbIntraModeInfoL,m_pbIntraModeInfoL,sizeof(m_pbIntraModeInfoL));
+	memcpy(psSyntax->puiIntraModeInfoC,m_puiIntraModeInfoC,sizeof(m_puiIntraModeInfoC));
+}
+
+void H265CTUCompressor::EncodeCTU(CTUSyntax_t const *psSyntax, Cabac *& pcCabac, BitStreamHandler *& pcBitStreamHandler)
+{
+	xEncodeCTU(psSyntax->uiAddrX, psSyntax->uiAddrY, psSyntax->piCoeffY, psSyntax->piCoeffCb, psSyntax->piCoeffCr,
+		psSyntax->puiSigMapY, psSyntax->puiSigMapCb, psSyntax->puiSigMapCr,
+		psSyntax->pbNeighIntraModeL, psSyntax->pbIntraModeInfoL, psSyntax->puiIntraModeInfoC, pcCabac, pcBitStreamHandler);
+}
+
+void H265CTUCompressor::xEncodeCTU(u32 uiAddrX, u32 uiAddrY, i16 const *piCoeffY, i16 const *piCoeffCb, i16 const *piCoeffCr,
+								   u16 const *puiSigMapY, u16 const *puiSigMapCb, u16 const *puiSigMapCr,
+								   u8 const *pbNeighIntraModeL, u8 const *pbIntraModeInfoL, u16 const *puiIntraModeInfoC,
+								   Cabac *& pcCabac, BitStreamHandler *& pcBitStreamHandler)
 {
 	u32 uiDispCTUTop = 0;	// Displacement of the current "Luma" CU from the top of the CTU
 	u32 uiDispCTULeft = 0;	// Displacement of the current "Luma" CU from the left of the CTU
@@ -1125,21 +1093,14 @@ void H265CTUCompressor::EncodeCTU(u32 uiAddrX, u32 uiAddrY, Cabac *& pcCabac, Bi
 
 	// In the below, the term Curr pertains to the current location of the CU.
 	// E.g. m_pbCurrRefTopBuffY is the pointer to the top reference just above the current CU
-	byte *pbCurrIntraModeL;	// Current luma mode
-	byte *pbCurrRecY, *pbCurrRecCb, *pbCurrRecCr;	// Current reconstructed
-	i16 *piCurrCoeffY, *piCurrCoeffCb, *piCurrCoeffCr;	// Current coefficients
-	byte *pbCurrRefTopBuffY, *pbCurrRefTopBuffCb, *pbCurrRefTopBuffCr;	// Top reconstructed array
-	byte *pbCurrIntraModeInfoL;	// Luma mode information, used by chroma compressor
-	byte *pbCurrIntraModePredInfoL;	// Prediciton of the mode
-	u16 *puiCurrIntraModeInfoC;
+	u8 const *pbCurrIntraModeL;	// Current luma mode
+	i16 const *piCurrCoeffY, *piCurrCoeffCb, *piCurrCoeffCr;	// Current coefficients
+	u16 const *puiCurrSigMapY, *puiCurrSigMapCb, *puiCurrSigMapCr;	// Significance maps of the current coefficients
+	u8 const *pbCurrIntraModeInfoL;	// Luma mode information
+	u16 const *puiCurrIntraModeInfoC;
 
 	u32 uiTot4x4s = 0;	// Denots the total 4x4s scanned in the CTU
 
-	m_pbRefCb = m_pbRefYUnfiltered;	// Assign reference arrays
-	m_pbRefCr = m_pbRefYFiltered;	// Assign reference arrays
-
-	u32 uiCTUOffsetXFromTile = uiAddrX - m_cTileStartCTUPelTL.x;
-
 	// This loop will run at 4x4 level. For luma, there is no 4x4 CU, therefore, for the
 	// smallest CU of 8x8 and with a split flag, this loop will run 4 times, 1 time per PU.
 	// For chroma, and smallest CU of 8x8 with a split flag, this loop will only run for
@@ -1150,13 +1111,18 @@ void H265CTUCompressor::EncodeCTU(u32 uiAddrX, u32 uiAddrY, Cabac *& pcCabac, Bi
 		// CU from the CTU left and top
 		GetDispFrom4x4s(uiTot4x4s,uiDispCTULeft,uiDispCTUTop);
 
-		// Initialize the buffer pointers to correctly point to the location within the CTU memory
-		// This will also fit the m_pbCurrLumaModeInfo, m_pbCurrMode etc to the starting location
-		InitCUPointers(pbCurrIntraModeL,pbCurrRecY,pbCurrRecCb,pbCurrRecCr, 
-					piCurrCoeffY,piCurrCoeffCb,piCurrCoeffCr, 
-					pbCurrRefTopBuffY,pbCurrRefTopBuffCb,pbCurrRefTopBuffCr,
-					pbCurrIntraModeInfoL,pbCurrIntraModePredInfoL,puiCurrIntraModeInfoC,
-					uiDispCTULeft,uiDispCTUTop,uiCTUOffsetXFromTile);
+		// Point to the location of the CU within the syntax of the CTU, as in InitCUPointers()
+		pbCurrIntraModeL = pbNeighIntraModeL + (TOT_PUS_LINE+2) + 1;
+		pbCurrIntraModeL += uiDispCTULeft/MIN_CU_SIZE + (uiDispCTUTop/MIN_CU_SIZE)*(TOT_PUS_LINE+2);
+		piCurrCoeffY = piCoeffY + uiDispCTULeft + uiDispCTUTop*CTU_WIDTH;
+		piCurrCoeffCb = piCoeffCb + (uiDispCTULeft>>1) + (uiDispCTUTop>>1)*(CTU_WIDTH>>1);
+		piCurrCoeffCr = piCoeffCr + (uiDispCTULeft>>1) + (uiDispCTUTop>>1)*(CTU_WIDTH>>1);
+		puiCurrSigMapY = puiSigMapY + (uiDispCTULeft>>2) + (uiDispCTUTop>>2)*(CTU_WIDTH>>2);
+		puiCurrSigMapCb = puiSigMapCb + (uiDispCTULeft>>3) + (uiDispCTUTop>>3)*(CTU_WIDTH>>3);	// Also the group of the 4 4x4 PUs of an 8x8 CU
+		puiCurrSigMapCr = puiSigMapCr + (uiDispCTULeft>>3) + (uiDispCTUTop>>3)*(CTU_WIDTH>>3);
+		pbCurrIntraModeInfoL = pbIntraModeInfoL + (TOT_PUS_LINE+1) + 1;
+		pbCurrIntraModeInfoL += uiDispCTULeft/MIN_CU_SIZE + (uiDispCTUTop/MIN_CU_SIZE)*(TOT_PUS_LINE+1);
+		puiCurrIntraModeInfoC = puiIntraModeInfoC + uiDispCTULeft/MIN_CU_SIZE + (uiDispCTUTop/MIN_CU_SIZE)*TOT_PUS_LINE;
 
 		// Get the information about luma CU
 		u32 uiLog2Size = (pbCurrIntraModeInfoL[0]>>6) + 2;
@@ -1225,7 +1191,7 @@ void H265CTUCompressor::EncodeCTU(u32 uiAddrX, u32 uiAddrY, Cabac *& pcCabac, Bi
 		
 		// Encode the luma coefficients
 		if(uiCbfY)
-			pcCabac->EncodeCoeffNxN(piCurrCoeffY,uiSizeL,uiBestModeL,true,pcBitStreamHandler);
+			pcCabac->EncodeCoeffNxN(piCurrCoeffY,puiCurrSigMapY,uiSizeL,uiBestModeL,true,pcBitStreamHandler);
 
 		// Encode the chroma coefficients
 		// For an 8x8 CU with 4 4x4 PUs, chroma coefficients are only encoded for the last
@@ -1256,15 +1222,15 @@ void H265CTUCompressor::EncodeCTU(u32 uiAddrX, u32 uiAddrY, Cabac *& pcCabac, Bi
 			}
 
 			if(uiCbfCb)
-				pcCabac->EncodeCoeffNxN(piCurrCoeffCb,uiSizeC,uiNewModeC,false,pcBitStreamHandler);
+				pcCabac->EncodeCoeffNxN(piCurrCoeffCb,puiCurrSigMapCb,uiSizeC,uiNewModeC,false,pcBitStreamHandler);
 			if(uiCbfCr)
-				pcCabac->EncodeCoeffNxN(piCurrCoeffCr,uiSizeC,uiNewModeC,false,pcBitStreamHandler);
+				pcCabac->EncodeCoeffNxN(piCurrCoeffCr,puiCurrSigMapCr,uiSizeC,uiNewModeC,false,pcBitStreamHandler);
 		}
 		
 		uiTot4x4s += (1<<(((2+uiCurrSplitFlag)<<1)-4));
 	}while(uiTot4x4s < (TOT_PUS_LINE*TOT_PUS_LINE));
 
-	pcCabac->FinishEncodeCTU(IsLastTileCTU(uiAddrX,uiAddrY),IsLastSliceCTU(uiAddrX,uiAddrY),pcBitStreamHandler);
+	pcCabac->FinishEncodeCTU(IsLastSubStreamCTU(uiAddrX,uiAddrY),IsLastSliceCTU(uiAddrX,uiAddrY),pcBitStreamHandler);
 }
 
 
@@ -1302,13 +1268,13 @@ void H265CTUCompressor::UpdateBuffers(u32 uiAddrX, u32 uiAddrY, byte *pbYBuff, b
 		pbCurrIntraModeInfoL[i*(TOT_PUS_LINE+1)-1] = pbCurrIntraModeInfoL[i*(TOT_PUS_LINE+1)+TOT_PUS_LINE-1];
 	}
 
-	// Now also copy the reconstructed pixels to the top reference frame buffers
+	// Now also copy the reconstructed pixels to the top line of the CTU row below
 	u32 uiCTUOffsetXFromTile = uiAddrX - m_cTileStartCTUPelTL.x;
-	memcpy(&m_pbRefTopBuffY[1+uiCTUOffsetXFromTile],
+	memcpy(&m_pbNextTopBuffY[1+uiCTUOffsetXFromTile],
 		&m_pbRecY[2+(CTU_WIDTH-1)*(CTU_WIDTH+2)],CTU_WIDTH);
-	memcpy(&m_pbRefTopBuffCb[1+uiCTUOffsetXFromTile/2],
+	memcpy(&m_pbNextTopBuffCb[1+uiCTUOffsetXFromTile/2],
 		&m_pbRecCb[1+(CTU_WIDTH/2-1)*(CTU_WIDTH/2+1)],CTU_WIDTH/2);
-	memcpy(&m_pbRefTopBuffCr[1+uiCTUOffsetXFromTile/2],
+	memcpy(&m_pbNextTopBuffCr[1+uiCTUOffsetXFromTile/2],
 		&m_pbRecCr[1+(CTU_WIDTH/2-1)*(CTU_WIDTH/2+1)],CTU_WIDTH/2);
 
 
@@ -27,12 +27,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <BitStreamHandler.h>
 #include <H265SliceCompressor.h>
 #include <H265GOPCompressor.h>
+#include <Tracer.h>
 #include <stdio.h>
 #include <time.h>
 
 
 // GOP
-H265GOPCompressor::H265GOPCompressor(InputParameters *pcInputParam, ImageParameters *pcImageParam, BitStreamHandler ***& pppcBitStreamPerSlice)
+H265GOPCompressor::H265GOPCompressor(InputParameters *pcInputParam, ImageParameters *pcImageParam, BitStreamHandler ***& pppcBitStreamPerSlice,
+									 WorkQueue *pcWorkQueue)
 {
 	m_pcInputParam = pcInputParam;
 	m_pcImageParam = pcImageParam;
@@ -42,7 +44,7 @@ H265GOPCompressor::H265GOPCompressor(InputParameters *pcInputParam, ImageParamet
 	m_ppcH265SliceCompressor = new H265SliceCompressor*[m_uiNumSliceThreads];
 	for(u32 i=0;i<m_uiNumSliceThreads;i++)
 	{
-		m_ppcH265SliceCompressor[i] = new H265SliceCompressor(m_pcInputParam,m_pcImageParam,m_pppcBitStreamPerSlice[i]);
+		m_ppcH265SliceCompressor[i] = new H265SliceCompressor(m_pcInputParam,m_pcImageParam,m_pppcBitStreamPerSlice[i],pcWorkQueue);
 	}
 
 	m_pcTimePerSlice = new clock_t[m_uiNumSliceThreads];
@@ -59,7 +61,7 @@ H265GOPCompressor::~H265GOPCompressor()
 }
 
 void H265GOPCompressor::CompressGOP(byte **ppbYBuff, byte **ppbCbBuff, byte **ppbCrBuff,
-									u32 uiStartSliceNum)
+									u32 uiStartSliceNum, SliceParams_t const &sSliceParams)
 {
 	// Compress each slice individually
 	for(u32 i=0;i<m_pcInputParam->m_uiGopSize/m_uiNumSliceThreads;i++)
@@ -70,14 +72,25 @@ void H265GOPCompressor::CompressGOP(byte **ppbYBuff, byte **ppbCbBuff, byte **pp
 				ppbYBuff[i*m_uiNumSliceThreads+j],
 				ppbCbBuff[i*m_uiNumSliceThreads+j],
 				ppbCrBuff[i*m_uiNumSliceThreads+j],
-				uiStartSliceNum);
-			if(m_pcInputParam->m_bVerbose)
-				printf("Trace: Slice %u encoded.\n",uiStartSliceNum++);
+				uiStartSliceNum, sSliceParams);
+			TRACE(TRACE_LEVEL_VERBOSE, "Trace: Slice %u encoded.\n",uiStartSliceNum++);
 			m_pcTimePerSlice[j] = m_ppcH265SliceCompressor[j]->GetTimePerSlice();
 		}
 	}
 }
 
+void H265GOPCompressor::SetTileLayout(TileLayout_t const &sTileLayout)
+{
+	for(u32 i=0;i<m_uiNumSliceThreads;i++)
+		m_ppcH265SliceCompressor[i]->SetTileLayout(sTileLayout);
+}
+
+void H265GOPCompressor::SetSliceLayout(SliceLayout_t const &sSliceLayout)
+{
+	for(u32 i=0;i<m_uiNumSliceThreads;i++)
+		m_ppcH265SliceCompressor[i]->SetSliceLayout(sSliceLayout);
+}
+
 BitStreamHandler* H265GOPCompressor::GetSliceBitStreamHandler(u32 uiSliceNum)
 {
 	MAKE_SURE((uiSliceNum < m_pcInputParam->m_uiGopSize),"The Slice number is not correct");
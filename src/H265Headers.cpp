@@ -154,7 +154,7 @@ void H265Headers::GenSPSNALU(InputParameters const *pcInputParam, ImageParameter
 }
 
 /***********************PPS*************************/
-void H265Headers::WritePPSInBitstream(ImageParameters const *pcImageParam, BitStreamHandler *&pcBitStreamHandler)
+void H265Headers::WritePPSInBitstream(ImageParameters const *pcImageParam, TileLayout_t const &sTileLayout, BitStreamHandler *&pcBitStreamHandler)
 {
 	// Initialize the bitstream handler
 	pcBitStreamHandler->InitBitStreamWordLevel(true);
@@ -189,8 +189,15 @@ void H265Headers::WritePPSInBitstream(ImageParameters const *pcImageParam, BitSt
 	if(pcImageParam->m_uiTileCodingSync == 1)	// Tiles are present
 	{
 		pcBitStreamHandler->PutUVInBitstream(pcImageParam->m_uiFrameWidthInTiles-1,"num_tile_columns_minus1");
-		pcBitStreamHandler->PutUVInBitstream(pcImageParam->m_uiFrameHeightInTiles-1,"num_tile_columns_minus1");
-		pcBitStreamHandler->PutUNInBitstream(1,1,"uniform_spacing_flag");	// Always uniform spacing
+		pcBitStreamHandler->PutUVInBitstream(pcImageParam->m_uiFrameHeightInTiles-1,"num_tile_rows_minus1");
+		pcBitStreamHandler->PutUNInBitstream(sTileLayout.bUniform,1,"uniform_spacing_flag");
+		if(!sTileLayout.bUniform)	// The last column and row take the rest of the frame
+		{
+			for(u32 i=0;i<pcImageParam->m_uiFrameWidthInTiles-1;i++)
+				pcBitStreamHandler->PutUVInBitstream(sTileLayout.puiColWidthInCTUs[i]-1,"column_width_minus1");
+			for(u32 i=0;i<pcImageParam->m_uiFrameHeightInTiles-1;i++)
+				pcBitStreamHandler->PutUVInBitstream(sTileLayout.puiRowHeightInCTUs[i]-1,"row_height_minus1");
+		}
 		pcBitStreamHandler->PutUNInBitstream(0,1,"loop_filter_across_tiles_enabled_flag");
 	}
 
@@ -206,16 +213,18 @@ void H265Headers::WritePPSInBitstream(ImageParameters const *pcImageParam, BitSt
 	pcBitStreamHandler->FlushRemBytes();
 }
 
-void H265Headers::GenPPSNALU(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, BitStreamHandler *&pcBitStreamHandler)
+void H265Headers::GenPPSNALU(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, TileLayout_t const &sTileLayout,
+							 BitStreamHandler *&pcBitStreamHandler)
 {
 	// Write the PPS to the bitstream
-	WritePPSInBitstream(pcImageParam, pcBitStreamHandler);
+	WritePPSInBitstream(pcImageParam, sTileLayout, pcBitStreamHandler);
 }
 
 /***********************Slice*************************/
-void H265Headers::WriteSliceHdrInBitstream(ImageParameters const *pcImageParam, u32 uiCurrSliceNum, BitStreamHandler *&pcBitStreamHandler)
+void H265Headers::WriteSliceHdrInBitstream(ImageParameters const *pcImageParam, SliceParams_t const &sSliceParams, u32 uiCurrSliceNum, u32 uiSliceAddr,
+										   BitStreamHandler *&pcBitStreamHandler)
 {
-	eSliceType eCurrSliceType = pcImageParam->m_eSliceType;
+	eSliceType eCurrSliceType = sSliceParams.eType;
 	if(eCurrSliceType == I_SLICE)
 	{
 		if(uiCurrSliceNum == 0)	// First frame of the sequence
@@ -228,12 +237,21 @@ void H265Headers::WriteSliceHdrInBitstream(ImageParameters const *pcImageParam,
 
 	pcBitStreamHandler->PutCodeInBitstream(1,8,true);
 
-	pcBitStreamHandler->PutUNInBitstream(1,1,"first_slice_in_pic_flag");	// One slice per frame
+	pcBitStreamHandler->PutUNInBitstream(uiSliceAddr == 0,1,"first_slice_in_pic_flag");
 	if(eCurrSliceType == I_SLICE && uiCurrSliceNum == 0)	// Usman: Added the uiCurrSliceNum condition
 		pcBitStreamHandler->PutUNInBitstream(0,1,"no_output_of_prior_pics_flag");
 
 	pcBitStreamHandler->PutUVInBitstream(0,"pic_parameter_set_id");
 
+	// The address takes Ceil(Log2(PicSizeInCtbsY)) bits, there are no dependent slice segments
+	if(uiSliceAddr != 0)
+	{
+		u32 uiAddrBits = 0;
+		while((1u << uiAddrBits) < pcImageParam->m_uiFrameSizeInCTUs)
+			uiAddrBits++;
+		pcBitStreamHandler->PutUNInBitstream(uiSliceAddr,uiAddrBits,"slice_segment_address");
+	}
+
 	pcBitStreamHandler->PutUVInBitstream(eCurrSliceType,"slice_type");
 	pcBitStreamHandler->PutUNInBitstream(0,1,"dependent_slice_flag");
 
@@ -254,18 +272,19 @@ void H265Headers::WriteSliceHdrInBitstream(ImageParameters const *pcImageParam,
 	if (eCurrSliceType != I_SLICE) 
 		pcBitStreamHandler->PutUNInBitstream(0,1,"cabac_init_flag");
 
-	pcBitStreamHandler->PutSVInBitstream(pcImageParam->m_uiQP-26,"slice_qp_delta");
+	pcBitStreamHandler->PutSVInBitstream(i32(sSliceParams.uiQP)-26,"slice_qp_delta");
 	pcBitStreamHandler->PutUNInBitstream(1,1,"loop_filter_disable");
 	pcBitStreamHandler->PutUVInBitstream(0,"maxNumMergeCand");
 
-	if(pcImageParam->m_uiFrameSizeInTiles == 1)	// There is only one tile, so byte align here
+	if(pcImageParam->m_uiTileCodingSync == 0)	// No tiles or wavefronts, i.e. no entry points, so byte align here
 		pcBitStreamHandler->WriteRBSPTrailingBits();  // @todo Check if this is required for multiple tiles
 }
 
-void H265Headers::GenSliceHeader(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, u32 uiCurrSliceNum, BitStreamHandler *&pcBitStreamHandler)
+void H265Headers::GenSliceHeader(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, SliceParams_t const &sSliceParams, u32 uiCurrSliceNum,
+								 u32 uiSliceAddr, BitStreamHandler *&pcBitStreamHandler)
 {
 	// Write the slice header to the bitstream
-	WriteSliceHdrInBitstream(pcImageParam,uiCurrSliceNum,pcBitStreamHandler);
+	WriteSliceHdrInBitstream(pcImageParam,sSliceParams,uiCurrSliceNum,uiSliceAddr,pcBitStreamHandler);
 }
 
 void H265Headers::WriteTilesEntryPointsInSliceHeader(u32 uiNumEntryPointOffsets, u32 const *uiEntryPointOffsets, BitStreamHandler *&pcBitStreamHandler)
@@ -31,10 +31,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <Cabac.h>
 #include <WorkItem.h>
 #include <WorkQueue.h>
-#include <ThreadHandler.h>
 #include <Utilities.h>
+#include <Tracer.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef _MSC_VER
 #include <unistd.h>	// For the sleep() function
@@ -43,63 +44,104 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /**
 *	Work item preparation.
 *	Used for threading purposes.
+*	@param j Job number.
+*	@param t Tile compressed by the job.
 */
-#define			PREPARE_WORK_ITEM													\
+#define			PREPARE_WORK_ITEM(j,t)												\
 	do																				\
 	{																				\
-		m_ppcTileJobArgs[i]->iNum = i;												\
-		m_ppcTileJobArgs[i]->pbYBuff = pbYBuff;										\
-		m_ppcTileJobArgs[i]->pbCbBuff = pbCbBuff;									\
-		m_ppcTileJobArgs[i]->pbCrBuff = pbCrBuff;									\
-		m_ppcTileJobArgs[i]->pcCabac = m_ppcCabac[i];								\
-		m_ppcTileJobArgs[i]->pcBitStreamHandler = m_ppcBitStreamHandler[i];			\
-		m_ppcTileJobArgs[i]->pcTileCompressor = m_ppcH265TileCompressor[i];			\
-		m_ppcWorkItem[i]->m_pfPtrToFunc = CompressTileThread;						\
-		m_ppcWorkItem[i]->m_iItemNum = i;											\
-		m_ppcWorkItem[i]->m_pArgs = m_ppcTileJobArgs[i];							\
-		m_ppcWorkItem[i]->m_iTotArg = 0;											\
+		m_ppcTileJobArgs[j]->iNum = t;												\
+		m_ppcTileJobArgs[j]->pbYBuff = pbYBuff;										\
+		m_ppcTileJobArgs[j]->pbCbBuff = pbCbBuff;									\
+		m_ppcTileJobArgs[j]->pbCrBuff = pbCrBuff;									\
+		m_ppcTileJobArgs[j]->pcCabac = m_ppcCabac[t];								\
+		m_ppcTileJobArgs[j]->pcBitStreamHandler = m_ppcBitStreamHandler[t];			\
+		m_ppcTileJobArgs[j]->pcTileCompressor = m_ppcH265TileCompressor[t];			\
+		m_ppcWorkItem[j]->m_pfPtrToFunc = CompressTileThread;						\
+		m_ppcWorkItem[j]->m_iItemNum = t;											\
+		m_ppcWorkItem[j]->m_pArgs = m_ppcTileJobArgs[j];							\
+		m_ppcWorkItem[j]->m_iTotArg = 0;											\
 	}while(0)																		\
 
 // Slice
-H265SliceCompressor::H265SliceCompressor(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, BitStreamHandler **& ppcBitStreamHandler)
+H265SliceCompressor::H265SliceCompressor(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, BitStreamHandler **& ppcBitStreamHandler,
+										 WorkQueue *pcWorkQueue)
 {
 	m_pcInputParam = pcInputParam;
 	m_pcImageParam = pcImageParam;
+	m_pcWorkQueue = pcWorkQueue;
 
-	m_uiTotalTiles = m_pcImageParam->m_uiFrameSizeInTiles;
+	// With one tile and more slices, every CTU row band of a slice has its own tile compressor
+	m_uiMaxTiles = m_pcImageParam->m_uiFrameSizeInRegions;
+	m_uiTotalTiles = m_uiMaxTiles;
 	m_ppcBitStreamHandler = ppcBitStreamHandler;
 
-	m_pcTileStartCTUPel = new pixel[m_uiTotalTiles];
-	m_pcTileEndCTUPel = new pixel[m_uiTotalTiles];
+	m_pcTileStartCTUPel = new pixel[m_uiMaxTiles];
+	m_pcTileEndCTUPel = new pixel[m_uiMaxTiles];
 	
 	// Make the CTU address map, in Tile processing order
-	GenTileBoundingPixels();
+	m_sTileLayout = m_pcImageParam->m_sUniformTileLayout;
+	m_sSliceLayout = m_pcImageParam->m_sUniformSliceLayout;
+	if(m_pcImageParam->m_bSliceBands)
+		GenSliceBandBoundingPixels();
+	else
+		GenTileBoundingPixels();
 
-	m_ppcH265TileCompressor = new H265TileCompressor*[m_uiTotalTiles];
-	m_ppcCabac = new Cabac*[m_uiTotalTiles];
-	for(u32 i=0;i<m_uiTotalTiles;i++)
+	m_ppcH265TileCompressor = new H265TileCompressor*[m_uiMaxTiles];
+	m_ppcCabac = new Cabac*[m_uiMaxTiles];
+	for(u32 i=0;i<m_uiMaxTiles;i++)
 	{
 		m_ppcCabac[i] = new Cabac(m_pcImageParam);
 		m_ppcH265TileCompressor[i] = new H265TileCompressor(m_pcInputParam,m_pcImageParam,
 			m_pcTileStartCTUPel[i],m_pcTileEndCTUPel[i],i);
 	}
 
-	// If there are more than 1 tiles per slice, it means that we need to encode the tile entry information
-	// in the bitstream. This information is available at the end of encoding the complete slice, but must
-	// be added in the slice header. Therefore, if we have more than 1 tiles, we save the slice header at a
-	// different space. Else, the first tile bitstream handler is used to store the slice header
-	if(m_uiTotalTiles > 1)	// Tiles are present, there must be separate slice header bitstream handler
-		m_pcSliceHeaderBitStreamHandler = new BitStreamHandler(50);
-	else
-		m_pcSliceHeaderBitStreamHandler = m_ppcBitStreamHandler[0];
+	// The time per CTU drives the tile layout of the next frames
+	m_puiCTUCost = NULL;
+	if(m_pcImageParam->m_bAdaptiveTiles)
+	{
+		m_puiCTUCost = new u32[m_pcImageParam->m_uiFrameSizeInCTUs];
+		for(u32 i=0;i<m_uiMaxTiles;i++)
+			m_ppcH265TileCompressor[i]->SetCTUCostMap(m_puiCTUCost);
+	}
 
-	m_pcSliceBitStreamHandler = m_pcSliceHeaderBitStreamHandler;	// Assign the first bitstream handler as the main handler of the frame
+	// The bytes per CTU drive the slice layout of the next frames
+	m_puiCTUBytes = NULL;
+	if(m_pcImageParam->m_bAdaptiveSlices)
+	{
+		m_puiCTUBytes = new u32[m_pcImageParam->m_uiFrameSizeInCTUs];
+		for(u32 i=0;i<m_uiMaxTiles;i++)
+			m_ppcH265TileCompressor[i]->SetCTUBytesMap(m_puiCTUBytes);
+	}
+
+	// If there are more than 1 tiles (or wavefronts) per slice, it means that we need to encode the entry
+	// information in the bitstream. This information is available at the end of encoding the complete slice, but must
+	// be added in the slice header. Therefore, if we have entry points, we save the slice header at a
+	// different space. Else, the first tile bitstream handler of the slice is used to store the slice header
+	u32 uiMaxSlices = m_pcImageParam->m_uiFrameSizeInSlices;
+	m_ppcSliceHeaderBitStreamHandler = new BitStreamHandler*[uiMaxSlices];
+	for(u32 i=0;i<uiMaxSlices;i++)
+	{
+		if(m_pcImageParam->m_uiTileCodingSync != 0)	// Tiles or wavefronts are present, there must be separate slice header bitstream handler
+			m_ppcSliceHeaderBitStreamHandler[i] = new BitStreamHandler(50+4*max(m_uiMaxTiles,m_pcImageParam->m_uiFrameHeightInCTUs));	// One entry point per tile or CTU row
+		else
+			m_ppcSliceHeaderBitStreamHandler[i] = NULL;	// Set by GenSliceTiles()
+	}
+	m_puiSliceFirstTile = new u32[uiMaxSlices+1];
+	m_pu64BytesPerSlice = new u64[uiMaxSlices];
+	GenSliceTiles();
+
+	m_pcSliceBitStreamHandler = m_ppcSliceHeaderBitStreamHandler[0];	// Assign the first bitstream handler as the main handler of the frame
 	m_pcH265Headers = new H265Headers;
-	m_pcTimePerTile = new u32[m_uiTotalTiles];
-	m_pu64TotalBytesPerTile = new u64[m_uiTotalTiles];
+	m_pcTimePerTile = new u32[m_uiMaxTiles];
+	memset(m_pcTimePerTile,0,sizeof(u32)*m_uiMaxTiles);
+	m_puiTileOrder = new u32[m_uiMaxTiles];
+	m_puiTileSizeInCTUs = new u32[m_uiMaxTiles];
+	m_pu64TotalBytesPerTile = new u64[m_uiMaxTiles];
+	memset(m_pu64TotalBytesPerTile,0,sizeof(u64)*m_uiMaxTiles);
 
 #if(USE_THREADS)
-	MakeTileThreadsPool();
+	MakeTileJobs();
 #endif
 }
 
@@ -108,24 +150,22 @@ void H265SliceCompressor::GenTileBoundingPixels()
 	u32 uiTileIdx;
 	u32 uiStartCTUNumForTile;
 	u32 uiEndCTUNumForTile;
-	u32 *puiTileCTUNumX = m_pcImageParam->m_puiTileCTUNumX;
-	u32 *puiTileCTUNumY = m_pcImageParam->m_puiTileCTUNumY;
-	u32 *puiTileWidthInCTUs = m_pcImageParam->m_puiTileWidthInCTUs;
-	u32 *puiTileHeightInCTUs = m_pcImageParam->m_puiTileHeightInCTUs;
+	u32 uiTileCTUNumX;
+	u32 uiTileCTUNumY = 0;
 	u32 uiFrameWidthInCTUs = m_pcImageParam->m_uiFrameWidthInCTUs;
 
 	for(u32 i=0;i<m_pcImageParam->m_uiFrameHeightInTiles;i++)
 	{
+		uiTileCTUNumX = 0;
 		for(u32 j=0;j<m_pcImageParam->m_uiFrameWidthInTiles;j++)
 		{
 			uiTileIdx = i*m_pcImageParam->m_uiFrameWidthInTiles + j;
-			uiStartCTUNumForTile = puiTileCTUNumX[uiTileIdx]+
-				puiTileCTUNumY[uiTileIdx]*uiFrameWidthInCTUs;
+			uiStartCTUNumForTile = uiTileCTUNumX + uiTileCTUNumY*uiFrameWidthInCTUs;
 			m_pcImageParam->GetCTUStartPel(uiStartCTUNumForTile,
 				m_pcTileStartCTUPel[uiTileIdx].x,m_pcTileStartCTUPel[uiTileIdx].y);
 
-			uiEndCTUNumForTile = uiStartCTUNumForTile + (puiTileWidthInCTUs[uiTileIdx]-1)+
-				(puiTileHeightInCTUs[uiTileIdx]-1)*uiFrameWidthInCTUs;
+			uiEndCTUNumForTile = uiStartCTUNumForTile + (m_sTileLayout.puiColWidthInCTUs[j]-1)+
+				(m_sTileLayout.puiRowHeightInCTUs[i]-1)*uiFrameWidthInCTUs;
 			m_pcImageParam->GetCTUStartPel(uiEndCTUNumForTile,
 				m_pcTileEndCTUPel[uiTileIdx].x,m_pcTileEndCTUPel[uiTileIdx].y);
 
@@ -133,35 +173,128 @@ void H265SliceCompressor::GenTileBoundingPixels()
 				"Error: The ending tile x-pixel is smaller or equal to the starting x-pixel");
 			MAKE_SURE(m_pcTileEndCTUPel[uiTileIdx].y > m_pcTileStartCTUPel[uiTileIdx].y,
 				"Error: The ending tile y-pixel is smaller or equal to the starting y-pixel");
+			uiTileCTUNumX += m_sTileLayout.puiColWidthInCTUs[j];
 		}
+		uiTileCTUNumY += m_sTileLayout.puiRowHeightInCTUs[i];
+	}
+}
+
+void H265SliceCompressor::GenSliceBandBoundingPixels()
+{
+	// The bands span the frame width, one after the other
+	u32 uiRow = 0;
+	m_uiTotalTiles = m_sSliceLayout.uiNumSlices;
+	for(u32 i=0;i<m_uiTotalTiles;i++)
+	{
+		m_pcTileStartCTUPel[i].x = 0;
+		m_pcTileStartCTUPel[i].y = uiRow*CTU_HEIGHT;
+		uiRow += m_sSliceLayout.puiSliceSizeInUnits[i];
+		m_pcTileEndCTUPel[i].x = (m_pcImageParam->m_uiFrameWidthInCTUs-1)*CTU_WIDTH;
+		m_pcTileEndCTUPel[i].y = (uiRow-1)*CTU_HEIGHT;
 	}
+	MAKE_SURE(uiRow == m_pcImageParam->m_uiFrameHeightInCTUs, "Error: The slices do not cover the CTU rows of the frame");
 }
 
-void H265SliceCompressor::MakeTileThreadsPool()
+void H265SliceCompressor::GenSliceTiles()
 {
-	// The caller thread will also compress a tile, therefore, the additional
-	// threads are shown here
-	m_uiTotalTileThreads = m_pcInputParam->m_uiNumTileThreads-1;
-	u32 uiTotalTilesQueue = m_uiTotalTiles-1;
+	// With one tile, the slice sizes are in CTU rows and each band is a slice of its own, else the slices
+	// take the next tiles in the tile scan order
+	u32 uiTile = 0;
+	for(u32 i=0;i<m_sSliceLayout.uiNumSlices;i++)
+	{
+		m_puiSliceFirstTile[i] = uiTile;
+		uiTile += m_pcImageParam->m_uiFrameSizeInTiles == 1 ? 1 : m_sSliceLayout.puiSliceSizeInUnits[i];
+		if(m_pcImageParam->m_uiTileCodingSync == 0)
+			m_ppcSliceHeaderBitStreamHandler[i] = m_ppcBitStreamHandler[m_puiSliceFirstTile[i]];
+	}
+	m_puiSliceFirstTile[m_sSliceLayout.uiNumSlices] = uiTile;
+	MAKE_SURE(uiTile == m_uiTotalTiles, "Error: The slices do not cover the tiles of the frame");
 
-	m_pcTileWorkQueue = new WorkQueue(uiTotalTilesQueue);
+	for(u32 i=0;i<m_sSliceLayout.uiNumSlices;i++)
+		for(u32 j=m_puiSliceFirstTile[i];j<m_puiSliceFirstTile[i+1];j++)
+			m_ppcH265TileCompressor[j]->SetLastTileOfSlice(j == m_puiSliceFirstTile[i+1]-1);
+}
+
+void H265SliceCompressor::SetSliceLayout(SliceLayout_t const &sSliceLayout)
+{
+	if(m_pcImageParam->IsSameSliceLayout(m_sSliceLayout,sSliceLayout))
+		return;
+
+	m_sSliceLayout = sSliceLayout;
+	if(m_pcImageParam->m_bSliceBands)
+	{
+		GenSliceBandBoundingPixels();
+		for(u32 i=0;i<m_uiTotalTiles;i++)
+			m_ppcH265TileCompressor[i]->SetTileBoundary(m_pcTileStartCTUPel[i],m_pcTileEndCTUPel[i]);
+
+		// The times of the old bands do not predict the new ones, and the unused bands write nothing
+		memset(m_pcTimePerTile,0,sizeof(u32)*m_uiMaxTiles);
+		memset(m_pu64TotalBytesPerTile,0,sizeof(u64)*m_uiMaxTiles);
+	}
+	GenSliceTiles();
+}
+
+void H265SliceCompressor::SetTileLayout(TileLayout_t const &sTileLayout)
+{
+	if(m_pcImageParam->IsSameTileLayout(m_sTileLayout,sTileLayout))
+		return;
+
+	m_sTileLayout = sTileLayout;
+	GenTileBoundingPixels();
+	for(u32 i=0;i<m_uiTotalTiles;i++)
+		m_ppcH265TileCompressor[i]->SetTileBoundary(m_pcTileStartCTUPel[i],m_pcTileEndCTUPel[i]);
+
+	// The times of the old tiles do not predict the new ones
+	memset(m_pcTimePerTile,0,sizeof(u32)*m_uiTotalTiles);
+}
+
+void H265SliceCompressor::OrderTilesByPredictedTime()
+{
+	// Tiles which took equally long (the time is in msec) are ordered by their size
+	u32 *puiTileCTUs = m_puiTileSizeInCTUs;
+	for(u32 i=0;i<m_uiTotalTiles;i++)
+	{
+		puiTileCTUs[i] = ((m_pcTileEndCTUPel[i].x-m_pcTileStartCTUPel[i].x)/CTU_WIDTH+1)*
+			((m_pcTileEndCTUPel[i].y-m_pcTileStartCTUPel[i].y)/CTU_HEIGHT+1);
+		m_puiTileOrder[i] = i;
+	}
+
+	// Longest first, the order of equal tiles is kept
+	for(u32 i=1;i<m_uiTotalTiles;i++)
+	{
+		u32 uiTile = m_puiTileOrder[i];
+		i32 j = i32(i)-1;
+		while(j >= 0 && (m_pcTimePerTile[m_puiTileOrder[j]] < m_pcTimePerTile[uiTile] ||
+			(m_pcTimePerTile[m_puiTileOrder[j]] == m_pcTimePerTile[uiTile] && puiTileCTUs[m_puiTileOrder[j]] < puiTileCTUs[uiTile])))
+		{
+			m_puiTileOrder[j+1] = m_puiTileOrder[j];
+			j--;
+		}
+		m_puiTileOrder[j+1] = uiTile;
+	}
+}
+
+void H265SliceCompressor::MakeTileJobs()
+{
+	// The caller thread will also compress a tile, therefore, the
+	// remaining tiles are jobs
+	u32 uiTotalTilesQueue = m_uiMaxTiles-1;
+	m_i64PendingTileJobs = 0;
+
+	// With wavefronts, the tiles push CTU row jobs in the same queue
+	for(u32 i=0;i<m_uiMaxTiles;i++)
+		m_ppcH265TileCompressor[i]->SetWorkQueue(m_pcWorkQueue);
 
 	m_ppcTileJobArgs = new TileJobArgs_t*[uiTotalTilesQueue];
 	for(u32 i=0;i<uiTotalTilesQueue;i++)
 		m_ppcTileJobArgs[i] = new TileJobArgs_t;
 
-	m_ppcTileThreadHandler = new ThreadHandler*[m_uiTotalTileThreads];
-	for(u32 i=0;i<m_uiTotalTileThreads;i++)
-		m_ppcTileThreadHandler[i] = new ThreadHandler(m_pcTileWorkQueue);
-
-	// Start the threads
-	// They will wait for jobs inserted in the job queue
-	for(u32 i=0;i<m_uiTotalTileThreads;i++)
-		m_ppcTileThreadHandler[i]->StartThread();
-
 	m_ppcWorkItem = new WorkItem*[uiTotalTilesQueue];
 	for(u32 i=0;i<uiTotalTilesQueue;i++)
+	{
 		m_ppcWorkItem[i] = new WorkItem();
+		m_ppcWorkItem[i]->m_pi64Group = &m_i64PendingTileJobs;
+	}
 }
 
 H265SliceCompressor::~H265SliceCompressor()
@@ -169,91 +302,126 @@ H265SliceCompressor::~H265SliceCompressor()
 	delete [] m_pcTileStartCTUPel;
 	delete [] m_pcTileEndCTUPel;
 
-	for(u32 i=0;i<m_uiTotalTiles;i++)
+	for(u32 i=0;i<m_uiMaxTiles;i++)
 	{
 		delete m_ppcH265TileCompressor[i];
 		delete m_ppcCabac[i];
 	}
 	delete [] m_ppcH265TileCompressor;
 	delete [] m_ppcCabac;
-	if(m_uiTotalTiles > 1)	// Tiles are present, there must be separate slice header bitstream handler
-		delete m_pcSliceHeaderBitStreamHandler;
+	if(m_pcImageParam->m_uiTileCodingSync != 0)	// Tiles or wavefronts are present, there must be separate slice header bitstream handler
+		for(u32 i=0;i<m_pcImageParam->m_uiFrameSizeInSlices;i++)
+			delete m_ppcSliceHeaderBitStreamHandler[i];
+	delete [] m_ppcSliceHeaderBitStreamHandler;
+	delete [] m_puiSliceFirstTile;
+	delete [] m_pu64BytesPerSlice;
+	delete [] m_puiCTUBytes;
 
 	delete m_pcH265Headers;
 	delete [] m_pcTimePerTile;
+	delete [] m_puiTileOrder;
+	delete [] m_puiTileSizeInCTUs;
 	delete [] m_pu64TotalBytesPerTile;
+	delete [] m_puiCTUCost;
 
 #if(USE_THREADS)
-	u32 uiTotalTilesQueue = m_uiTotalTiles-1;
+	u32 uiTotalTilesQueue = m_uiMaxTiles-1;
 	for(u32 i=0;i<uiTotalTilesQueue;i++)
 		delete m_ppcTileJobArgs[i];
 	delete [] m_ppcTileJobArgs;
 
-	for(u32 i=0;i<m_uiTotalTileThreads;i++)
-		delete m_ppcTileThreadHandler[i];
-	delete [] m_ppcTileThreadHandler;
-
 	for(u32 i=0;i<uiTotalTilesQueue;i++)
 		delete m_ppcWorkItem[i];
 	delete [] m_ppcWorkItem;
-
-	delete m_pcTileWorkQueue;
 #endif
 }
 
 void H265SliceCompressor::InitialToCompression()
 {
 	m_u64TotalBytesPerSlice = 0;
-	m_pcSliceHeaderBitStreamHandler->InitBitStreamWordLevel(true);	// This is necessary for multiple slices
-	for(u32 i=0;i<m_pcImageParam->m_uiFrameSizeInTiles;i++)
+	if(m_pcImageParam->m_uiTileCodingSync != 0)
+		for(u32 i=0;i<m_sSliceLayout.uiNumSlices;i++)
+			m_ppcSliceHeaderBitStreamHandler[i]->InitBitStreamWordLevel(true);	// This is necessary for multiple slices
+	for(u32 i=0;i<m_uiTotalTiles;i++)
 	{
 		m_ppcBitStreamHandler[i]->InitBitStreamWordLevel(true);
-		m_ppcCabac[i]->InitCabac();
+		m_ppcCabac[i]->InitCabac(m_sSliceParams.eType,m_sSliceParams.uiQP);
+		m_ppcH265TileCompressor[i]->InitSubStreams(m_sSliceParams.eType,m_sSliceParams.uiQP);
 	}
 }
 
 void H265SliceCompressor::WriteSliceHeader(u32 uiCurrSliceNum)
 {
-	m_pcH265Headers->GenSliceHeader(m_pcInputParam,
-		m_pcImageParam,uiCurrSliceNum,m_pcSliceHeaderBitStreamHandler);
+	// A slice starts with the top left CTU of its first tile (or band)
+	for(u32 i=0;i<m_sSliceLayout.uiNumSlices;i++)
+	{
+		u32 uiFirstTile = m_puiSliceFirstTile[i];
+		u32 uiSliceAddr = (m_pcTileStartCTUPel[uiFirstTile].y/CTU_HEIGHT)*m_pcImageParam->m_uiFrameWidthInCTUs +
+			m_pcTileStartCTUPel[uiFirstTile].x/CTU_WIDTH;
+		m_pcH265Headers->GenSliceHeader(m_pcInputParam,
+			m_pcImageParam,m_sSliceParams,uiCurrSliceNum,uiSliceAddr,m_ppcSliceHeaderBitStreamHandler[i]);
+	}
 }
 
-void H265SliceCompressor::WriteTilesEntryPointInSliceHeader()
+void H265SliceCompressor::WriteTilesEntryPointInSliceHeader(u32 uiSlice)
 {
-	u32 uiNumEntryPointOffsets = m_uiTotalTiles-1;
-	u32 *uiEntryPointOffsets = new u32[uiNumEntryPointOffsets];
-
-	for(u32 i=0;i<uiNumEntryPointOffsets;i++)
-		uiEntryPointOffsets[i] = u32(m_ppcBitStreamHandler[i]->GetTotalBytesWritten());
+	// Every substream (a tile or a wavefront CTU row) of the slice except the last one has an entry point
+	u32 uiNumEntryPointOffsets = 0;
+	for(u32 i=m_puiSliceFirstTile[uiSlice];i<m_puiSliceFirstTile[uiSlice+1];i++)
+		uiNumEntryPointOffsets += m_ppcH265TileCompressor[i]->GetTotalSubStreams();
+	uiNumEntryPointOffsets--;
+	u32 *uiEntryPointOffsets = new u32[uiNumEntryPointOffsets+1];
+
+	for(u32 i=m_puiSliceFirstTile[uiSlice],k=0;i<m_puiSliceFirstTile[uiSlice+1];i++)
+		for(u32 j=0;j<m_ppcH265TileCompressor[i]->GetTotalSubStreams();j++,k++)
+			uiEntryPointOffsets[k] = u32(m_ppcH265TileCompressor[i]->GetSubStreamBitStreamHandler(j)->GetTotalBytesWritten());
 	
 	m_pcH265Headers->WriteTilesEntryPointsInSliceHeader(uiNumEntryPointOffsets,
-		uiEntryPointOffsets,m_pcSliceHeaderBitStreamHandler);
+		uiEntryPointOffsets,m_ppcSliceHeaderBitStreamHandler[uiSlice]);
 	
 	delete [] uiEntryPointOffsets;
 }
 
 void H265SliceCompressor::CatTileBitStreamHandlers()
 {
-	// If there are more than 1 tiles, then slice header information is written at a different
-	// bitstream handler. We copy this information to the first tile bitstream handler
-	if(m_uiTotalTiles > 1)
+	// If there are more than 1 tiles (or wavefronts), then slice header information is written at a different
+	// bitstream handler, which is linked in front of the first tile of the slice. The slices follow each other
+	BitStreamHandler *pcLast = NULL;
+	for(u32 i=0;i<m_sSliceLayout.uiNumSlices;i++)
 	{
-		MAKE_SURE(m_ppcBitStreamHandler[0] != m_pcSliceHeaderBitStreamHandler,
-			"Error: Something went wrong while assigning the slice header bitstream handler");
-		m_pcSliceHeaderBitStreamHandler->SetNextBitStreamHandler(m_ppcBitStreamHandler[0]);
-		m_ppcBitStreamHandler[0]->SetPrevBitStreamHandler(m_pcSliceHeaderBitStreamHandler);
-	}
+		u32 uiFirstTile = m_puiSliceFirstTile[i];
+		if(m_pcImageParam->m_uiTileCodingSync != 0)
+		{
+			MAKE_SURE(m_ppcBitStreamHandler[uiFirstTile] != m_ppcSliceHeaderBitStreamHandler[i],
+				"Error: Something went wrong while assigning the slice header bitstream handler");
+			if(pcLast)
+				pcLast->SetNextBitStreamHandler(m_ppcSliceHeaderBitStreamHandler[i]);
+			m_ppcSliceHeaderBitStreamHandler[i]->SetPrevBitStreamHandler(pcLast);
+			pcLast = m_ppcSliceHeaderBitStreamHandler[i];
+		}
 
-	for(u32 i=0;i<m_uiTotalTiles-1;i++)
-	{
-		m_ppcBitStreamHandler[i]->SetNextBitStreamHandler(m_ppcBitStreamHandler[i+1]);
-		m_ppcBitStreamHandler[i+1]->SetPrevBitStreamHandler(m_ppcBitStreamHandler[i]);
+		// The substreams within a tile are already linked by the tile compressor
+		for(u32 j=uiFirstTile;j<m_puiSliceFirstTile[i+1];j++)
+		{
+			if(pcLast)
+				pcLast->SetNextBitStreamHandler(m_ppcBitStreamHandler[j]);
+			m_ppcBitStreamHandler[j]->SetPrevBitStreamHandler(pcLast);
+			pcLast = m_ppcH265TileCompressor[j]->GetSubStreamBitStreamHandler(m_ppcH265TileCompressor[j]->GetTotalSubStreams()-1);
+		}
 	}
+
+	// With adaptive slices, the last tile may have been followed by another one before
+	BitStreamHandler *pcNone = NULL;
+	pcLast->SetNextBitStreamHandler(pcNone);
 }
 
 void H265SliceCompressor::FixZeroTermination()
 {
-	m_ppcBitStreamHandler[m_uiTotalTiles-1]->FixZeroTermination();
+	for(u32 i=0;i<m_sSliceLayout.uiNumSlices;i++)
+	{
+		H265TileCompressor *pcLastTile = m_ppcH265TileCompressor[m_puiSliceFirstTile[i+1]-1];
+		pcLastTile->GetSubStreamBitStreamHandler(pcLastTile->GetTotalSubStreams()-1)->FixZeroTermination();
+	}
 }
 
 /**
@@ -264,36 +432,41 @@ static void *CompressTileThread(void *pArgs)
 {
 	TileJobArgs_t *pcArgs = (TileJobArgs_t *)pArgs;
 	H265TileCompressor *pcTileCompressor = pcArgs->pcTileCompressor;
-	printf("Trace: Thread for tile %d.\n",pcArgs->iNum);
+	TRACE(TRACE_LEVEL_DEBUG, "Trace: Thread for tile %d.\n",pcArgs->iNum);
 	pcTileCompressor->CompressTile(pcArgs->pbYBuff, pcArgs->pbCbBuff, pcArgs->pbCrBuff, pcArgs->pcCabac, pcArgs->pcBitStreamHandler);
 	return NULL;
 }
 
 void H265SliceCompressor::CompressSlice(byte *pbYBuff, byte *pbCbBuff, byte *pbCrBuff,
-										u32 uiCurrSliceNum)
+										u32 uiCurrSliceNum, SliceParams_t const &sSliceParams)
 {
 	m_ctTimeForSlice = GetTimeInMiliSec();
-	m_eSliceType = m_pcImageParam->m_eSliceType;
+	m_sSliceParams = sSliceParams;
 	InitialToCompression();
 	WriteSliceHeader(uiCurrSliceNum);
 	// Compress each Tile individually
 #if(USE_THREADS)
-	// Proces all tile except for the last one
+	// The tiles which are predicted to take longest from the previous frame go first,
+	// so that a long tile does not start last and delay the whole slice
+	OrderTilesByPredictedTime();
+
+	// Proces all tile except for the longest one, which is started right away by the caller
 	for(u32 i=0;i<m_uiTotalTiles-1;i++)
-	{
-		PREPARE_WORK_ITEM;
-		// Push the current job in the queue
-		MAKE_SURE(m_pcTileWorkQueue->AddToJob(m_ppcWorkItem[i]) == 0,
+		PREPARE_WORK_ITEM(i,m_puiTileOrder[i+1]);
+	// Push the jobs in the queue at once, the other threads take them longest first
+	if(m_uiTotalTiles > 1)
+		MAKE_SURE(m_pcWorkQueue->AddJobs(m_ppcWorkItem, i32(m_uiTotalTiles-1)) == 0,
 			"Error: No space in the workqueue.");
-	}
 
-	// Let the caller process one of the tiles (the last tile)
-	printf("Job started for work item number %d\n",m_uiTotalTiles-1);
-	m_ppcH265TileCompressor[m_uiTotalTiles-1]->CompressTile(pbYBuff, pbCbBuff, pbCrBuff, 
-		m_ppcCabac[m_uiTotalTiles-1],m_ppcBitStreamHandler[m_uiTotalTiles-1]);
+	// Let the caller process one of the tiles (the longest tile)
+	u32 uiCallerTile = m_puiTileOrder[0];
+	TRACE(TRACE_LEVEL_DEBUG, "Job started for work item number %u\n",uiCallerTile);
+	m_ppcH265TileCompressor[uiCallerTile]->CompressTile(pbYBuff, pbCbBuff, pbCrBuff, 
+		m_ppcCabac[uiCallerTile],m_ppcBitStreamHandler[uiCallerTile]);
 
-	// Let the threads finish their job
-	m_pcTileWorkQueue->WaitQueueEmpty();
+	// Let the other threads finish their tiles, or take over the tiles nobody has picked up yet
+	// (and any other queued job), instead of sleeping while jobs are waiting
+	m_pcWorkQueue->WaitGroupDone(m_i64PendingTileJobs);
 
 	// Get time per tile
 	for(u32 i=0;i<m_uiTotalTiles;i++)
@@ -308,24 +481,34 @@ void H265SliceCompressor::CompressSlice(byte *pbYBuff, byte *pbCbBuff, byte *pbC
 #endif
 	for(u32 i=0;i<m_uiTotalTiles;i++)
 	{
-		m_pu64TotalBytesPerTile[i] = m_ppcBitStreamHandler[i]->GetTotalBytesWritten();
-		MAKE_SURE((m_pu64TotalBytesPerTile[i] < m_ppcBitStreamHandler[i]->GetTotalBytesAllocate()),
-			"Error: Bitstream Buffer overflow detected");
-		if(m_pcInputParam->m_bVerbose)
-			printf("Trace: Tile %u encoded in %u msec.\n",i,m_ppcH265TileCompressor[i]->GetTimePerTile());
-		m_u64TotalBytesPerSlice += m_ppcBitStreamHandler[i]->GetTotalBytesWritten();
+		m_pu64TotalBytesPerTile[i] = m_ppcH265TileCompressor[i]->GetTotalBytesWritten();
+		for(u32 j=0;j<m_ppcH265TileCompressor[i]->GetTotalSubStreams();j++)
+		{
+			BitStreamHandler *pcSubStream = m_ppcH265TileCompressor[i]->GetSubStreamBitStreamHandler(j);
+			MAKE_SURE((pcSubStream->GetTotalBytesWritten() < pcSubStream->GetTotalBytesAllocate()),
+				"Error: Bitstream Buffer overflow detected");
+		}
+		TRACE(TRACE_LEVEL_VERBOSE, "Trace: Tile %u encoded in %u msec.\n",i,m_ppcH265TileCompressor[i]->GetTimePerTile());
+		m_u64TotalBytesPerSlice += m_pu64TotalBytesPerTile[i];
 	}
 
-	if(m_uiTotalTiles > 1)	// If more than 1 tiles per frame
+	for(u32 i=0;i<m_sSliceLayout.uiNumSlices;i++)
 	{
-		// Encode the tile entry points in the bitstream
-		WriteTilesEntryPointInSliceHeader();
-		m_u64TotalBytesPerSlice += m_pcSliceHeaderBitStreamHandler->GetTotalBytesWritten();
-
-		// Concatenate tiles' bitstreams into a linked list
-		CatTileBitStreamHandlers();
+		m_pu64BytesPerSlice[i] = 0;
+		for(u32 j=m_puiSliceFirstTile[i];j<m_puiSliceFirstTile[i+1];j++)
+			m_pu64BytesPerSlice[i] += m_pu64TotalBytesPerTile[j];
+		if(m_pcImageParam->m_uiTileCodingSync != 0)	// If more than 1 tiles per frame or wavefronts
+		{
+			// Encode the tile entry points in the bitstream
+			WriteTilesEntryPointInSliceHeader(i);
+			m_pu64BytesPerSlice[i] += m_ppcSliceHeaderBitStreamHandler[i]->GetTotalBytesWritten();
+			m_u64TotalBytesPerSlice += m_ppcSliceHeaderBitStreamHandler[i]->GetTotalBytesWritten();
+		}
 	}
 
+	// Concatenate the bitstreams of the slices and their tiles into a linked list
+	CatTileBitStreamHandlers();
+
 	FixZeroTermination();
 	m_ctTimeForSlice = GetTimeInMiliSec() - m_ctTimeForSlice;
 }
\ No newline at end of file
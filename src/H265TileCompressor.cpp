@@ -28,7 +28,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <H265CTUCompressor.h>
 #include <Cabac.h>
 #include <H265TileCompressor.h>
+#include <WorkQueue.h>
+#include <WorkItem.h>
+#include <TaskGraph.h>
 #include <Utilities.h>
+#include <Tracer.h>
+#include <string.h>
+
+/**
+*	Compress a CTU of a tile as a task.
+*	Will only be called with wavefronts and if USE_THREADS is enabled.
+*	The task graph only starts the task once the CTUs it depends upon are done.
+*/
+static void *CompressCTUTask(void *pArgs)
+{
+	CTUTaskArgs_t *pcArgs = (CTUTaskArgs_t *)pArgs;
+	pcArgs->pcTileCompressor->CompressCTU(pcArgs->uiRow, pcArgs->uiCol);
+	return NULL;
+}
+
+/**
+*	Entropy code the compressed CTUs of a tile as a job.
+*	Will only be called with the CTU pipeline and if USE_THREADS is enabled.
+*/
+static void *EncodeCTUPipeTask(void *pArgs)
+{
+	((H265TileCompressor *)pArgs)->EncodeCTUPipe();
+	return NULL;
+}
 
 // Tile
 H265TileCompressor::H265TileCompressor(InputParameters const *pcInputParam, ImageParameters const *pcImageParam, 
@@ -36,31 +63,114 @@ H265TileCompressor::H265TileCompressor(InputParameters const *pcInputParam, Imag
 {
 	m_pcInputParam = pcInputParam;
 	m_pcImageParam = pcImageParam;
+	m_puiCTUCost = NULL;
+	m_puiCTUBytes = NULL;
+
+	// Get tile statistics
+	SetTileDimensions(cTileStartCTUPelTL, cTileEndCTUPelTL);
+
+	// The tile may be resized later on, so the buffers are made for the tile with the largest possible size
+	bit bResizable = m_pcImageParam->m_bAdaptiveTiles || m_pcImageParam->m_bAdaptiveSlices;
+	u32 uiMaxTileWidthInPels = bResizable ? m_pcImageParam->m_uiFrameWidth : m_uiTileWidthInPels;
+	u32 uiMaxTileSizeInCTUs = bResizable ? m_pcImageParam->m_uiFrameSizeInCTUs : m_uiTotalCTUsInTile;
+	
+	m_puiCTUAddrMapX = new u32[uiMaxTileSizeInCTUs];
+	m_puiCTUAddrMapY = new u32[uiMaxTileSizeInCTUs];
+
+	// Make a map of addresses for the CTUs in the tile. This will help in compression at CTU level
+	MakeCTUAddrMap();
+
+	// Top lines shared by all the CTU rows of the tile
+	// CTU_WIDTH+1 added to eliminate invalid reads in reference generation
+	for(u32 i=0;i<2;i++)
+	{
+		m_sTopLine.ppbY[i] = new byte[uiMaxTileWidthInPels+CTU_WIDTH+1];
+		m_sTopLine.ppbCb[i] = new byte[(uiMaxTileWidthInPels>>1)+(CTU_WIDTH>>1)+1];
+		m_sTopLine.ppbCr[i] = new byte[(uiMaxTileWidthInPels>>1)+(CTU_WIDTH>>1)+1];
+	}
+	m_sTopLine.pbIntraModeInfoL = new u8[uiMaxTileWidthInPels/MIN_CU_SIZE+1];
+
+	// With wavefronts, every CTU row is a substream and as many rows as the tile threads are compressed concurrently
+	bit bWPP = (m_pcImageParam->m_uiTileCodingSync == 2);
+	m_uiTotalSubStreams = bWPP ? m_uiTileHeightInCTUs : 1;
+	m_uiTotalRowWorkers = 1;
+#if(USE_THREADS)
+	if(bWPP)
+		m_uiTotalRowWorkers = min(m_pcInputParam->m_uiNumTileThreads,m_uiTileHeightInCTUs);
+#endif
 
+	// One CTU compressor per concurrent row
+	m_ppcH265CTUCompressor = new H265CTUCompressor*[m_uiTotalRowWorkers];
+	for(u32 i=0;i<m_uiTotalRowWorkers;i++)
+		m_ppcH265CTUCompressor[i] = new H265CTUCompressor(m_pcInputParam,m_pcImageParam,m_cTileStartCTUPelTL,m_cTileEndCTUPelTL,&m_sTopLine);
+
+	// Without wavefronts, the CTUs can be entropy coded while the next ones are compressed
+	m_psCTUPipe = NULL;
+	m_uiCTUPipeDepth = 0;
+#if(USE_THREADS)
+	if(!bWPP && m_pcInputParam->m_uiCTUPipeDepth > 0)
+	{
+		m_uiCTUPipeDepth = m_pcInputParam->m_uiCTUPipeDepth;
+		m_psCTUPipe = new CTUSyntax_t[m_uiCTUPipeDepth];
+	}
+#endif
+	m_i64CTUPipeHead = 0;
+	m_i64CTUPipeTail = 0;
+	m_i64CTUPipeOwner = 0;
+	m_i64PendingEntropyJobs = 0;
+	m_pcEntropyWorkItem = NULL;
+
+	// The first substream is the one of the tile, the rest are owned by the tile compressor
+	m_ppcSubStreamCabac = new Cabac*[m_uiTotalSubStreams];
+	m_ppcSubStreamBitStreamHandler = new BitStreamHandler*[m_uiTotalSubStreams];
+	m_ppcSubStreamCabac[0] = NULL;
+	m_ppcSubStreamBitStreamHandler[0] = NULL;
+	for(u32 i=1;i<m_uiTotalSubStreams;i++)
+	{
+		m_ppcSubStreamCabac[i] = new Cabac(m_pcImageParam);
+		m_ppcSubStreamBitStreamHandler[i] = new BitStreamHandler(m_uiTileWidthInCTUs*BYTES_PER_CTU);
+	}
+	m_pbWPPContextModels = new u8[m_uiTotalSubStreams*MAX_NUM_CTX_MOD];
+
+	m_pcWorkQueue = NULL;
+	m_pcCTUGraph = NULL;
+	m_pcCTUTaskArgs = NULL;
+
+	m_uiTileID = uiTileID;
+
+	m_uiTotalBytes = 0;
+	
+}
+
+void H265TileCompressor::SetTileDimensions(pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL)
+{
 	m_cTileStartCTUPelTL.x = cTileStartCTUPelTL.x;
 	m_cTileStartCTUPelTL.y = cTileStartCTUPelTL.y;
 
 	m_cTileEndCTUPelTL.x = cTileEndCTUPelTL.x;
 	m_cTileEndCTUPelTL.y = cTileEndCTUPelTL.y;
 
-	// Get tile statistics
 	m_uiTileWidthInPels = m_cTileEndCTUPelTL.x - m_cTileStartCTUPelTL.x + CTU_WIDTH;
 	m_uiTileHeightInPels = m_cTileEndCTUPelTL.y - m_cTileStartCTUPelTL.y + CTU_HEIGHT;
 	m_uiTileWidthInCTUs = (m_uiTileWidthInPels + 1)/CTU_WIDTH;
 	m_uiTileHeightInCTUs = (m_uiTileHeightInPels + 1)/CTU_HEIGHT;
 	m_uiTotalCTUsInTile = m_uiTileWidthInCTUs*m_uiTileHeightInCTUs;
-	
-	m_puiCTUAddrMapX = new u32[m_uiTotalCTUsInTile];
-	m_puiCTUAddrMapY = new u32[m_uiTotalCTUsInTile];
+}
 
-	// Make a map of addresses for the CTUs in the tile. This will help in compression at CTU level
+void H265TileCompressor::SetTileBoundary(pixel cTileStartCTUPelTL, pixel cTileEndCTUPelTL)
+{
+	MAKE_SURE(m_pcImageParam->m_bAdaptiveTiles || m_pcImageParam->m_bAdaptiveSlices,
+		"Error: The tiles can only be resized with adaptive tiles or slices");
+	SetTileDimensions(cTileStartCTUPelTL, cTileEndCTUPelTL);
 	MakeCTUAddrMap();
-	// Make only one CTU compressor class. This means that we will not implement threads for this class
-	m_pcH265CTUCompressor = new H265CTUCompressor(m_pcInputParam,m_pcImageParam,m_cTileStartCTUPelTL,m_cTileEndCTUPelTL);
-	m_uiTileID = uiTileID;
+	for(u32 i=0;i<m_uiTotalRowWorkers;i++)
+		m_ppcH265CTUCompressor[i]->SetTileBoundary(m_cTileStartCTUPelTL, m_cTileEndCTUPelTL);
+}
 
-	m_uiTotalBytes = 0;
-	
+void H265TileCompressor::SetLastTileOfSlice(bit bLastTileOfSlice)
+{
+	for(u32 i=0;i<m_uiTotalRowWorkers;i++)
+		m_ppcH265CTUCompressor[i]->SetLastTileOfSlice(bLastTileOfSlice);
 }
 
 void H265TileCompressor::MakeCTUAddrMap()
@@ -77,34 +187,231 @@ void H265TileCompressor::MakeCTUAddrMap()
 
 H265TileCompressor::~H265TileCompressor()
 {
-	delete m_pcH265CTUCompressor;
+	for(u32 i=0;i<m_uiTotalRowWorkers;i++)
+		delete m_ppcH265CTUCompressor[i];
+	delete [] m_ppcH265CTUCompressor;
+	for(u32 i=0;i<2;i++)
+	{
+		delete [] m_sTopLine.ppbY[i];
+		delete [] m_sTopLine.ppbCb[i];
+		delete [] m_sTopLine.ppbCr[i];
+	}
+	delete [] m_sTopLine.pbIntraModeInfoL;
+
+	for(u32 i=1;i<m_uiTotalSubStreams;i++)
+	{
+		delete m_ppcSubStreamCabac[i];
+		delete m_ppcSubStreamBitStreamHandler[i];
+	}
+	delete [] m_ppcSubStreamCabac;
+	delete [] m_ppcSubStreamBitStreamHandler;
+	delete [] m_pbWPPContextModels;
+
+	delete m_pcCTUGraph;
+	delete [] m_pcCTUTaskArgs;
+	delete m_pcEntropyWorkItem;
+	delete [] m_psCTUPipe;
+
 	delete [] m_puiCTUAddrMapX;
 	delete [] m_puiCTUAddrMapY;
 }
 
-void H265TileCompressor::CompressTile(byte *pbYBuff, byte *pbCbBuff, byte *pbCrBuff, 
-									  Cabac *& pcCabac, BitStreamHandler *& pcBitstreamHandler)
+void H265TileCompressor::SetWorkQueue(WorkQueue *pcWorkQueue)
+{
+	m_pcWorkQueue = pcWorkQueue;
+
+	// Only the wavefronts have CTUs which can be compressed concurrently
+	if(m_uiTotalRowWorkers > 1)
+	{
+		m_pcCTUTaskArgs = new CTUTaskArgs_t[m_uiTotalCTUsInTile];
+		m_pcCTUGraph = new TaskGraph(m_uiTotalCTUsInTile);
+		MakeCTUGraph();
+	}
+
+	// The CTU pipeline needs a job to entropy code the CTUs
+	if(m_psCTUPipe)
+		m_pcEntropyWorkItem = new WorkItem(EncodeCTUPipeTask, i32(m_uiTileID), this, 0, &m_i64PendingEntropyJobs);
+}
+
+void H265TileCompressor::MakeCTUGraph()
+{
+	// Tasks are numbered in raster scan order, so that the right neighbour of a CTU is its first successor
+	m_pcCTUGraph->Clear();
+	for(u32 i=0;i<m_uiTileHeightInCTUs;i++)
+	{
+		for(u32 j=0;j<m_uiTileWidthInCTUs;j++)
+		{
+			CTUTaskArgs_t *pcArgs = &m_pcCTUTaskArgs[i*m_uiTileWidthInCTUs+j];
+			pcArgs->uiRow = i;
+			pcArgs->uiCol = j;
+			pcArgs->pcTileCompressor = this;
+			u32 uiTask = m_pcCTUGraph->AddTask(CompressCTUTask, pcArgs);
+
+			if(j > 0)	// Left
+				m_pcCTUGraph->AddDependency(uiTask, uiTask-1);
+			if(i > 0)	// Top right, or top for the last column
+				m_pcCTUGraph->AddDependency(uiTask, (i-1)*m_uiTileWidthInCTUs+min(j+1,m_uiTileWidthInCTUs-1));
+			if(j == 0 && i >= m_uiTotalRowWorkers)	// The CTU compressor is free
+				m_pcCTUGraph->AddDependency(uiTask, (i-m_uiTotalRowWorkers+1)*m_uiTileWidthInCTUs-1);
+		}
+	}
+}
+
+void H265TileCompressor::InitSubStreams(eSliceType eCurrSliceType, u32 uiQP)
+{
+	for(u32 i=1;i<m_uiTotalSubStreams;i++)
+	{
+		m_ppcSubStreamBitStreamHandler[i]->InitBitStreamWordLevel(true);
+		m_ppcSubStreamCabac[i]->InitCabac(eCurrSliceType,uiQP);
+	}
+}
+
+void H265TileCompressor::CompressCTU(u32 uiRow, u32 uiCol)
 {
 	u32 uiAddrX;
 	u32 uiAddrY;
+	u64 u64CTUTime = 0;
+	// The rows sharing a CTU compressor never overlap, see MakeCTUGraph()
+	H265CTUCompressor *pcCTUCompressor = m_ppcH265CTUCompressor[uiRow % m_uiTotalRowWorkers];
+	bit bWPP = (m_uiTotalSubStreams > 1);
+	u32 uiSubStream = bWPP ? uiRow : 0;
+	Cabac *pcCabac = m_ppcSubStreamCabac[uiSubStream];
+	BitStreamHandler *pcBitStreamHandler = m_ppcSubStreamBitStreamHandler[uiSubStream];
+
+	if(bWPP && uiCol == 0)
+	{
+		// With wavefronts, a row must not depend upon the row compressed before by the same compressor
+		pcCTUCompressor->InitBuffersNewTile();
+
+		// Continue with the contexts of the row above after its second CTU
+		// If the row above has only one CTU, the contexts stay initialized
+		if(uiRow > 0 && m_uiTileWidthInCTUs > 1)
+			pcCabac->LoadContextModels(&m_pbWPPContextModels[(uiRow-1)*MAX_NUM_CTX_MOD]);
+	}
+
+	// 1- Compress
+	// 2- Encode
+	// 3- Update
+	uiAddrX = m_puiCTUAddrMapX[uiRow*m_uiTileWidthInCTUs+uiCol];
+	uiAddrY = m_puiCTUAddrMapY[uiRow*m_uiTileWidthInCTUs+uiCol];
+	if(m_puiCTUCost)
+		u64CTUTime = GetTimeInMicroSec();
+	pcCTUCompressor->CompressCTU(uiAddrX, uiAddrY, m_pbYBuff, m_pbCbBuff, m_pbCrBuff);
+	// With the CTU pipeline, the CTU is entropy coded by another job, and only the compression is measured
+	if(m_pcEntropyWorkItem)
+		PushCTUSyntax(pcCTUCompressor, uiAddrX, uiAddrY);
+	else
+	{
+		u64 u64Bytes = pcBitStreamHandler->GetTotalBytesWritten();
+		pcCTUCompressor->EncodeCTU(uiAddrX, uiAddrY, pcCabac, pcBitStreamHandler);
+		if(m_puiCTUBytes)
+			m_puiCTUBytes[(uiAddrY/CTU_HEIGHT)*m_pcImageParam->m_uiFrameWidthInCTUs+uiAddrX/CTU_WIDTH] =
+				u32(pcBitStreamHandler->GetTotalBytesWritten()-u64Bytes);
+	}
+	pcCTUCompressor->UpdateBuffers(uiAddrX, uiAddrY, m_pbYBuff, m_pbCbBuff, m_pbCrBuff);
+	if(m_puiCTUCost)
+		m_puiCTUCost[(uiAddrY/CTU_HEIGHT)*m_pcImageParam->m_uiFrameWidthInCTUs+uiAddrX/CTU_WIDTH] = u32(GetTimeInMicroSec()-u64CTUTime);
+	if(bWPP && uiCol == 1)
+		pcCabac->StoreContextModels(&m_pbWPPContextModels[uiRow*MAX_NUM_CTX_MOD]);
+	TRACE(TRACE_LEVEL_VERBOSE, "Trace: CTU at (%u,%u) encoded in %u msec.\n",uiAddrX,uiAddrY,pcCTUCompressor->GetTimePerCTU());
+}
+
+void H265TileCompressor::PushCTUSyntax(H265CTUCompressor *pcCTUCompressor, u32 uiAddrX, u32 uiAddrY)
+{
+	// Only this thread fills the ring
+	i64 i64Tail = ATOMIC_LOAD(m_i64CTUPipeTail);
+
+	// If the ring is full, help with the entropy coding, or wait for the thread which is at it
+	while(i64Tail - ATOMIC_LOAD(m_i64CTUPipeHead) >= i64(m_uiCTUPipeDepth))
+	{
+		if(!EncodeCTUPipe())
+			CPU_RELAX();
+	}
+
+	pcCTUCompressor->SaveSyntax(uiAddrX, uiAddrY, &m_psCTUPipe[i64Tail % m_uiCTUPipeDepth]);
+	ATOMIC_STORE(m_i64CTUPipeTail, i64Tail+1);
+
+	// The work item is reused only when the last job is done. If that job is just finishing,
+	// it may miss this CTU, which is then taken by the next job or by FinishCTUPipe()
+	if(ATOMIC_LOAD(m_i64PendingEntropyJobs) == 0)
+		MAKE_SURE(m_pcWorkQueue->AddToJob(m_pcEntropyWorkItem) == 0, "Error: No space in the workqueue.");
+}
+
+bit H265TileCompressor::EncodeCTUPipe()
+{
+	if(!ATOMIC_CAS(m_i64CTUPipeOwner, 0, 1))
+		return false;
+
+	// The CTUs are taken in the order they were compressed, so that the CABAC sees the same sequence of CTUs
+	i64 i64Head = ATOMIC_LOAD(m_i64CTUPipeHead);
+	while(i64Head != ATOMIC_LOAD(m_i64CTUPipeTail))
+	{
+		CTUSyntax_t const *psSyntax = &m_psCTUPipe[i64Head % m_uiCTUPipeDepth];
+		u64 u64Bytes = m_ppcSubStreamBitStreamHandler[0]->GetTotalBytesWritten();
+		m_ppcH265CTUCompressor[0]->EncodeCTU(psSyntax, m_ppcSubStreamCabac[0], m_ppcSubStreamBitStreamHandler[0]);
+		if(m_puiCTUBytes)
+			m_puiCTUBytes[(psSyntax->uiAddrY/CTU_HEIGHT)*m_pcImageParam->m_uiFrameWidthInCTUs+psSyntax->uiAddrX/CTU_WIDTH] =
+				u32(m_ppcSubStreamBitStreamHandler[0]->GetTotalBytesWritten()-u64Bytes);
+		ATOMIC_STORE(m_i64CTUPipeHead, ++i64Head);
+	}
+
+	ATOMIC_STORE(m_i64CTUPipeOwner, 0);
+	return true;
+}
+
+void H265TileCompressor::FinishCTUPipe()
+{
+	// Help with the last job, then take the CTUs it may have missed
+	m_pcWorkQueue->WaitGroupDone(m_i64PendingEntropyJobs);
+	bit bDone = EncodeCTUPipe();
+	MAKE_SURE(bDone && ATOMIC_LOAD(m_i64CTUPipeHead) == ATOMIC_LOAD(m_i64CTUPipeTail),
+		"Error: The CTUs of the tile are not entropy coded");
+}
+
+void H265TileCompressor::CompressCTURow(u32 uiRow)
+{
+	for(u32 j=0;j<m_uiTileWidthInCTUs;j++)
+		CompressCTU(uiRow,j);
+}
+
+void H265TileCompressor::CatSubStreamBitStreamHandlers()
+{
+	for(u32 i=0;i<m_uiTotalSubStreams-1;i++)
+	{
+		m_ppcSubStreamBitStreamHandler[i]->SetNextBitStreamHandler(m_ppcSubStreamBitStreamHandler[i+1]);
+		m_ppcSubStreamBitStreamHandler[i+1]->SetPrevBitStreamHandler(m_ppcSubStreamBitStreamHandler[i]);
+	}
+}
+
+void H265TileCompressor::CompressTile(byte *pbYBuff, byte *pbCbBuff, byte *pbCrBuff, 
+									  Cabac *& pcCabac, BitStreamHandler *& pcBitstreamHandler)
+{
 	m_ctTimeForTile = GetTimeInMiliSec();
-	m_pcH265CTUCompressor->InitBuffersNewTile();
+	m_pbYBuff = pbYBuff;
+	m_pbCbBuff = pbCbBuff;
+	m_pbCrBuff = pbCrBuff;
+	m_ppcSubStreamCabac[0] = pcCabac;
+	m_ppcSubStreamBitStreamHandler[0] = pcBitstreamHandler;
+
+	m_ppcH265CTUCompressor[0]->InitBuffersNewTile();
+	memset(m_sTopLine.pbIntraModeInfoL,INVALID_MODE,m_uiTileWidthInPels/MIN_CU_SIZE+1);
 
-	for(u32 i=0;i<m_uiTotalCTUsInTile;i++)
+	// With wavefronts, the CTUs are tasks of the shared queue, and the caller helps until all are done
+	if(m_pcCTUGraph)
+		m_pcCTUGraph->Run(m_pcWorkQueue);
+	else
 	{
-		// 1- Compress
-		// 2- Encode
-		// 3- Update
-		uiAddrX = m_puiCTUAddrMapX[i];
-		uiAddrY = m_puiCTUAddrMapY[i];
-		m_pcH265CTUCompressor->CompressCTU(uiAddrX, uiAddrY, pbYBuff, pbCbBuff, pbCrBuff);
-		m_pcH265CTUCompressor->EncodeCTU(uiAddrX, uiAddrY, pcCabac, pcBitstreamHandler);
-		m_pcH265CTUCompressor->UpdateBuffers(uiAddrX, uiAddrY, pbYBuff, pbCbBuff, pbCrBuff);
-		if(m_pcInputParam->m_bVerbose)
-			printf("Trace: CTU at (%u,%u) encoded in %u msec.\n",uiAddrX,uiAddrY,m_pcH265CTUCompressor->GetTimePerCTU());
+		for(u32 i=0;i<m_uiTileHeightInCTUs;i++)
+			CompressCTURow(i);
+		if(m_pcEntropyWorkItem)
+			FinishCTUPipe();
 	}
+
+	CatSubStreamBitStreamHandlers();
+
 	m_ctTimeForTile = GetTimeInMiliSec() - m_ctTimeForTile;
-	m_uiTotalBytes = pcBitstreamHandler->GetTotalBytesWritten();
-	if(m_pcInputParam->m_bVerbose)
-		printf("Trace: Total bytes for tile %u = %llu.\n",m_uiTileID,pcBitstreamHandler->GetTotalBytesWritten());
+	m_uiTotalBytes = 0;
+	for(u32 i=0;i<m_uiTotalSubStreams;i++)
+		m_uiTotalBytes += m_ppcSubStreamBitStreamHandler[i]->GetTotalBytesWritten();
+	TRACE(TRACE_LEVEL_VERBOSE, "Trace: Total bytes for tile %u = %llu.\n",m_uiTileID,m_uiTotalBytes);
 }
@@ -27,6 +27,47 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string.h>
 #include <cassert>
 
+/**
+*	Picture size, slice and tile limits of the HEVC levels (Table A.6 of the standard).
+*	Levels with the same limits are listed once.
+*/
+static const struct
+{
+	u32	uiMaxLumaPs;		//!< Most luma samples per picture
+	u32	uiMaxSliceSegs;		//!< Most slice segments per picture
+	u32	uiMaxTileCols;		//!< Most tile columns
+	u32	uiMaxTileRows;		//!< Most tile rows
+}g_sLevelLimits[] =
+{
+	{   122880,  16,  1,  1},	// Level 1 to 2
+	{   245760,  20,  1,  1},	// Level 2.1
+	{   552960,  30,  2,  2},	// Level 3
+	{   983040,  40,  3,  3},	// Level 3.1
+	{  2228224,  75,  5,  5},	// Level 4 and 4.1
+	{  8912896, 200, 10, 11},	// Level 5 to 5.2
+	{ 35651584, MAX_SLICES_PER_FRAME, MAX_TILE_COLUMNS, MAX_TILE_ROWS},	// Level 6 to 6.2
+};
+
+/**
+*	Get the lowest HEVC level which allows the resolution.
+*	@param uiFrameWidth Width of the frame in pixels.
+*	@param uiFrameHeight Height of the frame in pixels.
+*	@param bAnyLevel True for the highest level instead.
+*	@return Index of the level in g_sLevelLimits.
+*/
+static u32 GetLevelIdx(u32 uiFrameWidth, u32 uiFrameHeight, bit bAnyLevel)
+{
+	// The lowest level which takes the picture size, and its width and height (at most sqrt(8*MaxLumaPs))
+	u32 uiNumLevels = sizeof(g_sLevelLimits)/sizeof(g_sLevelLimits[0]);
+	u32 uiLevel = bAnyLevel ? uiNumLevels-1 : 0;
+	u64 u64PicSize = u64(uiFrameWidth)*uiFrameHeight;
+	while(uiLevel+1 < uiNumLevels && (u64PicSize > g_sLevelLimits[uiLevel].uiMaxLumaPs ||
+		u64(uiFrameWidth)*uiFrameWidth > 8*u64(g_sLevelLimits[uiLevel].uiMaxLumaPs) ||
+		u64(uiFrameHeight)*uiFrameHeight > 8*u64(g_sLevelLimits[uiLevel].uiMaxLumaPs)))
+		uiLevel++;
+	return uiLevel;
+}
+
 ImageParameters::ImageParameters()
 {
 	m_uiMaxCUSize = CTU_WIDTH;
@@ -79,6 +120,12 @@ void ImageParameters::InitImgProp(InputParameters *pcInputParam)
 		"Error: The Tile sizes are incorrect or they do not match the total tiles in a frame");
 
 	m_uiTileCodingSync = RET_1_IF_TRUE(m_uiFrameSizeInTiles > 1);
+	if(pcInputParam->m_bWPP)
+	{
+		// tiles_or_entropy_coding_sync_idc can signal either tiles or the entropy coding sync, not both
+		MAKE_SURE(m_uiFrameSizeInTiles == 1,"Error: Wavefront parallel processing can only be used with one tile per frame");
+		m_uiTileCodingSync = 2;
+	}
 
 	// Determine Tiles widths and heights
 	m_puiTileWidthInCTUs	=	new u32[m_uiFrameSizeInTiles];
@@ -92,6 +139,45 @@ void ImageParameters::InitImgProp(InputParameters *pcInputParam)
 		uiMaxTileWidthInCTUs, uiMaxTileHeightInCTUs,
 		m_puiTileWidthInCTUs,m_puiTileHeightInCTUs,m_puiTileCTUNumX,m_puiTileCTUNumY);
 
+	u32 uiMaxTileCols, uiMaxTileRows;
+	GetMaxTiles(m_uiFrameWidth, m_uiFrameHeight, true, uiMaxTileCols, uiMaxTileRows);
+	MAKE_SURE(m_uiFrameWidthInTiles <= uiMaxTileCols && m_uiFrameHeightInTiles <= uiMaxTileRows,
+		"Error: Too many tile columns or rows for the resolution");
+	for(u32 i=0;i<m_uiFrameWidthInTiles;i++)
+		m_sUniformTileLayout.puiColWidthInCTUs[i] = m_puiTileWidthInCTUs[i];
+	for(u32 i=0;i<m_uiFrameHeightInTiles;i++)
+		m_sUniformTileLayout.puiRowHeightInCTUs[i] = m_puiTileHeightInCTUs[i*m_uiFrameWidthInTiles];
+	m_sUniformTileLayout.bUniform = true;
+
+	// Adaptive layouts need at least two tiles
+	m_bAdaptiveTiles = pcInputParam->m_bAdaptiveTiles && m_uiTileCodingSync == 1;
+	if(m_bAdaptiveTiles)
+	{
+		// A tile can grow until all the other tiles of its row and column are of the minimum size (2 CTUs)
+		uiMaxTileWidthInCTUs = m_uiFrameWidthInCTUs - 2*(m_uiFrameWidthInTiles-1);
+		uiMaxTileHeightInCTUs = m_uiFrameHeightInCTUs - 2*(m_uiFrameHeightInTiles-1);
+	}
+
+	// Slices, made of whole tiles or, with one tile per frame, of bands of whole CTU rows. Each band is compressed
+	// by its own tile compressor, but it is not signalled as a tile
+	u32 uiSliceUnits = m_uiFrameSizeInTiles > 1 ? m_uiFrameSizeInTiles : m_uiFrameHeightInCTUs;
+	m_uiSliceMaxBytes = pcInputParam->m_uiSliceMaxBytes;
+	m_uiFrameSizeInSlices = m_uiSliceMaxBytes ? min(uiSliceUnits, GetMaxSlices(m_uiFrameWidth, m_uiFrameHeight, true)) : pcInputParam->m_uiSlicesPerFrame;
+	MAKE_SURE(m_uiFrameSizeInSlices >= 1 && m_uiFrameSizeInSlices <= min(uiSliceUnits, u32(MAX_SLICES_PER_FRAME)),
+		"Error: A slice must have at least one tile, or with one tile per frame, at least one CTU row");
+	m_bSliceBands = m_uiFrameSizeInTiles == 1 && m_uiFrameSizeInSlices > 1;
+	m_uiFrameSizeInRegions = m_bSliceBands ? m_uiFrameSizeInSlices : m_uiFrameSizeInTiles;
+	m_sUniformSliceLayout.uiNumSlices = m_uiFrameSizeInSlices;
+	for(u32 i=0;i<m_uiFrameSizeInSlices;i++)
+		m_sUniformSliceLayout.puiSliceSizeInUnits[i] = (i+1)*uiSliceUnits/m_uiFrameSizeInSlices - i*uiSliceUnits/m_uiFrameSizeInSlices;
+
+	// With a byte budget, the bands are resized from frame to frame, which is done like for adaptive tiles
+	m_bAdaptiveSlices = m_uiSliceMaxBytes > 0 && m_bSliceBands;
+	MAKE_SURE(!m_bAdaptiveSlices || m_uiTileCodingSync == 0,
+		"Error: The byte budget of the slices can only be used with one tile per frame and without wavefront parallel processing");
+	if(m_bSliceBands)
+		uiMaxTileHeightInCTUs = m_bAdaptiveSlices ? m_uiFrameHeightInCTUs : (m_uiFrameHeightInCTUs+m_uiFrameSizeInSlices-1)/m_uiFrameSizeInSlices;
+
 	// Entropy buffer size
 	m_u64TotalBytesPerTile	=	uiMaxTileWidthInCTUs*uiMaxTileHeightInCTUs*BYTES_PER_CTU;
 }
@@ -145,6 +231,29 @@ void ImageParameters::SetTileStruct(u32 uiFrameWidth, u32 uiFrameHeight, u32 uiF
 	}
 }
 
+bit ImageParameters::IsSameTileLayout(TileLayout_t const &sTileLayoutA, TileLayout_t const &sTileLayoutB) const
+{
+	if(sTileLayoutA.bUniform != sTileLayoutB.bUniform)
+		return false;
+	for(u32 i=0;i<m_uiFrameWidthInTiles;i++)
+		if(sTileLayoutA.puiColWidthInCTUs[i] != sTileLayoutB.puiColWidthInCTUs[i])
+			return false;
+	for(u32 i=0;i<m_uiFrameHeightInTiles;i++)
+		if(sTileLayoutA.puiRowHeightInCTUs[i] != sTileLayoutB.puiRowHeightInCTUs[i])
+			return false;
+	return true;
+}
+
+bit ImageParameters::IsSameSliceLayout(SliceLayout_t const &sSliceLayoutA, SliceLayout_t const &sSliceLayoutB) const
+{
+	if(sSliceLayoutA.uiNumSlices != sSliceLayoutB.uiNumSlices)
+		return false;
+	for(u32 i=0;i<sSliceLayoutA.uiNumSlices;i++)
+		if(sSliceLayoutA.puiSliceSizeInUnits[i] != sSliceLayoutB.puiSliceSizeInUnits[i])
+			return false;
+	return true;
+}
+
 void ImageParameters::GetCTUStartPel(u32 uiCTUNum, u32 &uiPelX, u32 &uiPelY) const
 {
 	uiPelX = (uiCTUNum % m_uiFrameWidthInCTUs)*CTU_WIDTH;
@@ -168,4 +277,15 @@ u32 ImageParameters::GetLog2FromCUSize(u32 uiSize)
 		uiLog2Size++;
 	}
 	return uiLog2Size;
-}
\ No newline at end of file
+}
+void ImageParameters::GetMaxTiles(u32 uiFrameWidth, u32 uiFrameHeight, bit bAnyLevel, u32 &uiMaxTileCols, u32 &uiMaxTileRows)
+{
+	u32 uiLevel = GetLevelIdx(uiFrameWidth, uiFrameHeight, bAnyLevel);
+	uiMaxTileCols = max(min(g_sLevelLimits[uiLevel].uiMaxTileCols, uiFrameWidth/(2*CTU_WIDTH)), 1u);
+	uiMaxTileRows = max(min(g_sLevelLimits[uiLevel].uiMaxTileRows, uiFrameHeight/(2*CTU_HEIGHT)), 1u);
+}
+
+u32 ImageParameters::GetMaxSlices(u32 uiFrameWidth, u32 uiFrameHeight, bit bAnyLevel)
+{
+	return g_sLevelLimits[GetLevelIdx(uiFrameWidth, uiFrameHeight, bAnyLevel)].uiMaxSliceSegs;
+}
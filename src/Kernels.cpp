@@ -0,0 +1,996 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file Kernels.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the C kernels and the choice of the kernels from the CPU features.
+*/
+
+#include <Kernels.h>
+#include <H265Transform.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#if ARCH_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+Kernels_t g_sKernels;
+
+static i8 const *g_ppcCPULevelNames[CPU_LEVEL_TOTAL] = {"C", "SSE4.1", "AVX2", "AVX-512"};
+
+#if ARCH_X86
+/**
+*	Execute CPUID.
+*	@param uiLeaf Leaf (EAX).
+*	@param uiSubLeaf Sub-leaf (ECX).
+*	@param puiRegs EAX, EBX, ECX and EDX after the instruction.
+*/
+static void CPUID(u32 uiLeaf, u32 uiSubLeaf, u32 *puiRegs)
+{
+#ifdef _MSC_VER
+	__cpuidex((int *)puiRegs, i32(uiLeaf), i32(uiSubLeaf));
+#else
+	__cpuid_count(uiLeaf, uiSubLeaf, puiRegs[0], puiRegs[1], puiRegs[2], puiRegs[3]);
+#endif
+}
+
+/**
+*	Get the register states which the operating system saves (XCR0).
+*	Only valid if CPUID reports OSXSAVE.
+*/
+static u64 GetXCR0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	u32 uiLow, uiHigh;
+	__asm__ __volatile__("xgetbv" : "=a"(uiLow), "=d"(uiHigh) : "c"(0));
+	return (u64(uiHigh) << 32) | uiLow;
+#endif
+}
+
+/**
+*	Probe the processor.
+*	AVX2 and AVX-512 also need the operating system to save the YMM (and ZMM and mask) registers.
+*/
+static eCPULevel ProbeCPULevel()
+{
+	u32 puiRegs[4];
+	CPUID(0, 0, puiRegs);
+	u32 uiMaxLeaf = puiRegs[0];
+	if(uiMaxLeaf < 1)
+		return CPU_LEVEL_C;
+
+	CPUID(1, 0, puiRegs);
+	if(!(puiRegs[2] & (1u << 19)))	// SSE4.1
+		return CPU_LEVEL_C;
+	bit bOSXSave = (puiRegs[2] & (1u << 27)) != 0;
+	bit bAVX = (puiRegs[2] & (1u << 28)) != 0;
+	u64 u64XCR0 = bOSXSave ? GetXCR0() : 0;
+	if(!bAVX || (u64XCR0 & 0x06) != 0x06 || uiMaxLeaf < 7)
+		return CPU_LEVEL_SSE41;
+
+	CPUID(7, 0, puiRegs);
+	if(!(puiRegs[1] & (1u << 5)))	// AVX2
+		return CPU_LEVEL_SSE41;
+	if(!(puiRegs[1] & (1u << 16)) || !(puiRegs[1] & (1u << 30)) || (u64XCR0 & 0xE6) != 0xE6)	// AVX-512 F and BW
+		return CPU_LEVEL_AVX2;
+	return CPU_LEVEL_AVX512;
+}
+#endif
+
+eCPULevel GetCPULevel()
+{
+	static i32 iCPULevel = -1;	// Racy, but every thread computes the same value
+	if(iCPULevel < 0)
+	{
+#if ARCH_X86
+		iCPULevel = i32(ProbeCPULevel());
+#else
+		iCPULevel = i32(CPU_LEVEL_C);
+#endif
+	}
+	return eCPULevel(iCPULevel);
+}
+
+i8 const *GetCPULevelName(eCPULevel eLevel)
+{
+	return g_ppcCPULevelNames[eLevel < CPU_LEVEL_TOTAL ? eLevel : CPU_LEVEL_C];
+}
+
+bit GetCPULevelFromName(i8 const *pcName, eCPULevel &eLevel)
+{
+	// Compare without case, dots and dashes, so that e.g. "sse41", "SSE4.1" and "avx512" are accepted
+	for(u32 uiLevel=0;uiLevel<CPU_LEVEL_TOTAL;uiLevel++)
+	{
+		i8 const *pcA = pcName, *pcB = g_ppcCPULevelNames[uiLevel];
+		for(;;)
+		{
+			while(*pcA == '.' || *pcA == '-')
+				pcA++;
+			while(*pcB == '.' || *pcB == '-')
+				pcB++;
+			if(tolower(*pcA) != tolower(*pcB) || !*pcA)
+				break;
+			pcA++, pcB++;
+		}
+		if(!*pcA && !*pcB)
+		{
+			eLevel = eCPULevel(uiLevel);
+			return true;
+		}
+	}
+	return false;
+}
+
+void FillKernels(Kernels_t &sKernels, eCPULevel eLevel)
+{
+	InitKernelsC(sKernels);
+#if ARCH_X86
+	if(eLevel >= CPU_LEVEL_SSE41)
+		InitKernelsSSE41(sKernels);
+	if(eLevel >= CPU_LEVEL_AVX2)
+		InitKernelsAVX2(sKernels);
+	if(eLevel >= CPU_LEVEL_AVX512)
+		InitKernelsAVX512(sKernels);
+#endif
+}
+
+eCPULevel InitKernels(eCPULevel eMaxLevel)
+{
+	eCPULevel eLevel = min(GetCPULevel(), eMaxLevel);
+	FillKernels(g_sKernels, eLevel);
+	return eLevel;
+}
+
+/**
+*	SAD of a square block in C.
+*	@param uiSize Width and height of the block.
+*	@see SADFunc_t
+*/
+static inline u32 SADC(u32 uiSize, byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	u32 uiSAD = 0;
+	for(u32 i=0;i<uiSize;i++)
+		for(u32 j=0;j<uiSize;j++)
+			uiSAD += ABS(pbSrc[i*uiSrcStride+j] - pbRef[i*uiRefStride+j]);
+	return uiSAD;
+}
+
+static u32 SAD4x4C(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SADC(4, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+static u32 SAD8x8C(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SADC(8, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+static u32 SAD16x16C(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SADC(16, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+static u32 SAD32x32C(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SADC(32, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+
+/**
+*	Hadamard transform of the differences of a 4x4 or an 8x8 block in C.
+*	@param uiSize Width and height of the block (4 or 8).
+*	@see SATDFunc_t
+*	@return Sum of the absolute transformed differences, halved for 4x4 and divided by 4 for 8x8.
+*/
+static inline u32 HadamardC(u32 uiSize, byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	i32 piBlk[8*8];
+	for(u32 i=0;i<uiSize;i++)
+		for(u32 j=0;j<uiSize;j++)
+			piBlk[i*uiSize+j] = pbSrc[i*uiSrcStride+j] - pbRef[i*uiRefStride+j];
+
+	// Butterflies of the rows and then of the columns
+	for(u32 uiDist=1;uiDist<uiSize;uiDist<<=1)
+		for(u32 i=0;i<uiSize;i++)
+			for(u32 j=0;j<uiSize;j++)
+				if(!(j & uiDist))
+				{
+					i32 iA = piBlk[i*uiSize+j];
+					i32 iB = piBlk[i*uiSize+j+uiDist];
+					piBlk[i*uiSize+j] = iA + iB;
+					piBlk[i*uiSize+j+uiDist] = iA - iB;
+				}
+	for(u32 uiDist=1;uiDist<uiSize;uiDist<<=1)
+		for(u32 i=0;i<uiSize;i++)
+			if(!(i & uiDist))
+				for(u32 j=0;j<uiSize;j++)
+				{
+					i32 iA = piBlk[i*uiSize+j];
+					i32 iB = piBlk[(i+uiDist)*uiSize+j];
+					piBlk[i*uiSize+j] = iA + iB;
+					piBlk[(i+uiDist)*uiSize+j] = iA - iB;
+				}
+
+	u32 uiSum = 0;
+	for(u32 i=0;i<uiSize*uiSize;i++)
+		uiSum += ABS(piBlk[i]);
+	return uiSize == 4 ? (uiSum + 1) >> 1 : (uiSum + 2) >> 2;
+}
+
+/**
+*	SATD of a square block in C.
+*	@param uiSize Width and height of the block.
+*	@see SATDFunc_t
+*/
+static inline u32 SATDC(u32 uiSize, byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	if(uiSize == 4)
+		return HadamardC(4, pbSrc, uiSrcStride, pbRef, uiRefStride);
+
+	u32 uiSATD = 0;
+	for(u32 i=0;i<uiSize;i+=8)
+		for(u32 j=0;j<uiSize;j+=8)
+			uiSATD += HadamardC(8, pbSrc+i*uiSrcStride+j, uiSrcStride, pbRef+i*uiRefStride+j, uiRefStride);
+	return uiSATD;
+}
+
+static u32 SATD4x4C(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SATDC(4, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+static u32 SATD8x8C(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SATDC(8, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+static u32 SATD16x16C(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SATDC(16, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+static u32 SATD32x32C(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SATDC(32, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+
+/**
+*	Angular intra prediction in C.
+*	@param uiSize Width and height of the block.
+*	@see IntraPredAngFunc_t
+*/
+static inline void IntraPredAngC(u32 uiSize, byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose)
+{
+	i32 iDeltaPos = 0;
+	i32 iIdx;
+	i32 iFact;
+	i32 iRefMainIdx;
+
+	for(u32 k=0;k<uiSize;k++)
+	{
+		iDeltaPos += iAngle;
+		iIdx = iDeltaPos >> 5;	// Equation 8-53
+		iFact = iDeltaPos & 0x1F;	// Equation 8-54
+
+		if(iFact)	// We need to filter
+		{
+			for(i32 x=0;x<i32(uiSize);x++)
+			{
+				iRefMainIdx = x+iIdx+1;
+				pbPred[k*uiSize+x] = ( ((32-iFact)*pbMainRef[iRefMainIdx] + iFact*pbMainRef[iRefMainIdx+1] + 16 ) >> 5);
+			}
+		}
+		else
+			for(i32 x=0;x<i32(uiSize);x++)
+				pbPred[k*uiSize+x] = pbMainRef[x+iIdx+1];
+	}
+
+	// Filtering in case of prediction modes equal to HOR or VER
+	if(pbSideRef)
+	{
+		for(u32 x=0;x<uiSize;x++)
+			pbPred[x*uiSize] = Clip1(pbPred[x*uiSize] + ((pbSideRef[x+1] - pbSideRef[0])>>1));
+	}
+
+	if(bTranspose)	// Do the matrix transpose
+	{
+		byte bTmp;
+		for(u32 k=0;k<uiSize-1;k++)
+		{
+			for(u32 x=k+1;x<uiSize;x++)
+			{
+				bTmp = pbPred[k*uiSize+x];
+				pbPred[k*uiSize+x] = pbPred[x*uiSize+k];
+				pbPred[x*uiSize+k] = bTmp;
+			}
+		}
+	}
+}
+
+static void IntraPredAng4x4C(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose){IntraPredAngC(4, pbPred, pbMainRef, pbSideRef, iAngle, bTranspose);}
+static void IntraPredAng8x8C(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose){IntraPredAngC(8, pbPred, pbMainRef, pbSideRef, iAngle, bTranspose);}
+static void IntraPredAng16x16C(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose){IntraPredAngC(16, pbPred, pbMainRef, pbSideRef, iAngle, bTranspose);}
+static void IntraPredAng32x32C(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose){IntraPredAngC(32, pbPred, pbMainRef, pbSideRef, iAngle, bTranspose);}
+
+/**
+*	DC intra prediction in C.
+*	@param uiSize Width and height of the block.
+*	@see IntraPredDCFunc_t
+*/
+static inline void IntraPredDCC(u32 uiSize, byte *pbPred, byte const *pbRef, bit bFilterEdge)
+{
+	byte const *pbTop = pbRef + (uiSize<<1) + 1;
+	byte const *pbLeft = pbRef + (uiSize<<1) - 1;	// The left array starts from the top and goes to the bottom. We must have a negative iterator
+
+	// Get DC value
+	u32 uiTopSum = 0;
+	u32 uiLeftSum = 0;
+	for(i32 i=0;i<i32(uiSize);i++)
+	{
+		uiTopSum += pbTop[i];
+		uiLeftSum += pbLeft[-i];
+	}
+	u32 uiDCVal = (uiTopSum + uiLeftSum + uiSize) / (uiSize<<1);
+
+	// Copy DC values to all locations of the predictor
+	memset(pbPred,uiDCVal,uiSize*uiSize);
+
+	if(bFilterEdge)	// Luma pixels require DC filtering
+	{
+		u32 uiDCValx3 = (uiDCVal<<1)+uiDCVal;	// uiDCVal * 3
+		pbPred[0] = (pbLeft[0] + (uiDCVal<<1) + pbTop[0] + 2) >> 2;
+		for(i32 i=1;i<i32(uiSize);i++)
+		{
+			pbPred[i]			= (pbTop[i] + uiDCValx3 + 2) >> 2;			// Prediction samples [x,0]
+			pbPred[i*uiSize]	= (pbLeft[-i] + uiDCValx3 + 2) >> 2;		// Prediction samples [0,y]
+		}
+	}
+}
+
+static void IntraPredDC4x4C(byte *pbPred, byte const *pbRef, bit bFilterEdge){IntraPredDCC(4, pbPred, pbRef, bFilterEdge);}
+static void IntraPredDC8x8C(byte *pbPred, byte const *pbRef, bit bFilterEdge){IntraPredDCC(8, pbPred, pbRef, bFilterEdge);}
+static void IntraPredDC16x16C(byte *pbPred, byte const *pbRef, bit bFilterEdge){IntraPredDCC(16, pbPred, pbRef, bFilterEdge);}
+static void IntraPredDC32x32C(byte *pbPred, byte const *pbRef, bit bFilterEdge){IntraPredDCC(32, pbPred, pbRef, bFilterEdge);}
+
+/**
+*	Planar intra prediction in C.
+*	@param uiSize Width and height of the block.
+*	@see IntraPredPlanarFunc_t
+*/
+static inline void IntraPredPlanarC(u32 uiSize, byte *pbPred, byte const *pbRef)
+{
+	byte const *pbTop = pbRef + (uiSize<<1) + 1;
+	byte const *pbLeft = pbRef + (uiSize<<1) - 1;	// The left array starts from the top and goes to the bottom. We must have a negative iterator
+
+	byte bTopRightRec = pbTop[uiSize];
+	byte bBottomLeftRec = pbLeft[-i32(uiSize)];
+
+	i32 iTopComp;
+	i32 iLeftComp;
+	u32 uiDiv = LOG2(uiSize-1) + 1;
+	i32 iSize = i32(uiSize);
+
+	for(i32 y=0;y<iSize;y++)
+	{
+		for(i32 x=0;x<iSize;x++)
+		{
+			iTopComp = (iSize-1-y)*pbTop[x] + (y+1)*bBottomLeftRec;
+			iLeftComp = (iSize-1-x)*pbLeft[-y] + (x+1)*bTopRightRec;
+			pbPred[y*iSize+x] = (iTopComp + iLeftComp + iSize) >> uiDiv;
+		}
+	}
+}
+
+static void IntraPredPlanar4x4C(byte *pbPred, byte const *pbRef){IntraPredPlanarC(4, pbPred, pbRef);}
+static void IntraPredPlanar8x8C(byte *pbPred, byte const *pbRef){IntraPredPlanarC(8, pbPred, pbRef);}
+static void IntraPredPlanar16x16C(byte *pbPred, byte const *pbRef){IntraPredPlanarC(16, pbPred, pbRef);}
+static void IntraPredPlanar32x32C(byte *pbPred, byte const *pbRef){IntraPredPlanarC(32, pbPred, pbRef);}
+
+static void RefSamplesC(byte *pbRef, byte *pbFiltered, byte const *pbLeft, u32 uiLeftStride, byte const *pbTopLeft,
+						u32 const *puiRefOffset, u8 bValidFlag, u32 uiSize)
+{
+	u32 uiLast = 4*uiSize;
+	u32 uiFirst = 0;	// First available neighbourhood
+	while(!(bValidFlag & (1 << uiFirst)))
+		uiFirst++;
+
+	// The samples before the first available one take its value (see 8.4.3.1.1 in draft)
+	u32 uiStart = puiRefOffset[uiFirst];
+	byte bSubstitute = uiStart < 2*uiSize ? pbLeft[(2*uiSize-1-uiStart)*uiLeftStride] : pbTopLeft[uiStart-2*uiSize];
+
+	for(u32 n=0;n<5;n++)
+	{
+		bit bAvail = (bValidFlag & (1 << n)) != 0;
+		for(u32 i=puiRefOffset[n];i<puiRefOffset[n+1];i++)
+		{
+			if(bAvail)	// Left samples go upwards, the top ones to the right
+				bSubstitute = i < 2*uiSize ? pbLeft[(2*uiSize-1-i)*uiLeftStride] : pbTopLeft[i-2*uiSize];
+			pbRef[i] = bSubstitute;		// Unavailable samples repeat the last one
+			if(i >= 2)
+				pbFiltered[i-1] = (pbRef[i-2] + (pbRef[i-1] << 1) + pbRef[i] + 2) >> 2;
+		}
+	}
+	pbFiltered[0] = pbRef[0];			// Bottom left pixel
+	pbFiltered[uiLast] = pbRef[uiLast];	// Top right pixel
+}
+
+/**
+*	Forward transforms in C, with the partial butterflies.
+*	@see DCTFunc_t
+*/
+static void DST4C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	// See 8.6.4.2 in draft
+	i32 iRound = 1<<(uiShift-1);
+	i32 c0, c1, c2, c3, c4;
+
+	for(u32 i=0;i<4;i++) 
+	{
+		// Intermediate Variables from 8-276 and 8-277
+		c0 = piSrc[i*uiStride+0] + piSrc[i*uiStride+3];
+		c1 = piSrc[i*uiStride+1] + piSrc[i*uiStride+3];
+		c2 = piSrc[i*uiStride+0] - piSrc[i*uiStride+1];
+		c3 = 74* piSrc[i*uiStride+2];
+		c4 = (piSrc[i*uiStride+0] + piSrc[i*uiStride+1] - piSrc[i*uiStride+3]);
+
+		piDest[0*uiStride+i] =  ( 29 * c0 + 55 * c1 + c3 + iRound ) >> uiShift;
+		piDest[1*uiStride+i] =  ( 74 * c4                + iRound ) >> uiShift;
+		piDest[2*uiStride+i] =  ( 29 * c2 + 55 * c0 - c3 + iRound ) >> uiShift;
+		piDest[3*uiStride+i] =  ( 55 * c2 - 29 * c1 + c3 + iRound ) >> uiShift;
+	}
+}
+
+static void DCT4C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	// See 8.6.4.2 in draft
+	i32 iRound = 1<<(uiShift-1);
+	i32 E0, E1, O0, O1;
+
+	for(u32 i=0;i<uiTrLines;i++) 
+	{
+		// Intermediate even and odd variable
+		E0 = piSrc[i*uiStride+0] + piSrc[i*uiStride+3];
+		O0 = piSrc[i*uiStride+0] - piSrc[i*uiStride+3];
+		E1 = piSrc[i*uiStride+1] + piSrc[i*uiStride+2];
+		O1 = piSrc[i*uiStride+1] - piSrc[i*uiStride+2];
+
+		piDest[0*uiStride+i] =  ( g_piT4[0*4+0]*E0 + g_piT4[0*4+1]*E1 + iRound ) >> uiShift;
+		piDest[2*uiStride+i] =  ( g_piT4[2*4+0]*E0 + g_piT4[2*4+1]*E1 + iRound ) >> uiShift;
+		piDest[1*uiStride+i] =  ( g_piT4[1*4+0]*O0 + g_piT4[1*4+1]*O1 + iRound ) >> uiShift;
+		piDest[3*uiStride+i] =  ( g_piT4[3*4+0]*O0 + g_piT4[3*4+1]*O1 + iRound ) >> uiShift;
+	}
+}
+
+static void DCT8C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	i32 iRound = 1<<(uiShift-1);
+	i32 E[4], O[4];
+	i32 EE[2], EO[2];
+	for(u32 i=0; i<uiTrLines; i++) 
+	{
+		/* E and O */
+		E[0] = piSrc[i*uiStride+0] + piSrc[i*uiStride+7];
+		O[0] = piSrc[i*uiStride+0] - piSrc[i*uiStride+7];
+		E[1] = piSrc[i*uiStride+1] + piSrc[i*uiStride+6];
+		O[1] = piSrc[i*uiStride+1] - piSrc[i*uiStride+6];
+		E[2] = piSrc[i*uiStride+2] + piSrc[i*uiStride+5];
+		O[2] = piSrc[i*uiStride+2] - piSrc[i*uiStride+5];
+		E[3] = piSrc[i*uiStride+3] + piSrc[i*uiStride+4];
+		O[3] = piSrc[i*uiStride+3] - piSrc[i*uiStride+4];
+
+		/* EE and EO */
+		EE[0] = E[0] + E[3];
+		EO[0] = E[0] - E[3];
+		EE[1] = E[1] + E[2];
+		EO[1] = E[1] - E[2];
+
+		piDest[0*uiStride+i] = (g_piT8[0*8+0]*EE[0] + g_piT8[0*8+1]*EE[1] + iRound) >> uiShift;
+		piDest[4*uiStride+i] = (g_piT8[4*8+0]*EE[0] + g_piT8[4*8+1]*EE[1] + iRound) >> uiShift;
+		piDest[2*uiStride+i] = (g_piT8[2*8+0]*EO[0] + g_piT8[2*8+1]*EO[1] + iRound) >> uiShift;
+		piDest[6*uiStride+i] = (g_piT8[6*8+0]*EO[0] + g_piT8[6*8+1]*EO[1] + iRound) >> uiShift;
+
+		piDest[1*uiStride+i] = (g_piT8[1*8+0]*O[0] + g_piT8[1*8+1]*O[1] + g_piT8[1*8+2]*O[2] + g_piT8[1*8+3]*O[3] + iRound) >> uiShift;
+		piDest[3*uiStride+i] = (g_piT8[3*8+0]*O[0] + g_piT8[3*8+1]*O[1] + g_piT8[3*8+2]*O[2] + g_piT8[3*8+3]*O[3] + iRound) >> uiShift;
+		piDest[5*uiStride+i] = (g_piT8[5*8+0]*O[0] + g_piT8[5*8+1]*O[1] + g_piT8[5*8+2]*O[2] + g_piT8[5*8+3]*O[3] + iRound) >> uiShift;
+		piDest[7*uiStride+i] = (g_piT8[7*8+0]*O[0] + g_piT8[7*8+1]*O[1] + g_piT8[7*8+2]*O[2] + g_piT8[7*8+3]*O[3] + iRound) >> uiShift;
+	}
+}
+
+static void DCT16C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+
+	i32 iRound = 1<<(uiShift-1);
+	i32 E[8],O[8];
+	i32 EE[4],EO[4];
+	i32 EEE[2],EEO[2];
+
+	for(u32 i=0;i<uiTrLines;i++) 
+	{
+		/* Even and Odd */
+		E[0] = piSrc[i*uiStride+0] + piSrc[i*uiStride+15];
+		O[0] = piSrc[i*uiStride+0] - piSrc[i*uiStride+15];
+		E[1] = piSrc[i*uiStride+1] + piSrc[i*uiStride+14];
+		O[1] = piSrc[i*uiStride+1] - piSrc[i*uiStride+14];
+		E[2] = piSrc[i*uiStride+2] + piSrc[i*uiStride+13];
+		O[2] = piSrc[i*uiStride+2] - piSrc[i*uiStride+13];
+		E[3] = piSrc[i*uiStride+3] + piSrc[i*uiStride+12];
+		O[3] = piSrc[i*uiStride+3] - piSrc[i*uiStride+12];
+		E[4] = piSrc[i*uiStride+4] + piSrc[i*uiStride+11];
+		O[4] = piSrc[i*uiStride+4] - piSrc[i*uiStride+11];
+		E[5] = piSrc[i*uiStride+5] + piSrc[i*uiStride+10];
+		O[5] = piSrc[i*uiStride+5] - piSrc[i*uiStride+10];
+		E[6] = piSrc[i*uiStride+6] + piSrc[i*uiStride+ 9];
+		O[6] = piSrc[i*uiStride+6] - piSrc[i*uiStride+ 9];
+		E[7] = piSrc[i*uiStride+7] + piSrc[i*uiStride+ 8];
+		O[7] = piSrc[i*uiStride+7] - piSrc[i*uiStride+ 8];
+
+		/* EE and EO */
+		EE[0] = E[0] + E[7];
+		EO[0] = E[0] - E[7];
+		EE[1] = E[1] + E[6];
+		EO[1] = E[1] - E[6];
+		EE[2] = E[2] + E[5];
+		EO[2] = E[2] - E[5];
+		EE[3] = E[3] + E[4];
+		EO[3] = E[3] - E[4];
+
+		/* EEE and EEO */
+		EEE[0] = EE[0] + EE[3];
+		EEO[0] = EE[0] - EE[3];
+		EEE[1] = EE[1] + EE[2];
+		EEO[1] = EE[1] - EE[2];
+
+		piDest[ 0*uiStride+i] = (g_piT16[ 0*16+0]*EEE[0] + g_piT16[ 0*16+1]*EEE[1] + iRound) >> uiShift;
+		piDest[ 8*uiStride+i] = (g_piT16[ 8*16+0]*EEE[0] + g_piT16[ 8*16+1]*EEE[1] + iRound) >> uiShift;
+		piDest[ 4*uiStride+i] = (g_piT16[ 4*16+0]*EEO[0] + g_piT16[ 4*16+1]*EEO[1] + iRound) >> uiShift;
+		piDest[12*uiStride+i] = (g_piT16[12*16+0]*EEO[0] + g_piT16[12*16+1]*EEO[1] + iRound) >> uiShift;
+
+		piDest[ 2*uiStride+i] = (g_piT16[ 2*16+0]*EO[0] + g_piT16[ 2*16+1]*EO[1] + g_piT16[ 2*16+2]*EO[2] + g_piT16[ 2*16+3]*EO[3] + iRound) >> uiShift;
+		piDest[ 6*uiStride+i] = (g_piT16[ 6*16+0]*EO[0] + g_piT16[ 6*16+1]*EO[1] + g_piT16[ 6*16+2]*EO[2] + g_piT16[ 6*16+3]*EO[3] + iRound) >> uiShift;
+		piDest[10*uiStride+i] = (g_piT16[10*16+0]*EO[0] + g_piT16[10*16+1]*EO[1] + g_piT16[10*16+2]*EO[2] + g_piT16[10*16+3]*EO[3] + iRound) >> uiShift;
+		piDest[14*uiStride+i] = (g_piT16[14*16+0]*EO[0] + g_piT16[14*16+1]*EO[1] + g_piT16[14*16+2]*EO[2] + g_piT16[14*16+3]*EO[3] + iRound) >> uiShift;
+
+		piDest[ 1*uiStride+i] = (g_piT16[ 1*16+0]*O[0] + g_piT16[ 1*16+1]*O[1] + g_piT16[ 1*16+2]*O[2] + g_piT16[ 1*16+3]*O[3] +
+							  g_piT16[ 1*16+4]*O[4] + g_piT16[ 1*16+5]*O[5] + g_piT16[ 1*16+6]*O[6] + g_piT16[ 1*16+7]*O[7] + iRound) >> uiShift;
+		piDest[ 3*uiStride+i] = (g_piT16[ 3*16+0]*O[0] + g_piT16[ 3*16+1]*O[1] + g_piT16[ 3*16+2]*O[2] + g_piT16[ 3*16+3]*O[3] +
+							  g_piT16[ 3*16+4]*O[4] + g_piT16[ 3*16+5]*O[5] + g_piT16[ 3*16+6]*O[6] + g_piT16[ 3*16+7]*O[7] + iRound) >> uiShift;
+		piDest[ 5*uiStride+i] = (g_piT16[ 5*16+0]*O[0] + g_piT16[ 5*16+1]*O[1] + g_piT16[ 5*16+2]*O[2] + g_piT16[ 5*16+3]*O[3] +
+							  g_piT16[ 5*16+4]*O[4] + g_piT16[ 5*16+5]*O[5] + g_piT16[ 5*16+6]*O[6] + g_piT16[ 5*16+7]*O[7] + iRound) >> uiShift;
+		piDest[ 7*uiStride+i] = (g_piT16[ 7*16+0]*O[0] + g_piT16[ 7*16+1]*O[1] + g_piT16[ 7*16+2]*O[2] + g_piT16[ 7*16+3]*O[3] +
+							  g_piT16[ 7*16+4]*O[4] + g_piT16[ 7*16+5]*O[5] + g_piT16[ 7*16+6]*O[6] + g_piT16[ 7*16+7]*O[7] + iRound) >> uiShift;
+		piDest[ 9*uiStride+i] = (g_piT16[ 9*16+0]*O[0] + g_piT16[ 9*16+1]*O[1] + g_piT16[ 9*16+2]*O[2] + g_piT16[ 9*16+3]*O[3] +
+							  g_piT16[ 9*16+4]*O[4] + g_piT16[ 9*16+5]*O[5] + g_piT16[ 9*16+6]*O[6] + g_piT16[ 9*16+7]*O[7] + iRound) >> uiShift;
+		piDest[11*uiStride+i] = (g_piT16[11*16+0]*O[0] + g_piT16[11*16+1]*O[1] + g_piT16[11*16+2]*O[2] + g_piT16[11*16+3]*O[3] +
+							  g_piT16[11*16+4]*O[4] + g_piT16[11*16+5]*O[5] + g_piT16[11*16+6]*O[6] + g_piT16[11*16+7]*O[7] + iRound) >> uiShift;
+		piDest[13*uiStride+i] = (g_piT16[13*16+0]*O[0] + g_piT16[13*16+1]*O[1] + g_piT16[13*16+2]*O[2] + g_piT16[13*16+3]*O[3] +
+							  g_piT16[13*16+4]*O[4] + g_piT16[13*16+5]*O[5] + g_piT16[13*16+6]*O[6] + g_piT16[13*16+7]*O[7] + iRound) >> uiShift;
+		piDest[15*uiStride+i] = (g_piT16[15*16+0]*O[0] + g_piT16[15*16+1]*O[1] + g_piT16[15*16+2]*O[2] + g_piT16[15*16+3]*O[3] +
+							  g_piT16[15*16+4]*O[4] + g_piT16[15*16+5]*O[5] + g_piT16[15*16+6]*O[6] + g_piT16[15*16+7]*O[7] + iRound) >> uiShift;
+	}
+
+}
+
+static void DCT32C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	i32 E[16],O[16];
+	i32 EE[8],EO[8];
+	i32 EEE[4],EEO[4];
+	i32 EEEE[2],EEEO[2];
+	i32 iRound = 1<<(uiShift-1);
+
+	for(u32 i=0;i<uiTrLines;i++) 
+	{
+		/* E and O */
+		for(u32 k=0; k<16; k++ ) 
+		{
+			E[k] = piSrc[i*uiStride+k] + piSrc[i*uiStride+31-k];
+			O[k] = piSrc[i*uiStride+k] - piSrc[i*uiStride+31-k];
+		}
+		/* EE and EO */
+		for(u32 k=0; k<8; k++ ) 
+		{
+			EE[k] = E[k] + E[15-k];
+			EO[k] = E[k] - E[15-k];
+		}
+		/* EEE and EEO */
+		for(u32 k=0; k<4; k++ ) 
+		{
+			EEE[k] = EE[k] + EE[7-k];
+			EEO[k] = EE[k] - EE[7-k];
+		}
+		/* EEEE and EEEO */
+		EEEE[0] = EEE[0] + EEE[3];
+		EEEO[0] = EEE[0] - EEE[3];
+		EEEE[1] = EEE[1] + EEE[2];
+		EEEO[1] = EEE[1] - EEE[2];
+
+		// 0, 8, 16, 24
+		piDest[ 0*uiStride+i] = (g_piT32[ 0*32+0]*EEEE[0] + g_piT32[ 0*32+1]*EEEE[1] + iRound) >> uiShift;
+		piDest[16*uiStride+i] = (g_piT32[16*32+0]*EEEE[0] + g_piT32[16*32+1]*EEEE[1] + iRound) >> uiShift;
+		piDest[ 8*uiStride+i] = (g_piT32[ 8*32+0]*EEEO[0] + g_piT32[ 8*32+1]*EEEO[1] + iRound) >> uiShift;
+		piDest[24*uiStride+i] = (g_piT32[24*32+0]*EEEO[0] + g_piT32[24*32+1]*EEEO[1] + iRound) >> uiShift;
+
+		// 4, 12, 20, 28
+		for(u32 k=4; k<32; k+=8 ) 
+			piDest[k*uiStride+i] = (g_piT32[k*32+0]*EEO[0] + g_piT32[k*32+1]*EEO[1] + g_piT32[k*32+2]*EEO[2] + g_piT32[k*32+3]*EEO[3] + iRound) >> uiShift;
+
+		// 2, 6, 10, 14, 18, 22, 26, 30
+		for(u32 k=2; k<32; k+=4 ) 
+			piDest[k*uiStride+i] = (g_piT32[k*32+0]*EO[0] + g_piT32[k*32+1]*EO[1] + g_piT32[k*32+2]*EO[2] + g_piT32[k*32+3]*EO[3] +
+								 g_piT32[k*32+4]*EO[4] + g_piT32[k*32+5]*EO[5] + g_piT32[k*32+6]*EO[6] + g_piT32[k*32+7]*EO[7] + iRound) >> uiShift;
+
+		// 1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31
+		for(u32 k=1; k<32; k+=2 ) 
+			piDest[k*uiStride+i]=(g_piT32[k*32+ 0]*O[ 0] + g_piT32[k*32+ 1]*O[ 1] + g_piT32[k*32+ 2]*O[ 2] + g_piT32[k*32+ 3]*O[ 3] +
+								 g_piT32[k*32+ 4]*O[ 4] + g_piT32[k*32+ 5]*O[ 5] + g_piT32[k*32+ 6]*O[ 6] + g_piT32[k*32+ 7]*O[ 7] +
+								 g_piT32[k*32+ 8]*O[ 8] + g_piT32[k*32+ 9]*O[ 9] + g_piT32[k*32+10]*O[10] + g_piT32[k*32+11]*O[11] +
+								 g_piT32[k*32+12]*O[12] + g_piT32[k*32+13]*O[13] + g_piT32[k*32+14]*O[14] + g_piT32[k*32+15]*O[15] + iRound) >> uiShift;
+	}
+}
+
+/**
+*	Inverse transforms in C, with the partial butterflies.
+*	The results are saturated to 16 bits, like the intermediate values of 8.6.4.2.
+*	@see IDCTFunc_t
+*/
+static void IDST4C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	i32 iRound = 1 << (uiShift-1);
+	i32 c0, c1, c2, c3, c4;
+
+	for(u32 i=0; i<4; i++ ) 
+	{
+		// Intermediate Variables
+		c0 = piSrc[0*uiStride+i] + piSrc[2*uiStride+i];
+		c1 = piSrc[2*uiStride+i] + piSrc[3*uiStride+i];
+		c2 = piSrc[0*uiStride+i] - piSrc[3*uiStride+i];
+		c3 = 74* piSrc[1*uiStride+i];
+		c4 = piSrc[0*uiStride+i] - piSrc[2*uiStride+i] + piSrc[3*uiStride+i];
+
+		piDest[i*uiStride+0] = Clip3(-32768, 32767, ( 29 * c0 + 55 * c1 + c3 + iRound ) >> uiShift);
+		piDest[i*uiStride+1] = Clip3(-32768, 32767, ( 55 * c2 - 29 * c1 + c3 + iRound ) >> uiShift);
+		piDest[i*uiStride+2] = Clip3(-32768, 32767, ( 74 * c4                + iRound ) >> uiShift);
+		piDest[i*uiStride+3] = Clip3(-32768, 32767, ( 55 * c0 + 29 * c2 - c3 + iRound ) >> uiShift);
+	}
+}
+
+static void IDCT4C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	i32 iRound = 1<<(uiShift-1);
+	i32 O0, O1, E0, E1;
+
+	for(u32 i=0; i<uiTrLines; i++) 
+	{
+		/* Utilizing symmetry properties to the maximum to minimize the number of multiplications */
+		O0 = g_piT4[1*4+0]*piSrc[1*uiStride+i] + g_piT4[3*4+0]*piSrc[3*uiStride+i];
+		O1 = g_piT4[1*4+1]*piSrc[1*uiStride+i] + g_piT4[3*4+1]*piSrc[3*uiStride+i];
+		E0 = g_piT4[0*4+0]*piSrc[0*uiStride+i] + g_piT4[2*4+0]*piSrc[2*uiStride+i];
+		E1 = g_piT4[0*4+1]*piSrc[0*uiStride+i] + g_piT4[2*4+1]*piSrc[2*uiStride+i];
+
+		/* Combining even and odd terms at each hierarchy levels to calculate the final spatial domain vector */
+		piDest[i*uiStride+0] = Clip3(-32768, 32767, (E0 + O0 + iRound) >> uiShift);
+		piDest[i*uiStride+1] = Clip3(-32768, 32767, (E1 + O1 + iRound) >> uiShift);
+		piDest[i*uiStride+2] = Clip3(-32768, 32767, (E1 - O1 + iRound) >> uiShift);
+		piDest[i*uiStride+3] = Clip3(-32768, 32767, (E0 - O0 + iRound) >> uiShift);
+
+	}
+}
+
+static void IDCT8C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	i32 iRound = 1<<(uiShift-1);
+	i32 O[4], E[4];
+	i32 EO[2], EE[2];
+
+	for(u32 i=0; i<uiTrLines; i++) 
+	{
+		/* Utilizing symmetry properties to the maximum to minimize the number of multiplications */
+		O[0] = g_piT8[1*8+0]*piSrc[1*uiStride+i] + g_piT8[3*8+0]*piSrc[3*uiStride+i] + g_piT8[5*8+0]*piSrc[5*uiStride+i] + g_piT8[7*8+0]*piSrc[7*uiStride+i];
+		O[1] = g_piT8[1*8+1]*piSrc[1*uiStride+i] + g_piT8[3*8+1]*piSrc[3*uiStride+i] + g_piT8[5*8+1]*piSrc[5*uiStride+i] + g_piT8[7*8+1]*piSrc[7*uiStride+i];
+		O[2] = g_piT8[1*8+2]*piSrc[1*uiStride+i] + g_piT8[3*8+2]*piSrc[3*uiStride+i] + g_piT8[5*8+2]*piSrc[5*uiStride+i] + g_piT8[7*8+2]*piSrc[7*uiStride+i];
+		O[3] = g_piT8[1*8+3]*piSrc[1*uiStride+i] + g_piT8[3*8+3]*piSrc[3*uiStride+i] + g_piT8[5*8+3]*piSrc[5*uiStride+i] + g_piT8[7*8+3]*piSrc[7*uiStride+i];
+
+		EO[0] = g_piT8[2*8+0]*piSrc[2*uiStride+i] + g_piT8[6*8+0]*piSrc[6*uiStride+i];
+		EO[1] = g_piT8[2*8+1]*piSrc[2*uiStride+i] + g_piT8[6*8+1]*piSrc[6*uiStride+i];
+		EE[0] = g_piT8[0*8+0]*piSrc[0*uiStride+i] + g_piT8[4*8+0]*piSrc[4*uiStride+i];
+		EE[1] = g_piT8[0*8+1]*piSrc[0*uiStride+i] + g_piT8[4*8+1]*piSrc[4*uiStride+i];
+
+		/* Combining even and odd terms at each hierarchy levels to calculate the final spatial domain vector */
+		E[0] = EE[0] + EO[0];
+		E[3] = EE[0] - EO[0];
+		E[1] = EE[1] + EO[1];
+		E[2] = EE[1] - EO[1];
+
+		piDest[i*uiStride+0] = Clip3(-32768, 32767, (E[0] + O[0] + iRound) >> uiShift);
+		piDest[i*uiStride+1] = Clip3(-32768, 32767, (E[1] + O[1] + iRound) >> uiShift);
+		piDest[i*uiStride+2] = Clip3(-32768, 32767, (E[2] + O[2] + iRound) >> uiShift);
+		piDest[i*uiStride+3] = Clip3(-32768, 32767, (E[3] + O[3] + iRound) >> uiShift);
+		piDest[i*uiStride+4] = Clip3(-32768, 32767, (E[3] - O[3] + iRound) >> uiShift);
+		piDest[i*uiStride+5] = Clip3(-32768, 32767, (E[2] - O[2] + iRound) >> uiShift);
+		piDest[i*uiStride+6] = Clip3(-32768, 32767, (E[1] - O[1] + iRound) >> uiShift);
+		piDest[i*uiStride+7] = Clip3(-32768, 32767, (E[0] - O[0] + iRound) >> uiShift);
+	}
+}
+
+static void IDCT16C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	i32 rnd = 1<<(uiShift-1);
+	i32 O[8], E[8];
+	i32 EO[4], EE[4];
+	i32 EEO[2], EEE[2];
+
+	for(u32 i=0; i<uiTrLines; i++) 
+	{
+		/* Utilizing symmetry properties to the maximum to minimize the number of multiplications */
+		O[0] =   g_piT16[ 1*16+0]*piSrc[ 1*uiStride+i] + g_piT16[ 3*16+0]*piSrc[ 3*uiStride+i] + g_piT16[ 5*16+0]*piSrc[ 5*uiStride+i] + g_piT16[ 7*16+0]*piSrc[ 7*uiStride+i]
+		   + g_piT16[ 9*16+0]*piSrc[ 9*uiStride+i] + g_piT16[11*16+0]*piSrc[11*uiStride+i] + g_piT16[13*16+0]*piSrc[13*uiStride+i] + g_piT16[15*16+0]*piSrc[15*uiStride+i];
+		O[1] =   g_piT16[ 1*16+1]*piSrc[ 1*uiStride+i] + g_piT16[ 3*16+1]*piSrc[ 3*uiStride+i] + g_piT16[ 5*16+1]*piSrc[ 5*uiStride+i] + g_piT16[ 7*16+1]*piSrc[ 7*uiStride+i]
+		   + g_piT16[ 9*16+1]*piSrc[ 9*uiStride+i] + g_piT16[11*16+1]*piSrc[11*uiStride+i] + g_piT16[13*16+1]*piSrc[13*uiStride+i] + g_piT16[15*16+1]*piSrc[15*uiStride+i];
+		O[2] =   g_piT16[ 1*16+2]*piSrc[ 1*uiStride+i] + g_piT16[ 3*16+2]*piSrc[ 3*uiStride+i] + g_piT16[ 5*16+2]*piSrc[ 5*uiStride+i] + g_piT16[ 7*16+2]*piSrc[ 7*uiStride+i]
+		   + g_piT16[ 9*16+2]*piSrc[ 9*uiStride+i] + g_piT16[11*16+2]*piSrc[11*uiStride+i] + g_piT16[13*16+2]*piSrc[13*uiStride+i] + g_piT16[15*16+2]*piSrc[15*uiStride+i];
+		O[3] =   g_piT16[ 1*16+3]*piSrc[ 1*uiStride+i] + g_piT16[ 3*16+3]*piSrc[ 3*uiStride+i] + g_piT16[ 5*16+3]*piSrc[ 5*uiStride+i] + g_piT16[ 7*16+3]*piSrc[ 7*uiStride+i]
+		  + g_piT16[ 9*16+3]*piSrc[ 9*uiStride+i] + g_piT16[11*16+3]*piSrc[11*uiStride+i] + g_piT16[13*16+3]*piSrc[13*uiStride+i] + g_piT16[15*16+3]*piSrc[15*uiStride+i];
+		O[4] =   g_piT16[ 1*16+4]*piSrc[ 1*uiStride+i] + g_piT16[ 3*16+4]*piSrc[ 3*uiStride+i] + g_piT16[ 5*16+4]*piSrc[ 5*uiStride+i] + g_piT16[ 7*16+4]*piSrc[ 7*uiStride+i]
+		  + g_piT16[ 9*16+4]*piSrc[ 9*uiStride+i] + g_piT16[11*16+4]*piSrc[11*uiStride+i] + g_piT16[13*16+4]*piSrc[13*uiStride+i] + g_piT16[15*16+4]*piSrc[15*uiStride+i];
+		O[5] =   g_piT16[ 1*16+5]*piSrc[ 1*uiStride+i] + g_piT16[ 3*16+5]*piSrc[ 3*uiStride+i] + g_piT16[ 5*16+5]*piSrc[ 5*uiStride+i] + g_piT16[ 7*16+5]*piSrc[ 7*uiStride+i]
+		  + g_piT16[ 9*16+5]*piSrc[ 9*uiStride+i] + g_piT16[11*16+5]*piSrc[11*uiStride+i] + g_piT16[13*16+5]*piSrc[13*uiStride+i] + g_piT16[15*16+5]*piSrc[15*uiStride+i];
+		O[6] =   g_piT16[ 1*16+6]*piSrc[ 1*uiStride+i] + g_piT16[ 3*16+6]*piSrc[ 3*uiStride+i] + g_piT16[ 5*16+6]*piSrc[ 5*uiStride+i] + g_piT16[ 7*16+6]*piSrc[ 7*uiStride+i]
+		  + g_piT16[ 9*16+6]*piSrc[ 9*uiStride+i] + g_piT16[11*16+6]*piSrc[11*uiStride+i] + g_piT16[13*16+6]*piSrc[13*uiStride+i] + g_piT16[15*16+6]*piSrc[15*uiStride+i];
+		O[7] =   g_piT16[ 1*16+7]*piSrc[ 1*uiStride+i] + g_piT16[ 3*16+7]*piSrc[ 3*uiStride+i] + g_piT16[ 5*16+7]*piSrc[ 5*uiStride+i] + g_piT16[ 7*16+7]*piSrc[ 7*uiStride+i]
+		   + g_piT16[ 9*16+7]*piSrc[ 9*uiStride+i] + g_piT16[11*16+7]*piSrc[11*uiStride+i] + g_piT16[13*16+7]*piSrc[13*uiStride+i] + g_piT16[15*16+7]*piSrc[15*uiStride+i];
+
+		EO[0] = g_piT16[ 2*16+0]*piSrc[ 2*uiStride+i] + g_piT16[ 6*16+0]*piSrc[ 6*uiStride+i] + g_piT16[10*16+0]*piSrc[10*uiStride+i] + g_piT16[14*16+0]*piSrc[14*uiStride+i];
+		EO[1] = g_piT16[ 2*16+1]*piSrc[ 2*uiStride+i] + g_piT16[ 6*16+1]*piSrc[ 6*uiStride+i] + g_piT16[10*16+1]*piSrc[10*uiStride+i] + g_piT16[14*16+1]*piSrc[14*uiStride+i];
+		EO[2] = g_piT16[ 2*16+2]*piSrc[ 2*uiStride+i] + g_piT16[ 6*16+2]*piSrc[ 6*uiStride+i] + g_piT16[10*16+2]*piSrc[10*uiStride+i] + g_piT16[14*16+2]*piSrc[14*uiStride+i];
+		EO[3] = g_piT16[ 2*16+3]*piSrc[ 2*uiStride+i] + g_piT16[ 6*16+3]*piSrc[ 6*uiStride+i] + g_piT16[10*16+3]*piSrc[10*uiStride+i] + g_piT16[14*16+3]*piSrc[14*uiStride+i];
+
+		EEO[0] = g_piT16[4*16+0]*piSrc[4*uiStride+i] + g_piT16[12*16+0]*piSrc[12*uiStride+i];
+		EEO[1] = g_piT16[4*16+1]*piSrc[4*uiStride+i] + g_piT16[12*16+1]*piSrc[12*uiStride+i];
+		EEE[0] = g_piT16[0*16+0]*piSrc[0*uiStride+i] + g_piT16[ 8*16+0]*piSrc[ 8*uiStride+i];
+		EEE[1] = g_piT16[0*16+1]*piSrc[0*uiStride+i] + g_piT16[ 8*16+1]*piSrc[ 8*uiStride+i];
+
+		/* Combining even and odd terms at each hierarchy levels to calculate the final spatial domain vector */
+		EE[0] = EEE[0] + EEO[0];
+		EE[3] = EEE[0] - EEO[0];
+		EE[1] = EEE[1] + EEO[1];
+		EE[2] = EEE[1] - EEO[1];
+
+		E[0] = EE[0] + EO[0];
+		E[7] = EE[0] - EO[0];
+		E[1] = EE[1] + EO[1];
+		E[6] = EE[1] - EO[1];
+		E[2] = EE[2] + EO[2];
+		E[5] = EE[2] - EO[2];
+		E[3] = EE[3] + EO[3];
+		E[4] = EE[3] - EO[3];
+
+		piDest[i*uiStride+ 0] = Clip3(-32768, 32767, (E[0] + O[0] + rnd) >> uiShift);
+		piDest[i*uiStride+15] = Clip3(-32768, 32767, (E[0] - O[0] + rnd) >> uiShift);
+		piDest[i*uiStride+ 1] = Clip3(-32768, 32767, (E[1] + O[1] + rnd) >> uiShift);
+		piDest[i*uiStride+14] = Clip3(-32768, 32767, (E[1] - O[1] + rnd) >> uiShift);
+		piDest[i*uiStride+ 2] = Clip3(-32768, 32767, (E[2] + O[2] + rnd) >> uiShift);
+		piDest[i*uiStride+13] = Clip3(-32768, 32767, (E[2] - O[2] + rnd) >> uiShift);
+		piDest[i*uiStride+ 3] = Clip3(-32768, 32767, (E[3] + O[3] + rnd) >> uiShift);
+		piDest[i*uiStride+12] = Clip3(-32768, 32767, (E[3] - O[3] + rnd) >> uiShift);
+		piDest[i*uiStride+ 4] = Clip3(-32768, 32767, (E[4] + O[4] + rnd) >> uiShift);
+		piDest[i*uiStride+11] = Clip3(-32768, 32767, (E[4] - O[4] + rnd) >> uiShift);
+		piDest[i*uiStride+ 5] = Clip3(-32768, 32767, (E[5] + O[5] + rnd) >> uiShift);
+		piDest[i*uiStride+10] = Clip3(-32768, 32767, (E[5] - O[5] + rnd) >> uiShift);
+		piDest[i*uiStride+ 6] = Clip3(-32768, 32767, (E[6] + O[6] + rnd) >> uiShift);
+		piDest[i*uiStride+ 9] = Clip3(-32768, 32767, (E[6] - O[6] + rnd) >> uiShift);
+		piDest[i*uiStride+ 7] = Clip3(-32768, 32767, (E[7] + O[7] + rnd) >> uiShift);
+		piDest[i*uiStride+ 8] = Clip3(-32768, 32767, (E[7] - O[7] + rnd) >> uiShift);
+
+	}
+}
+
+static void IDCT32C(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	i32 E[16],O[16];
+	i32 EE[8],EO[8];
+	i32 EEE[4],EEO[4];
+	i32 EEEE[2],EEEO[2];
+	int rnd = 1<<(uiShift-1);
+
+	for(u32 i=0; i<32; i++ ) 
+	{
+		/* Utilizing symmetry properties to the maximum to minimize the number of multiplications */
+		for(u32 k=0; k<16; k++ ) 
+		{
+			O[k] =   g_piT32[ 1*32+k]*piSrc[ 1*uiStride+i] + g_piT32[ 3*32+k]*piSrc[ 3*uiStride+i]
+				   + g_piT32[ 5*32+k]*piSrc[ 5*uiStride+i] + g_piT32[ 7*32+k]*piSrc[ 7*uiStride+i]
+				   + g_piT32[ 9*32+k]*piSrc[ 9*uiStride+i] + g_piT32[11*32+k]*piSrc[11*uiStride+i]
+				   + g_piT32[13*32+k]*piSrc[13*uiStride+i] + g_piT32[15*32+k]*piSrc[15*uiStride+i]
+				   + g_piT32[17*32+k]*piSrc[17*uiStride+i] + g_piT32[19*32+k]*piSrc[19*uiStride+i]
+				   + g_piT32[21*32+k]*piSrc[21*uiStride+i] + g_piT32[23*32+k]*piSrc[23*uiStride+i]
+				   + g_piT32[25*32+k]*piSrc[25*uiStride+i] + g_piT32[27*32+k]*piSrc[27*uiStride+i]
+				   + g_piT32[29*32+k]*piSrc[29*uiStride+i] + g_piT32[31*32+k]*piSrc[31*uiStride+i];
+		}
+
+		for(u32 k=0; k<8; k++ ) 
+		{
+			EO[k] =   g_piT32[ 2*32+k]*piSrc[ 2*uiStride+i] + g_piT32[ 6*32+k]*piSrc[ 6*uiStride+i]
+					+ g_piT32[10*32+k]*piSrc[10*uiStride+i] + g_piT32[14*32+k]*piSrc[14*uiStride+i]
+					+ g_piT32[18*32+k]*piSrc[18*uiStride+i] + g_piT32[22*32+k]*piSrc[22*uiStride+i]
+					+ g_piT32[26*32+k]*piSrc[26*uiStride+i] + g_piT32[30*32+k]*piSrc[30*uiStride+i];
+		}
+
+		for(u32 k=0; k<4; k++ ) 
+		{
+			EEO[k] =   g_piT32[ 4*32+k]*piSrc[ 4*uiStride+i] + g_piT32[12*32+k]*piSrc[12*uiStride+i]
+					 + g_piT32[20*32+k]*piSrc[20*uiStride+i] + g_piT32[28*32+k]*piSrc[28*uiStride+i];
+		}
+		EEEO[0] = g_piT32[8*32+0]*piSrc[8*uiStride+i] + g_piT32[24*32+0]*piSrc[24*uiStride+i];
+		EEEO[1] = g_piT32[8*32+1]*piSrc[8*uiStride+i] + g_piT32[24*32+1]*piSrc[24*uiStride+i];
+		EEEE[0] = g_piT32[0*32+0]*piSrc[0*uiStride+i] + g_piT32[16*32+0]*piSrc[16*uiStride+i];
+		EEEE[1] = g_piT32[0*32+1]*piSrc[0*uiStride+i] + g_piT32[16*32+1]*piSrc[16*uiStride+i];
+
+		/* Combining even and odd terms at each hierarchy levels to calculate the final spatial domain vector */
+		EEE[0] = EEEE[0] + EEEO[0];
+		EEE[3] = EEEE[0] - EEEO[0];
+		EEE[1] = EEEE[1] + EEEO[1];
+		EEE[2] = EEEE[1] - EEEO[1];
+
+		EE[0] = EEE[0] + EEO[0];
+		EE[7] = EEE[0] - EEO[0];
+		EE[1] = EEE[1] + EEO[1];
+		EE[6] = EEE[1] - EEO[1];
+		EE[5] = EEE[2] - EEO[2];
+		EE[2] = EEE[2] + EEO[2];
+		EE[3] = EEE[3] + EEO[3];
+		EE[4] = EEE[3] - EEO[3];
+
+		for(u32 k=0; k<8; k++ ) 
+		{
+			E[k  ] = EE[k  ] + EO[k  ];
+			E[k+8] = EE[7-k] - EO[7-k];
+		}
+
+		for(u32 k=0; k<16; k++ ) 
+		{
+			piDest[i*uiStride+k   ] = Clip3(-32768, 32767, (E[k   ] + O[k   ] + rnd) >> uiShift);
+			piDest[i*uiStride+k+16] = Clip3(-32768, 32767, (E[15-k] - O[15-k] + rnd) >> uiShift);
+		}
+	}
+}
+
+/**
+*	Second stage of the inverse transform in C, with the reconstruction.
+*	@param uiSize Size of the transform.
+*	@param pfIDCT Inverse transform of the size.
+*	@see IDCTRecFunc_t
+*/
+static inline void IDCTRecC(u32 uiSize, IDCTFunc_t pfIDCT, byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride)
+{
+	i16 piRes[CTU_WIDTH*CTU_WIDTH];
+
+	pfIDCT(piRes, piSrc, uiStride, uiSize, SHIFT_INV_2);
+	for(u32 i=0;i<uiSize;i++)
+		for(u32 j=0;j<uiSize;j++)
+			pbRec[i*uiRecStride+j] = byte(Clip1(piRes[i*uiStride+j]+pbPred[i*uiPredStride+j]));
+}
+
+static void IDST4RecC(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecC(4, IDST4C, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+static void IDCT4RecC(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecC(4, IDCT4C, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+static void IDCT8RecC(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecC(8, IDCT8C, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+static void IDCT16RecC(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecC(16, IDCT16C, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+static void IDCT32RecC(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecC(32, IDCT32C, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+
+/**
+*	Quantization in C.
+*	@param uiSize Size of the block.
+*	@see QuantFunc_t
+*/
+static inline u32 QuantC(u32 uiSize, i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift)
+{
+	u32 uiSigStride = uiCoeffStride >> 2;
+	u32 uiNumSig = 0;
+
+	for(u32 i=0;i<(uiSize>>2);i++)
+		memset(puiSigMap+i*uiSigStride, 0, (uiSize>>2)*sizeof(u16));
+
+	for(u32 i=0;i<uiSize;i++)
+	{
+		for(u32 j=0;j<uiSize;j++)
+		{
+			i32 iLevel = piSrc[i*uiSrcStride+j];
+			i32 iSign = (iLevel < 0 ? -1 : 1);
+
+			iLevel = (ABS(iLevel)*iScale + iRound) >> uiShift;
+			if(iLevel)
+			{
+				puiSigMap[(i>>2)*uiSigStride+(j>>2)] |= 1 << (((i&3)<<2)|(j&3));
+				uiNumSig++;
+			}
+			iLevel *= iSign;
+			piCoeff[i*uiCoeffStride+j] = Clip3(-32768,32767,iLevel);
+		}
+	}
+	return uiNumSig;
+}
+
+static u32 Quant4x4C(i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift){return QuantC(4, piCoeff, uiCoeffStride, puiSigMap, piSrc, uiSrcStride, iScale, iRound, uiShift);}
+static u32 Quant8x8C(i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift){return QuantC(8, piCoeff, uiCoeffStride, puiSigMap, piSrc, uiSrcStride, iScale, iRound, uiShift);}
+static u32 Quant16x16C(i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift){return QuantC(16, piCoeff, uiCoeffStride, puiSigMap, piSrc, uiSrcStride, iScale, iRound, uiShift);}
+static u32 Quant32x32C(i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift){return QuantC(32, piCoeff, uiCoeffStride, puiSigMap, piSrc, uiSrcStride, iScale, iRound, uiShift);}
+
+/**
+*	Inverse quantization in C.
+*	@param uiSize Size of the block.
+*	@see InvQuantFunc_t
+*/
+static inline void InvQuantC(u32 uiSize, i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift)
+{
+	u32 uiSigStride = uiCoeffStride >> 2;
+	i32 iRound = 1 << (uiShift-1);
+
+	for(u32 i=0;i<uiSize;i++)
+	{
+		for(u32 j=0;j<uiSize;j++)
+		{
+			if(puiSigMap[(i>>2)*uiSigStride+(j>>2)] == 0)
+			{
+				piDest[i*uiDestStride+j] = 0;
+				continue;
+			}
+			i32 iIQCoeff = (piCoeff[i*uiCoeffStride+j]*iScale + iRound) >> uiShift;
+			piDest[i*uiDestStride+j] = Clip3(-32768, 32767, iIQCoeff);
+		}
+	}
+}
+
+static void InvQuant4x4C(i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift){InvQuantC(4, piDest, uiDestStride, piCoeff, uiCoeffStride, puiSigMap, iScale, uiShift);}
+static void InvQuant8x8C(i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift){InvQuantC(8, piDest, uiDestStride, piCoeff, uiCoeffStride, puiSigMap, iScale, uiShift);}
+static void InvQuant16x16C(i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift){InvQuantC(16, piDest, uiDestStride, piCoeff, uiCoeffStride, puiSigMap, iScale, uiShift);}
+static void InvQuant32x32C(i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift){InvQuantC(32, piDest, uiDestStride, piCoeff, uiCoeffStride, puiSigMap, iScale, uiShift);}
+
+void InitKernelsC(Kernels_t &sKernels)
+{
+	sKernels.pfSAD[0] = SAD4x4C;
+	sKernels.pfSAD[1] = SAD8x8C;
+	sKernels.pfSAD[2] = SAD16x16C;
+	sKernels.pfSAD[3] = SAD32x32C;
+
+	sKernels.pfSATD[0] = SATD4x4C;
+	sKernels.pfSATD[1] = SATD8x8C;
+	sKernels.pfSATD[2] = SATD16x16C;
+	sKernels.pfSATD[3] = SATD32x32C;
+
+	sKernels.pfIntraPredAng[0] = IntraPredAng4x4C;
+	sKernels.pfIntraPredAng[1] = IntraPredAng8x8C;
+	sKernels.pfIntraPredAng[2] = IntraPredAng16x16C;
+	sKernels.pfIntraPredAng[3] = IntraPredAng32x32C;
+
+	sKernels.pfIntraPredDC[0] = IntraPredDC4x4C;
+	sKernels.pfIntraPredDC[1] = IntraPredDC8x8C;
+	sKernels.pfIntraPredDC[2] = IntraPredDC16x16C;
+	sKernels.pfIntraPredDC[3] = IntraPredDC32x32C;
+
+	sKernels.pfIntraPredPlanar[0] = IntraPredPlanar4x4C;
+	sKernels.pfIntraPredPlanar[1] = IntraPredPlanar8x8C;
+	sKernels.pfIntraPredPlanar[2] = IntraPredPlanar16x16C;
+	sKernels.pfIntraPredPlanar[3] = IntraPredPlanar32x32C;
+
+	sKernels.pfRefSamples = RefSamplesC;
+
+	sKernels.pfDCT[0] = DST4C;
+	sKernels.pfDCT[1] = DCT4C;
+	sKernels.pfDCT[2] = DCT8C;
+	sKernels.pfDCT[3] = DCT16C;
+	sKernels.pfDCT[4] = DCT32C;
+
+	sKernels.pfIDCT[0] = IDST4C;
+	sKernels.pfIDCT[1] = IDCT4C;
+	sKernels.pfIDCT[2] = IDCT8C;
+	sKernels.pfIDCT[3] = IDCT16C;
+	sKernels.pfIDCT[4] = IDCT32C;
+
+	sKernels.pfIDCTRec[0] = IDST4RecC;
+	sKernels.pfIDCTRec[1] = IDCT4RecC;
+	sKernels.pfIDCTRec[2] = IDCT8RecC;
+	sKernels.pfIDCTRec[3] = IDCT16RecC;
+	sKernels.pfIDCTRec[4] = IDCT32RecC;
+
+	sKernels.pfQuant[0] = Quant4x4C;
+	sKernels.pfQuant[1] = Quant8x8C;
+	sKernels.pfQuant[2] = Quant16x16C;
+	sKernels.pfQuant[3] = Quant32x32C;
+
+	sKernels.pfInvQuant[0] = InvQuant4x4C;
+	sKernels.pfInvQuant[1] = InvQuant8x8C;
+	sKernels.pfInvQuant[2] = InvQuant16x16C;
+	sKernels.pfInvQuant[3] = InvQuant32x32C;
+}
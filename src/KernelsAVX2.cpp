@@ -0,0 +1,441 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file KernelsAVX2.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the AVX2 kernels. The blocks which are too narrow for them keep the SSE4.1 kernels.
+*/
+
+#include <KernelsX86.h>
+#include <H265Transform.h>
+
+#if ARCH_X86
+
+/**
+*	Add up the four 64-bit sums of VPSADBW.
+*/
+TARGET_AVX2 static inline u32 SumSAD(__m256i mSAD)
+{
+	__m128i mSum = _mm_add_epi32(_mm256_castsi256_si128(mSAD), _mm256_extracti128_si256(mSAD, 1));
+	return u32(_mm_cvtsi128_si32(mSum) + _mm_extract_epi32(mSum, 2));
+}
+
+TARGET_AVX2 static u32 SAD16x16AVX2(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m256i mSum = _mm256_setzero_si256();
+	for(u32 i=0;i<16;i+=2)	// Two rows at once
+	{
+		__m256i mSrc = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i const *)(pbSrc+i*uiSrcStride))),
+			_mm_loadu_si128((__m128i const *)(pbSrc+(i+1)*uiSrcStride)), 1);
+		__m256i mRef = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i const *)(pbRef+i*uiRefStride))),
+			_mm_loadu_si128((__m128i const *)(pbRef+(i+1)*uiRefStride)), 1);
+		mSum = _mm256_add_epi32(mSum, _mm256_sad_epu8(mSrc, mRef));
+	}
+	return SumSAD(mSum);
+}
+
+TARGET_AVX2 static u32 SAD32x32AVX2(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m256i mSum = _mm256_setzero_si256();
+	for(u32 i=0;i<32;i++)
+	{
+		__m256i mSrc = _mm256_loadu_si256((__m256i const *)(pbSrc+i*uiSrcStride));
+		__m256i mRef = _mm256_loadu_si256((__m256i const *)(pbRef+i*uiRefStride));
+		mSum = _mm256_add_epi32(mSum, _mm256_sad_epu8(mSrc, mRef));
+	}
+	return SumSAD(mSum);
+}
+
+/**
+*	Differences of 16 samples of a row as 16-bit values.
+*/
+TARGET_AVX2 static inline __m256i Diff16(byte const *pbSrc, byte const *pbRef)
+{
+	return _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)pbSrc)), _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)pbRef)));
+}
+
+/**
+*	Butterflies of an 8-point Hadamard transform across 8 registers, i.e. on each of their 16-bit lanes.
+*/
+TARGET_AVX2 static inline void Hadamard8(__m256i &m0, __m256i &m1, __m256i &m2, __m256i &m3, __m256i &m4, __m256i &m5, __m256i &m6, __m256i &m7)
+{
+	__m256i mA0 = _mm256_add_epi16(m0, m4), mA4 = _mm256_sub_epi16(m0, m4);
+	__m256i mA1 = _mm256_add_epi16(m1, m5), mA5 = _mm256_sub_epi16(m1, m5);
+	__m256i mA2 = _mm256_add_epi16(m2, m6), mA6 = _mm256_sub_epi16(m2, m6);
+	__m256i mA3 = _mm256_add_epi16(m3, m7), mA7 = _mm256_sub_epi16(m3, m7);
+	__m256i mB0 = _mm256_add_epi16(mA0, mA2), mB2 = _mm256_sub_epi16(mA0, mA2);
+	__m256i mB1 = _mm256_add_epi16(mA1, mA3), mB3 = _mm256_sub_epi16(mA1, mA3);
+	__m256i mB4 = _mm256_add_epi16(mA4, mA6), mB6 = _mm256_sub_epi16(mA4, mA6);
+	__m256i mB5 = _mm256_add_epi16(mA5, mA7), mB7 = _mm256_sub_epi16(mA5, mA7);
+	m0 = _mm256_add_epi16(mB0, mB1); m1 = _mm256_sub_epi16(mB0, mB1);
+	m2 = _mm256_add_epi16(mB2, mB3); m3 = _mm256_sub_epi16(mB2, mB3);
+	m4 = _mm256_add_epi16(mB4, mB5); m5 = _mm256_sub_epi16(mB4, mB5);
+	m6 = _mm256_add_epi16(mB6, mB7); m7 = _mm256_sub_epi16(mB6, mB7);
+}
+
+/**
+*	Transpose the two 8x8 blocks of 16-bit values in the 128-bit lanes.
+*/
+TARGET_AVX2 static inline void Transpose8x8Words(__m256i &m0, __m256i &m1, __m256i &m2, __m256i &m3, __m256i &m4, __m256i &m5, __m256i &m6, __m256i &m7)
+{
+	__m256i mA0 = _mm256_unpacklo_epi16(m0, m1), mA1 = _mm256_unpackhi_epi16(m0, m1);
+	__m256i mA2 = _mm256_unpacklo_epi16(m2, m3), mA3 = _mm256_unpackhi_epi16(m2, m3);
+	__m256i mA4 = _mm256_unpacklo_epi16(m4, m5), mA5 = _mm256_unpackhi_epi16(m4, m5);
+	__m256i mA6 = _mm256_unpacklo_epi16(m6, m7), mA7 = _mm256_unpackhi_epi16(m6, m7);
+	__m256i mB0 = _mm256_unpacklo_epi32(mA0, mA2), mB1 = _mm256_unpackhi_epi32(mA0, mA2);
+	__m256i mB2 = _mm256_unpacklo_epi32(mA1, mA3), mB3 = _mm256_unpackhi_epi32(mA1, mA3);
+	__m256i mB4 = _mm256_unpacklo_epi32(mA4, mA6), mB5 = _mm256_unpackhi_epi32(mA4, mA6);
+	__m256i mB6 = _mm256_unpacklo_epi32(mA5, mA7), mB7 = _mm256_unpackhi_epi32(mA5, mA7);
+	m0 = _mm256_unpacklo_epi64(mB0, mB4); m1 = _mm256_unpackhi_epi64(mB0, mB4);
+	m2 = _mm256_unpacklo_epi64(mB1, mB5); m3 = _mm256_unpackhi_epi64(mB1, mB5);
+	m4 = _mm256_unpacklo_epi64(mB2, mB6); m5 = _mm256_unpackhi_epi64(mB2, mB6);
+	m6 = _mm256_unpacklo_epi64(mB3, mB7); m7 = _mm256_unpackhi_epi64(mB3, mB7);
+}
+
+/**
+*	Hadamard transforms of the differences of two neighbouring 8x8 blocks, one in each 128-bit lane.
+*	@see SATDFunc_t
+*	@return Sums of the absolute transformed differences of the blocks divided by 4, in the two lowest 32-bit lanes.
+*/
+TARGET_AVX2 static inline __m128i Hadamard8x8PairAVX2(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m256i m0 = Diff16(pbSrc, pbRef);
+	__m256i m1 = Diff16(pbSrc+uiSrcStride, pbRef+uiRefStride);
+	__m256i m2 = Diff16(pbSrc+2*uiSrcStride, pbRef+2*uiRefStride);
+	__m256i m3 = Diff16(pbSrc+3*uiSrcStride, pbRef+3*uiRefStride);
+	__m256i m4 = Diff16(pbSrc+4*uiSrcStride, pbRef+4*uiRefStride);
+	__m256i m5 = Diff16(pbSrc+5*uiSrcStride, pbRef+5*uiRefStride);
+	__m256i m6 = Diff16(pbSrc+6*uiSrcStride, pbRef+6*uiRefStride);
+	__m256i m7 = Diff16(pbSrc+7*uiSrcStride, pbRef+7*uiRefStride);
+
+	Hadamard8(m0, m1, m2, m3, m4, m5, m6, m7);
+	Transpose8x8Words(m0, m1, m2, m3, m4, m5, m6, m7);
+	Hadamard8(m0, m1, m2, m3, m4, m5, m6, m7);
+
+	__m256i mOnes = _mm256_set1_epi16(1);
+	__m256i mSum = _mm256_madd_epi16(_mm256_add_epi16(_mm256_abs_epi16(m0), _mm256_abs_epi16(m1)), mOnes);
+	mSum = _mm256_add_epi32(mSum, _mm256_madd_epi16(_mm256_add_epi16(_mm256_abs_epi16(m2), _mm256_abs_epi16(m3)), mOnes));
+	mSum = _mm256_add_epi32(mSum, _mm256_madd_epi16(_mm256_add_epi16(_mm256_abs_epi16(m4), _mm256_abs_epi16(m5)), mOnes));
+	mSum = _mm256_add_epi32(mSum, _mm256_madd_epi16(_mm256_add_epi16(_mm256_abs_epi16(m6), _mm256_abs_epi16(m7)), mOnes));
+	__m128i mPair = _mm_hadd_epi32(_mm256_castsi256_si128(mSum), _mm256_extracti128_si256(mSum, 1));
+	mPair = _mm_hadd_epi32(mPair, mPair);
+	return _mm_srli_epi32(_mm_add_epi32(mPair, _mm_set1_epi32(2)), 2);
+}
+
+/**
+*	SATD of a square block of 16x16 or more with AVX2.
+*	@param uiSize Width and height of the block.
+*	@see SATDFunc_t
+*/
+TARGET_AVX2 static inline u32 SATDAVX2(u32 uiSize, byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m128i mSum = _mm_setzero_si128();
+	for(u32 i=0;i<uiSize;i+=8)
+		for(u32 j=0;j<uiSize;j+=16)
+			mSum = _mm_add_epi32(mSum, Hadamard8x8PairAVX2(pbSrc+i*uiSrcStride+j, uiSrcStride, pbRef+i*uiRefStride+j, uiRefStride));
+	return u32(_mm_cvtsi128_si32(mSum) + _mm_extract_epi32(mSum, 1));
+}
+
+TARGET_AVX2 static u32 SATD16x16AVX2(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SATDAVX2(16, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+TARGET_AVX2 static u32 SATD32x32AVX2(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SATDAVX2(32, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+
+/**
+*	Interpolate 32 samples of the angular prediction, ((32-iFact)*pbMainRef[x] + iFact*pbMainRef[x+1] + 16) >> 5.
+*	@param mA The reference samples pbMainRef[x].
+*	@param mB The reference samples pbMainRef[x+1].
+*	@param mWeights The weights 32-iFact and iFact in every pair of bytes.
+*	@return The 32 samples.
+*/
+TARGET_AVX2 static inline __m256i InterpolateAng32(__m256i mA, __m256i mB, __m256i mWeights)
+{
+	__m256i mRound = _mm256_set1_epi16(16);
+	__m256i mLo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_maddubs_epi16(_mm256_unpacklo_epi8(mA, mB), mWeights), mRound), 5);
+	__m256i mHi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_maddubs_epi16(_mm256_unpackhi_epi8(mA, mB), mWeights), mRound), 5);
+	return _mm256_packus_epi16(mLo, mHi);	// The unpacks and the pack work on each 128-bit lane, so the samples stay in order
+}
+
+/**
+*	Get the weights 32-iFact and iFact of the angular prediction in every pair of bytes.
+*/
+static inline i16 GetAngWeights(i32 iFact)
+{
+	return i16((iFact << 8) | (32-iFact));
+}
+
+TARGET_AVX2 static void IntraPredAng16x16AVX2(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose)
+{
+	i32 iDeltaPos = 0;
+	for(u32 k=0;k<16;k+=2)	// Two rows at once, with their own positions and weights in each 128-bit lane
+	{
+		iDeltaPos += iAngle;
+		byte const *pbRow0 = pbMainRef+(iDeltaPos >> 5)+1;	// Equation 8-53
+		i32 iFact0 = iDeltaPos & 0x1F;	// Equation 8-54
+		iDeltaPos += iAngle;
+		byte const *pbRow1 = pbMainRef+(iDeltaPos >> 5)+1;
+		i32 iFact1 = iDeltaPos & 0x1F;
+
+		__m256i mA = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i const *)pbRow0)),
+			_mm_loadu_si128((__m128i const *)pbRow1), 1);
+		__m256i mB = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i const *)(pbRow0+1))),
+			_mm_loadu_si128((__m128i const *)(pbRow1+1)), 1);
+		__m256i mWeights = _mm256_setr_m128i(_mm_set1_epi16(GetAngWeights(iFact0)), _mm_set1_epi16(GetAngWeights(iFact1)));
+		_mm256_storeu_si256((__m256i *)(pbPred+k*16), InterpolateAng32(mA, mB, mWeights));	// A weight of 0 gives pbMainRef[x]
+	}
+
+	FinishIntraPredAng(16, pbPred, pbSideRef, bTranspose);
+}
+
+TARGET_AVX2 static void IntraPredAng32x32AVX2(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose)
+{
+	i32 iDeltaPos = 0;
+	for(u32 k=0;k<32;k++)
+	{
+		iDeltaPos += iAngle;
+		byte const *pbRow = pbMainRef+(iDeltaPos >> 5)+1;	// Equation 8-53
+		i32 iFact = iDeltaPos & 0x1F;	// Equation 8-54
+		__m256i mA = _mm256_loadu_si256((__m256i const *)pbRow);
+
+		if(iFact)	// We need to filter
+			mA = InterpolateAng32(mA, _mm256_loadu_si256((__m256i const *)(pbRow+1)), _mm256_set1_epi16(GetAngWeights(iFact)));
+		_mm256_storeu_si256((__m256i *)(pbPred+k*32), mA);
+	}
+
+	FinishIntraPredAng(32, pbPred, pbSideRef, bTranspose);
+}
+
+/**
+*	Planar intra prediction with AVX2, with 16 samples of a row at once in 16-bit lanes.
+*	@param uiSize Width and height of the block (16 or 32).
+*	@see IntraPredPlanarFunc_t
+*/
+TARGET_AVX2 static inline void IntraPredPlanarAVX2(u32 uiSize, byte *pbPred, byte const *pbRef)
+{
+	byte const *pbTop = pbRef + (uiSize<<1) + 1;
+	byte const *pbLeft = pbRef + (uiSize<<1) - 1;	// The left array starts from the top and goes to the bottom. We must have a negative iterator
+	u32 uiNumChunks = uiSize >> 4;
+	i32 iShift = LOG2(uiSize-1) + 1;
+
+	__m256i mBottomLeft = _mm256_set1_epi16(pbLeft[-i32(uiSize)]);
+	__m256i mTopRight = _mm256_set1_epi16(pbTop[uiSize]);
+	__m256i pmTopComp[CTU_WIDTH/16];	// (size-1-y)*pbTop[x] + (y+1)*bBottomLeft of the current row
+	__m256i pmTopDelta[CTU_WIDTH/16];	// bBottomLeft - pbTop[x]
+	__m256i pmLeftWeight[CTU_WIDTH/16];	// size-1-x
+	__m256i pmRightComp[CTU_WIDTH/16];	// (x+1)*bTopRight + size
+	for(u32 c=0;c<uiNumChunks;c++)
+	{
+		__m256i mX = _mm256_add_epi16(_mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm256_set1_epi16(i16(c << 4)));
+		__m256i mTop = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)(pbTop+(c << 4))));
+		pmTopComp[c] = _mm256_add_epi16(_mm256_mullo_epi16(mTop, _mm256_set1_epi16(i16(uiSize-1))), mBottomLeft);
+		pmTopDelta[c] = _mm256_sub_epi16(mBottomLeft, mTop);
+		pmLeftWeight[c] = _mm256_sub_epi16(_mm256_set1_epi16(i16(uiSize-1)), mX);
+		pmRightComp[c] = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_add_epi16(mX, _mm256_set1_epi16(1)), mTopRight), _mm256_set1_epi16(i16(uiSize)));
+	}
+
+	for(u32 y=0;y<uiSize;y++)
+	{
+		__m256i mLeft = _mm256_set1_epi16(pbLeft[-i32(y)]);
+		__m256i pmRow[CTU_WIDTH/16];
+		for(u32 c=0;c<uiNumChunks;c++)
+		{
+			pmRow[c] = _mm256_add_epi16(_mm256_add_epi16(pmTopComp[c], _mm256_mullo_epi16(pmLeftWeight[c], mLeft)), pmRightComp[c]);
+			pmRow[c] = _mm256_srli_epi16(pmRow[c], iShift);
+			pmTopComp[c] = _mm256_add_epi16(pmTopComp[c], pmTopDelta[c]);
+		}
+
+		// The pack works on each 128-bit lane, so the 64-bit parts are put back in order
+		byte *pbPredRow = pbPred+y*uiSize;
+		if(uiSize == 16)
+			_mm_storeu_si128((__m128i *)pbPredRow, _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(pmRow[0], pmRow[0]), 0xD8)));
+		else
+			_mm256_storeu_si256((__m256i *)pbPredRow, _mm256_permute4x64_epi64(_mm256_packus_epi16(pmRow[0], pmRow[1]), 0xD8));
+	}
+}
+
+TARGET_AVX2 static void IntraPredPlanar16x16AVX2(byte *pbPred, byte const *pbRef){IntraPredPlanarAVX2(16, pbPred, pbRef);}
+TARGET_AVX2 static void IntraPredPlanar32x32AVX2(byte *pbPred, byte const *pbRef){IntraPredPlanarAVX2(32, pbPred, pbRef);}
+
+/**
+*	Forward transform with AVX2, like DCTSSE41() but with the pairs of 8 lines in a register.
+*	@param uiSize Size of the transform (8 to 32).
+*	@param piT Transform matrix.
+*	@see DCTFunc_t
+*/
+TARGET_AVX2 static inline void DCTAVX2(u32 uiSize, i16 const *piT, i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	__m256i mRound = _mm256_set1_epi32(1 << (uiShift-1));
+	__m128i pmPairs[CTU_WIDTH];
+	__m256i pmPairs8[CTU_WIDTH/2];
+
+	for(u32 i=0;i<uiTrLines;i+=8)
+	{
+		LoadPairs(piSrc+i*uiStride, uiStride, uiSize, pmPairs);
+		for(u32 j=0;j<(uiSize>>1);j++)
+			pmPairs8[j] = _mm256_setr_m128i(pmPairs[2*j], pmPairs[2*j+1]);
+
+		for(u32 k=0;k<uiSize;k++)
+		{
+			i16 const *piRow = piT+k*uiSize;
+			__m256i mSum = mRound;
+			for(u32 j=0;j<(uiSize>>1);j++)
+				mSum = _mm256_add_epi32(mSum, _mm256_madd_epi16(pmPairs8[j], _mm256_set1_epi32(Load32((byte const *)(piRow+2*j)))));
+			mSum = _mm256_srai_epi32(mSum, uiShift);
+			_mm_storeu_si128((__m128i *)(piDest+k*uiStride+i), _mm_packs_epi32(_mm256_castsi256_si128(mSum), _mm256_extracti128_si256(mSum, 1)));
+		}
+	}
+}
+
+TARGET_AVX2 static void DCT8AVX2(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){DCTAVX2(8, g_piT8, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+TARGET_AVX2 static void DCT16AVX2(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){DCTAVX2(16, g_piT16, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+TARGET_AVX2 static void DCT32AVX2(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){DCTAVX2(32, g_piT32, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+
+/**
+*	Inverse transform of 4 lines with AVX2, like IDCTLinesSSE41() but with 16 columns of the matrix in a register.
+*	@param uiSize Size of the transform (16 or 32).
+*	@param piT Transform matrix.
+*	@param piSrc Source data, whose columns i to i+3 are transformed.
+*	@param uiStride Stride for the next line of source.
+*	@param uiShift Shift of the transform.
+*	@param uiCol Column of the matrix and of the lines, i.e. the 16 results from uiCol on are made.
+*	@param pmLines The 4 lines of results, saturated to 16 bits.
+*/
+TARGET_AVX2 static inline void IDCTLinesAVX2(u32 uiSize, i16 const *piT, i16 const *piSrc, u32 uiStride, u32 uiShift, u32 uiCol, __m256i *pmLines)
+{
+	__m256i mRound = _mm256_set1_epi32(1 << (uiShift-1));
+	// Columns 0 to 3 and 8 to 11 (Lo), and 4 to 7 and 12 to 15 (Hi) of each line
+	__m256i mSum0Lo = mRound, mSum1Lo = mRound, mSum2Lo = mRound, mSum3Lo = mRound;
+	__m256i mSum0Hi = mRound, mSum1Hi = mRound, mSum2Hi = mRound, mSum3Hi = mRound;
+
+	for(u32 j=0;j<uiSize;j+=2)
+	{
+		__m128i mSrcPairs = _mm_unpacklo_epi16(_mm_loadl_epi64((__m128i const *)(piSrc+j*uiStride)), _mm_loadl_epi64((__m128i const *)(piSrc+(j+1)*uiStride)));
+		if(_mm_testz_si128(mSrcPairs, mSrcPairs))
+			continue;
+
+		__m256i mSrcPairs2 = _mm256_broadcastsi128_si256(mSrcPairs);
+		i16 const *piRows = piT+j*uiSize+uiCol;
+		__m256i mRow0 = _mm256_loadu_si256((__m256i const *)piRows);
+		__m256i mRow1 = _mm256_loadu_si256((__m256i const *)(piRows+uiSize));
+		__m256i mCoeffLo = _mm256_unpacklo_epi16(mRow0, mRow1);
+		__m256i mCoeffHi = _mm256_unpackhi_epi16(mRow0, mRow1);
+		__m256i mPair0 = _mm256_shuffle_epi32(mSrcPairs2, 0x00);
+		__m256i mPair1 = _mm256_shuffle_epi32(mSrcPairs2, 0x55);
+		__m256i mPair2 = _mm256_shuffle_epi32(mSrcPairs2, 0xAA);
+		__m256i mPair3 = _mm256_shuffle_epi32(mSrcPairs2, 0xFF);
+		mSum0Lo = _mm256_add_epi32(mSum0Lo, _mm256_madd_epi16(mPair0, mCoeffLo));
+		mSum1Lo = _mm256_add_epi32(mSum1Lo, _mm256_madd_epi16(mPair1, mCoeffLo));
+		mSum2Lo = _mm256_add_epi32(mSum2Lo, _mm256_madd_epi16(mPair2, mCoeffLo));
+		mSum3Lo = _mm256_add_epi32(mSum3Lo, _mm256_madd_epi16(mPair3, mCoeffLo));
+		mSum0Hi = _mm256_add_epi32(mSum0Hi, _mm256_madd_epi16(mPair0, mCoeffHi));
+		mSum1Hi = _mm256_add_epi32(mSum1Hi, _mm256_madd_epi16(mPair1, mCoeffHi));
+		mSum2Hi = _mm256_add_epi32(mSum2Hi, _mm256_madd_epi16(mPair2, mCoeffHi));
+		mSum3Hi = _mm256_add_epi32(mSum3Hi, _mm256_madd_epi16(mPair3, mCoeffHi));
+	}
+	// The packing within the 128-bit lanes puts the columns back in order
+	pmLines[0] = _mm256_packs_epi32(_mm256_srai_epi32(mSum0Lo, uiShift), _mm256_srai_epi32(mSum0Hi, uiShift));
+	pmLines[1] = _mm256_packs_epi32(_mm256_srai_epi32(mSum1Lo, uiShift), _mm256_srai_epi32(mSum1Hi, uiShift));
+	pmLines[2] = _mm256_packs_epi32(_mm256_srai_epi32(mSum2Lo, uiShift), _mm256_srai_epi32(mSum2Hi, uiShift));
+	pmLines[3] = _mm256_packs_epi32(_mm256_srai_epi32(mSum3Lo, uiShift), _mm256_srai_epi32(mSum3Hi, uiShift));
+}
+
+/**
+*	First stage of the inverse transform with AVX2.
+*	@param uiSize Size of the transform (16 or 32).
+*	@param piT Transform matrix.
+*	@see IDCTFunc_t
+*/
+TARGET_AVX2 static inline void IDCTAVX2(u32 uiSize, i16 const *piT, i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	__m256i pmLines[4];
+
+	for(u32 i=0;i<uiTrLines;i+=4)
+	{
+		for(u32 k=0;k<uiSize;k+=16)
+		{
+			IDCTLinesAVX2(uiSize, piT, piSrc+i, uiStride, uiShift, k, pmLines);
+			for(u32 l=0;l<4;l++)
+				_mm256_storeu_si256((__m256i *)(piDest+(i+l)*uiStride+k), pmLines[l]);
+		}
+	}
+}
+
+/**
+*	Second stage of the inverse transform with the reconstruction with AVX2.
+*	@param uiSize Size of the transform (16 or 32).
+*	@param piT Transform matrix.
+*	@see IDCTRecFunc_t
+*/
+TARGET_AVX2 static inline void IDCTRecAVX2(u32 uiSize, i16 const *piT, byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride)
+{
+	__m256i pmLines[4];
+
+	for(u32 i=0;i<uiSize;i+=4)
+	{
+		for(u32 k=0;k<uiSize;k+=16)
+		{
+			IDCTLinesAVX2(uiSize, piT, piSrc+i, uiStride, SHIFT_INV_2, k, pmLines);
+			for(u32 l=0;l<4;l++)
+			{
+				__m256i mPred = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)(pbPred+(i+l)*uiPredStride+k)));
+				__m256i mRec = _mm256_adds_epi16(pmLines[l], mPred);
+				__m128i mRec8 = _mm_packus_epi16(_mm256_castsi256_si128(mRec), _mm256_extracti128_si256(mRec, 1));
+				_mm_storeu_si128((__m128i *)(pbRec+(i+l)*uiRecStride+k), mRec8);
+			}
+		}
+	}
+}
+
+TARGET_AVX2 static void IDCT16AVX2(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){IDCTAVX2(16, g_piT16, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+TARGET_AVX2 static void IDCT32AVX2(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){IDCTAVX2(32, g_piT32, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+
+TARGET_AVX2 static void IDCT16RecAVX2(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecAVX2(16, g_piT16, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+TARGET_AVX2 static void IDCT32RecAVX2(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecAVX2(32, g_piT32, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+
+void InitKernelsAVX2(Kernels_t &sKernels)
+{
+	sKernels.pfSAD[2] = SAD16x16AVX2;
+	sKernels.pfSAD[3] = SAD32x32AVX2;
+
+	sKernels.pfSATD[2] = SATD16x16AVX2;
+	sKernels.pfSATD[3] = SATD32x32AVX2;
+
+	sKernels.pfIntraPredAng[2] = IntraPredAng16x16AVX2;
+	sKernels.pfIntraPredAng[3] = IntraPredAng32x32AVX2;
+
+	sKernels.pfIntraPredPlanar[2] = IntraPredPlanar16x16AVX2;
+	sKernels.pfIntraPredPlanar[3] = IntraPredPlanar32x32AVX2;
+
+	sKernels.pfDCT[2] = DCT8AVX2;
+	sKernels.pfDCT[3] = DCT16AVX2;
+	sKernels.pfDCT[4] = DCT32AVX2;
+
+	sKernels.pfIDCT[3] = IDCT16AVX2;
+	sKernels.pfIDCT[4] = IDCT32AVX2;
+
+	sKernels.pfIDCTRec[3] = IDCT16RecAVX2;
+	sKernels.pfIDCTRec[4] = IDCT32RecAVX2;
+}
+
+#else
+
+void InitKernelsAVX2(Kernels_t &sKernels)
+{
+}
+
+#endif	// ARCH_X86
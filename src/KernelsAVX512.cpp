@@ -0,0 +1,91 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file KernelsAVX512.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the AVX-512 kernels. The blocks which are too narrow for them keep the AVX2 or SSE4.1 kernels.
+*/
+
+#include <Kernels.h>
+
+#if ARCH_X86
+#include <immintrin.h>
+
+/**
+*	Add up the eight 64-bit sums of VPSADBW.
+*	The halves are taken with zero masking, as the plain casts and extracts of GCC have undefined pass-through values.
+*/
+TARGET_AVX512 static inline u32 SumSAD(__m512i mSAD)
+{
+	__m256i mSum = _mm256_add_epi64(_mm512_maskz_extracti64x4_epi64(0xF, mSAD, 0), _mm512_maskz_extracti64x4_epi64(0xF, mSAD, 1));
+	__m128i mSum128 = _mm_add_epi64(_mm256_castsi256_si128(mSum), _mm256_extracti128_si256(mSum, 1));
+	return u32(_mm_cvtsi128_si32(mSum128) + _mm_extract_epi32(mSum128, 2));
+}
+
+/**
+*	Load four rows of 16 bytes.
+*/
+TARGET_AVX512 static inline __m512i Load4x16(byte const *pbSrc, u32 uiStride)
+{
+	__m512i mRows = _mm512_castsi128_si512(_mm_loadu_si128((__m128i const *)pbSrc));
+	mRows = _mm512_inserti32x4(mRows, _mm_loadu_si128((__m128i const *)(pbSrc+uiStride)), 1);
+	mRows = _mm512_inserti32x4(mRows, _mm_loadu_si128((__m128i const *)(pbSrc+2*uiStride)), 2);
+	return _mm512_inserti32x4(mRows, _mm_loadu_si128((__m128i const *)(pbSrc+3*uiStride)), 3);
+}
+
+/**
+*	Load two rows of 32 bytes.
+*	The first row is a masked load, which zeroes the upper half, and the second row is broadcast into the upper half.
+*/
+TARGET_AVX512 static inline __m512i Load2x32(byte const *pbSrc, u32 uiStride)
+{
+	__m512i mRows = _mm512_maskz_loadu_epi64(0x0F, pbSrc);
+	return _mm512_mask_broadcast_i64x4(mRows, 0xF0, _mm256_loadu_si256((__m256i const *)(pbSrc+uiStride)));
+}
+
+TARGET_AVX512 static u32 SAD16x16AVX512(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m512i mSum = _mm512_setzero_si512();
+	for(u32 i=0;i<16;i+=4)	// Four rows at once
+		mSum = _mm512_add_epi64(mSum, _mm512_sad_epu8(Load4x16(pbSrc+i*uiSrcStride, uiSrcStride), Load4x16(pbRef+i*uiRefStride, uiRefStride)));
+	return SumSAD(mSum);
+}
+
+TARGET_AVX512 static u32 SAD32x32AVX512(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m512i mSum = _mm512_setzero_si512();
+	for(u32 i=0;i<32;i+=2)	// Two rows at once
+		mSum = _mm512_add_epi64(mSum, _mm512_sad_epu8(Load2x32(pbSrc+i*uiSrcStride, uiSrcStride), Load2x32(pbRef+i*uiRefStride, uiRefStride)));
+	return SumSAD(mSum);
+}
+
+void InitKernelsAVX512(Kernels_t &sKernels)
+{
+	sKernels.pfSAD[2] = SAD16x16AVX512;
+	sKernels.pfSAD[3] = SAD32x32AVX512;
+}
+
+#else
+
+void InitKernelsAVX512(Kernels_t &sKernels)
+{
+}
+
+#endif	// ARCH_X86
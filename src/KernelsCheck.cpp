@@ -0,0 +1,384 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file KernelsCheck.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the check of the SIMD kernels against the C kernels (see --checkkernels).
+*/
+
+#include <Kernels.h>
+#include <H265Transform.h>
+#include <stdio.h>
+#include <string.h>
+
+#define			CHECK_ROUNDS						64			//!<	Random blocks per kernel, after the blocks with the extreme values
+#define			CHECK_STRIDE						(CTU_WIDTH+8)	//!<	Stride of the source blocks, which is not the one of the kernels
+
+/**
+*	State of the check of the kernels of one level.
+*/
+typedef struct _KernelCheck
+{
+	Kernels_t const		*psC;				//!< C kernels
+	Kernels_t const		*psPrev;			//!< Kernels up to the level below
+	Kernels_t const		*psCurr;			//!< Kernels up to the level
+	i8 const			*pcLevel;			//!< Name of the level
+	u32					uiChecked;			//!< Kernels of the level which were checked
+	u32					uiFailed;			//!< Kernels of the level whose results differ from the C kernels
+	u32					uiSeed;				//!< State of the random numbers
+}KernelCheck_t;
+
+/**
+*	Next random number, the same on every platform.
+*	@return A random number of 15 bits.
+*/
+static u32 CheckRand(KernelCheck_t &sCheck)
+{
+	sCheck.uiSeed = sCheck.uiSeed*1103515245 + 12345;
+	return (sCheck.uiSeed >> 16) & 0x7FFF;
+}
+
+/**
+*	Fill samples for a round of the check.
+*	The first rounds have the extreme values, i.e. all 0, all 255 and 0 and 255 alternating, then the samples are random.
+*/
+static void CheckFillBytes(KernelCheck_t &sCheck, u32 uiRound, byte *pbBuff, u32 uiLen)
+{
+	for(u32 i=0;i<uiLen;i++)
+	{
+		switch(uiRound)
+		{
+		case 0:		pbBuff[i] = 0; break;
+		case 1:		pbBuff[i] = 255; break;
+		case 2:		pbBuff[i] = (i & 1) ? 255 : 0; break;
+		case 3:		pbBuff[i] = ((i ^ (i/CHECK_STRIDE)) & 1) ? 0 : 255; break;
+		default:	pbBuff[i] = byte(CheckRand(sCheck)); break;
+		}
+	}
+}
+
+/**
+*	Fill coefficients for a round of the check.
+*	The first rounds have the extreme values, then the coefficients are random, small or sparse.
+*/
+static void CheckFillCoeffs(KernelCheck_t &sCheck, u32 uiRound, i16 *piBuff, u32 uiLen)
+{
+	for(u32 i=0;i<uiLen;i++)
+	{
+		switch(uiRound)
+		{
+		case 0:		piBuff[i] = 32767; break;
+		case 1:		piBuff[i] = -32768; break;
+		case 2:		piBuff[i] = (i & 1) ? 32767 : -32768; break;
+		case 3:		piBuff[i] = 0; break;
+		default:
+			switch(uiRound & 3)
+			{
+			case 0:		piBuff[i] = i16(CheckRand(sCheck)*2 - 32768 + (CheckRand(sCheck) & 1)); break;
+			case 1:		piBuff[i] = i16(i32(CheckRand(sCheck) % 2001) - 1000); break;
+			default:	piBuff[i] = (CheckRand(sCheck) & 7) ? 0 : i16(i32(CheckRand(sCheck) % 201) - 100); break;
+			}
+		}
+	}
+}
+
+/**
+*	Start the check of a kernel.
+*	@return True if the level has its own kernel, which must be checked.
+*/
+static bit CheckBegin(KernelCheck_t &sCheck, void const *pvPrev, void const *pvCurr)
+{
+	if(pvPrev == pvCurr)
+		return false;
+	sCheck.uiChecked++;
+	return true;
+}
+
+/**
+*	End the check of a kernel.
+*	@param bSame The kernel gave the results of the C kernel for all the blocks.
+*	@param pcName Name of the kernel.
+*	@param uiIdx Index of the kernel in its table.
+*/
+static void CheckEnd(KernelCheck_t &sCheck, bit bSame, i8 const *pcName, u32 uiIdx)
+{
+	if(bSame)
+		return;
+	sCheck.uiFailed++;
+	printf("Error: The %s kernel %s[%u] differs from the C kernel.\n", sCheck.pcLevel, pcName, uiIdx);
+}
+
+static void CheckSAD(KernelCheck_t &sCheck)
+{
+	byte pbSrc[CTU_WIDTH*CHECK_STRIDE], pbRef[CTU_WIDTH*CHECK_STRIDE];
+	for(u32 t=0;t<4;t++)
+	{
+		u32 uiSize = 4 << t;
+		bit bCheckSAD = CheckBegin(sCheck, (void const *)sCheck.psPrev->pfSAD[t], (void const *)sCheck.psCurr->pfSAD[t]);
+		bit bCheckSATD = CheckBegin(sCheck, (void const *)sCheck.psPrev->pfSATD[t], (void const *)sCheck.psCurr->pfSATD[t]);
+		bit bSameSAD = true, bSameSATD = true;
+		for(u32 r=0;r<CHECK_ROUNDS && (bCheckSAD || bCheckSATD);r++)
+		{
+			CheckFillBytes(sCheck, r, pbSrc, sizeof(pbSrc));
+			CheckFillBytes(sCheck, r < 4 ? 3-r : r, pbRef, sizeof(pbRef));	// The opposite extremes
+			u32 uiRefStride = (r & 1) ? uiSize : CHECK_STRIDE;
+			if(bCheckSAD)
+				bSameSAD &= sCheck.psCurr->pfSAD[t](pbSrc, CHECK_STRIDE, pbRef, uiRefStride) == sCheck.psC->pfSAD[t](pbSrc, CHECK_STRIDE, pbRef, uiRefStride);
+			if(bCheckSATD)
+				bSameSATD &= sCheck.psCurr->pfSATD[t](pbSrc, CHECK_STRIDE, pbRef, uiRefStride) == sCheck.psC->pfSATD[t](pbSrc, CHECK_STRIDE, pbRef, uiRefStride);
+		}
+		if(bCheckSAD)
+			CheckEnd(sCheck, bSameSAD, "pfSAD", t);
+		if(bCheckSATD)
+			CheckEnd(sCheck, bSameSATD, "pfSATD", t);
+	}
+}
+
+static void CheckIntraPred(KernelCheck_t &sCheck)
+{
+	// The angles of the modes 2 to 34 (see 8.4.3.1.6 Table 8-5 in draft), each of them with and without the transpose
+	static const i32 piAngles[17] = {-32, -26, -21, -17, -13, -9, -5, -2, 0, 2, 5, 9, 13, 17, 21, 26, 32};
+	byte pbRef[4*CTU_WIDTH+1+16];
+	byte pbSideRef[CTU_WIDTH+1];
+	byte pbPredC[CTU_WIDTH*CTU_WIDTH], pbPred[CTU_WIDTH*CTU_WIDTH];
+	byte *pbMainRef = pbRef + CTU_WIDTH;	// Room for the samples projected from the side reference
+
+	for(u32 t=0;t<4;t++)
+	{
+		u32 uiSize = 4 << t;
+		u32 uiLen = uiSize*uiSize;
+
+		if(CheckBegin(sCheck, (void const *)sCheck.psPrev->pfIntraPredAng[t], (void const *)sCheck.psCurr->pfIntraPredAng[t]))
+		{
+			bit bSame = true;
+			for(u32 r=0;r<CHECK_ROUNDS/4;r++)
+			{
+				CheckFillBytes(sCheck, r, pbRef, sizeof(pbRef));
+				CheckFillBytes(sCheck, r, pbSideRef, sizeof(pbSideRef));
+				for(u32 a=0;a<17;a++)
+					for(u32 uiVariant=0;uiVariant<(piAngles[a] ? 2u : 4u);uiVariant++)
+					{
+						bit bTranspose = (uiVariant & 1) != 0;
+						byte const *pbSide = (uiVariant & 2) ? pbSideRef : NULL;	// The edge filter is only used without an angle
+						sCheck.psC->pfIntraPredAng[t](pbPredC, pbMainRef, pbSide, piAngles[a], bTranspose);
+						sCheck.psCurr->pfIntraPredAng[t](pbPred, pbMainRef, pbSide, piAngles[a], bTranspose);
+						bSame &= memcmp(pbPred, pbPredC, uiLen) == 0;
+					}
+			}
+			CheckEnd(sCheck, bSame, "pfIntraPredAng", t);
+		}
+
+		if(CheckBegin(sCheck, (void const *)sCheck.psPrev->pfIntraPredDC[t], (void const *)sCheck.psCurr->pfIntraPredDC[t]))
+		{
+			bit bSame = true;
+			for(u32 r=0;r<CHECK_ROUNDS;r++)
+			{
+				CheckFillBytes(sCheck, r, pbRef, 4*uiSize+1);
+				sCheck.psC->pfIntraPredDC[t](pbPredC, pbRef, (r & 1) != 0);
+				sCheck.psCurr->pfIntraPredDC[t](pbPred, pbRef, (r & 1) != 0);
+				bSame &= memcmp(pbPred, pbPredC, uiLen) == 0;
+			}
+			CheckEnd(sCheck, bSame, "pfIntraPredDC", t);
+		}
+
+		if(CheckBegin(sCheck, (void const *)sCheck.psPrev->pfIntraPredPlanar[t], (void const *)sCheck.psCurr->pfIntraPredPlanar[t]))
+		{
+			bit bSame = true;
+			for(u32 r=0;r<CHECK_ROUNDS;r++)
+			{
+				CheckFillBytes(sCheck, r, pbRef, 4*uiSize+1);
+				sCheck.psC->pfIntraPredPlanar[t](pbPredC, pbRef);
+				sCheck.psCurr->pfIntraPredPlanar[t](pbPred, pbRef);
+				bSame &= memcmp(pbPred, pbPredC, uiLen) == 0;
+			}
+			CheckEnd(sCheck, bSame, "pfIntraPredPlanar", t);
+		}
+	}
+
+	if(CheckBegin(sCheck, (void const *)sCheck.psPrev->pfRefSamples, (void const *)sCheck.psCurr->pfRefSamples))
+	{
+		// The top row of the neighbours, under it the left column
+		byte pbNeigh[(2*CTU_WIDTH+1)*CHECK_STRIDE];
+		byte *pbRefC = pbPredC + 4*CTU_WIDTH+1;
+		bit bSame = true;
+		for(u32 r=0;r<CHECK_ROUNDS;r++)
+		{
+			u32 uiSize = 4 << (r & 3);
+			u32 puiRefOffset[6] = {0, uiSize, 2*uiSize, 2*uiSize+1, 3*uiSize+1, 4*uiSize+1};	// See H265CTUCompressor::InitRefPointers()
+			u8 bValidFlag = u8(1 + r % 31);		// Every combination of the neighbourhoods
+			CheckFillBytes(sCheck, r, pbNeigh, sizeof(pbNeigh));
+			sCheck.psC->pfRefSamples(pbRefC, pbPredC, pbNeigh+CHECK_STRIDE, CHECK_STRIDE, pbNeigh, puiRefOffset, bValidFlag, uiSize);
+			sCheck.psCurr->pfRefSamples(pbRef, pbPred, pbNeigh+CHECK_STRIDE, CHECK_STRIDE, pbNeigh, puiRefOffset, bValidFlag, uiSize);
+			bSame &= memcmp(pbRef, pbRefC, 4*uiSize+1) == 0 && memcmp(pbPred, pbPredC, 4*uiSize+1) == 0;
+		}
+		CheckEnd(sCheck, bSame, "pfRefSamples", 0);
+	}
+}
+
+static void CheckTransforms(KernelCheck_t &sCheck)
+{
+	byte pbSrc[CTU_WIDTH*CHECK_STRIDE], pbPred[CTU_WIDTH*CHECK_STRIDE];
+	byte pbRecC[CTU_WIDTH*CHECK_STRIDE], pbRec[CTU_WIDTH*CHECK_STRIDE];
+	i16 piRes[CTU_WIDTH*CTU_WIDTH], piCoeff[CTU_WIDTH*CTU_WIDTH];
+	i16 piTmpC[CTU_WIDTH*CTU_WIDTH], piTmp[CTU_WIDTH*CTU_WIDTH];
+	i16 piOutC[CTU_WIDTH*CTU_WIDTH], piOut[CTU_WIDTH*CTU_WIDTH];
+
+	for(u32 t=0;t<5;t++)
+	{
+		u32 uiLog2Size = t ? t+1 : 2;	// The 4x4 DST, then the 4x4 to 32x32 DCT
+		u32 uiSize = 1 << uiLog2Size;
+		u32 uiLen = uiSize*uiSize*sizeof(i16);
+
+		if(CheckBegin(sCheck, (void const *)sCheck.psPrev->pfDCT[t], (void const *)sCheck.psCurr->pfDCT[t]))
+		{
+			// Both stages of the forward transform of a residue (see H265Transform::ResDCT())
+			bit bSame = true;
+			for(u32 r=0;r<CHECK_ROUNDS;r++)
+			{
+				CheckFillBytes(sCheck, r, pbSrc, uiSize*uiSize);
+				CheckFillBytes(sCheck, r < 4 ? 3-r : r, pbPred, uiSize*uiSize);
+				for(u32 i=0;i<uiSize*uiSize;i++)
+					piRes[i] = pbSrc[i] - pbPred[i];
+				sCheck.psC->pfDCT[t](piTmpC, piRes, uiSize, uiSize, uiLog2Size-1);
+				sCheck.psCurr->pfDCT[t](piTmp, piRes, uiSize, uiSize, uiLog2Size-1);
+				bSame &= memcmp(piTmp, piTmpC, uiLen) == 0;
+				sCheck.psC->pfDCT[t](piOutC, piTmpC, uiSize, uiSize, uiLog2Size+6);
+				sCheck.psCurr->pfDCT[t](piOut, piTmpC, uiSize, uiSize, uiLog2Size+6);
+				bSame &= memcmp(piOut, piOutC, uiLen) == 0;
+			}
+			CheckEnd(sCheck, bSame, "pfDCT", t);
+		}
+
+		if(CheckBegin(sCheck, (void const *)sCheck.psPrev->pfIDCT[t], (void const *)sCheck.psCurr->pfIDCT[t]))
+		{
+			bit bSame = true;
+			for(u32 r=0;r<CHECK_ROUNDS;r++)
+			{
+				CheckFillCoeffs(sCheck, r, piCoeff, uiSize*uiSize);
+				sCheck.psC->pfIDCT[t](piTmpC, piCoeff, uiSize, uiSize, SHIFT_INV_1);
+				sCheck.psCurr->pfIDCT[t](piTmp, piCoeff, uiSize, uiSize, SHIFT_INV_1);
+				bSame &= memcmp(piTmp, piTmpC, uiLen) == 0;
+			}
+			CheckEnd(sCheck, bSame, "pfIDCT", t);
+		}
+
+		if(CheckBegin(sCheck, (void const *)sCheck.psPrev->pfIDCTRec[t], (void const *)sCheck.psCurr->pfIDCTRec[t]))
+		{
+			bit bSame = true;
+			for(u32 r=0;r<CHECK_ROUNDS;r++)
+			{
+				CheckFillCoeffs(sCheck, r, piCoeff, uiSize*uiSize);
+				CheckFillBytes(sCheck, r, pbPred, sizeof(pbPred));
+				sCheck.psC->pfIDCT[t](piTmpC, piCoeff, uiSize, uiSize, SHIFT_INV_1);
+				u32 uiPredStride = (r & 1) ? uiSize : CHECK_STRIDE;
+				memset(pbRecC, 0, sizeof(pbRecC));
+				memset(pbRec, 0, sizeof(pbRec));
+				sCheck.psC->pfIDCTRec[t](pbRecC, CHECK_STRIDE, piTmpC, uiSize, pbPred, uiPredStride);
+				sCheck.psCurr->pfIDCTRec[t](pbRec, CHECK_STRIDE, piTmpC, uiSize, pbPred, uiPredStride);
+				bSame &= memcmp(pbRec, pbRecC, sizeof(pbRec)) == 0;
+			}
+			CheckEnd(sCheck, bSame, "pfIDCTRec", t);
+		}
+	}
+}
+
+static void CheckQuant(KernelCheck_t &sCheck)
+{
+	i16 piSrc[CTU_WIDTH*CTU_WIDTH];
+	i16 piCoeffC[CTU_WIDTH*CTU_WIDTH], piCoeff[CTU_WIDTH*CTU_WIDTH];
+	i16 piDestC[CTU_WIDTH*CTU_WIDTH], piDest[CTU_WIDTH*CTU_WIDTH];
+	u16 puiSigMapC[(CTU_WIDTH>>2)*(CTU_WIDTH>>2)], puiSigMap[(CTU_WIDTH>>2)*(CTU_WIDTH>>2)];
+
+	for(u32 t=0;t<4;t++)
+	{
+		u32 uiLog2Size = t+2;
+		u32 uiSize = 1 << uiLog2Size;
+		bit bCheckQuant = CheckBegin(sCheck, (void const *)sCheck.psPrev->pfQuant[t], (void const *)sCheck.psCurr->pfQuant[t]);
+		bit bCheckInvQuant = CheckBegin(sCheck, (void const *)sCheck.psPrev->pfInvQuant[t], (void const *)sCheck.psCurr->pfInvQuant[t]);
+		bit bSameQuant = true, bSameInvQuant = true;
+		for(u32 r=0;r<CHECK_ROUNDS && (bCheckQuant || bCheckInvQuant);r++)
+		{
+			// The parameters of H265Transform::Quant() and H265Transform::InvQuant() with a QP of the round,
+			// and the coefficients in a block of the CTU with the stride of the luma or the chroma, which have no blocks of the CTU size
+			u32 uiQP = (r*13) % 52;
+			u32 uiStride = (r & 1) || uiSize == CTU_WIDTH ? CTU_WIDTH : (CTU_WIDTH>>1);
+			i32 iTransShift = MAX_TR_DYN_RANGE - 8 - uiLog2Size;
+			i32 iQBits = QUANT_SHIFT + uiQP/6 + iTransShift;
+			i32 iRound = ((r & 2) ? 171 : 85) << (iQBits - 9);
+
+			CheckFillCoeffs(sCheck, r, piSrc, CTU_WIDTH*CTU_WIDTH);
+			memset(piCoeffC, 0, sizeof(piCoeffC));
+			memset(piCoeff, 0, sizeof(piCoeff));
+			memset(puiSigMapC, 0, sizeof(puiSigMapC));
+			memset(puiSigMap, 0, sizeof(puiSigMap));
+			u32 uiNumC = sCheck.psC->pfQuant[t](piCoeffC, uiStride, puiSigMapC, piSrc, uiSize, g_piQuantScales[uiQP%6], iRound, iQBits);
+			if(bCheckQuant)
+			{
+				u32 uiNum = sCheck.psCurr->pfQuant[t](piCoeff, uiStride, puiSigMap, piSrc, uiSize, g_piQuantScales[uiQP%6], iRound, iQBits);
+				bSameQuant &= uiNum == uiNumC && memcmp(piCoeff, piCoeffC, sizeof(piCoeff)) == 0 && memcmp(puiSigMap, puiSigMapC, sizeof(puiSigMap)) == 0;
+			}
+			if(bCheckInvQuant)
+			{
+				i32 iScale = g_piInvQuantScales[uiQP%6] << (uiQP/6);
+				u32 uiShift = IQUANT_SHIFT - QUANT_SHIFT - iTransShift;
+				memset(piDestC, 0, sizeof(piDestC));
+				memset(piDest, 0, sizeof(piDest));
+				sCheck.psC->pfInvQuant[t](piDestC, uiSize, piCoeffC, uiStride, puiSigMapC, iScale, uiShift);
+				sCheck.psCurr->pfInvQuant[t](piDest, uiSize, piCoeffC, uiStride, puiSigMapC, iScale, uiShift);
+				bSameInvQuant &= memcmp(piDest, piDestC, sizeof(piDest)) == 0;
+			}
+		}
+		if(bCheckQuant)
+			CheckEnd(sCheck, bSameQuant, "pfQuant", t);
+		if(bCheckInvQuant)
+			CheckEnd(sCheck, bSameInvQuant, "pfInvQuant", t);
+	}
+}
+
+u32 CheckKernels(eCPULevel eLevel, bit bVerbose)
+{
+	Kernels_t sC, sPrev, sCurr;
+	InitKernelsC(sC);
+	u32 uiFailed = 0;
+
+	for(u32 uiLevel=CPU_LEVEL_C+1;uiLevel<=u32(eLevel);uiLevel++)
+	{
+		KernelCheck_t sCheck;
+		FillKernels(sPrev, eCPULevel(uiLevel-1));
+		FillKernels(sCurr, eCPULevel(uiLevel));
+		sCheck.psC = &sC;
+		sCheck.psPrev = &sPrev;
+		sCheck.psCurr = &sCurr;
+		sCheck.pcLevel = GetCPULevelName(eCPULevel(uiLevel));
+		sCheck.uiChecked = 0;
+		sCheck.uiFailed = 0;
+		sCheck.uiSeed = 1;
+
+		CheckSAD(sCheck);
+		CheckIntraPred(sCheck);
+		CheckTransforms(sCheck);
+		CheckQuant(sCheck);
+
+		if(bVerbose)
+			printf("Trace: %u kernels of %s checked, %u differ from the C kernels.\n", sCheck.uiChecked, sCheck.pcLevel, sCheck.uiFailed);
+		uiFailed += sCheck.uiFailed;
+	}
+	return uiFailed;
+}
@@ -0,0 +1,804 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file KernelsSSE41.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the SSE4.1 kernels.
+*/
+
+#include <KernelsX86.h>
+#include <H265Transform.h>
+
+#if ARCH_X86
+
+/**
+*	Add up the two 64-bit sums of PSADBW.
+*/
+TARGET_SSE41 static inline u32 SumSAD(__m128i mSAD)
+{
+	return u32(_mm_cvtsi128_si32(mSAD) + _mm_extract_epi32(mSAD, 2));
+}
+
+TARGET_SSE41 static u32 SAD4x4SSE41(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m128i mSrc = _mm_setr_epi32(Load32(pbSrc), Load32(pbSrc+uiSrcStride), Load32(pbSrc+2*uiSrcStride), Load32(pbSrc+3*uiSrcStride));
+	__m128i mRef = _mm_setr_epi32(Load32(pbRef), Load32(pbRef+uiRefStride), Load32(pbRef+2*uiRefStride), Load32(pbRef+3*uiRefStride));
+	return SumSAD(_mm_sad_epu8(mSrc, mRef));
+}
+
+TARGET_SSE41 static u32 SAD8x8SSE41(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m128i mSum = _mm_setzero_si128();
+	for(u32 i=0;i<8;i+=2)	// Two rows at once
+	{
+		__m128i mSrc = _mm_unpacklo_epi64(_mm_loadl_epi64((__m128i const *)(pbSrc+i*uiSrcStride)),
+			_mm_loadl_epi64((__m128i const *)(pbSrc+(i+1)*uiSrcStride)));
+		__m128i mRef = _mm_unpacklo_epi64(_mm_loadl_epi64((__m128i const *)(pbRef+i*uiRefStride)),
+			_mm_loadl_epi64((__m128i const *)(pbRef+(i+1)*uiRefStride)));
+		mSum = _mm_add_epi32(mSum, _mm_sad_epu8(mSrc, mRef));
+	}
+	return SumSAD(mSum);
+}
+
+TARGET_SSE41 static u32 SAD16x16SSE41(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m128i mSum = _mm_setzero_si128();
+	for(u32 i=0;i<16;i++)
+	{
+		__m128i mSrc = _mm_loadu_si128((__m128i const *)(pbSrc+i*uiSrcStride));
+		__m128i mRef = _mm_loadu_si128((__m128i const *)(pbRef+i*uiRefStride));
+		mSum = _mm_add_epi32(mSum, _mm_sad_epu8(mSrc, mRef));
+	}
+	return SumSAD(mSum);
+}
+
+TARGET_SSE41 static u32 SAD32x32SSE41(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m128i mSum = _mm_setzero_si128();
+	for(u32 i=0;i<32;i++)
+	{
+		byte const *pbSrcRow = pbSrc+i*uiSrcStride;
+		byte const *pbRefRow = pbRef+i*uiRefStride;
+		mSum = _mm_add_epi32(mSum, _mm_sad_epu8(_mm_loadu_si128((__m128i const *)pbSrcRow), _mm_loadu_si128((__m128i const *)pbRefRow)));
+		mSum = _mm_add_epi32(mSum, _mm_sad_epu8(_mm_loadu_si128((__m128i const *)(pbSrcRow+16)), _mm_loadu_si128((__m128i const *)(pbRefRow+16))));
+	}
+	return SumSAD(mSum);
+}
+
+/**
+*	Differences of 8 samples of a row as 16-bit values.
+*/
+TARGET_SSE41 static inline __m128i Diff8(byte const *pbSrc, byte const *pbRef)
+{
+	return _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const *)pbSrc)), _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const *)pbRef)));
+}
+
+/**
+*	Butterflies of an 8-point Hadamard transform across 8 registers, i.e. on each of their 16-bit lanes.
+*/
+TARGET_SSE41 static inline void Hadamard8(__m128i &m0, __m128i &m1, __m128i &m2, __m128i &m3, __m128i &m4, __m128i &m5, __m128i &m6, __m128i &m7)
+{
+	__m128i mA0 = _mm_add_epi16(m0, m4), mA4 = _mm_sub_epi16(m0, m4);
+	__m128i mA1 = _mm_add_epi16(m1, m5), mA5 = _mm_sub_epi16(m1, m5);
+	__m128i mA2 = _mm_add_epi16(m2, m6), mA6 = _mm_sub_epi16(m2, m6);
+	__m128i mA3 = _mm_add_epi16(m3, m7), mA7 = _mm_sub_epi16(m3, m7);
+	__m128i mB0 = _mm_add_epi16(mA0, mA2), mB2 = _mm_sub_epi16(mA0, mA2);
+	__m128i mB1 = _mm_add_epi16(mA1, mA3), mB3 = _mm_sub_epi16(mA1, mA3);
+	__m128i mB4 = _mm_add_epi16(mA4, mA6), mB6 = _mm_sub_epi16(mA4, mA6);
+	__m128i mB5 = _mm_add_epi16(mA5, mA7), mB7 = _mm_sub_epi16(mA5, mA7);
+	m0 = _mm_add_epi16(mB0, mB1); m1 = _mm_sub_epi16(mB0, mB1);
+	m2 = _mm_add_epi16(mB2, mB3); m3 = _mm_sub_epi16(mB2, mB3);
+	m4 = _mm_add_epi16(mB4, mB5); m5 = _mm_sub_epi16(mB4, mB5);
+	m6 = _mm_add_epi16(mB6, mB7); m7 = _mm_sub_epi16(mB6, mB7);
+}
+
+/**
+*	Transpose an 8x8 block of 16-bit values.
+*/
+TARGET_SSE41 static inline void Transpose8x8Words(__m128i &m0, __m128i &m1, __m128i &m2, __m128i &m3, __m128i &m4, __m128i &m5, __m128i &m6, __m128i &m7)
+{
+	__m128i mA0 = _mm_unpacklo_epi16(m0, m1), mA1 = _mm_unpackhi_epi16(m0, m1);
+	__m128i mA2 = _mm_unpacklo_epi16(m2, m3), mA3 = _mm_unpackhi_epi16(m2, m3);
+	__m128i mA4 = _mm_unpacklo_epi16(m4, m5), mA5 = _mm_unpackhi_epi16(m4, m5);
+	__m128i mA6 = _mm_unpacklo_epi16(m6, m7), mA7 = _mm_unpackhi_epi16(m6, m7);
+	__m128i mB0 = _mm_unpacklo_epi32(mA0, mA2), mB1 = _mm_unpackhi_epi32(mA0, mA2);
+	__m128i mB2 = _mm_unpacklo_epi32(mA1, mA3), mB3 = _mm_unpackhi_epi32(mA1, mA3);
+	__m128i mB4 = _mm_unpacklo_epi32(mA4, mA6), mB5 = _mm_unpackhi_epi32(mA4, mA6);
+	__m128i mB6 = _mm_unpacklo_epi32(mA5, mA7), mB7 = _mm_unpackhi_epi32(mA5, mA7);
+	m0 = _mm_unpacklo_epi64(mB0, mB4); m1 = _mm_unpackhi_epi64(mB0, mB4);
+	m2 = _mm_unpacklo_epi64(mB1, mB5); m3 = _mm_unpackhi_epi64(mB1, mB5);
+	m4 = _mm_unpacklo_epi64(mB2, mB6); m5 = _mm_unpackhi_epi64(mB2, mB6);
+	m6 = _mm_unpacklo_epi64(mB3, mB7); m7 = _mm_unpackhi_epi64(mB3, mB7);
+}
+
+/**
+*	Hadamard transform of the differences of an 8x8 block.
+*	@see SATDFunc_t
+*	@return Sum of the absolute transformed differences divided by 4, in the lowest 32-bit lane.
+*/
+TARGET_SSE41 static inline __m128i Hadamard8x8SSE41(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m128i m0 = Diff8(pbSrc, pbRef);
+	__m128i m1 = Diff8(pbSrc+uiSrcStride, pbRef+uiRefStride);
+	__m128i m2 = Diff8(pbSrc+2*uiSrcStride, pbRef+2*uiRefStride);
+	__m128i m3 = Diff8(pbSrc+3*uiSrcStride, pbRef+3*uiRefStride);
+	__m128i m4 = Diff8(pbSrc+4*uiSrcStride, pbRef+4*uiRefStride);
+	__m128i m5 = Diff8(pbSrc+5*uiSrcStride, pbRef+5*uiRefStride);
+	__m128i m6 = Diff8(pbSrc+6*uiSrcStride, pbRef+6*uiRefStride);
+	__m128i m7 = Diff8(pbSrc+7*uiSrcStride, pbRef+7*uiRefStride);
+
+	// The columns, and the rows after the transpose. The values stay within 16 bits (at most 64*255).
+	Hadamard8(m0, m1, m2, m3, m4, m5, m6, m7);
+	Transpose8x8Words(m0, m1, m2, m3, m4, m5, m6, m7);
+	Hadamard8(m0, m1, m2, m3, m4, m5, m6, m7);
+
+	// Two absolute values still fit in a signed 16-bit lane
+	__m128i mOnes = _mm_set1_epi16(1);
+	__m128i mSum = _mm_madd_epi16(_mm_add_epi16(_mm_abs_epi16(m0), _mm_abs_epi16(m1)), mOnes);
+	mSum = _mm_add_epi32(mSum, _mm_madd_epi16(_mm_add_epi16(_mm_abs_epi16(m2), _mm_abs_epi16(m3)), mOnes));
+	mSum = _mm_add_epi32(mSum, _mm_madd_epi16(_mm_add_epi16(_mm_abs_epi16(m4), _mm_abs_epi16(m5)), mOnes));
+	mSum = _mm_add_epi32(mSum, _mm_madd_epi16(_mm_add_epi16(_mm_abs_epi16(m6), _mm_abs_epi16(m7)), mOnes));
+	mSum = _mm_hadd_epi32(mSum, mSum);
+	mSum = _mm_hadd_epi32(mSum, mSum);
+	return _mm_srli_epi32(_mm_add_epi32(mSum, _mm_set1_epi32(2)), 2);
+}
+
+TARGET_SSE41 static u32 SATD4x4SSE41(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m128i mSrc = _mm_setr_epi32(Load32(pbSrc), Load32(pbSrc+uiSrcStride), Load32(pbSrc+2*uiSrcStride), Load32(pbSrc+3*uiSrcStride));
+	__m128i mRef = _mm_setr_epi32(Load32(pbRef), Load32(pbRef+uiRefStride), Load32(pbRef+2*uiRefStride), Load32(pbRef+3*uiRefStride));
+	__m128i mZero = _mm_setzero_si128();
+	__m128i mRows01 = _mm_sub_epi16(_mm_unpacklo_epi8(mSrc, mZero), _mm_unpacklo_epi8(mRef, mZero));	// Rows 0 and 1
+	__m128i mRows23 = _mm_sub_epi16(_mm_unpackhi_epi8(mSrc, mZero), _mm_unpackhi_epi8(mRef, mZero));	// Rows 2 and 3
+
+	// Columns: rows 0+2 and 1+3, and 0-2 and 1-3, then the sums and differences of the two
+	__m128i mA = _mm_add_epi16(mRows01, mRows23);
+	__m128i mB = _mm_sub_epi16(mRows01, mRows23);
+	__m128i mC = _mm_unpacklo_epi64(mA, mB);
+	__m128i mD = _mm_unpackhi_epi64(mA, mB);
+	mA = _mm_add_epi16(mC, mD);
+	mB = _mm_sub_epi16(mC, mD);
+
+	// Rows: the horizontal sums and differences of the pairs, twice
+	mC = _mm_hadd_epi16(mA, mB);
+	mD = _mm_hsub_epi16(mA, mB);
+	mA = _mm_hadd_epi16(mC, mD);
+	mB = _mm_hsub_epi16(mC, mD);
+
+	__m128i mSum = _mm_madd_epi16(_mm_add_epi16(_mm_abs_epi16(mA), _mm_abs_epi16(mB)), _mm_set1_epi16(1));
+	mSum = _mm_hadd_epi32(mSum, mSum);
+	mSum = _mm_hadd_epi32(mSum, mSum);
+	return (u32(_mm_cvtsi128_si32(mSum)) + 1) >> 1;
+}
+
+/**
+*	SATD of a square block of 8x8 or more with SSE4.1.
+*	@param uiSize Width and height of the block.
+*	@see SATDFunc_t
+*/
+TARGET_SSE41 static inline u32 SATDSSE41(u32 uiSize, byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride)
+{
+	__m128i mSum = _mm_setzero_si128();
+	for(u32 i=0;i<uiSize;i+=8)
+		for(u32 j=0;j<uiSize;j+=8)
+			mSum = _mm_add_epi32(mSum, Hadamard8x8SSE41(pbSrc+i*uiSrcStride+j, uiSrcStride, pbRef+i*uiRefStride+j, uiRefStride));
+	return u32(_mm_cvtsi128_si32(mSum));
+}
+
+TARGET_SSE41 static u32 SATD8x8SSE41(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SATDSSE41(8, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+TARGET_SSE41 static u32 SATD16x16SSE41(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SATDSSE41(16, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+TARGET_SSE41 static u32 SATD32x32SSE41(byte const *pbSrc, u32 uiSrcStride, byte const *pbRef, u32 uiRefStride){return SATDSSE41(32, pbSrc, uiSrcStride, pbRef, uiRefStride);}
+
+/**
+*	Interpolate 8 samples of a row of the angular prediction, ((32-iFact)*pbMainRef[x] + iFact*pbMainRef[x+1] + 16) >> 5.
+*	@param pbMainRef First reference sample of the row.
+*	@param mWeights The weights 32-iFact and iFact in every pair of bytes.
+*	@return The 8 samples in the lower 8 bytes.
+*/
+TARGET_SSE41 static inline __m128i InterpolateAng8(byte const *pbMainRef, __m128i mWeights)
+{
+	__m128i mPairs = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)pbMainRef), _mm_loadl_epi64((__m128i const *)(pbMainRef+1)));
+	__m128i mSum = _mm_srli_epi16(_mm_add_epi16(_mm_maddubs_epi16(mPairs, mWeights), _mm_set1_epi16(16)), 5);
+	return _mm_packus_epi16(mSum, mSum);
+}
+
+/**
+*	Interpolate 16 samples of a row of the angular prediction.
+*	@see InterpolateAng8()
+*/
+TARGET_SSE41 static inline __m128i InterpolateAng16(byte const *pbMainRef, __m128i mWeights)
+{
+	__m128i mA = _mm_loadu_si128((__m128i const *)pbMainRef);
+	__m128i mB = _mm_loadu_si128((__m128i const *)(pbMainRef+1));
+	__m128i mRound = _mm_set1_epi16(16);
+	__m128i mLo = _mm_srli_epi16(_mm_add_epi16(_mm_maddubs_epi16(_mm_unpacklo_epi8(mA, mB), mWeights), mRound), 5);
+	__m128i mHi = _mm_srli_epi16(_mm_add_epi16(_mm_maddubs_epi16(_mm_unpackhi_epi8(mA, mB), mWeights), mRound), 5);
+	return _mm_packus_epi16(mLo, mHi);
+}
+
+/**
+*	Angular intra prediction with SSE4.1.
+*	Each row is interpolated with PMADDUBSW from the pairs of reference samples and the pairs of weights.
+*	@param uiSize Width and height of the block.
+*	@see IntraPredAngFunc_t
+*/
+TARGET_SSE41 static inline void IntraPredAngSSE41(u32 uiSize, byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose)
+{
+	i32 iDeltaPos = 0;
+	for(u32 k=0;k<uiSize;k++)
+	{
+		iDeltaPos += iAngle;
+		i32 iIdx = iDeltaPos >> 5;	// Equation 8-53
+		i32 iFact = iDeltaPos & 0x1F;	// Equation 8-54
+		byte const *pbRow = pbMainRef+iIdx+1;
+		byte *pbPredRow = pbPred+k*uiSize;
+
+		if(iFact)	// We need to filter
+		{
+			__m128i mWeights = _mm_set1_epi16(i16((iFact << 8) | (32-iFact)));
+			if(uiSize == 4)
+				Store32(pbPredRow, _mm_cvtsi128_si32(InterpolateAng8(pbRow, mWeights)));
+			else if(uiSize == 8)
+				_mm_storel_epi64((__m128i *)pbPredRow, InterpolateAng8(pbRow, mWeights));
+			else
+				for(u32 x=0;x<uiSize;x+=16)
+					_mm_storeu_si128((__m128i *)(pbPredRow+x), InterpolateAng16(pbRow+x, mWeights));
+		}
+		else
+			memcpy(pbPredRow, pbRow, uiSize);
+	}
+
+	FinishIntraPredAng(uiSize, pbPred, pbSideRef, bTranspose);
+}
+
+TARGET_SSE41 static void IntraPredAng4x4SSE41(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose){IntraPredAngSSE41(4, pbPred, pbMainRef, pbSideRef, iAngle, bTranspose);}
+TARGET_SSE41 static void IntraPredAng8x8SSE41(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose){IntraPredAngSSE41(8, pbPred, pbMainRef, pbSideRef, iAngle, bTranspose);}
+TARGET_SSE41 static void IntraPredAng16x16SSE41(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose){IntraPredAngSSE41(16, pbPred, pbMainRef, pbSideRef, iAngle, bTranspose);}
+TARGET_SSE41 static void IntraPredAng32x32SSE41(byte *pbPred, byte const *pbMainRef, byte const *pbSideRef, i32 iAngle, bit bTranspose){IntraPredAngSSE41(32, pbPred, pbMainRef, pbSideRef, iAngle, bTranspose);}
+
+/**
+*	DC intra prediction with SSE4.1.
+*	The sums are made with PSADBW and the filtered edges in 16-bit lanes.
+*	@param uiSize Width and height of the block.
+*	@see IntraPredDCFunc_t
+*/
+TARGET_SSE41 static inline void IntraPredDCSSE41(u32 uiSize, byte *pbPred, byte const *pbRef, bit bFilterEdge)
+{
+	byte const *pbTop = pbRef + (uiSize<<1) + 1;
+	byte const *pbLeft = pbRef + uiSize;	// The left samples from the bottom to the top
+	__m128i mZero = _mm_setzero_si128();
+	__m128i mSum;
+
+	// Get DC value
+	if(uiSize == 4)
+		mSum = _mm_sad_epu8(_mm_setr_epi32(Load32(pbTop), Load32(pbLeft), 0, 0), mZero);
+	else if(uiSize == 8)
+		mSum = _mm_sad_epu8(_mm_unpacklo_epi64(_mm_loadl_epi64((__m128i const *)pbTop), _mm_loadl_epi64((__m128i const *)pbLeft)), mZero);
+	else
+	{
+		mSum = mZero;
+		for(u32 i=0;i<uiSize;i+=16)
+		{
+			mSum = _mm_add_epi32(mSum, _mm_sad_epu8(_mm_loadu_si128((__m128i const *)(pbTop+i)), mZero));
+			mSum = _mm_add_epi32(mSum, _mm_sad_epu8(_mm_loadu_si128((__m128i const *)(pbLeft+i)), mZero));
+		}
+	}
+	u32 uiDCVal = (SumSAD(mSum) + uiSize) >> (LOG2(uiSize-1) + 1);
+
+	// Copy DC values to all locations of the predictor
+	__m128i mDC = _mm_set1_epi8(i8(uiDCVal));
+	for(u32 i=0;i<uiSize*uiSize;i+=16)
+		_mm_storeu_si128((__m128i *)(pbPred+i), mDC);
+
+	if(bFilterEdge)	// Luma pixels require DC filtering
+	{
+		// Filter 8 samples of the first row and of the first column at once, the latter from the bottom to the top
+		byte pbRow[CTU_WIDTH+8];
+		byte pbCol[CTU_WIDTH+8];
+		__m128i mDCx3 = _mm_set1_epi16(i16(3*uiDCVal + 2));
+		for(u32 x=0;x<uiSize;x+=8)
+		{
+			__m128i mRow = _mm_srli_epi16(_mm_add_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const *)(pbTop+x))), mDCx3), 2);
+			__m128i mCol = _mm_srli_epi16(_mm_add_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const *)(pbLeft+x))), mDCx3), 2);
+			_mm_storel_epi64((__m128i *)(pbRow+x), _mm_packus_epi16(mRow, mRow));
+			_mm_storel_epi64((__m128i *)(pbCol+x), _mm_packus_epi16(mCol, mCol));
+		}
+		pbRow[0] = (pbLeft[uiSize-1] + (uiDCVal<<1) + pbTop[0] + 2) >> 2;
+		memcpy(pbPred, pbRow, uiSize);
+		for(u32 y=1;y<uiSize;y++)
+			pbPred[y*uiSize] = pbCol[uiSize-1-y];
+	}
+}
+
+TARGET_SSE41 static void IntraPredDC4x4SSE41(byte *pbPred, byte const *pbRef, bit bFilterEdge){IntraPredDCSSE41(4, pbPred, pbRef, bFilterEdge);}
+TARGET_SSE41 static void IntraPredDC8x8SSE41(byte *pbPred, byte const *pbRef, bit bFilterEdge){IntraPredDCSSE41(8, pbPred, pbRef, bFilterEdge);}
+TARGET_SSE41 static void IntraPredDC16x16SSE41(byte *pbPred, byte const *pbRef, bit bFilterEdge){IntraPredDCSSE41(16, pbPred, pbRef, bFilterEdge);}
+TARGET_SSE41 static void IntraPredDC32x32SSE41(byte *pbPred, byte const *pbRef, bit bFilterEdge){IntraPredDCSSE41(32, pbPred, pbRef, bFilterEdge);}
+
+/**
+*	Planar intra prediction with SSE4.1.
+*	A row is made of 8 samples at once in 16-bit lanes, and the largest sum of a 32x32 block is below 2^15.
+*	The part (size-1-y)*pbTop[x] + (y+1)*bBottomLeft is updated from row to row.
+*	@param uiSize Width and height of the block.
+*	@see IntraPredPlanarFunc_t
+*/
+TARGET_SSE41 static inline void IntraPredPlanarSSE41(u32 uiSize, byte *pbPred, byte const *pbRef)
+{
+	byte const *pbTop = pbRef + (uiSize<<1) + 1;
+	byte const *pbLeft = pbRef + (uiSize<<1) - 1;	// The left array starts from the top and goes to the bottom. We must have a negative iterator
+	u32 uiNumChunks = (uiSize+7) >> 3;
+	i32 iShift = LOG2(uiSize-1) + 1;
+
+	__m128i mBottomLeft = _mm_set1_epi16(pbLeft[-i32(uiSize)]);
+	__m128i mTopRight = _mm_set1_epi16(pbTop[uiSize]);
+	__m128i pmTopComp[CTU_WIDTH/8];		// (size-1-y)*pbTop[x] + (y+1)*bBottomLeft of the current row
+	__m128i pmTopDelta[CTU_WIDTH/8];	// bBottomLeft - pbTop[x]
+	__m128i pmLeftWeight[CTU_WIDTH/8];	// size-1-x
+	__m128i pmRightComp[CTU_WIDTH/8];	// (x+1)*bTopRight + size
+	for(u32 c=0;c<uiNumChunks;c++)
+	{
+		__m128i mX = _mm_add_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _mm_set1_epi16(i16(c << 3)));
+		__m128i mTop = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const *)(pbTop+(c << 3))));
+		pmTopComp[c] = _mm_add_epi16(_mm_mullo_epi16(mTop, _mm_set1_epi16(i16(uiSize-1))), mBottomLeft);
+		pmTopDelta[c] = _mm_sub_epi16(mBottomLeft, mTop);
+		pmLeftWeight[c] = _mm_sub_epi16(_mm_set1_epi16(i16(uiSize-1)), mX);
+		pmRightComp[c] = _mm_add_epi16(_mm_mullo_epi16(_mm_add_epi16(mX, _mm_set1_epi16(1)), mTopRight), _mm_set1_epi16(i16(uiSize)));
+	}
+
+	for(u32 y=0;y<uiSize;y++)
+	{
+		__m128i mLeft = _mm_set1_epi16(pbLeft[-i32(y)]);
+		__m128i pmRow[CTU_WIDTH/8];
+		for(u32 c=0;c<uiNumChunks;c++)
+		{
+			pmRow[c] = _mm_add_epi16(_mm_add_epi16(pmTopComp[c], _mm_mullo_epi16(pmLeftWeight[c], mLeft)), pmRightComp[c]);
+			pmRow[c] = _mm_srli_epi16(pmRow[c], iShift);
+			pmTopComp[c] = _mm_add_epi16(pmTopComp[c], pmTopDelta[c]);
+		}
+
+		byte *pbPredRow = pbPred+y*uiSize;
+		if(uiSize == 4)
+			Store32(pbPredRow, _mm_cvtsi128_si32(_mm_packus_epi16(pmRow[0], pmRow[0])));
+		else if(uiSize == 8)
+			_mm_storel_epi64((__m128i *)pbPredRow, _mm_packus_epi16(pmRow[0], pmRow[0]));
+		else
+			for(u32 c=0;c<uiNumChunks;c+=2)
+				_mm_storeu_si128((__m128i *)(pbPredRow+(c << 3)), _mm_packus_epi16(pmRow[c], pmRow[c+1]));
+	}
+}
+
+TARGET_SSE41 static void IntraPredPlanar4x4SSE41(byte *pbPred, byte const *pbRef){IntraPredPlanarSSE41(4, pbPred, pbRef);}
+TARGET_SSE41 static void IntraPredPlanar8x8SSE41(byte *pbPred, byte const *pbRef){IntraPredPlanarSSE41(8, pbPred, pbRef);}
+TARGET_SSE41 static void IntraPredPlanar16x16SSE41(byte *pbPred, byte const *pbRef){IntraPredPlanarSSE41(16, pbPred, pbRef);}
+TARGET_SSE41 static void IntraPredPlanar32x32SSE41(byte *pbPred, byte const *pbRef){IntraPredPlanarSSE41(32, pbPred, pbRef);}
+
+/**
+*	[1 2 1] filter of the 8 reference samples from pbRef[i], in 16-bit lanes.
+*/
+TARGET_SSE41 static inline void FilterRef8SSE41(byte *pbFiltered, byte const *pbRef, u32 i)
+{
+	__m128i mPrev = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const *)(pbRef+i-1)));
+	__m128i mCurr = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const *)(pbRef+i)));
+	__m128i mNext = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const *)(pbRef+i+1)));
+	__m128i mSum = _mm_add_epi16(_mm_add_epi16(mPrev, _mm_slli_epi16(mCurr, 1)), _mm_add_epi16(mNext, _mm_set1_epi16(2)));
+	mSum = _mm_srli_epi16(mSum, 2);
+	_mm_storel_epi64((__m128i *)(pbFiltered+i), _mm_packus_epi16(mSum, mSum));
+}
+
+/**
+*	Reference samples with SSE4.1. Each neighbourhood is fetched or substituted, and then the 8 samples
+*	whose right neighbour is there are filtered at once, while they are still in the cache.
+*	The last 8 samples overlap the ones before them, so that nothing after the reference samples is read.
+*	@see RefSamplesFunc_t
+*/
+TARGET_SSE41 static void RefSamplesSSE41(byte *pbRef, byte *pbFiltered, byte const *pbLeft, u32 uiLeftStride, byte const *pbTopLeft,
+										u32 const *puiRefOffset, u8 bValidFlag, u32 uiSize)
+{
+	u32 uiLast = 4*uiSize;
+	u32 uiFirst = 0;	// First available neighbourhood
+	while(!(bValidFlag & (1 << uiFirst)))
+		uiFirst++;
+
+	// The samples before the first available one take its value (see 8.4.3.1.1 in draft)
+	u32 uiStart = puiRefOffset[uiFirst];
+	byte bSubstitute = uiStart < 2*uiSize ? pbLeft[(2*uiSize-1-uiStart)*uiLeftStride] : pbTopLeft[uiStart-2*uiSize];
+
+	u32 uiFiltered = 1;	// Next sample to filter
+	for(u32 n=0;n<5;n++)
+	{
+		u32 uiEnd = puiRefOffset[n+1];
+		if(!(bValidFlag & (1 << n)))	// Unavailable samples repeat the last one
+		{
+			memset(pbRef+puiRefOffset[n], bSubstitute, uiEnd-puiRefOffset[n]);
+		}
+		else
+		{
+			u32 i = puiRefOffset[n];
+			for(;i<uiEnd && i<2*uiSize;i++)	// Left samples go upwards
+				pbRef[i] = pbLeft[(2*uiSize-1-i)*uiLeftStride];
+			if(i < uiEnd)					// The top ones to the right
+				memcpy(pbRef+i, pbTopLeft+i-2*uiSize, uiEnd-i);
+			bSubstitute = pbRef[uiEnd-1];
+		}
+		for(;uiFiltered+8<uiEnd;uiFiltered+=8)
+			FilterRef8SSE41(pbFiltered, pbRef, uiFiltered);
+	}
+	if(uiFiltered < uiLast)
+		FilterRef8SSE41(pbFiltered, pbRef, uiLast-8);
+	pbFiltered[0] = pbRef[0];				// Bottom left pixel
+	pbFiltered[uiLast] = pbRef[uiLast];		// Top right pixel
+}
+
+/**
+*	Forward transform with SSE4.1, as the product of the transform matrix with the lines.
+*	The pairs of samples of 4 lines are multiplied with a pair of coefficients of a row of the matrix by PMADDWD,
+*	so that a row of the destination is made for 8 lines at once. The sums are the same as with the butterflies.
+*	@param uiSize Size of the transform (8 to 32).
+*	@param piT Transform matrix.
+*	@see DCTFunc_t
+*/
+TARGET_SSE41 static inline void DCTSSE41(u32 uiSize, i16 const *piT, i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	__m128i mRound = _mm_set1_epi32(1 << (uiShift-1));
+	__m128i pmPairs[CTU_WIDTH];
+
+	for(u32 i=0;i<uiTrLines;i+=8)
+	{
+		LoadPairs(piSrc+i*uiStride, uiStride, uiSize, pmPairs);
+		for(u32 k=0;k<uiSize;k++)
+		{
+			i16 const *piRow = piT+k*uiSize;
+			__m128i mSum0 = mRound;
+			__m128i mSum1 = mRound;
+			for(u32 j=0;j<(uiSize>>1);j++)
+			{
+				__m128i mCoeffPair = _mm_set1_epi32(Load32((byte const *)(piRow+2*j)));
+				mSum0 = _mm_add_epi32(mSum0, _mm_madd_epi16(pmPairs[2*j], mCoeffPair));
+				mSum1 = _mm_add_epi32(mSum1, _mm_madd_epi16(pmPairs[2*j+1], mCoeffPair));
+			}
+			_mm_storeu_si128((__m128i *)(piDest+k*uiStride+i), _mm_packs_epi32(_mm_srai_epi32(mSum0, uiShift), _mm_srai_epi32(mSum1, uiShift)));
+		}
+	}
+}
+
+/**
+*	4x4 forward transform with SSE4.1, like DCTSSE41() but with the whole matrix in two registers.
+*	@param piT Transform matrix.
+*	@see DCTFunc_t
+*/
+TARGET_SSE41 static inline void DCT4x4SSE41(i16 const *piT, i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiShift)
+{
+	__m128i mRound = _mm_set1_epi32(1 << (uiShift-1));
+	__m128i m01 = _mm_unpacklo_epi32(_mm_loadl_epi64((__m128i const *)piSrc), _mm_loadl_epi64((__m128i const *)(piSrc+uiStride)));
+	__m128i m23 = _mm_unpacklo_epi32(_mm_loadl_epi64((__m128i const *)(piSrc+2*uiStride)), _mm_loadl_epi64((__m128i const *)(piSrc+3*uiStride)));
+	__m128i mPair0 = _mm_unpacklo_epi64(m01, m23);	// Samples 0 and 1 of the 4 lines
+	__m128i mPair1 = _mm_unpackhi_epi64(m01, m23);	// Samples 2 and 3 of the 4 lines
+	__m128i mT01 = _mm_loadu_si128((__m128i const *)piT);		// Rows 0 and 1 of the matrix
+	__m128i mT23 = _mm_loadu_si128((__m128i const *)(piT+8));	// Rows 2 and 3 of the matrix
+
+	__m128i mSum0 = _mm_add_epi32(_mm_madd_epi16(mPair0, _mm_shuffle_epi32(mT01, 0x00)), _mm_madd_epi16(mPair1, _mm_shuffle_epi32(mT01, 0x55)));
+	__m128i mSum1 = _mm_add_epi32(_mm_madd_epi16(mPair0, _mm_shuffle_epi32(mT01, 0xAA)), _mm_madd_epi16(mPair1, _mm_shuffle_epi32(mT01, 0xFF)));
+	__m128i mSum2 = _mm_add_epi32(_mm_madd_epi16(mPair0, _mm_shuffle_epi32(mT23, 0x00)), _mm_madd_epi16(mPair1, _mm_shuffle_epi32(mT23, 0x55)));
+	__m128i mSum3 = _mm_add_epi32(_mm_madd_epi16(mPair0, _mm_shuffle_epi32(mT23, 0xAA)), _mm_madd_epi16(mPair1, _mm_shuffle_epi32(mT23, 0xFF)));
+	__m128i mRows01 = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(mSum0, mRound), uiShift), _mm_srai_epi32(_mm_add_epi32(mSum1, mRound), uiShift));
+	__m128i mRows23 = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(mSum2, mRound), uiShift), _mm_srai_epi32(_mm_add_epi32(mSum3, mRound), uiShift));
+	_mm_storel_epi64((__m128i *)piDest, mRows01);
+	_mm_storel_epi64((__m128i *)(piDest+uiStride), _mm_unpackhi_epi64(mRows01, mRows01));
+	_mm_storel_epi64((__m128i *)(piDest+2*uiStride), mRows23);
+	_mm_storel_epi64((__m128i *)(piDest+3*uiStride), _mm_unpackhi_epi64(mRows23, mRows23));
+}
+
+TARGET_SSE41 static void DST4SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){DCT4x4SSE41(g_piDST4, piDest, piSrc, uiStride, uiShift);}
+TARGET_SSE41 static void DCT4SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){DCT4x4SSE41(g_piT4, piDest, piSrc, uiStride, uiShift);}
+TARGET_SSE41 static void DCT8SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){DCTSSE41(8, g_piT8, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+TARGET_SSE41 static void DCT16SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){DCTSSE41(16, g_piT16, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+TARGET_SSE41 static void DCT32SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){DCTSSE41(32, g_piT32, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+
+/**
+*	Inverse transform of 4 lines with SSE4.1, as the sum of the rows of the matrix weighted with the columns of the source.
+*	The pairs of neighbouring rows of the matrix are multiplied with the pairs of the source of each line by PMADDWD.
+*	The pairs of rows, whose source is zero for all the 4 lines, are skipped.
+*	@param uiSize Size of the transform (4 to 32).
+*	@param piT Transform matrix.
+*	@param piSrc Source data, whose columns i to i+3 are transformed.
+*	@param uiStride Stride for the next line of source.
+*	@param uiShift Shift of the transform.
+*	@param uiCol Column of the matrix and of the lines, i.e. the 8 (or 4, for 4x4) results from uiCol on are made.
+*	@param pmLines The 4 lines of results, saturated to 16 bits.
+*/
+TARGET_SSE41 static inline void IDCTLinesSSE41(u32 uiSize, i16 const *piT, i16 const *piSrc, u32 uiStride, u32 uiShift, u32 uiCol, __m128i *pmLines)
+{
+	__m128i mRound = _mm_set1_epi32(1 << (uiShift-1));
+	// Columns uiCol to uiCol+3 (Lo) and uiCol+4 to uiCol+7 (Hi) of each line
+	__m128i mSum0Lo = mRound, mSum1Lo = mRound, mSum2Lo = mRound, mSum3Lo = mRound;
+	__m128i mSum0Hi = mRound, mSum1Hi = mRound, mSum2Hi = mRound, mSum3Hi = mRound;
+
+	for(u32 j=0;j<uiSize;j+=2)
+	{
+		__m128i mSrcPairs = _mm_unpacklo_epi16(_mm_loadl_epi64((__m128i const *)(piSrc+j*uiStride)), _mm_loadl_epi64((__m128i const *)(piSrc+(j+1)*uiStride)));
+		if(_mm_testz_si128(mSrcPairs, mSrcPairs))
+			continue;
+
+		i16 const *piRows = piT+j*uiSize+uiCol;
+		__m128i mRow0 = uiSize == 4 ? _mm_loadl_epi64((__m128i const *)piRows) : _mm_loadu_si128((__m128i const *)piRows);
+		__m128i mRow1 = uiSize == 4 ? _mm_loadl_epi64((__m128i const *)(piRows+uiSize)) : _mm_loadu_si128((__m128i const *)(piRows+uiSize));
+		__m128i mCoeffLo = _mm_unpacklo_epi16(mRow0, mRow1);
+		__m128i mCoeffHi = _mm_unpackhi_epi16(mRow0, mRow1);
+		__m128i mPair0 = _mm_shuffle_epi32(mSrcPairs, 0x00);
+		__m128i mPair1 = _mm_shuffle_epi32(mSrcPairs, 0x55);
+		__m128i mPair2 = _mm_shuffle_epi32(mSrcPairs, 0xAA);
+		__m128i mPair3 = _mm_shuffle_epi32(mSrcPairs, 0xFF);
+		mSum0Lo = _mm_add_epi32(mSum0Lo, _mm_madd_epi16(mPair0, mCoeffLo));
+		mSum1Lo = _mm_add_epi32(mSum1Lo, _mm_madd_epi16(mPair1, mCoeffLo));
+		mSum2Lo = _mm_add_epi32(mSum2Lo, _mm_madd_epi16(mPair2, mCoeffLo));
+		mSum3Lo = _mm_add_epi32(mSum3Lo, _mm_madd_epi16(mPair3, mCoeffLo));
+		if(uiSize > 4)
+		{
+			mSum0Hi = _mm_add_epi32(mSum0Hi, _mm_madd_epi16(mPair0, mCoeffHi));
+			mSum1Hi = _mm_add_epi32(mSum1Hi, _mm_madd_epi16(mPair1, mCoeffHi));
+			mSum2Hi = _mm_add_epi32(mSum2Hi, _mm_madd_epi16(mPair2, mCoeffHi));
+			mSum3Hi = _mm_add_epi32(mSum3Hi, _mm_madd_epi16(mPair3, mCoeffHi));
+		}
+	}
+	pmLines[0] = _mm_packs_epi32(_mm_srai_epi32(mSum0Lo, uiShift), _mm_srai_epi32(mSum0Hi, uiShift));
+	pmLines[1] = _mm_packs_epi32(_mm_srai_epi32(mSum1Lo, uiShift), _mm_srai_epi32(mSum1Hi, uiShift));
+	pmLines[2] = _mm_packs_epi32(_mm_srai_epi32(mSum2Lo, uiShift), _mm_srai_epi32(mSum2Hi, uiShift));
+	pmLines[3] = _mm_packs_epi32(_mm_srai_epi32(mSum3Lo, uiShift), _mm_srai_epi32(mSum3Hi, uiShift));
+}
+
+/**
+*	First stage of the inverse transform with SSE4.1.
+*	@param uiSize Size of the transform.
+*	@param piT Transform matrix.
+*	@see IDCTFunc_t
+*/
+TARGET_SSE41 static inline void IDCTSSE41(u32 uiSize, i16 const *piT, i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift)
+{
+	__m128i pmLines[4];
+
+	for(u32 i=0;i<uiTrLines;i+=4)
+	{
+		for(u32 k=0;k<uiSize;k+=8)
+		{
+			IDCTLinesSSE41(uiSize, piT, piSrc+i, uiStride, uiShift, k, pmLines);
+			for(u32 l=0;l<4;l++)
+			{
+				if(uiSize == 4)
+					_mm_storel_epi64((__m128i *)(piDest+(i+l)*uiStride), pmLines[l]);
+				else
+					_mm_storeu_si128((__m128i *)(piDest+(i+l)*uiStride+k), pmLines[l]);
+			}
+		}
+	}
+}
+
+/**
+*	Second stage of the inverse transform with the reconstruction with SSE4.1.
+*	@param uiSize Size of the transform.
+*	@param piT Transform matrix.
+*	@see IDCTRecFunc_t
+*/
+TARGET_SSE41 static inline void IDCTRecSSE41(u32 uiSize, i16 const *piT, byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride)
+{
+	__m128i pmLines[4];
+
+	for(u32 i=0;i<uiSize;i+=4)
+	{
+		for(u32 k=0;k<uiSize;k+=8)
+		{
+			IDCTLinesSSE41(uiSize, piT, piSrc+i, uiStride, SHIFT_INV_2, k, pmLines);
+			for(u32 l=0;l<4;l++)
+			{
+				byte const *pbPredLine = pbPred+(i+l)*uiPredStride+k;
+				byte *pbRecLine = pbRec+(i+l)*uiRecStride+k;
+				__m128i mPred = uiSize == 4 ? _mm_cvtsi32_si128(Load32(pbPredLine)) : _mm_loadl_epi64((__m128i const *)pbPredLine);
+				__m128i mRec = _mm_adds_epi16(pmLines[l], _mm_cvtepu8_epi16(mPred));
+				mRec = _mm_packus_epi16(mRec, mRec);
+				if(uiSize == 4)
+					Store32(pbRecLine, _mm_cvtsi128_si32(mRec));
+				else
+					_mm_storel_epi64((__m128i *)pbRecLine, mRec);
+			}
+		}
+	}
+}
+
+TARGET_SSE41 static void IDST4SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){IDCTSSE41(4, g_piDST4, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+TARGET_SSE41 static void IDCT4SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){IDCTSSE41(4, g_piT4, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+TARGET_SSE41 static void IDCT8SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){IDCTSSE41(8, g_piT8, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+TARGET_SSE41 static void IDCT16SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){IDCTSSE41(16, g_piT16, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+TARGET_SSE41 static void IDCT32SSE41(i16 *piDest, i16 const *piSrc, u32 uiStride, u32 uiTrLines, u32 uiShift){IDCTSSE41(32, g_piT32, piDest, piSrc, uiStride, uiTrLines, uiShift);}
+
+TARGET_SSE41 static void IDST4RecSSE41(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecSSE41(4, g_piDST4, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+TARGET_SSE41 static void IDCT4RecSSE41(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecSSE41(4, g_piT4, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+TARGET_SSE41 static void IDCT8RecSSE41(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecSSE41(8, g_piT8, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+TARGET_SSE41 static void IDCT16RecSSE41(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecSSE41(16, g_piT16, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+TARGET_SSE41 static void IDCT32RecSSE41(byte *pbRec, u32 uiRecStride, i16 const *piSrc, u32 uiStride, byte const *pbPred, u32 uiPredStride){IDCTRecSSE41(32, g_piT32, pbRec, uiRecStride, piSrc, uiStride, pbPred, uiPredStride);}
+
+/**
+*	Quantization with SSE4.1.
+*	The 4 lines of a row of 4x4 groups are quantized 8 (or 4, for 4x4) coefficients at a time, and the bits of the
+*	coefficients, which are not zero, are collected in the masks of the two groups.
+*	@param uiSize Size of the block.
+*	@see QuantFunc_t
+*/
+TARGET_SSE41 static inline u32 QuantSSE41(u32 uiSize, i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift)
+{
+	__m128i mScale = _mm_set1_epi16(i16(iScale));
+	__m128i mRound = _mm_set1_epi32(iRound);
+	__m128i mShift = _mm_cvtsi32_si128(i32(uiShift));
+	__m128i mZero = _mm_setzero_si128();
+	__m128i mNumZero = _mm_setzero_si128();
+
+	for(u32 i=0;i<uiSize;i+=4)
+	{
+		for(u32 j=0;j<uiSize;j+=8)
+		{
+			u32 uiMaskLeft = 0;
+			u32 uiMaskRight = 0;
+			for(u32 l=0;l<4;l++)
+			{
+				i16 const *piSrcLine = piSrc+(i+l)*uiSrcStride+j;
+				__m128i mSrc = uiSize == 4 ? _mm_loadl_epi64((__m128i const *)piSrcLine) : _mm_loadu_si128((__m128i const *)piSrcLine);
+				// |c|*scale does not fit in 16 bits, the unsigned product is made of its low and high halves
+				__m128i mAbs = _mm_abs_epi16(mSrc);
+				__m128i mProdLo = _mm_mullo_epi16(mAbs, mScale);
+				__m128i mProdHi = _mm_mulhi_epu16(mAbs, mScale);
+				__m128i mLevel0 = _mm_srl_epi32(_mm_add_epi32(_mm_unpacklo_epi16(mProdLo, mProdHi), mRound), mShift);
+				__m128i mLevel1 = _mm_srl_epi32(_mm_add_epi32(_mm_unpackhi_epi16(mProdLo, mProdHi), mRound), mShift);
+				__m128i mLevel = _mm_sign_epi16(_mm_packs_epi32(mLevel0, mLevel1), mSrc);
+				__m128i mIsZero = _mm_cmpeq_epi16(mLevel, mZero);
+				u32 uiSig = ~_mm_movemask_epi8(_mm_packs_epi16(mIsZero, mIsZero)) & 0xFF;
+				uiMaskLeft |= (uiSig & 0xF) << (l<<2);
+				uiMaskRight |= (uiSig >> 4) << (l<<2);
+				if(uiSize == 4)
+				{
+					_mm_storel_epi64((__m128i *)(piCoeff+(i+l)*uiCoeffStride+j), mLevel);
+					mIsZero = _mm_unpacklo_epi64(mIsZero, mZero);
+				}
+				else
+					_mm_storeu_si128((__m128i *)(piCoeff+(i+l)*uiCoeffStride+j), mLevel);
+				mNumZero = _mm_sub_epi16(mNumZero, mIsZero);
+			}
+			u16 *puiSig = puiSigMap+(i>>2)*(uiCoeffStride>>2)+(j>>2);
+			puiSig[0] = u16(uiMaskLeft);
+			if(uiSize > 4)
+				puiSig[1] = u16(uiMaskRight);
+		}
+	}
+	mNumZero = _mm_sad_epu8(mNumZero, mZero);
+	return uiSize*uiSize - (_mm_cvtsi128_si32(mNumZero) + _mm_extract_epi32(mNumZero, 2));
+}
+
+TARGET_SSE41 static u32 Quant4x4SSE41(i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift){return QuantSSE41(4, piCoeff, uiCoeffStride, puiSigMap, piSrc, uiSrcStride, iScale, iRound, uiShift);}
+TARGET_SSE41 static u32 Quant8x8SSE41(i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift){return QuantSSE41(8, piCoeff, uiCoeffStride, puiSigMap, piSrc, uiSrcStride, iScale, iRound, uiShift);}
+TARGET_SSE41 static u32 Quant16x16SSE41(i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift){return QuantSSE41(16, piCoeff, uiCoeffStride, puiSigMap, piSrc, uiSrcStride, iScale, iRound, uiShift);}
+TARGET_SSE41 static u32 Quant32x32SSE41(i16 *piCoeff, u32 uiCoeffStride, u16 *puiSigMap, i16 const *piSrc, u32 uiSrcStride, i32 iScale, i32 iRound, u32 uiShift){return QuantSSE41(32, piCoeff, uiCoeffStride, puiSigMap, piSrc, uiSrcStride, iScale, iRound, uiShift);}
+
+/**
+*	Inverse quantization with SSE4.1.
+*	Two neighbouring 4x4 groups (or one, for 4x4) are done at a time, and are only set to zero if both have no coefficients.
+*	@param uiSize Size of the block.
+*	@see InvQuantFunc_t
+*/
+TARGET_SSE41 static inline void InvQuantSSE41(u32 uiSize, i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift)
+{
+	__m128i mScale = _mm_set1_epi16(i16(iScale));
+	__m128i mRound = _mm_set1_epi32(1 << (uiShift-1));
+	__m128i mZero = _mm_setzero_si128();
+
+	for(u32 i=0;i<uiSize;i+=4)
+	{
+		for(u32 j=0;j<uiSize;j+=8)
+		{
+			u16 const *puiSig = puiSigMap+(i>>2)*(uiCoeffStride>>2)+(j>>2);
+			bit bZero = uiSize == 4 ? (puiSig[0] == 0) : ((puiSig[0] | puiSig[1]) == 0);
+			for(u32 l=0;l<4;l++)
+			{
+				__m128i mDest = mZero;
+				if(!bZero)
+				{
+					i16 const *piCoeffLine = piCoeff+(i+l)*uiCoeffStride+j;
+					__m128i mCoeff = uiSize == 4 ? _mm_loadl_epi64((__m128i const *)piCoeffLine) : _mm_loadu_si128((__m128i const *)piCoeffLine);
+					__m128i mProdLo = _mm_mullo_epi16(mCoeff, mScale);
+					__m128i mProdHi = _mm_mulhi_epi16(mCoeff, mScale);
+					__m128i mDest0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(mProdLo, mProdHi), mRound), uiShift);
+					__m128i mDest1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(mProdLo, mProdHi), mRound), uiShift);
+					mDest = _mm_packs_epi32(mDest0, mDest1);
+				}
+				if(uiSize == 4)
+					_mm_storel_epi64((__m128i *)(piDest+(i+l)*uiDestStride+j), mDest);
+				else
+					_mm_storeu_si128((__m128i *)(piDest+(i+l)*uiDestStride+j), mDest);
+			}
+		}
+	}
+}
+
+TARGET_SSE41 static void InvQuant4x4SSE41(i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift){InvQuantSSE41(4, piDest, uiDestStride, piCoeff, uiCoeffStride, puiSigMap, iScale, uiShift);}
+TARGET_SSE41 static void InvQuant8x8SSE41(i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift){InvQuantSSE41(8, piDest, uiDestStride, piCoeff, uiCoeffStride, puiSigMap, iScale, uiShift);}
+TARGET_SSE41 static void InvQuant16x16SSE41(i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift){InvQuantSSE41(16, piDest, uiDestStride, piCoeff, uiCoeffStride, puiSigMap, iScale, uiShift);}
+TARGET_SSE41 static void InvQuant32x32SSE41(i16 *piDest, u32 uiDestStride, i16 const *piCoeff, u32 uiCoeffStride, u16 const *puiSigMap, i32 iScale, u32 uiShift){InvQuantSSE41(32, piDest, uiDestStride, piCoeff, uiCoeffStride, puiSigMap, iScale, uiShift);}
+
+void InitKernelsSSE41(Kernels_t &sKernels)
+{
+	sKernels.pfSAD[0] = SAD4x4SSE41;
+	sKernels.pfSAD[1] = SAD8x8SSE41;
+	sKernels.pfSAD[2] = SAD16x16SSE41;
+	sKernels.pfSAD[3] = SAD32x32SSE41;
+
+	sKernels.pfSATD[0] = SATD4x4SSE41;
+	sKernels.pfSATD[1] = SATD8x8SSE41;
+	sKernels.pfSATD[2] = SATD16x16SSE41;
+	sKernels.pfSATD[3] = SATD32x32SSE41;
+
+	sKernels.pfIntraPredAng[0] = IntraPredAng4x4SSE41;
+	sKernels.pfIntraPredAng[1] = IntraPredAng8x8SSE41;
+	sKernels.pfIntraPredAng[2] = IntraPredAng16x16SSE41;
+	sKernels.pfIntraPredAng[3] = IntraPredAng32x32SSE41;
+
+	sKernels.pfIntraPredDC[0] = IntraPredDC4x4SSE41;
+	sKernels.pfIntraPredDC[1] = IntraPredDC8x8SSE41;
+	sKernels.pfIntraPredDC[2] = IntraPredDC16x16SSE41;
+	sKernels.pfIntraPredDC[3] = IntraPredDC32x32SSE41;
+
+	sKernels.pfIntraPredPlanar[0] = IntraPredPlanar4x4SSE41;
+	sKernels.pfIntraPredPlanar[1] = IntraPredPlanar8x8SSE41;
+	sKernels.pfIntraPredPlanar[2] = IntraPredPlanar16x16SSE41;
+	sKernels.pfIntraPredPlanar[3] = IntraPredPlanar32x32SSE41;
+
+	sKernels.pfRefSamples = RefSamplesSSE41;
+
+	sKernels.pfDCT[0] = DST4SSE41;
+	sKernels.pfDCT[1] = DCT4SSE41;
+	sKernels.pfDCT[2] = DCT8SSE41;
+	sKernels.pfDCT[3] = DCT16SSE41;
+	sKernels.pfDCT[4] = DCT32SSE41;
+
+	sKernels.pfIDCT[0] = IDST4SSE41;
+	sKernels.pfIDCT[1] = IDCT4SSE41;
+	sKernels.pfIDCT[2] = IDCT8SSE41;
+	sKernels.pfIDCT[3] = IDCT16SSE41;
+	sKernels.pfIDCT[4] = IDCT32SSE41;
+
+	sKernels.pfIDCTRec[0] = IDST4RecSSE41;
+	sKernels.pfIDCTRec[1] = IDCT4RecSSE41;
+	sKernels.pfIDCTRec[2] = IDCT8RecSSE41;
+	sKernels.pfIDCTRec[3] = IDCT16RecSSE41;
+	sKernels.pfIDCTRec[4] = IDCT32RecSSE41;
+
+	sKernels.pfQuant[0] = Quant4x4SSE41;
+	sKernels.pfQuant[1] = Quant8x8SSE41;
+	sKernels.pfQuant[2] = Quant16x16SSE41;
+	sKernels.pfQuant[3] = Quant32x32SSE41;
+
+	sKernels.pfInvQuant[0] = InvQuant4x4SSE41;
+	sKernels.pfInvQuant[1] = InvQuant8x8SSE41;
+	sKernels.pfInvQuant[2] = InvQuant16x16SSE41;
+	sKernels.pfInvQuant[3] = InvQuant32x32SSE41;
+}
+
+#else
+
+void InitKernelsSSE41(Kernels_t &sKernels)
+{
+}
+
+#endif	// ARCH_X86
@@ -0,0 +1,95 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file SliceBalancer.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the methods of the SliceBalancer class.
+*/
+
+#include <SliceBalancer.h>
+#include <ImageParameters.h>
+
+SliceBalancer::SliceBalancer(ImageParameters const *pcImageParam)
+{
+	m_pcImageParam = pcImageParam;
+	m_pu64RowBytes = new u64[m_pcImageParam->m_uiFrameHeightInCTUs];
+	m_bBytesValid = false;
+	m_sSliceLayout = m_pcImageParam->m_sUniformSliceLayout;
+	m_u64TotalFrames = 0;
+	m_u64TotalSlices = 0;
+	m_u64OverBudgetSlices = 0;
+}
+
+SliceBalancer::~SliceBalancer()
+{
+	delete [] m_pu64RowBytes;
+}
+
+void SliceBalancer::AddFrameBytes(u32 const *puiCTUBytes, u32 uiNumSlices, u64 const *pu64BytesPerSlice)
+{
+	// A row which got larger is taken at once, as the budget must not be exceeded,
+	// while a row which got smaller is forgotten exponentially
+	u32 uiWidth = m_pcImageParam->m_uiFrameWidthInCTUs;
+	for(u32 i=0;i<m_pcImageParam->m_uiFrameHeightInCTUs;i++)
+	{
+		u64 u64Bytes = 0;
+		for(u32 j=0;j<uiWidth;j++)
+			u64Bytes += puiCTUBytes[i*uiWidth+j];
+		m_pu64RowBytes[i] = m_bBytesValid ? max(u64Bytes, (m_pu64RowBytes[i] + u64Bytes + 1)>>1) : u64Bytes;
+	}
+	m_bBytesValid = true;
+
+	m_u64TotalFrames++;
+	m_u64TotalSlices += uiNumSlices;
+	for(u32 i=0;i<uiNumSlices;i++)
+		if(pu64BytesPerSlice[i] > m_pcImageParam->m_uiSliceMaxBytes)
+			m_u64OverBudgetSlices++;
+}
+
+bit SliceBalancer::UpdateSliceLayout()
+{
+	if(!m_bBytesValid)
+		return false;
+
+	// A new slice is started when the next row does not fit anymore. A row which does not fit into an empty slice
+	// gets a slice of its own, and once the level allows no more slices, the last one takes the remaining rows
+	u64 u64MaxBytes = u64(m_pcImageParam->m_uiSliceMaxBytes)*SLICE_BYTES_FILL/100;
+	SliceLayout_t sSliceLayout;
+	u64 u64SliceBytes = 0;
+	sSliceLayout.uiNumSlices = 0;
+	sSliceLayout.puiSliceSizeInUnits[0] = 0;
+	for(u32 i=0;i<m_pcImageParam->m_uiFrameHeightInCTUs;i++)
+	{
+		if(sSliceLayout.puiSliceSizeInUnits[sSliceLayout.uiNumSlices] > 0 && u64SliceBytes + m_pu64RowBytes[i] > u64MaxBytes &&
+			sSliceLayout.uiNumSlices+1 < m_pcImageParam->m_uiFrameSizeInSlices)
+		{
+			sSliceLayout.puiSliceSizeInUnits[++sSliceLayout.uiNumSlices] = 0;
+			u64SliceBytes = 0;
+		}
+		sSliceLayout.puiSliceSizeInUnits[sSliceLayout.uiNumSlices]++;
+		u64SliceBytes += m_pu64RowBytes[i];
+	}
+	sSliceLayout.uiNumSlices++;
+
+	if(m_pcImageParam->IsSameSliceLayout(sSliceLayout,m_sSliceLayout))
+		return false;
+	m_sSliceLayout = sSliceLayout;
+	return true;
+}
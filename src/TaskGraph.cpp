@@ -0,0 +1,139 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file TaskGraph.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the methods of the TaskGraph class.
+*/
+
+#include <TaskGraph.h>
+#include <WorkItem.h>
+#include <WorkQueue.h>
+
+TaskGraph::TaskGraph(u32 uiMaxTasks)
+{
+	m_uiMaxTasks = uiMaxTasks;
+	m_uiNumTasks = 0;
+	m_pcTasks = new TaskNode_t[uiMaxTasks];
+	m_ppcReadyTasks = new WorkItem*[uiMaxTasks];
+	m_uiNumReadyTasks = 0;
+	m_pcWorkQueue = NULL;
+	m_i64PendingTasks = 0;
+	for(u32 i=0;i<uiMaxTasks;i++)
+	{
+		m_pcTasks[i].pcGraph = this;
+		m_pcTasks[i].pcWorkItem = new WorkItem(ExecTask,i,&m_pcTasks[i],0,&m_i64PendingTasks);
+	}
+}
+
+TaskGraph::~TaskGraph()
+{
+	for(u32 i=0;i<m_uiMaxTasks;i++)
+		delete m_pcTasks[i].pcWorkItem;
+	delete [] m_pcTasks;
+	delete [] m_ppcReadyTasks;
+}
+
+void TaskGraph::Clear()
+{
+	m_uiNumTasks = 0;
+}
+
+u32 TaskGraph::AddTask(void *(*pfFunc)(void *p), void *pArgs)
+{
+	MAKE_SURE(m_uiNumTasks < m_uiMaxTasks, "Error: Too many tasks in the task graph.");
+	TaskNode_t *pcTask = &m_pcTasks[m_uiNumTasks];
+	pcTask->pfFunc = pfFunc;
+	pcTask->pArgs = pArgs;
+	pcTask->uiNumDeps = 0;
+	pcTask->i64PendingDeps = 0;
+	pcTask->uiNumSuccessors = 0;
+	return m_uiNumTasks++;
+}
+
+void TaskGraph::AddDependency(u32 uiTask, u32 uiDependsOn)
+{
+	MAKE_SURE(uiTask < m_uiNumTasks && uiDependsOn < m_uiNumTasks && uiTask != uiDependsOn, "Error: Invalid task dependency.");
+	TaskNode_t *pcDependsOn = &m_pcTasks[uiDependsOn];
+	MAKE_SURE(pcDependsOn->uiNumSuccessors < MAX_TASK_SUCCESSORS, "Error: Too many tasks depend upon one task.");
+	pcDependsOn->puiSuccessors[pcDependsOn->uiNumSuccessors++] = uiTask;
+	m_pcTasks[uiTask].uiNumDeps++;
+}
+
+bit TaskGraph::ReleaseTask(u32 uiTask)
+{
+	TaskNode_t *pcTask = &m_pcTasks[uiTask];
+	return pcTask->uiNumDeps == 0 || ATOMIC_FETCH_ADD(pcTask->i64PendingDeps, -1) == 1;
+}
+
+void TaskGraph::QueueTasks(WorkItem **ppcTasks, u32 uiNumTasks)
+{
+	if(uiNumTasks == 0)
+		return;
+	if(m_pcWorkQueue)
+		MAKE_SURE(m_pcWorkQueue->AddJobs(ppcTasks, i32(uiNumTasks)) == 0, "Error: No space in the workqueue.");
+	else
+	{
+		for(u32 i=0;i<uiNumTasks;i++)
+			m_ppcReadyTasks[m_uiNumReadyTasks++] = ppcTasks[i];
+	}
+}
+
+void *TaskGraph::ExecTask(void *pArgs)
+{
+	TaskNode_t *pcTask = (TaskNode_t *)pArgs;
+	TaskGraph *pcGraph = pcTask->pcGraph;
+	WorkItem *ppcReady[MAX_TASK_SUCCESSORS];
+	u32 uiNumReady = 0;
+	pcTask->pfFunc(pcTask->pArgs);
+
+	// The successors are queued before this job is done, so the pending tasks never drop to zero too early
+	for(i32 i=i32(pcTask->uiNumSuccessors)-1;i>=0;i--)
+		if(pcGraph->ReleaseTask(pcTask->puiSuccessors[i]))
+			ppcReady[uiNumReady++] = pcGraph->m_pcTasks[pcTask->puiSuccessors[i]].pcWorkItem;
+	pcGraph->QueueTasks(ppcReady, uiNumReady);
+	return NULL;
+}
+
+void TaskGraph::Run(WorkQueue *pcWorkQueue)
+{
+	m_pcWorkQueue = pcWorkQueue;
+	m_uiNumReadyTasks = 0;
+
+	// All the counters are set before the first task can run
+	for(u32 i=0;i<m_uiNumTasks;i++)
+		ATOMIC_STORE(m_pcTasks[i].i64PendingDeps, i64(m_pcTasks[i].uiNumDeps));
+	for(i32 i=i32(m_uiNumTasks)-1;i>=0;i--)
+		if(m_pcTasks[i].uiNumDeps == 0)
+			m_ppcReadyTasks[m_uiNumReadyTasks++] = m_pcTasks[i].pcWorkItem;
+
+	if(m_pcWorkQueue)
+	{
+		// The tasks without dependencies are queued at once
+		QueueTasks(m_ppcReadyTasks, m_uiNumReadyTasks);
+		m_uiNumReadyTasks = 0;
+		m_pcWorkQueue->WaitGroupDone(m_i64PendingTasks);
+	}
+	else
+	{
+		while(m_uiNumReadyTasks > 0)
+			ExecTask(m_ppcReadyTasks[--m_uiNumReadyTasks]->m_pArgs);
+	}
+}
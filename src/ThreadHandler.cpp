@@ -26,24 +26,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ThreadHandler.h"
 #include "WorkQueue.h"
 #include "WorkItem.h"
-#include <iostream>
+#include "Utilities.h"
+#include "Tracer.h"
 #include <cassert>
 
-using namespace std;
-
-ThreadHandler::ThreadHandler(WorkQueue *pcWorkQueue)
+ThreadHandler::ThreadHandler(WorkQueue *pcWorkQueue, int iCPU, int iRTPriority)
 {
 	m_pcWorkQueue = pcWorkQueue;
 	m_iStatus = 0;
 	m_iDetached = 0;
+	m_iCPU = iCPU;
+	m_iRTPriority = iRTPriority;
 }
 
 ThreadHandler::~ThreadHandler()
 {
-	if(m_iStatus == 1 && m_iDetached == 0)
-		pthread_detach(m_TID);
-	//if(m_iStatus == 1)
-		pthread_cancel(m_TID);
+	// The work queue must have been shut down, so that the thread leaves its loop
+	WaitTillThreadFinish();
 }
 
 static void* runThread(void* arg)
@@ -53,14 +52,21 @@ static void* runThread(void* arg)
 
 void *ThreadHandler::RunThread()
 {
+	if(m_iCPU >= 0 && !SetThreadAffinity(u32(m_iCPU)))
+		printf("Warning: Worker thread could not be pinned to processor %d.\n",m_iCPU);
+	if(m_iRTPriority > 0 && !SetThreadRealTime(m_iRTPriority))
+		printf("Warning: Worker thread could not be given the real-time priority %d.\n",m_iRTPriority);
+
+	m_pcWorkQueue->RegisterWorker(m_iCPU >= 0 ? GetNUMANodeOfCPU(u32(m_iCPU)) : 0);
 	while(1)
 	{
 		// Remove an item from the queue
 		WorkItem *pcWorkItem = m_pcWorkQueue->GetNextJob();
-		m_pcWorkQueue->IncNumJobsUnderProcess();
-		cout << "Job started for work item number " << pcWorkItem->m_iItemNum << endl;
+		if(pcWorkItem == NULL)	// The queue is shut down
+			break;
+		TRACE(TRACE_LEVEL_DEBUG, "Job started for work item number %d\n", pcWorkItem->m_iItemNum);
 		pcWorkItem->m_pfPtrToFunc(pcWorkItem->m_pArgs);
-		m_pcWorkQueue->JobDone();
+		m_pcWorkQueue->JobDone(pcWorkItem);
 	}
 	pthread_exit((void*) 0);
 }
@@ -78,7 +84,7 @@ int ThreadHandler::StartThread()
 int ThreadHandler::WaitTillThreadFinish()
 {
 	int iRet = -1;
-	if(m_iStatus == 1)	// Still running
+	if(m_iStatus == 1 && m_iDetached == 0)	// Still running
 	{
 		iRet = pthread_join(m_TID, NULL);	// Wait for the thread to finish
 		if(iRet == 0)
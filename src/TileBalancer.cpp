@@ -0,0 +1,178 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* @file TileBalancer.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the methods of the TileBalancer class.
+*/
+
+#include <TileBalancer.h>
+#include <ImageParameters.h>
+
+TileBalancer::TileBalancer(ImageParameters const *pcImageParam)
+{
+	m_pcImageParam = pcImageParam;
+	m_pu64CTUCost = new u64[m_pcImageParam->m_uiFrameSizeInCTUs];
+	m_pu64IntegralCost = new u64[(m_pcImageParam->m_uiFrameWidthInCTUs+1)*(m_pcImageParam->m_uiFrameHeightInCTUs+1)];
+	m_bCostValid = false;
+	m_sTileLayout = m_pcImageParam->m_sUniformTileLayout;
+}
+
+TileBalancer::~TileBalancer()
+{
+	delete [] m_pu64CTUCost;
+	delete [] m_pu64IntegralCost;
+}
+
+void TileBalancer::AddFrameCost(u32 const *puiCTUCost)
+{
+	// A CTU never costs nothing, otherwise a tile could grow without limit over a static area.
+	// The older frames are forgotten exponentially, so that a single outlier does not move the tiles
+	for(u32 i=0;i<m_pcImageParam->m_uiFrameSizeInCTUs;i++)
+	{
+		u64 u64Cost = u64(puiCTUCost[i]) + 1;
+		m_pu64CTUCost[i] = m_bCostValid ? (m_pu64CTUCost[i] + u64Cost + 1)>>1 : u64Cost;
+	}
+	m_bCostValid = true;
+}
+
+u64 TileBalancer::GetRectCost(u32 uiX0, u32 uiY0, u32 uiX1, u32 uiY1)
+{
+	u32 uiStride = m_pcImageParam->m_uiFrameWidthInCTUs+1;
+	return m_pu64IntegralCost[uiY1*uiStride+uiX1] - m_pu64IntegralCost[uiY0*uiStride+uiX1]
+		- m_pu64IntegralCost[uiY1*uiStride+uiX0] + m_pu64IntegralCost[uiY0*uiStride+uiX0];
+}
+
+u64 TileBalancer::GetSpanCost(bit bColumns, u32 uiStart, u32 uiEnd, TileLayout_t const &sTileLayout)
+{
+	u64 u64MaxCost = 0;
+	u64 u64Cost;
+	u32 uiPos = 0;
+	u32 uiTotalBands = bColumns ? m_pcImageParam->m_uiFrameHeightInTiles : m_pcImageParam->m_uiFrameWidthInTiles;
+	u32 const *puiBandSize = bColumns ? sTileLayout.puiRowHeightInCTUs : sTileLayout.puiColWidthInCTUs;
+	for(u32 i=0;i<uiTotalBands;i++)
+	{
+		if(bColumns)
+			u64Cost = GetRectCost(uiStart,uiPos,uiEnd,uiPos+puiBandSize[i]);
+		else
+			u64Cost = GetRectCost(uiPos,uiStart,uiPos+puiBandSize[i],uiEnd);
+		if(u64Cost > u64MaxCost)
+			u64MaxCost = u64Cost;
+		uiPos += puiBandSize[i];
+	}
+	return u64MaxCost;
+}
+
+u64 TileBalancer::GetCriticalPath(TileLayout_t const &sTileLayout)
+{
+	u64 u64MaxCost = 0;
+	u64 u64Cost;
+	u32 uiPos = 0;
+	for(u32 i=0;i<m_pcImageParam->m_uiFrameWidthInTiles;i++)
+	{
+		u64Cost = GetSpanCost(true,uiPos,uiPos+sTileLayout.puiColWidthInCTUs[i],sTileLayout);
+		if(u64Cost > u64MaxCost)
+			u64MaxCost = u64Cost;
+		uiPos += sTileLayout.puiColWidthInCTUs[i];
+	}
+	return u64MaxCost;
+}
+
+bit TileBalancer::SplitWithMaxCost(bit bColumns, u64 u64MaxCost, TileLayout_t &sTileLayout)
+{
+	u32 uiTotalCTUs = bColumns ? m_pcImageParam->m_uiFrameWidthInCTUs : m_pcImageParam->m_uiFrameHeightInCTUs;
+	u32 uiTotalParts = bColumns ? m_pcImageParam->m_uiFrameWidthInTiles : m_pcImageParam->m_uiFrameHeightInTiles;
+	u32 *puiSize = bColumns ? sTileLayout.puiColWidthInCTUs : sTileLayout.puiRowHeightInCTUs;
+	u32 uiStart = 0;
+	u32 uiEnd;
+	u32 uiMaxEnd;
+
+	// Every part is made as large as possible, while leaving the minimum size for the parts after it
+	for(u32 i=0;i<uiTotalParts;i++)
+	{
+		uiMaxEnd = uiTotalCTUs - 2*(uiTotalParts-1-i);
+		uiEnd = (i == uiTotalParts-1) ? uiTotalCTUs : uiStart+2;
+		if(GetSpanCost(bColumns,uiStart,uiEnd,sTileLayout) > u64MaxCost)
+			return false;
+		while(uiEnd < uiMaxEnd && GetSpanCost(bColumns,uiStart,uiEnd+1,sTileLayout) <= u64MaxCost)
+			uiEnd++;
+		puiSize[i] = uiEnd - uiStart;
+		uiStart = uiEnd;
+	}
+	return true;
+}
+
+void TileBalancer::SplitMinMax(bit bColumns, TileLayout_t &sTileLayout)
+{
+	// Binary search for the smallest cost of the slowest tile which can be met
+	u64 u64Low = 0;
+	u64 u64High = GetRectCost(0,0,m_pcImageParam->m_uiFrameWidthInCTUs,m_pcImageParam->m_uiFrameHeightInCTUs);
+	while(u64Low < u64High)
+	{
+		u64 u64Mid = u64Low + ((u64High-u64Low)>>1);
+		if(SplitWithMaxCost(bColumns,u64Mid,sTileLayout))
+			u64High = u64Mid;
+		else
+			u64Low = u64Mid+1;
+	}
+	SplitWithMaxCost(bColumns,u64High,sTileLayout);
+}
+
+bit TileBalancer::UpdateTileLayout()
+{
+	if(!m_bCostValid)
+		return false;
+
+	// Summed area table, so that the cost of any tile is found with 4 lookups
+	u32 uiWidth = m_pcImageParam->m_uiFrameWidthInCTUs;
+	u32 uiHeight = m_pcImageParam->m_uiFrameHeightInCTUs;
+	u32 uiStride = uiWidth+1;
+	for(u32 i=0;i<=uiWidth;i++)
+		m_pu64IntegralCost[i] = 0;
+	for(u32 i=1;i<=uiHeight;i++)
+	{
+		u64 u64RowCost = 0;
+		m_pu64IntegralCost[i*uiStride] = 0;
+		for(u32 j=1;j<=uiWidth;j++)
+		{
+			u64RowCost += m_pu64CTUCost[(i-1)*uiWidth+j-1];
+			m_pu64IntegralCost[i*uiStride+j] = m_pu64IntegralCost[(i-1)*uiStride+j] + u64RowCost;
+		}
+	}
+
+	// The columns and rows are split in turns, each time for the tiles of the other one
+	TileLayout_t sTileLayout = m_sTileLayout;
+	for(u32 i=0;i<4;i++)
+	{
+		SplitMinMax(true,sTileLayout);
+		SplitMinMax(false,sTileLayout);
+	}
+
+	// Changing the layout costs a PPS and cold buffers, only do it if it is worth it
+	u64 u64CurrCost = GetCriticalPath(m_sTileLayout);
+	u64 u64NewCost = GetCriticalPath(sTileLayout);
+	if(u64NewCost*100 > u64CurrCost*(100-ADAPTIVE_TILES_MIN_GAIN))
+		return false;
+
+	// Return to the uniform signalling if the sizes happen to be the uniform ones
+	sTileLayout.bUniform = true;
+	sTileLayout.bUniform = m_pcImageParam->IsSameTileLayout(sTileLayout,m_pcImageParam->m_sUniformTileLayout);
+	m_sTileLayout = sTileLayout;
+	return true;
+}
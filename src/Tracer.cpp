@@ -0,0 +1,187 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file Tracer.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the methods of the Tracer class.
+*/
+
+#include <Tracer.h>
+#include <Utilities.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#ifdef _MSC_VER
+#include <sys/timeb.h>
+#endif
+
+i32 Tracer::m_iLevel = TRACE_LEVEL_OFF;
+bool Tracer::m_bRunning = false;
+i64 Tracer::m_i64Generation = 0;
+TraceRing_t *Tracer::m_psRings = NULL;
+pthread_t Tracer::m_ptFlusher;
+pthread_mutex_t Tracer::m_ptMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t Tracer::m_ptCond = PTHREAD_COND_INITIALIZER;
+
+static THREAD_LOCAL TraceRing_t *t_psRing = NULL;		//!< Ring of the thread
+static THREAD_LOCAL i64 t_i64RingGeneration = -1;		//!< Generation of the tracer the ring belongs to
+
+TraceRing_t *Tracer::GetThreadRing()
+{
+	if(t_psRing && t_i64RingGeneration == m_i64Generation)
+		return t_psRing;
+
+	// First message of the thread
+	TraceRing_t *psRing = new TraceRing_t;
+	psRing->i64Head = 0;
+	psRing->i64Tail = 0;
+	psRing->i64Dropped = 0;
+	psRing->psRecords = new TraceRecord_t[TRACE_RING_SIZE];
+	pthread_mutex_lock(&m_ptMutex);
+	psRing->psNext = m_psRings;
+	m_psRings = psRing;
+	pthread_mutex_unlock(&m_ptMutex);
+	t_psRing = psRing;
+	t_i64RingGeneration = m_i64Generation;
+	return psRing;
+}
+
+void Tracer::Log(i8 const *pcFormat, ...)
+{
+	va_list vaArgs;
+	va_start(vaArgs, pcFormat);
+	if(!m_bRunning)
+	{
+		vprintf(pcFormat, vaArgs);
+		va_end(vaArgs);
+		return;
+	}
+
+	TraceRing_t *psRing = GetThreadRing();
+	i64 i64Head = psRing->i64Head;
+	if(i64Head - ATOMIC_LOAD(psRing->i64Tail) >= TRACE_RING_SIZE)
+	{
+		// The flusher is behind, do not wait for it
+		ATOMIC_FETCH_ADD(psRing->i64Dropped, 1);
+		va_end(vaArgs);
+		return;
+	}
+	TraceRecord_t *psRecord = &psRing->psRecords[i64Head & (TRACE_RING_SIZE-1)];
+	psRecord->u64TimeUSec = GetTimeInMicroSec();
+	if(vsnprintf(psRecord->pcMsg, TRACE_MSG_LEN, pcFormat, vaArgs) >= TRACE_MSG_LEN)
+		psRecord->pcMsg[TRACE_MSG_LEN-2] = '\n';	// Truncated
+	va_end(vaArgs);
+	ATOMIC_STORE(psRing->i64Head, i64Head+1);	// Publish the message
+}
+
+void Tracer::Drain()
+{
+	while(1)
+	{
+		// Oldest message of all the rings
+		TraceRing_t *psOldest = NULL;
+		u64 u64OldestTime = 0;
+		for(TraceRing_t *psRing = m_psRings;psRing;psRing = psRing->psNext)
+		{
+			i64 i64Tail = psRing->i64Tail;
+			if(i64Tail == ATOMIC_LOAD(psRing->i64Head))
+				continue;
+			u64 u64Time = psRing->psRecords[i64Tail & (TRACE_RING_SIZE-1)].u64TimeUSec;
+			if(psOldest == NULL || u64Time < u64OldestTime)
+			{
+				psOldest = psRing;
+				u64OldestTime = u64Time;
+			}
+		}
+		if(psOldest == NULL)
+			break;
+		i64 i64Tail = psOldest->i64Tail;
+		fputs(psOldest->psRecords[i64Tail & (TRACE_RING_SIZE-1)].pcMsg, stdout);
+		ATOMIC_STORE(psOldest->i64Tail, i64Tail+1);	// Give the slot back to the thread
+	}
+	fflush(stdout);
+}
+
+void *Tracer::FlusherThread(void *pArgs)
+{
+	pthread_mutex_lock(&m_ptMutex);
+	while(m_bRunning)
+	{
+		timespec ts;
+#ifdef _MSC_VER
+		__timeb64 tb;
+		_ftime64(&tb);
+		ts.tv_sec = tb.time;
+		ts.tv_nsec = tb.millitm*1000000;
+#else
+		clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+		ts.tv_nsec += TRACE_FLUSH_PERIOD*1000000;
+		ts.tv_sec += ts.tv_nsec/1000000000;
+		ts.tv_nsec %= 1000000000;
+		pthread_cond_timedwait(&m_ptCond, &m_ptMutex, &ts);
+		Drain();
+	}
+	pthread_mutex_unlock(&m_ptMutex);
+	return NULL;
+}
+
+void Tracer::Start()
+{
+	if(m_bRunning || m_iLevel == TRACE_LEVEL_OFF)
+		return;
+	m_bRunning = true;
+	MAKE_SURE(pthread_create(&m_ptFlusher, NULL, FlusherThread, NULL) == 0, "Error: Cannot create the trace flusher thread.");
+}
+
+void Tracer::Stop()
+{
+	if(!m_bRunning)
+		return;
+	pthread_mutex_lock(&m_ptMutex);
+	m_bRunning = false;
+	pthread_cond_signal(&m_ptCond);
+	pthread_mutex_unlock(&m_ptMutex);
+	pthread_join(m_ptFlusher, NULL);
+
+	// The messages written after the last flush
+	Drain();
+	i64 i64Dropped = 0;
+	while(m_psRings)
+	{
+		TraceRing_t *psRing = m_psRings;
+		m_psRings = psRing->psNext;
+		i64Dropped += psRing->i64Dropped;
+		delete [] psRing->psRecords;
+		delete psRing;
+	}
+	m_i64Generation++;
+	if(i64Dropped)
+		printf("Warning: %lld trace messages dropped.\n",i64Dropped);
+}
+
+void Tracer::Flush()
+{
+	if(!m_bRunning)
+		return;
+	pthread_mutex_lock(&m_ptMutex);
+	Drain();
+	pthread_mutex_unlock(&m_ptMutex);
+}
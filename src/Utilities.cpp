@@ -24,8 +24,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <Utilities.h>
 #include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #ifdef _MSC_VER
 #include <Windows.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 #endif
 
 u32 GetTimeInMiliSec()
@@ -40,6 +47,20 @@ u32 GetTimeInMiliSec()
 #endif
 }
 
+u64 GetTimeInMicroSec()
+{
+#ifdef _MSC_VER
+	LARGE_INTEGER liCount, liFreq;
+	QueryPerformanceCounter(&liCount);
+	QueryPerformanceFrequency(&liFreq);
+	return u64(liCount.QuadPart/liFreq.QuadPart)*1000000 + u64(liCount.QuadPart%liFreq.QuadPart)*1000000/u64(liFreq.QuadPart);
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return u64(ts.tv_sec)*1000000 + u64(ts.tv_nsec)/1000;
+#endif
+}
+
 void BubbleSortValIndex(i32 *piVals, i32 *piIdx, u32 uiSize)
 {
 	// Modified from: http://rosettacode.org/wiki/Sorting_algorithms/Bubble_sort#C
@@ -63,4 +84,226 @@ void GetCurrentDateTime(i8 *piBuff, u32 uiBuffSize)
 	// Visit http://www.cplusplus.com/reference/clibrary/ctime/strftime/
 	// for more information about date/time format
 	strftime(piBuff, uiBuffSize, "%d-%m-%Y @ %X", &tstruct);
+}
+
+u32 GetNumOnlineCores()
+{
+#ifdef _MSC_VER
+	SYSTEM_INFO sSysInfo;
+	GetSystemInfo(&sSysInfo);
+	return sSysInfo.dwNumberOfProcessors;
+#else
+	long lNumCores = sysconf(_SC_NPROCESSORS_ONLN);
+	return lNumCores < 1 ? 1 : u32(lNumCores);
+#endif
+}
+
+u32 GetNumUsableCores()
+{
+	u32 uiNumCores = GetNumOnlineCores();
+#ifdef _MSC_VER
+	DWORD_PTR dwProcessMask, dwSystemMask;
+	if(GetProcessAffinityMask(GetCurrentProcess(), &dwProcessMask, &dwSystemMask))
+	{
+		u32 uiNumAllowed = 0;
+		for(;dwProcessMask;dwProcessMask&=dwProcessMask-1)
+			uiNumAllowed++;
+		uiNumCores = uiNumAllowed > 0 && uiNumAllowed < uiNumCores ? uiNumAllowed : uiNumCores;
+	}
+#elif defined __linux
+	// Processors the process may run on
+	cpu_set_t sCPUSet;
+	if(sched_getaffinity(0, sizeof(cpu_set_t), &sCPUSet) == 0)
+	{
+		u32 uiNumAllowed = u32(CPU_COUNT(&sCPUSet));
+		uiNumCores = uiNumAllowed > 0 && uiNumAllowed < uiNumCores ? uiNumAllowed : uiNumCores;
+	}
+
+	// CPU quota of the control group, "quota period" (v2) or separate files (v1), rounded up to full processors
+	i64 i64Quota = -1, i64Period = 0;
+	i8 pcQuota[32];
+	FILE *pFile = fopen("/sys/fs/cgroup/cpu.max", "r");
+	if(pFile)
+	{
+		if(fscanf(pFile, "%31s %lld", pcQuota, &i64Period) == 2 && strcmp(pcQuota, "max"))
+			i64Quota = atoll(pcQuota);
+		fclose(pFile);
+	}
+	else if((pFile = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r")) != NULL)
+	{
+		if(fscanf(pFile, "%lld", &i64Quota) != 1)
+			i64Quota = -1;
+		fclose(pFile);
+		if((pFile = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r")) != NULL)
+		{
+			if(fscanf(pFile, "%lld", &i64Period) != 1)
+				i64Period = 0;
+			fclose(pFile);
+		}
+	}
+	if(i64Quota > 0 && i64Period > 0)
+	{
+		u32 uiNumQuota = u32((i64Quota+i64Period-1)/i64Period);
+		uiNumCores = uiNumQuota < uiNumCores ? uiNumQuota : uiNumCores;
+	}
+#endif
+	return uiNumCores < 1 ? 1 : uiNumCores;
+}
+
+u64 GetCacheSize(u32 uiLevel)
+{
+#ifdef _MSC_VER
+	SYSTEM_LOGICAL_PROCESSOR_INFORMATION psInfo[256];
+	DWORD dwLength = sizeof(psInfo);
+	if(!GetLogicalProcessorInformation(psInfo, &dwLength))
+		return 0;
+	for(u32 i=0;i<dwLength/sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);i++)
+		if(psInfo[i].Relationship == RelationCache && psInfo[i].Cache.Level == uiLevel && psInfo[i].Cache.Type != CacheInstruction)
+			return psInfo[i].Cache.Size;
+	return 0;
+#else
+	// Every cache of the processor has a directory with its level, type and size (e.g. "2048K")
+	i8 pcPath[FILE_NAME_LEN];
+	i8 pcType[32];
+	for(u32 i=0;i<16;i++)
+	{
+		u32 uiCacheLevel = 0;
+		u64 u64Size = 0;
+		i8 cUnit = 0;
+		FILE *pFile;
+		sprintf(pcPath, "/sys/devices/system/cpu/cpu0/cache/index%u/level", i);
+		if((pFile = fopen(pcPath, "r")) == NULL)
+			break;
+		if(fscanf(pFile, "%u", &uiCacheLevel) != 1)
+			uiCacheLevel = 0;
+		fclose(pFile);
+		if(uiCacheLevel != uiLevel)
+			continue;
+
+		sprintf(pcPath, "/sys/devices/system/cpu/cpu0/cache/index%u/type", i);
+		if((pFile = fopen(pcPath, "r")) == NULL)
+			continue;
+		if(fscanf(pFile, "%31s", pcType) != 1)
+			pcType[0] = 0;
+		fclose(pFile);
+		if(!strcmp(pcType, "Instruction"))
+			continue;
+
+		sprintf(pcPath, "/sys/devices/system/cpu/cpu0/cache/index%u/size", i);
+		if((pFile = fopen(pcPath, "r")) == NULL)
+			continue;
+		if(fscanf(pFile, "%llu%c", &u64Size, &cUnit) < 1)
+			u64Size = 0;
+		fclose(pFile);
+		return cUnit == 'K' ? u64Size << 10 : cUnit == 'M' ? u64Size << 20 : u64Size;
+	}
+	return 0;
+#endif
+}
+
+u32 ParseCPUList(i8 const *pcList, u32 *puiCPUs, u32 uiMaxCPUs)
+{
+	u32 uiNumCPUs = 0;
+	i8 *pcEnd;
+	while(*pcList)
+	{
+		// A number or a range of numbers
+		long lFirst = strtol(pcList, &pcEnd, 10);
+		long lLast = lFirst;
+		if(pcEnd == pcList || lFirst < 0)
+			return 0;
+		pcList = pcEnd;
+		if(*pcList == '-')
+		{
+			lLast = strtol(++pcList, &pcEnd, 10);
+			if(pcEnd == pcList || lLast < lFirst)
+				return 0;
+			pcList = pcEnd;
+		}
+
+		for(long l=lFirst;l<=lLast;l++)
+		{
+			if(uiNumCPUs == uiMaxCPUs)
+				return 0;
+			puiCPUs[uiNumCPUs++] = u32(l);
+		}
+
+		if(*pcList == ',')
+			pcList++;
+		else if(*pcList)
+			return 0;
+	}
+	return uiNumCPUs;
+}
+
+i32 GetNUMANodeOfCPU(u32 uiCPU)
+{
+#ifdef _MSC_VER
+	UCHAR ucNode;
+	if(uiCPU > 255 || !GetNumaProcessorNode(UCHAR(uiCPU), &ucNode) || ucNode == 0xFF)
+		return 0;
+	return i32(ucNode);
+#else
+	// The processor directory holds a link to its node
+	i8 pcPath[FILE_NAME_LEN];
+	for(i32 i=0;i<256;i++)
+	{
+		sprintf(pcPath, "/sys/devices/system/cpu/cpu%u/node%d", uiCPU, i);
+		if(access(pcPath, F_OK) == 0)
+			return i;
+	}
+	return 0;
+#endif
+}
+
+bit SetThreadAffinity(u32 uiCPU)
+{
+#ifdef _MSC_VER
+	if(uiCPU >= sizeof(DWORD_PTR)*8)
+		return false;
+	return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << uiCPU) != 0;
+#elif defined __linux
+	if(uiCPU >= CPU_SETSIZE)
+		return false;
+	cpu_set_t sCPUSet;
+	CPU_ZERO(&sCPUSet);
+	CPU_SET(uiCPU, &sCPUSet);
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &sCPUSet) == 0;
+#else
+	return false;
+#endif
+}
+
+void *AlignedMalloc(u64 u64Size)
+{
+	void *pMem = NULL;
+	u64Size = (u64Size+CACHE_LINE_SIZE-1)/CACHE_LINE_SIZE*CACHE_LINE_SIZE;
+#ifdef _MSC_VER
+	pMem = _aligned_malloc(size_t(u64Size), CACHE_LINE_SIZE);
+#else
+	if(posix_memalign(&pMem, CACHE_LINE_SIZE, size_t(u64Size)) != 0)
+		pMem = NULL;
+#endif
+	MAKE_SURE(pMem != NULL, "Error: Cannot allocate the memory.");
+	return pMem;
+}
+
+void AlignedFree(void *pMem)
+{
+#ifdef _MSC_VER
+	_aligned_free(pMem);
+#else
+	free(pMem);
+#endif
+}
+
+bit SetThreadRealTime(i32 iPriority)
+{
+#ifdef _MSC_VER
+	return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#else
+	struct sched_param sParam;
+	sParam.sched_priority = iPriority;
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &sParam) == 0;
+#endif
 }
\ No newline at end of file
@@ -16,6 +16,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 /**
 * @file WorkQueue.cpp
 * @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
@@ -24,100 +25,398 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "WorkQueue.h"
+#include "WorkStealDeque.h"
 #include "WorkItem.h"
 #include "TypeDefs.h"
+#include "Utilities.h"
+#include <string.h>
+
+static THREAD_LOCAL WorkQueue	*t_pcWorkerQueue = NULL;	//!< Queue the calling thread is a worker of
+static THREAD_LOCAL i32			t_iWorkerIdx = -1;			//!< Worker index within t_pcWorkerQueue
+static THREAD_LOCAL i32			t_iSpinRounds = WORK_SPIN_MIN_ROUNDS;	//!< Rounds the calling thread spins before parking
+
+/**
+*	Raise a maximum shared by several threads.
+*/
+static void AtomicMax(volatile i64 &i64Max, i64 i64Val)
+{
+	i64 i64Old = ATOMIC_LOAD(i64Max);
+	while(i64Val > i64Old && !ATOMIC_CAS(i64Max, i64Old, i64Val))
+		i64Old = ATOMIC_LOAD(i64Max);
+}
 
-WorkQueue::WorkQueue(int iSize)
+WorkQueue::WorkQueue(int iSize, int iNumWorkers)
 {
-	m_iSize = iSize;
-	m_iCurrSize = 0;
-	m_iCurrWriteLoc = 0;
-	m_iCurrReadLoc = 0;
-	m_iPendingJobs = 0;
-	m_ppcWorkItemQueue = new WorkItem*[iSize];
+	m_iNumWorkers = iNumWorkers;
+	m_i64NumRegistered = 0;
+	m_i64MultiNode = 0;
+	m_i64InjectLock = 0;
+	m_i64NumSleepers = 0;
+	m_i64Shutdown = 0;
+	m_i64NumActive = iNumWorkers;
+	m_bMeasureLatency = false;
+
+	// Nobody can publish a job while a single processor spins
+	m_iMaxSpinRounds = GetNumUsableCores() > 1 ? WORK_SPIN_MAX_ROUNDS : WORK_SPIN_MIN_ROUNDS;
+
+	m_pcInjectDeque = new WorkStealDeque(iSize);
+	m_ppcWorkerDeque = new WorkStealDeque*[iNumWorkers];
+	m_pi64WorkerNode = new i64[iNumWorkers];
+	for(i32 i=0;i<iNumWorkers;i++)
+	{
+		m_ppcWorkerDeque[i] = new WorkStealDeque(iSize);
+		m_pi64WorkerNode[i] = 0;
+	}
+	m_psWorkerStats = new WorkerStats_t[iNumWorkers+1];	// Cache line aligned, see CACHE_ALIGNED_NEW
+	memset((void *)m_psWorkerStats, 0, sizeof(WorkerStats_t)*(iNumWorkers+1));
 
 	pthread_mutex_init(&m_ptMutex, NULL);
 	pthread_cond_init(&m_ptJobAvailCond, NULL);
 	pthread_cond_init(&m_ptQueueEmptyCond, NULL);
+	pthread_cond_init(&m_ptUnparkCond, NULL);
 }
 
 WorkQueue::~WorkQueue()
 {
-	delete [] m_ppcWorkItemQueue;
+	for(i32 i=0;i<m_iNumWorkers;i++)
+		delete m_ppcWorkerDeque[i];
+	delete [] m_ppcWorkerDeque;
+	delete [] m_pi64WorkerNode;
+	delete [] m_psWorkerStats;
+	delete m_pcInjectDeque;
 
 	pthread_mutex_destroy(&m_ptMutex);
 	pthread_cond_destroy(&m_ptJobAvailCond);
 	pthread_cond_destroy(&m_ptQueueEmptyCond);
+	pthread_cond_destroy(&m_ptUnparkCond);
 }
 
-int WorkQueue::AddToJob(WorkItem *pcWorkItem)
+int WorkQueue::RegisterWorker(i32 iNode)
 {
-	pthread_mutex_lock(&m_ptMutex);
-	if(m_iCurrSize == m_iSize)	// No space in the queue
+	i32 iWorkerIdx = i32(ATOMIC_FETCH_ADD(m_i64NumRegistered, 1));
+	MAKE_SURE(iWorkerIdx < m_iNumWorkers, "Error: More workers registered than the queue was made for.");
+	ATOMIC_STORE(m_pi64WorkerNode[iWorkerIdx], iNode);
+	if(iNode != 0)
+		ATOMIC_STORE(m_i64MultiNode, 1);
+	t_pcWorkerQueue = this;
+	t_iWorkerIdx = iWorkerIdx;
+	return iWorkerIdx;
+}
+
+i32 WorkQueue::GetWorkerIdx()
+{
+	return t_pcWorkerQueue == this ? t_iWorkerIdx : -1;
+}
+
+void WorkQueue::WakeWorkers(i32 iNumJobs)
+{
+	// The submitter has published the jobs, the sleeper has published itself under the mutex
+	// before looking for jobs. With a barrier in between, at least one of them sees the other.
+	MEMORY_BARRIER();
+	i64 i64Sleepers = ATOMIC_LOAD(m_i64NumSleepers);
+	if(i64Sleepers > 0)
 	{
+		pthread_mutex_lock(&m_ptMutex);
+		if(iNumJobs >= i64Sleepers)
+			pthread_cond_broadcast(&m_ptJobAvailCond);
+		else
+		{
+			for(i32 i=0;i<iNumJobs;i++)
+				pthread_cond_signal(&m_ptJobAvailCond);
+		}
 		pthread_mutex_unlock(&m_ptMutex);
+	}
+}
+
+int WorkQueue::AddJobs(WorkItem **ppcWorkItems, i32 iNumItems)
+{
+	i32 iRet;
+	i32 iWorkerIdx = GetWorkerIdx();
+
+	// Counted before they become visible, so that WaitQueueEmpty() and WaitGroupDone() cannot miss them.
+	// Every thread counts in its own cache line, only the groups are shared
+	WorkerStats_t *psStats = GetWorkerStats(iWorkerIdx);
+	ATOMIC_FETCH_ADD(psStats->i64Submitted, iNumItems);
+	for(i32 i=0;i<iNumItems;)
+	{
+		// Once per run of jobs of the same group
+		volatile i64 *pi64Group = ppcWorkItems[i]->m_pi64Group;
+		i32 iRun = 1;
+		while(i+iRun < iNumItems && ppcWorkItems[i+iRun]->m_pi64Group == pi64Group)
+			iRun++;
+		if(pi64Group)
+			ATOMIC_FETCH_ADD(*pi64Group, iRun);
+		i += iRun;
+	}
+	if(m_bMeasureLatency)
+	{
+		u64 u64Now = GetTimeInMicroSec();
+		for(i32 i=0;i<iNumItems;i++)
+			ppcWorkItems[i]->m_u64SubmitTime = u64Now;
+	}
+
+	if(iWorkerIdx >= 0)	// A worker submits to its own deque
+		iRet = m_ppcWorkerDeque[iWorkerIdx]->PushBatch(ppcWorkItems, iNumItems);
+	else
+	{
+		while(!ATOMIC_CAS(m_i64InjectLock, 0, 1))
+			CPU_RELAX();
+		iRet = m_pcInjectDeque->PushBatch(ppcWorkItems, iNumItems);
+		ATOMIC_CAS(m_i64InjectLock, 1, 0);
+	}
+
+	if(iRet != 0)	// No space in the queue
+	{
+		for(i32 i=0;i<iNumItems;i++)
+			if(ppcWorkItems[i]->m_pi64Group)
+				ATOMIC_FETCH_ADD(*ppcWorkItems[i]->m_pi64Group, -1);
+		ATOMIC_FETCH_ADD(psStats->i64Submitted, -iNumItems);
 		return 1;
 	}
-	else	// Space in the queue available
+
+	// The workers waiting for a group do not take the jobs from outside, so all the sleepers are woken up for them,
+	// as a signal could be used up by such a waiter
+	WakeWorkers(iWorkerIdx >= 0 ? iNumItems : I32_MAX);
+	return 0;
+}
+
+WorkItem *WorkQueue::FindJob(i32 iWorkerIdx, u32 *puiSeed, bit bInjected)
+{
+	WorkItem *pcWorkItem = NULL;
+
+	// Own jobs first, newest first as they are still warm in the cache
+	if(iWorkerIdx >= 0)
+		pcWorkItem = m_ppcWorkerDeque[iWorkerIdx]->Pop();
+
+	// Then the jobs from outside, oldest first
+	if(pcWorkItem == NULL && bInjected)
+		pcWorkItem = m_pcInjectDeque->Steal();
+
+	// Then a random victim and everyone after it, the ones on the own NUMA node first
+	if(pcWorkItem == NULL && m_iNumWorkers > 0)
 	{
-		m_ppcWorkItemQueue[m_iCurrWriteLoc] = pcWorkItem;
-		m_iCurrWriteLoc = (m_iCurrWriteLoc+1) % m_iSize;	// Circular buffer
-		m_iCurrSize++;
-		pthread_cond_signal(&m_ptJobAvailCond);
-		pthread_mutex_unlock(&m_ptMutex);
-		return 0;
+		*puiSeed ^= *puiSeed << 13;
+		*puiSeed ^= *puiSeed >> 17;
+		*puiSeed ^= *puiSeed << 5;
+		i32 iFirstVictim = i32(*puiSeed % u32(m_iNumWorkers));
+		bit bByNode = iWorkerIdx >= 0 && ATOMIC_LOAD(m_i64MultiNode);
+		i64 i64Node = bByNode ? ATOMIC_LOAD(m_pi64WorkerNode[iWorkerIdx]) : 0;
+		for(i32 iPass=bByNode?0:1;iPass<2 && pcWorkItem == NULL;iPass++)
+		{
+			i32 iVictim = iFirstVictim;
+			for(i32 i=0;i<m_iNumWorkers && pcWorkItem == NULL;i++)
+			{
+				if(iVictim != iWorkerIdx && (!bByNode || (ATOMIC_LOAD(m_pi64WorkerNode[iVictim]) == i64Node) == (iPass == 0)))
+					pcWorkItem = m_ppcWorkerDeque[iVictim]->Steal();
+				iVictim = iVictim+1 == m_iNumWorkers ? 0 : iVictim+1;
+			}
+		}
+	}
+	return pcWorkItem;
+}
+
+WorkItem *WorkQueue::SpinForJob(i32 iWorkerIdx, u32 *puiSeed, volatile i64 *pi64Group, bit bInjected)
+{
+	i32 iRounds = t_iSpinRounds;
+	for(i32 i=0;i<iRounds;i++)
+	{
+		WorkItem *pcWorkItem = FindJob(iWorkerIdx, puiSeed, bInjected);
+		if(pcWorkItem)
+		{
+			// Spinning paid off, spin longer next time
+			t_iSpinRounds = min(iRounds*2, m_iMaxSpinRounds);
+			return pcWorkItem;
+		}
+		if(ATOMIC_LOAD(m_i64Shutdown) || (pi64Group && ATOMIC_LOAD(*pi64Group) <= 0) || (!pi64Group && IsParked(iWorkerIdx)))
+			return NULL;
+		CPU_RELAX();
+	}
+
+	// The thread will park anyway, spin shorter next time
+	t_iSpinRounds = max(iRounds/2, WORK_SPIN_MIN_ROUNDS);
+	return NULL;
+}
+
+void WorkQueue::JobStarted(WorkItem *pcWorkItem, i32 iWorkerIdx)
+{
+	WorkerStats_t *psStats = GetWorkerStats(iWorkerIdx);
+	ATOMIC_FETCH_ADD(psStats->i64Jobs, 1);
+	if(m_bMeasureLatency)
+	{
+		i64 i64Latency = i64(GetTimeInMicroSec() - pcWorkItem->m_u64SubmitTime);
+		ATOMIC_FETCH_ADD(psStats->i64StartLatency, i64Latency);
+		AtomicMax(psStats->i64StartLatencyMax, i64Latency);
 	}
 }
 
 WorkItem *WorkQueue::GetNextJob()
 {
-	pthread_mutex_lock(&m_ptMutex);
+	i32 iWorkerIdx = GetWorkerIdx();
+	u32 uiSeed = 2463534242u + u32(iWorkerIdx+1)*2654435761u;
 	WorkItem *pcWorkItem = NULL;
-	while(m_iCurrSize == 0)	// Wait until a job gets available
-		pthread_cond_wait(&m_ptJobAvailCond, &m_ptMutex);
 
-	pcWorkItem = m_ppcWorkItemQueue[m_iCurrReadLoc];
-	m_iCurrReadLoc = (m_iCurrReadLoc+1) % m_iSize;
-	m_iCurrSize--;
+	while(1)
+	{
+		// A parked worker sleeps apart from the idle ones, so that it is not woken up for the jobs
+		if(IsParked(iWorkerIdx))
+		{
+			pthread_mutex_lock(&m_ptMutex);
+			while(IsParked(iWorkerIdx) && !ATOMIC_LOAD(m_i64Shutdown))
+				pthread_cond_wait(&m_ptUnparkCond, &m_ptMutex);
+			pthread_mutex_unlock(&m_ptMutex);
+		}
 
-	MAKE_SURE(m_iCurrSize >= 0, "Error: The thread is spuriously woken-up."); 
+		// Spin for a while, jobs usually arrive in bursts
+		pcWorkItem = SpinForJob(iWorkerIdx, &uiSeed, NULL, true);
+		if(pcWorkItem == NULL && !ATOMIC_LOAD(m_i64Shutdown) && !IsParked(iWorkerIdx))
+		{
+			// Go to sleep
+			pthread_mutex_lock(&m_ptMutex);
+			ATOMIC_FETCH_ADD(m_i64NumSleepers, 1);
+			pcWorkItem = FindJob(iWorkerIdx, &uiSeed, true);
+			while(pcWorkItem == NULL && !ATOMIC_LOAD(m_i64Shutdown) && !IsParked(iWorkerIdx))
+			{
+				ATOMIC_FETCH_ADD(GetWorkerStats(iWorkerIdx)->i64Parks, 1);
+				pthread_cond_wait(&m_ptJobAvailCond, &m_ptMutex);
+				pcWorkItem = FindJob(iWorkerIdx, &uiSeed, true);
+			}
+			ATOMIC_FETCH_ADD(m_i64NumSleepers, -1);
+			pthread_mutex_unlock(&m_ptMutex);
+		}
 
-	pthread_mutex_unlock(&m_ptMutex);
-	return pcWorkItem;
+		if(pcWorkItem)
+		{
+			JobStarted(pcWorkItem, iWorkerIdx);
+			return pcWorkItem;
+		}
+		if(ATOMIC_LOAD(m_i64Shutdown))
+			return NULL;
+	}
 }
 
 int WorkQueue::GetNumJobsInQueue()
 {
-	pthread_mutex_lock(&m_ptMutex);
-	int iWrittenItems = m_iCurrSize;
-	pthread_mutex_unlock(&m_ptMutex);
+	i32 iWrittenItems = m_pcInjectDeque->GetSize();
+	for(i32 i=0;i<m_iNumWorkers;i++)
+		iWrittenItems += m_ppcWorkerDeque[i]->GetSize();
 	return iWrittenItems;
 }
 
-void WorkQueue::IncNumJobsUnderProcess()
+void WorkQueue::JobDone(WorkItem *pcWorkItem)
+{
+	// Once the job is counted as done, its owner may reuse or delete the item, so it is not touched afterwards
+	volatile i64 *pi64Group = pcWorkItem->m_pi64Group;
+	WorkerStats_t *psStats = GetWorkerStats(GetWorkerIdx());
+	if(m_bMeasureLatency)
+	{
+		i64 i64Latency = i64(GetTimeInMicroSec() - pcWorkItem->m_u64SubmitTime);
+		ATOMIC_FETCH_ADD(psStats->i64DoneLatency, i64Latency);
+		AtomicMax(psStats->i64DoneLatencyMax, i64Latency);
+	}
+
+	// Counted before the group, so the waiters woken up by the group see it done
+	ATOMIC_FETCH_ADD(psStats->i64Done, 1);
+
+	// The last job of the queue is also the last one of its group (the groups only count jobs),
+	// so the queue can only become empty here, and jobs without a group are checked every time
+	if(pi64Group == NULL || ATOMIC_FETCH_ADD(*pi64Group, -1) == 1)
+	{
+		// The group waiters sleep on the same condition as the idle workers
+		pthread_mutex_lock(&m_ptMutex);
+		if(pi64Group)
+			pthread_cond_broadcast(&m_ptJobAvailCond);
+		i32 iRetVal = pthread_cond_broadcast(&m_ptQueueEmptyCond);
+		MAKE_SURE(iRetVal == 0, "Error: The conditional variable not set properly");
+		pthread_mutex_unlock(&m_ptMutex);
+	}
+}
+
+i64 WorkQueue::GetPendingJobs()
+{
+	i64 i64Done = 0;
+	i64 i64Submitted = 0;
+	for(i32 i=0;i<=m_iNumWorkers;i++)
+		i64Done += ATOMIC_LOAD(m_psWorkerStats[i].i64Done);
+	for(i32 i=0;i<=m_iNumWorkers;i++)
+		i64Submitted += ATOMIC_LOAD(m_psWorkerStats[i].i64Submitted);
+	return i64Submitted - i64Done;
+}
+
+void WorkQueue::WaitGroupDone(volatile i64 &i64Group, bit bAnyJob)
+{
+	i32 iWorkerIdx = GetWorkerIdx();
+	// The jobs of a worker's group are in the deques of the workers, while a thread which is not a worker
+	// submits its jobs from outside and must be able to take them itself, e.g. without any worker thread
+	bit bInjected = bAnyJob || iWorkerIdx < 0;
+	u32 uiSeed = 88172645u + u32(iWorkerIdx+1)*2654435761u;
+	WorkItem *pcWorkItem;
+
+	while(ATOMIC_LOAD(i64Group) > 0)
+	{
+		// Help with the queued jobs, the ones of the group are likely among them
+		pcWorkItem = SpinForJob(iWorkerIdx, &uiSeed, &i64Group, bInjected);
+
+		if(pcWorkItem == NULL && ATOMIC_LOAD(i64Group) > 0)
+		{
+			// The rest of the group is under process by other threads, sleep like an idle worker
+			pthread_mutex_lock(&m_ptMutex);
+			ATOMIC_FETCH_ADD(m_i64NumSleepers, 1);
+			while(ATOMIC_LOAD(i64Group) > 0 && (pcWorkItem = FindJob(iWorkerIdx, &uiSeed, bInjected)) == NULL)
+			{
+				ATOMIC_FETCH_ADD(GetWorkerStats(iWorkerIdx)->i64Parks, 1);
+				pthread_cond_wait(&m_ptJobAvailCond, &m_ptMutex);
+			}
+			ATOMIC_FETCH_ADD(m_i64NumSleepers, -1);
+			pthread_mutex_unlock(&m_ptMutex);
+		}
+
+		if(pcWorkItem)
+		{
+			JobStarted(pcWorkItem, iWorkerIdx);
+			pcWorkItem->m_pfPtrToFunc(pcWorkItem->m_pArgs);
+			JobDone(pcWorkItem);
+		}
+	}
+}
+
+void WorkQueue::WaitQueueEmpty()
 {
 	pthread_mutex_lock(&m_ptMutex);
-	m_iPendingJobs++;
+	while(GetPendingJobs() > 0)	// Wait for job to finish
+		pthread_cond_wait(&m_ptQueueEmptyCond,&m_ptMutex);
 	pthread_mutex_unlock(&m_ptMutex);
 }
 
-void WorkQueue::JobDone()
+void WorkQueue::GetStats(WorkQueueStats_t &sStats)
 {
-	pthread_mutex_lock(&m_ptMutex);
-	m_iPendingJobs--;
-	if(m_iPendingJobs == 0 && m_iCurrSize == 0)
+	memset(&sStats, 0, sizeof(WorkQueueStats_t));
+	for(i32 i=0;i<=m_iNumWorkers;i++)
 	{
-		i32 iRetVal = pthread_cond_signal(&m_ptQueueEmptyCond);
-		MAKE_SURE(iRetVal == 0, "Error: The conditional variable not set properly");
+		WorkerStats_t *psStats = &m_psWorkerStats[i];
+		sStats.u64Jobs += u64(ATOMIC_LOAD(psStats->i64Jobs));
+		sStats.u64StartLatency += u64(ATOMIC_LOAD(psStats->i64StartLatency));
+		sStats.u64StartLatencyMax = max(sStats.u64StartLatencyMax, u64(ATOMIC_LOAD(psStats->i64StartLatencyMax)));
+		sStats.u64DoneLatency += u64(ATOMIC_LOAD(psStats->i64DoneLatency));
+		sStats.u64DoneLatencyMax = max(sStats.u64DoneLatencyMax, u64(ATOMIC_LOAD(psStats->i64DoneLatencyMax)));
+		sStats.u64Parks += u64(ATOMIC_LOAD(psStats->i64Parks));
 	}
+}
+
+void WorkQueue::SetActiveWorkers(i32 iNumActive)
+{
+	// The sleeping workers are woken up, so that the parked ones move over to the unpark condition
+	pthread_mutex_lock(&m_ptMutex);
+	ATOMIC_STORE(m_i64NumActive, i64(min(max(iNumActive, 0), m_iNumWorkers)));
+	pthread_cond_broadcast(&m_ptJobAvailCond);
+	pthread_cond_broadcast(&m_ptUnparkCond);
 	pthread_mutex_unlock(&m_ptMutex);
 }
 
-void WorkQueue::WaitQueueEmpty()
+void WorkQueue::Shutdown()
 {
-	// \todo Maybe I can insert a conditional wait statement here and get rid of too much testing of this function.
 	pthread_mutex_lock(&m_ptMutex);
-	while(m_iPendingJobs > 0 || m_iCurrSize > 0)	// Wait for job to finish
-		pthread_cond_wait(&m_ptQueueEmptyCond,&m_ptMutex);	// Wait should come before signal pthread
+	ATOMIC_STORE(m_i64Shutdown, 1);
+	pthread_cond_broadcast(&m_ptJobAvailCond);
+	pthread_cond_broadcast(&m_ptUnparkCond);
 	pthread_mutex_unlock(&m_ptMutex);
-}
\ No newline at end of file
+}
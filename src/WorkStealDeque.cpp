@@ -0,0 +1,102 @@
+/*
+CES265, a multi-threaded HEVC encoder.
+Copyright (C) 2013-2014, CES265 project.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+* @file WorkStealDeque.cpp
+* @author Muhammad Usman Karim Khan, Muhammad Shafique, Joerg Henkel (CES, KIT)
+* @brief This file contains the methods in WorkStealDeque class.
+*/
+
+#include "WorkStealDeque.h"
+#include "WorkItem.h"
+#include "TypeDefs.h"
+
+WorkStealDeque::WorkStealDeque(i32 iSize)
+{
+	i64 i64Capacity = 1;
+	while(i64Capacity < iSize)
+		i64Capacity <<= 1;
+	m_i64Mask = i64Capacity-1;
+	m_i64Top = 0;
+	m_i64Bottom = 0;
+	m_ppcBuffer = new WorkItem*[i64Capacity];
+}
+
+WorkStealDeque::~WorkStealDeque()
+{
+	delete [] m_ppcBuffer;
+}
+
+i32 WorkStealDeque::PushBatch(WorkItem **ppcWorkItems, i32 iNumItems)
+{
+	i64 i64Bottom = ATOMIC_LOAD(m_i64Bottom);
+	i64 i64Top = ATOMIC_LOAD(m_i64Top);
+	if(i64Bottom - i64Top + iNumItems > m_i64Mask+1)	// No space in the deque
+		return 1;
+
+	for(i32 i=0;i<iNumItems;i++)
+		m_ppcBuffer[(i64Bottom+i) & m_i64Mask] = ppcWorkItems[i];
+	ATOMIC_STORE(m_i64Bottom, i64Bottom+iNumItems);	// Publishes the items
+	return 0;
+}
+
+WorkItem *WorkStealDeque::Pop()
+{
+	// Reserve the bottom item before looking at the top
+	i64 i64Bottom = ATOMIC_LOAD(m_i64Bottom)-1;
+	ATOMIC_STORE(m_i64Bottom, i64Bottom);
+	i64 i64Top = ATOMIC_LOAD(m_i64Top);
+
+	if(i64Top > i64Bottom)	// Empty
+	{
+		ATOMIC_STORE(m_i64Bottom, i64Top);
+		return NULL;
+	}
+
+	WorkItem *pcWorkItem = m_ppcBuffer[i64Bottom & m_i64Mask];
+	if(i64Top == i64Bottom)	// Last item, race against the thieves
+	{
+		if(!ATOMIC_CAS(m_i64Top, i64Top, i64Top+1))
+			pcWorkItem = NULL;
+		ATOMIC_STORE(m_i64Bottom, i64Top+1);
+	}
+	return pcWorkItem;
+}
+
+WorkItem *WorkStealDeque::Steal()
+{
+	while(1)
+	{
+		i64 i64Top = ATOMIC_LOAD(m_i64Top);
+		i64 i64Bottom = ATOMIC_LOAD(m_i64Bottom);
+		if(i64Top >= i64Bottom)	// Empty
+			return NULL;
+
+		WorkItem *pcWorkItem = m_ppcBuffer[i64Top & m_i64Mask];
+		if(ATOMIC_CAS(m_i64Top, i64Top, i64Top+1))
+			return pcWorkItem;
+		// Lost against another thief or the owner, try again
+	}
+}
+
+i32 WorkStealDeque::GetSize()
+{
+	i64 i64Size = ATOMIC_LOAD(m_i64Bottom) - ATOMIC_LOAD(m_i64Top);
+	return i64Size > 0 ? i32(i64Size) : 0;
+}